@@ -0,0 +1,346 @@
+#include "Helper/Log.h"
+#include <sstream>
+
+#include <Rendering/GlfwManager.h>
+#include <Rendering/Vulkan/VulkanRenderer.h>
+
+#include <Helper/FPSCounter.h>
+#include <Helper/Profiler.h>
+#include <Helper/PerfCounters.h>
+#include <Helper/Timer.h>
+#include <Scene/Scene.h>
+#include "Asset/AssetManager.h"
+#include <Game/Setting.h>
+#include <Helper/PerformanceBaseline.h>
+#include <Rendering/Vulkan/VulkanFrameCapture.h>
+#include <glm/gtc/constants.hpp>
+#include <json.hpp>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+// Stress scene generated from a seed and a camera path driven by the frame index,
+// the same settings render the same frames on every run so the results can be compared between builds.
+// With BenchmarkReplay set to a frame capture, the captured frame is rendered again and again instead.
+
+struct BenchmarkScene
+{
+	std::string name;
+	uint32_t objectCount = 0;
+	float fieldSize = 0; // Side of the square the objects are spread on
+};
+
+// Every value of the report in millisecond
+nlohmann::json MakeTimeReport(std::vector<float> times)
+{
+	nlohmann::json report;
+	if (times.empty())
+		return report;
+
+	std::sort(times.begin(), times.end());
+	auto percentile = [&times](float p) { return times[std::min(static_cast<size_t>(p * times.size()), times.size() - 1)]; };
+
+	double totalTime = 0;
+	for (float time : times)
+		totalTime += time;
+
+	report["Samples"] = times.size();
+	report["Average"] = totalTime / times.size();
+	report["P50"] = percentile(0.50f);
+	report["P95"] = percentile(0.95f);
+	report["P99"] = percentile(0.99f);
+	report["Max"] = times.back();
+
+	return report;
+}
+
+// Write the scene file so it's loaded by the same path than the scenes of the game
+BenchmarkScene GenerateScene()
+{
+	BenchmarkScene benchmarkScene;
+	benchmarkScene.name = Setting::Get("BenchmarkScene", "Benchmark").get<std::string>();
+	benchmarkScene.objectCount = Setting::Get("BenchmarkObjectCount", 10000).get<uint32_t>();
+
+	std::vector<std::string> meshes = Setting::Get("BenchmarkMeshes", { "Barrel", "MultiCube", "Plane" }).get<std::vector<std::string>>();
+	std::vector<std::string> textures = Setting::Get("BenchmarkTextures", { "Barrel.png", "Checker.jpg", "CubeTexture.png", "Debug.jpg", "texture.jpg" }).get<std::vector<std::string>>();
+	float spacing = Setting::Get("BenchmarkSpacing", 3.0f).get<float>();
+	float staticRatio = Setting::Get("BenchmarkStaticRatio", 0.9f).get<float>();
+
+	if (meshes.empty() || textures.empty())
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "The benchmark needs at least one mesh and one texture");
+		return benchmarkScene;
+	}
+
+	// std::mt19937 gives the same sequence everywhere, the distributions are only used on it for floats
+	std::mt19937 random(Setting::Get("BenchmarkSeed", 1).get<uint32_t>());
+	auto randomFloat = [&random](float min, float max) { return min + (max - min) * (random() / static_cast<float>(std::mt19937::max())); };
+
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(benchmarkScene.objectCount))));
+	benchmarkScene.fieldSize = side * spacing;
+
+	nlohmann::json sceneObjects = nlohmann::json::array();
+	for (uint32_t i = 0; i < benchmarkScene.objectCount; i++)
+	{
+		glm::vec2 cell = (glm::vec2(i % side, i / side) - glm::vec2(side * 0.5f)) * spacing;
+		float scale = randomFloat(0.5f, 1.5f);
+
+		nlohmann::json sceneObject;
+		sceneObject["ClassType"] = "SceneModel";
+		sceneObject["ID"] = i + 1;
+		sceneObject["Name"] = "Object" + std::to_string(i);
+		sceneObject["Model"]["Mesh"] = meshes[random() % meshes.size()];
+		sceneObject["Model"]["Texture"] = textures[random() % textures.size()];
+		sceneObject["Model"]["ModelSaved"] = true;
+		sceneObject["Model"]["Static"] = randomFloat(0, 1) < staticRatio;
+		sceneObject["Transform"]["position"] = { { "x", cell.x + randomFloat(-0.25f, 0.25f) * spacing }, { "y", cell.y + randomFloat(-0.25f, 0.25f) * spacing }, { "z", randomFloat(0, 2.0f) } };
+		sceneObject["Transform"]["rotation"] = { { "x", 0.0f }, { "y", 0.0f }, { "z", randomFloat(0, 360.0f) } };
+		sceneObject["Transform"]["scale"] = { { "x", scale }, { "y", scale }, { "z", scale } };
+
+		sceneObjects.push_back(sceneObject);
+	}
+
+	nlohmann::json scene;
+	scene["Scene"]["IDCounter"] = benchmarkScene.objectCount + 1;
+	scene["Scene"]["DepthPrepass"] = Setting::Get("BenchmarkDepthPrepass", true).get<bool>();
+	scene["Scene"]["SceneObject"] = sceneObjects;
+
+	std::ofstream output(Scene::PATH + benchmarkScene.name + ".json");
+	output << scene;
+
+	return benchmarkScene;
+}
+
+// Loop around the field at a changing radius and height, looking at the ground a bit ahead
+void PlaceCamera(VulkanRenderer* renderer, const BenchmarkScene& benchmarkScene, uint32_t frame, uint32_t frameCount)
+{
+	auto pathPosition = [&benchmarkScene](float t)
+	{
+		float radius = benchmarkScene.fieldSize * (0.3f + 0.15f * std::sin(t * glm::two_pi<float>() * 2.0f));
+		float height = 10.0f + 5.0f * std::sin(t * glm::two_pi<float>() * 3.0f);
+		return glm::vec3(std::cos(t * glm::two_pi<float>()) * radius, std::sin(t * glm::two_pi<float>()) * radius, height);
+	};
+
+	float t = frame / static_cast<float>(std::max(frameCount, 1u));
+	glm::vec3 ahead = pathPosition(t + 0.02f);
+
+	renderer->camPos = pathPosition(t);
+	renderer->camDir = glm::normalize(glm::vec3(ahead.x, ahead.y, 0) - renderer->camPos);
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		Logger::Open("BenchmarkLog");
+		PROFILE_THREAD("Main");
+		Setting::Load();
+		Setting::ReadArguments(argc, argv);
+		AssetManager::Init();
+
+		bool headless = Setting::Get("BenchmarkHeadless", false).get<bool>();
+		uint32_t warmupFrameCount = Setting::Get("BenchmarkWarmupFrames", 60).get<uint32_t>();
+		uint32_t frameCount = Setting::Get("BenchmarkFrames", 1000).get<uint32_t>();
+		std::string replayPath = Setting::Get("BenchmarkReplay", "").get<std::string>();
+
+		std::unique_ptr<VulkanFrameCapture> capture;
+		VkExtent2D extent = { 1600, 900 };
+		if (!replayPath.empty())
+		{
+			capture = VulkanFrameCapture::Load(replayPath);
+			if (capture == nullptr)
+				Logger::Log(LogSeverity::FATAL_ERROR, "Can't replay " + replayPath);
+
+			// Rendered at the captured extent, a resized window can still change it
+			extent = capture->GetExtent();
+			Setting::Add("HeadlessWidth", extent.width);
+			Setting::Add("HeadlessHeight", extent.height);
+		}
+
+		// No window nor GLFW in headless mode
+		std::unique_ptr<GlfwManager> glfwManager;
+		if (!headless)
+			glfwManager = std::unique_ptr<GlfwManager>(new GlfwManager(extent.width, extent.height, "EmyBenchmark"));
+
+		std::unique_ptr<VulkanRenderer> renderer = std::unique_ptr<VulkanRenderer>(new VulkanRenderer(headless ? nullptr : glfwManager->GetWindow()));
+
+		Timer loadTimer;
+		loadTimer.Start();
+		BenchmarkScene benchmarkScene;
+		// Declared after the renderer so its models are destroyed first
+		std::unique_ptr<Scene> scene;
+		if (capture != nullptr)
+		{
+			benchmarkScene.name = std::filesystem::path(replayPath).stem().string();
+			benchmarkScene.objectCount = static_cast<uint32_t>(capture->GetModelCount());
+			capture->LoadModels(renderer.get());
+		}
+		else
+		{
+			benchmarkScene = GenerateScene();
+			scene = std::unique_ptr<Scene>(new Scene(benchmarkScene.name));
+		}
+		double loadTime = loadTimer.Stop();
+
+		std::vector<float> gpuFrameTimes;
+		double drawnModels = 0;
+		double occludedModels = 0;
+		double softwareOccludedModels = 0;
+		uint32_t measuredFrameCount = 0;
+
+		for (uint32_t frame = 0; frame < warmupFrameCount + frameCount; frame++)
+		{
+			if (!headless && glfwWindowShouldClose(glfwManager->GetWindow()))
+				break;
+
+			// The first frames compile the pipelines and fill the caches
+			if (frame == warmupFrameCount)
+			{
+				FPSCounter::Reset();
+				PerfCounters::Reset();
+			}
+
+			PROFILE_FRAME();
+			PROFILE_SCOPE("Frame");
+			FPSCounter::StartCounting();
+
+			if (!headless)
+			{
+				glfwPollEvents();
+				renderer->GetImgui()->StartFrame();
+			}
+
+			if (capture != nullptr)
+			{
+				capture->Apply(renderer.get());
+			}
+			else
+			{
+				PlaceCamera(renderer.get(), benchmarkScene, frame >= warmupFrameCount ? frame - warmupFrameCount : 0, frameCount);
+				scene->Update();
+			}
+
+			if (!headless)
+				renderer->GetImgui()->EndFrame();
+
+			renderer->Present(glfwManager.get());
+
+			FPSCounter::StopCounting();
+
+			if (frame < warmupFrameCount)
+				continue;
+
+			// Read at the start of Present once the fence of the frame slot signaled, so they are the ones of MAX_FRAMES_IN_FLIGHT frames before
+			const VulkanGpuProfiler* gpuProfiler = renderer->GetGpuProfiler();
+			if (gpuProfiler->IsEnabled())
+				gpuFrameTimes.push_back(static_cast<float>(gpuProfiler->GetFrameTime()));
+
+			uint32_t modelCount = static_cast<uint32_t>(renderer->GetDrawList().GetSize());
+			uint32_t occludedCount = renderer->GetOccludedModelCount();
+			uint32_t softwareOccludedCount = renderer->GetSoftwareOccludedModelCount();
+			drawnModels += modelCount - std::min(occludedCount + softwareOccludedCount, modelCount);
+			occludedModels += occludedCount;
+			softwareOccludedModels += softwareOccludedCount;
+			measuredFrameCount++;
+		}
+
+		renderer->WaitForIdle();
+
+		nlohmann::json report;
+		report["Device"] = renderer->GetPhysicalDevice()->GetProperties().deviceName;
+		report["Headless"] = headless;
+		report["Resolution"] = { renderer->GetSwapChain()->GetVkExtent2D().width, renderer->GetSwapChain()->GetVkExtent2D().height };
+		if (capture != nullptr)
+		{
+			report["Replay"] = replayPath;
+			report["LightCount"] = capture->GetLightCount();
+		}
+		else
+		{
+			report["Seed"] = Setting::Get("BenchmarkSeed", 1);
+		}
+		report["ObjectCount"] = benchmarkScene.objectCount;
+		report["WarmupFrames"] = warmupFrameCount;
+		report["Frames"] = measuredFrameCount;
+		report["LoadTime"] = loadTime;
+
+		FPSCounter::FrameTimeStats frameStats = FPSCounter::GetFrameTimeStats();
+		report["CpuFrame"] = MakeTimeReport(FPSCounter::GetFrameTimes(measuredFrameCount));
+		report["CpuFrame"]["OnePercentLowFPS"] = frameStats.onePercentLowFPS;
+		report["CpuFrame"]["Spikes"] = FPSCounter::GetSpikeCount();
+		report["GpuFrame"] = MakeTimeReport(gpuFrameTimes);
+
+		if (measuredFrameCount > 0)
+		{
+			report["Draw"]["Models"] = renderer->GetDrawList().GetSize();
+			report["Draw"]["AverageDrawnModels"] = drawnModels / measuredFrameCount;
+			report["Draw"]["AverageOccludedModels"] = occludedModels / measuredFrameCount;
+			report["Draw"]["AverageSoftwareOccludedModels"] = softwareOccludedModels / measuredFrameCount;
+		}
+		report["Draw"]["RenderGraphPasses"] = renderer->GetRenderGraph()->GetPassCount();
+
+		// Work done per frame, over the last measured frames the history keeps
+		report["Counters"] = PerfCounters::ToJson(measuredFrameCount);
+
+		// What the load and the streaming uploaded and still hold
+		const VulkanMemoryTracker* memoryTracker = renderer->GetMemoryTracker();
+		for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::COUNT); i++)
+		{
+			MemoryCategory category = static_cast<MemoryCategory>(i);
+			report["Memory"][VulkanMemoryTracker::GetCategoryName(category)] = { { "Bytes", memoryTracker->GetCategoryUsage(category) }, { "Allocations", memoryTracker->GetCategoryAllocationCount(category) } };
+		}
+		report["Memory"]["Evictions"] = memoryTracker->GetEvictionCount();
+
+		const TextureStreamer* textureStreamer = renderer->GetTextureStreamer();
+		if (textureStreamer != nullptr)
+		{
+			report["TextureStreaming"]["UsedBytes"] = textureStreamer->GetUsedBytes();
+			report["TextureStreaming"]["Evictions"] = textureStreamer->GetEvictionCount();
+		}
+
+		std::string outputPath = Setting::Get("BenchmarkOutput", "BenchmarkResults.json").get<std::string>();
+		std::ofstream output(outputPath);
+		output << std::setw(4) << report;
+
+		std::stringstream ss;
+		ss << "Benchmark of " << benchmarkScene.objectCount << " objects over " << measuredFrameCount << " frames, CPU p50: " << frameStats.p50 << " ms, p99: " << frameStats.p99 << " ms, written to " << outputPath;
+		Logger::Log(ss.str());
+
+		// Frames measured on another device or scene can't be compared
+		nlohmann::json context;
+		context["Device"] = report["Device"];
+		context["Headless"] = headless;
+		context["Resolution"] = report["Resolution"];
+		context["ObjectCount"] = benchmarkScene.objectCount;
+		if (capture != nullptr)
+		{
+			context["Replay"] = replayPath;
+			context["LightCount"] = report["LightCount"];
+		}
+		else
+		{
+			context["Seed"] = report["Seed"];
+			context["Meshes"] = Setting::Get("BenchmarkMeshes", nlohmann::json());
+			context["Textures"] = Setting::Get("BenchmarkTextures", nlohmann::json());
+		}
+
+		PerformanceBaseline::Samples samples;
+		for (float frameTime : FPSCounter::GetFrameTimes(measuredFrameCount))
+			samples["CpuFrame"].push_back(frameTime);
+		samples["GpuFrame"] = std::vector<double>(gpuFrameTimes.begin(), gpuFrameTimes.end());
+
+		if (!PerformanceBaseline::Check(benchmarkScene.name, samples, context))
+			return 2;
+	}
+	catch (const std::exception& e)
+	{
+		Logger::Log(LogSeverity::ERROR, e.what());
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,444 @@
+#include "Helper/Log.h"
+#include <sstream>
+
+#include <Helper/Timer.h>
+#include <Rendering/Mesh.h>
+#include <Rendering/SoftwareOcclusion.h>
+#include <Scene/Scene.h>
+#include "Asset/Asset.h"
+#include "Asset/MeshAsset.h"
+#include <Game/Setting.h>
+#include <Helper/PerformanceBaseline.h>
+#include <stb_image.h>
+#include <stb_image_write.h>
+#include <json.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <fstream>
+#include <iomanip>
+#include <functional>
+#include <filesystem>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+// Microbenchmarks of the loaders, the serialization and the software occlusion, nothing here creates a renderer so it runs without GPU.
+// The inputs are generated from a fixed seed and removed at the end, only the results file stays.
+
+struct BenchmarkOptions
+{
+	uint32_t warmupIterations = 3;
+	uint32_t minIterations = 10;
+	uint32_t maxIterations = 1000;
+	double minTime = 500; // Millisecond spent measuring each benchmark, once minIterations are done
+	std::string filter; // Only the benchmarks whose name contains it run
+};
+
+BenchmarkOptions options;
+nlohmann::json results = nlohmann::json::array();
+PerformanceBaseline::Samples samples;
+std::vector<std::string> generatedFiles;
+
+// Written by the benchmarks so the work they measure can't be optimized away
+volatile uint64_t sink = 0;
+
+/// <summary>
+/// Time the function until it ran minIterations times and minTime passed, the report is per call.
+/// </summary>
+/// <param name="itemCount">Work done by one call, gives the time per item for the fast functions called in a loop</param>
+void Run(const std::string& name, uint64_t itemCount, const std::function<void()>& function)
+{
+	if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+		return;
+
+	for (uint32_t i = 0; i < options.warmupIterations; i++)
+		function();
+
+	std::vector<double> times;
+	Timer totalTimer;
+	totalTimer.Start();
+
+	while (times.size() < options.maxIterations && (times.size() < options.minIterations || totalTimer.PeekTime() < options.minTime))
+	{
+		Timer timer;
+		timer.Start();
+		function();
+		times.push_back(timer.Stop());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	double totalTime = 0;
+	for (double time : times)
+		totalTime += time;
+	double mean = totalTime / times.size();
+
+	double variance = 0;
+	for (double time : times)
+		variance += (time - mean) * (time - mean);
+
+	double median = times[times.size() / 2];
+
+	nlohmann::json result;
+	result["Name"] = name;
+	result["Iterations"] = times.size();
+	result["Items"] = itemCount;
+	result["Min"] = times.front();
+	result["Median"] = median;
+	result["Mean"] = mean;
+	result["Max"] = times.back();
+	result["StdDev"] = std::sqrt(variance / times.size());
+	result["ItemsPerSecond"] = median > 0 ? itemCount * 1000.0 / median : 0.0;
+	results.push_back(result);
+	samples[name] = times;
+
+	std::stringstream ss;
+	ss << name << ": " << median << " ms median over " << times.size() << " iterations";
+	Logger::Log(ss.str());
+}
+
+// Square grid of side * side quads with a wave so the normals and tangents aren't all the same
+void WriteGridObj(const std::string& path, uint32_t side)
+{
+	std::ofstream output(path);
+
+	for (uint32_t y = 0; y <= side; y++)
+	{
+		for (uint32_t x = 0; x <= side; x++)
+		{
+			float u = x / static_cast<float>(side);
+			float v = y / static_cast<float>(side);
+			float height = 0.1f * std::sin(u * 20.0f) * std::cos(v * 20.0f);
+
+			output << "v " << u << " " << v << " " << height << "\n";
+			output << "vt " << u << " " << v << "\n";
+			output << "vn " << -2.0f * std::cos(u * 20.0f) * std::cos(v * 20.0f) << " " << 2.0f * std::sin(u * 20.0f) * std::sin(v * 20.0f) << " 1\n";
+		}
+	}
+
+	// OBJ indices start at 1, the position, uv and normal of a corner share the same index
+	for (uint32_t y = 0; y < side; y++)
+	{
+		for (uint32_t x = 0; x < side; x++)
+		{
+			uint32_t corner = y * (side + 1) + x + 1;
+			uint32_t right = corner + 1;
+			uint32_t up = corner + side + 1;
+			uint32_t upRight = up + 1;
+
+			output << "f " << corner << "/" << corner << "/" << corner << " " << right << "/" << right << "/" << right << " " << upRight << "/" << upRight << "/" << upRight << "\n";
+			output << "f " << corner << "/" << corner << "/" << corner << " " << upRight << "/" << upRight << "/" << upRight << " " << up << "/" << up << "/" << up << "\n";
+		}
+	}
+
+	generatedFiles.push_back(path);
+}
+
+// Gradient with noise, close to a photo for the compression instead of a flat color
+std::vector<uint8_t> MakeImage(uint32_t size, std::mt19937& random)
+{
+	std::vector<uint8_t> pixels(size * size * 4);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			uint8_t* pixel = &pixels[(y * size + x) * 4];
+			pixel[0] = static_cast<uint8_t>((x * 255 / size + random() % 32) & 0xFF);
+			pixel[1] = static_cast<uint8_t>((y * 255 / size + random() % 32) & 0xFF);
+			pixel[2] = static_cast<uint8_t>(((x + y) * 127 / size + random() % 32) & 0xFF);
+			pixel[3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+void WriteScene(const std::string& name, uint32_t objectCount, std::mt19937& random)
+{
+	auto randomFloat = [&random](float min, float max) { return min + (max - min) * (random() / static_cast<float>(std::mt19937::max())); };
+
+	nlohmann::json sceneObjects = nlohmann::json::array();
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		nlohmann::json sceneObject;
+		sceneObject["ID"] = i + 1;
+		sceneObject["Name"] = "Object" + std::to_string(i);
+		sceneObject["Transform"]["position"] = { { "x", randomFloat(-100, 100) }, { "y", randomFloat(-100, 100) }, { "z", randomFloat(0, 10) } };
+		sceneObject["Transform"]["rotation"] = { { "x", 0.0f }, { "y", 0.0f }, { "z", randomFloat(0, 360) } };
+		sceneObject["Transform"]["scale"] = { { "x", 1.0f }, { "y", 1.0f }, { "z", 1.0f } };
+
+		// Models need the renderer, lights are the objects with the most data that load without it
+		if (i % 2 == 0)
+		{
+			sceneObject["ClassType"] = "SceneObject";
+		}
+		else
+		{
+			sceneObject["ClassType"] = "SceneLight";
+			sceneObject["Light"] = { { "Color", { randomFloat(0, 1), randomFloat(0, 1), randomFloat(0, 1) } }, { "Intensity", randomFloat(1, 20) }, { "Range", randomFloat(1, 20) }, { "Spot", i % 4 == 1 }, { "ConeAngle", 35.0f } };
+		}
+
+		sceneObjects.push_back(sceneObject);
+	}
+
+	nlohmann::json scene;
+	scene["Scene"]["IDCounter"] = objectCount + 1;
+	scene["Scene"]["SceneObject"] = sceneObjects;
+
+	std::string path = Scene::PATH + name + ".json";
+	std::ofstream output(path);
+	output << scene;
+
+	generatedFiles.push_back(path);
+}
+
+void RunMeshBenchmarks()
+{
+	for (uint32_t side : Setting::Get("MicroBenchmarkObjSides", { 16, 256 }).get<std::vector<uint32_t>>())
+	{
+		std::string meshName = "MicroBenchmarkGrid" + std::to_string(side);
+		WriteGridObj("Assets/Meshs/" + meshName + ".obj", side);
+		uint64_t triangleCount = 2ull * side * side;
+
+		Run("Mesh/ObjLoader/" + std::to_string(triangleCount) + " triangles", triangleCount, [&meshName]()
+		{
+			sink += Mesh::LoadVertices(meshName + ".obj", Mesh::MeshFormat::OBJ)->GetVertexCount();
+		});
+
+		std::unique_ptr<Mesh> mesh = Mesh::LoadVertices(meshName + ".obj", Mesh::MeshFormat::OBJ);
+		Run("Mesh/ComputeTangents/" + std::to_string(triangleCount) + " triangles", triangleCount, [&mesh]()
+		{
+			mesh->ComputeTangents();
+		});
+	}
+}
+
+void RunTextureBenchmarks(std::mt19937& random)
+{
+	uint32_t size = Setting::Get("MicroBenchmarkTextureSize", 1024).get<uint32_t>();
+	std::vector<uint8_t> pixels = MakeImage(size, random);
+
+	std::string pngPath = "Assets/Textures/MicroBenchmark.png";
+	std::string jpgPath = "Assets/Textures/MicroBenchmark.jpg";
+	stbi_write_png(pngPath.c_str(), size, size, 4, pixels.data(), size * 4);
+	stbi_write_jpg(jpgPath.c_str(), size, size, 4, pixels.data(), 90);
+	generatedFiles.push_back(pngPath);
+	generatedFiles.push_back(jpgPath);
+
+	// Same request than Texture, decoded to RGBA
+	for (const std::string& path : { pngPath, jpgPath })
+	{
+		std::string extension = std::filesystem::path(path).extension().string();
+		Run("Texture/stbi_load/" + extension.substr(1) + " " + std::to_string(size) + "x" + std::to_string(size), static_cast<uint64_t>(size) * size, [&path]()
+		{
+			int width, height, channels;
+			stbi_uc* data = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+			if (data == nullptr)
+				Logger::Log(LogSeverity::FATAL_ERROR, "Failed to decode " + path);
+
+			sink += data[0];
+			stbi_image_free(data);
+		});
+	}
+}
+
+void RunSceneBenchmarks(std::mt19937& random)
+{
+	for (uint32_t objectCount : Setting::Get("MicroBenchmarkSceneSizes", { 100, 1000, 10000 }).get<std::vector<uint32_t>>())
+	{
+		std::string sceneName = "MicroBenchmark" + std::to_string(objectCount);
+		WriteScene(sceneName, objectCount, random);
+
+		Run("Scene/Load/" + std::to_string(objectCount) + " objects", objectCount, [&sceneName]()
+		{
+			std::unique_ptr<Scene> scene = std::unique_ptr<Scene>(new Scene(sceneName));
+			sink += scene->GetRootSceneObjectSize();
+		});
+
+		// Saved over the generated file, it loads the same
+		std::unique_ptr<Scene> scene = std::unique_ptr<Scene>(new Scene(sceneName));
+		Run("Scene/Save/" + std::to_string(objectCount) + " objects", objectCount, [&scene]()
+		{
+			scene->Save();
+		});
+	}
+}
+
+// Boxes of a fixed grid seen from above and a ground box crossing the near plane, every triangle counter clockwise from the outside
+void RenderOcclusionScene(SoftwareOcclusion& softwareOcclusion)
+{
+	static const std::vector<glm::vec3> boxVertices = {
+		{ -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+		{ -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 } };
+	static const std::vector<uint32_t> boxIndices = {
+		0, 2, 1, 0, 3, 2, // -z
+		4, 5, 6, 4, 6, 7, // +z
+		0, 1, 5, 0, 5, 4, // -y
+		2, 3, 7, 2, 7, 6, // +y
+		1, 2, 6, 1, 6, 5, // +x
+		3, 0, 4, 3, 4, 7 }; // -x
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	projection[1][1] *= -1;
+	glm::mat4 view = glm::lookAt(glm::vec3(0, -30, 15), glm::vec3(0, 0, 0), glm::vec3(0, 0, 1));
+	softwareOcclusion.Begin(projection * view);
+
+	for (int x = -4; x <= 4; x++)
+	{
+		for (int y = -4; y <= 4; y++)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(1), glm::vec3(x * 4.0f, y * 4.0f, (x + y) % 3));
+			model = glm::rotate(model, glm::radians(10.0f * x + 25.0f * y), glm::vec3(0.3f, 0.2f, 1.0f));
+			model = glm::scale(model, glm::vec3(1.0f + 0.1f * (x & 3), 1.0f, 0.5f + 0.2f * (y & 3)));
+			softwareOcclusion.AddOccluder(model, boxVertices, boxIndices);
+		}
+	}
+
+	softwareOcclusion.AddOccluder(glm::scale(glm::translate(glm::mat4(1), glm::vec3(0, -20, -2)), glm::vec3(40, 40, 1)), boxVertices, boxIndices);
+	softwareOcclusion.Rasterize();
+}
+
+void RunSoftwareOcclusionBenchmarks()
+{
+	const uint32_t width = 256;
+	const uint32_t height = 144;
+
+	SoftwareOcclusion scalar(width, height);
+	scalar.SetAvx2(false);
+	SoftwareOcclusion avx2(width, height);
+
+	// The AVX2 path steps its edges by blocks, only the pixels on the edges of the triangles can round differently
+	RenderOcclusionScene(scalar);
+	if (avx2.IsUsingAvx2())
+	{
+		RenderOcclusionScene(avx2);
+
+		uint32_t coveredCount = 0;
+		uint32_t differentCount = 0;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				coveredCount += scalar.GetDepth(x, y) < 1.0f;
+				differentCount += std::abs(scalar.GetDepth(x, y) - avx2.GetDepth(x, y)) > 0.0001f;
+			}
+		}
+
+		if (coveredCount == 0 || differentCount > width * height / 1000)
+			Logger::Log(LogSeverity::FATAL_ERROR, "The AVX2 and scalar software occlusion depths differ on " + std::to_string(differentCount) + " pixels, " + std::to_string(coveredCount) + " are covered");
+	}
+	else
+		Logger::Log(LogSeverity::WARNING, "No AVX2, the software occlusion paths aren't compared");
+
+	uint64_t triangleCount = scalar.GetTriangleCount();
+	Run("SoftwareOcclusion/Rasterize scalar/" + std::to_string(triangleCount) + " triangles", triangleCount, [&scalar]()
+	{
+		RenderOcclusionScene(scalar);
+		sink += static_cast<uint64_t>(scalar.GetDepth(0, 0));
+	});
+
+	if (avx2.IsUsingAvx2())
+	{
+		Run("SoftwareOcclusion/Rasterize AVX2/" + std::to_string(triangleCount) + " triangles", triangleCount, [&avx2]()
+		{
+			RenderOcclusionScene(avx2);
+			sink += static_cast<uint64_t>(avx2.GetDepth(0, 0));
+		});
+	}
+}
+
+void RunAssetBenchmarks()
+{
+	const uint32_t loadCount = 100;
+
+	std::shared_ptr<Asset> asset = Asset::Create<MeshAsset>();
+	asset->name = "MicroBenchmark";
+	asset->WriteToFile();
+	generatedFiles.push_back("Assets/TempAssetFolder/MicroBenchmark.json");
+
+	Run("Asset/LoadByType", loadCount, [loadCount]()
+	{
+		for (uint32_t i = 0; i < loadCount; i++)
+			sink += Asset::LoadByType("MicroBenchmark")->GetID();
+	});
+}
+
+void RunSettingBenchmarks()
+{
+	const uint32_t accessCount = 10000;
+
+	Setting::Add("MicroBenchmarkValue", 1.0f);
+	Setting::Add("MicroBenchmarkArray", { 1, 2, 3, 4, 5, 6, 7, 8 });
+
+	// The game reads its settings by name every time, there is no cached value
+	Run("Setting/Get float", accessCount, [accessCount]()
+	{
+		for (uint32_t i = 0; i < accessCount; i++)
+			sink += static_cast<uint64_t>(Setting::Get("MicroBenchmarkValue", 0.0f).get<float>());
+	});
+
+	Run("Setting/Get array", accessCount, [accessCount]()
+	{
+		for (uint32_t i = 0; i < accessCount; i++)
+			sink += Setting::Get("MicroBenchmarkArray", nlohmann::json::array()).size();
+	});
+
+	Run("Setting/Add", accessCount, [accessCount]()
+	{
+		for (uint32_t i = 0; i < accessCount; i++)
+			Setting::Add("MicroBenchmarkValue", static_cast<float>(i));
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		Logger::Open("MicroBenchmarkLog");
+		Setting::Load();
+		Setting::ReadArguments(argc, argv);
+
+		options.warmupIterations = Setting::Get("MicroBenchmarkWarmupIterations", options.warmupIterations).get<uint32_t>();
+		options.minIterations = Setting::Get("MicroBenchmarkMinIterations", options.minIterations).get<uint32_t>();
+		options.maxIterations = std::max(Setting::Get("MicroBenchmarkMaxIterations", options.maxIterations).get<uint32_t>(), 1u);
+		options.minTime = Setting::Get("MicroBenchmarkMinTime", options.minTime).get<double>();
+		options.filter = Setting::Get("MicroBenchmarkFilter", "").get<std::string>();
+
+		// The generated inputs only depend on the seed
+		std::mt19937 random(Setting::Get("MicroBenchmarkSeed", 1).get<uint32_t>());
+
+		RunMeshBenchmarks();
+		RunTextureBenchmarks(random);
+		RunSceneBenchmarks(random);
+		RunSoftwareOcclusionBenchmarks();
+		RunAssetBenchmarks();
+		RunSettingBenchmarks();
+
+		for (const std::string& path : generatedFiles)
+			std::filesystem::remove(path);
+
+		nlohmann::json report;
+		report["Options"]["WarmupIterations"] = options.warmupIterations;
+		report["Options"]["MinIterations"] = options.minIterations;
+		report["Options"]["MaxIterations"] = options.maxIterations;
+		report["Options"]["MinTime"] = options.minTime;
+		report["Options"]["Filter"] = options.filter;
+		report["Benchmarks"] = results;
+
+		std::string outputPath = Setting::Get("MicroBenchmarkOutput", "MicroBenchmarkResults.json").get<std::string>();
+		std::ofstream output(outputPath);
+		output << std::setw(4) << report;
+
+		Logger::Log(std::to_string(results.size()) + " benchmarks written to " + outputPath);
+
+		// The names carry the sizes, only the seed changes what is measured under the same name
+		if (!PerformanceBaseline::Check("MicroBenchmark", samples, { { "Seed", Setting::Get("MicroBenchmarkSeed", 1) } }))
+			return 2;
+	}
+	catch (const std::exception& e)
+	{
+		Logger::Log(LogSeverity::ERROR, e.what());
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -3,9 +3,9 @@
 #include <fstream>
 #include <iomanip>
 #include "MeshAsset.h"
+#include "Helper/Profiler.h"
 
 bool Asset::isBeingCreated = false;
-bool Asset::hasBeenInit = false;
 const std::string Asset::PATH = "Assets/TempAssetFolder/";
 
 Asset::Asset()
@@ -41,6 +41,8 @@ void Asset::Init(nlohmann::json data)
 
 std::shared_ptr<Asset> Asset::LoadByType(std::string name)
 {
+	PROFILE_FUNCTION();
+
 	using json = nlohmann::json;
 
 	std::ifstream input(PATH + name + ".json");
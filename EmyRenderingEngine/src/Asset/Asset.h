@@ -8,8 +8,8 @@
 class Asset
 {
 	static bool isBeingCreated;
-	static bool hasBeenInit;
 	static const std::string PATH;
+	bool hasBeenInit = false;
 	uint64_t ID = 0;
 
 public:
@@ -37,6 +37,24 @@ void Setting::Load()
 	input >> data;
 }
 
+void Setting::ReadArguments(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		size_t separator = argument.find('=');
+		if (separator == std::string::npos)
+		{
+			Logger::Log(LogSeverity::WARNING, "Ignored argument " + argument + ", expected Name=Value");
+			continue;
+		}
+
+		std::string value = argument.substr(separator + 1);
+		nlohmann::json parsedValue = nlohmann::json::parse(value, nullptr, false);
+		Add(argument.substr(0, separator), parsedValue.is_discarded() ? nlohmann::json(value) : parsedValue);
+	}
+}
+
 Setting::Setting()
 {
 }
@@ -14,6 +14,11 @@ public:
 	static void Save();
 	static void Load();
 
+	/// <summary>
+	/// Replace the settings given on the command line as Name=Value, the value is read as JSON or else as a string.
+	/// </summary>
+	static void ReadArguments(int argc, char* argv[]);
+
 private:
 	Setting();
 	~Setting();
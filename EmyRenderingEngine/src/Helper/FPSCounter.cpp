@@ -1,12 +1,22 @@
 #include "FPSCounter.h"
 #include "Helper/Log.h"
 
-int FPSCounter::fpsArrayCurrent;
-array<int, 10> FPSCounter::fpsArray;
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+array<float, FPSCounter::FRAME_TIME_CAPACITY> FPSCounter::frameTimes;
+uint64_t FPSCounter::frameCount = 0;
 int FPSCounter::fps = 0;
 float FPSCounter::deltaTime = 1.0f;
 Timer FPSCounter::timer;
 
+float FPSCounter::spikeFactor = 2.0f;
+float FPSCounter::recentFrameTime = 0;
+uint32_t FPSCounter::spikeCount = 0;
+float FPSCounter::lastSpikeTime = 0;
+bool FPSCounter::inSpike = false;
+
 void FPSCounter::StartCounting()
 {
 	if(timer.IsStop())
@@ -19,33 +29,148 @@ void FPSCounter::StartCounting()
 
 void FPSCounter::StopCounting()
 {
-	deltaTime = static_cast<float>(timer.Stop()) / 1000.0f;
+	float frameTime = static_cast<float>(timer.Stop());
+	deltaTime = frameTime / 1000.0f;
 	fps = static_cast<int>(1.0f / deltaTime);
 
-	fpsArray[fpsArrayCurrent] = fps;
-
-	fpsArrayCurrent++;
+	frameTimes[frameCount % FRAME_TIME_CAPACITY] = frameTime;
+	frameCount++;
 
-	if (fpsArrayCurrent >= fpsArray.size())
-		fpsArrayCurrent = 0;
+	// A run of slow frames is one spike, its time is the one of its slowest frame
+	bool slow = recentFrameTime > 0 && frameTime > recentFrameTime * spikeFactor;
+	if (slow && !inSpike)
+	{
+		spikeCount++;
+		lastSpikeTime = frameTime;
+	}
+	else if (slow)
+		lastSpikeTime = std::max(lastSpikeTime, frameTime);
+	inSpike = slow;
+	recentFrameTime = recentFrameTime == 0 ? frameTime : recentFrameTime + (frameTime - recentFrameTime) * 0.05f;
 }
 
 int FPSCounter::GetRawFPS()
 {
 	return fps;
 }
-int FPSCounter::GetAverageFPS()
+float FPSCounter::GetAverageFPS()
 {
-	int averageFps = 0;
-	for (int fps : fpsArray)
+	std::vector<float> lastFrames = GetFrameTimes(10);
+	if (lastFrames.empty())
+		return 0;
+
+	float totalTime = 0;
+	for (float frameTime : lastFrames)
 	{
-		averageFps += fps;
+		totalTime += frameTime;
 	}
-	averageFps = averageFps / fpsArray.size();
 
-	return averageFps;
+	return 1000.0f * lastFrames.size() / totalTime;
 }
 float FPSCounter::GetDeltaTime()
 {
 	return deltaTime;
 }
+
+FPSCounter::FrameTimeStats FPSCounter::GetFrameTimeStats()
+{
+	FrameTimeStats stats;
+
+	std::vector<float> sortedTimes = GetFrameTimes();
+	if (sortedTimes.empty())
+		return stats;
+
+	std::sort(sortedTimes.begin(), sortedTimes.end());
+
+	// Nearest rank, the smallest time with at least p of the frames at or under it
+	auto percentile = [&sortedTimes](double p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p * sortedTimes.size()));
+		return sortedTimes[std::min(std::max<size_t>(rank, 1), sortedTimes.size()) - 1];
+	};
+
+	stats.sampleCount = static_cast<uint32_t>(sortedTimes.size());
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.max = sortedTimes.back();
+
+	double totalTime = 0;
+	for (float frameTime : sortedTimes)
+		totalTime += frameTime;
+	stats.average = static_cast<float>(totalTime / sortedTimes.size());
+
+	size_t slowCount = std::max<size_t>(sortedTimes.size() / 100, 1);
+	double slowTime = 0;
+	for (size_t i = sortedTimes.size() - slowCount; i < sortedTimes.size(); i++)
+		slowTime += sortedTimes[i];
+	stats.onePercentLowFPS = slowTime > 0 ? static_cast<float>(1000.0 * slowCount / slowTime) : 0;
+
+	return stats;
+}
+
+std::vector<float> FPSCounter::GetFrameTimes(uint32_t count)
+{
+	uint64_t first = frameCount - std::min<uint64_t>(std::min(count, FRAME_TIME_CAPACITY), frameCount);
+
+	std::vector<float> times;
+	times.reserve(static_cast<size_t>(frameCount - first));
+	for (uint64_t i = first; i < frameCount; i++)
+		times.push_back(frameTimes[i % FRAME_TIME_CAPACITY]);
+
+	return times;
+}
+
+std::vector<float> FPSCounter::GetFrameTimeHistogram(uint32_t binCount, float binWidth)
+{
+	std::vector<float> bins(binCount, 0.0f);
+	if (binCount == 0 || binWidth <= 0)
+		return bins;
+
+	for (float frameTime : GetFrameTimes())
+		bins[std::min(static_cast<uint32_t>(frameTime / binWidth), binCount - 1)]++;
+
+	return bins;
+}
+
+uint32_t FPSCounter::GetSpikeCount()
+{
+	return spikeCount;
+}
+
+float FPSCounter::GetLastSpikeTime()
+{
+	return lastSpikeTime;
+}
+
+void FPSCounter::SetSpikeFactor(float factor)
+{
+	spikeFactor = factor;
+}
+
+void FPSCounter::Reset()
+{
+	frameCount = 0;
+	recentFrameTime = 0;
+	spikeCount = 0;
+	lastSpikeTime = 0;
+	inSpike = false;
+}
+
+bool FPSCounter::ExportCsv(const std::string& path)
+{
+	std::ofstream output(path);
+	if (!output.is_open())
+	{
+		Logger::Log(LogSeverity::WARNING, "Can't write the frame times to " + path);
+		return false;
+	}
+
+	output << "frame,time_ms\n";
+	std::vector<float> times = GetFrameTimes();
+	for (size_t i = 0; i < times.size(); i++)
+		output << i << "," << times[i] << "\n";
+
+	Logger::Log("Frame times written to " + path);
+	return true;
+}
\ No newline at end of file
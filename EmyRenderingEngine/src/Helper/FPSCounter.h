@@ -1,23 +1,82 @@
 #pragma once
 #include "Timer.h"
 #include <array>
+#include <string>
+#include <vector>
 
 class FPSCounter
 {
-	static int fpsArrayCurrent;
-	static array<int, 10> fpsArray;
+public:
+	static constexpr uint32_t FRAME_TIME_CAPACITY = 4096; // Frames kept for the statistics, the oldest are overwritten
+
+	// Frame times in millisecond over the frames kept
+	struct FrameTimeStats
+	{
+		uint32_t sampleCount = 0;
+		float average = 0;
+		float p50 = 0;
+		float p95 = 0;
+		float p99 = 0;
+		float max = 0;
+		float onePercentLowFPS = 0; // FPS of the average of the slowest 1% frames
+	};
+
+private:
+	static array<float, FRAME_TIME_CAPACITY> frameTimes; // Millisecond
+	static uint64_t frameCount;
 	static int fps;
 	static float deltaTime;
 	static Timer timer;
 
+	// A frame is a spike when it's this many times slower than the recent ones
+	static float spikeFactor;
+	static float recentFrameTime;
+	static uint32_t spikeCount;
+	static float lastSpikeTime;
+	static bool inSpike; // The last frame was slow, the next slow ones belong to its spike
+
 public:
 	static void StartCounting();
 	static void StopCounting();
 
 	static int GetRawFPS();
-	static int GetAverageFPS();
+
+	/// <summary>
+	/// FPS from the average frame time of the last ten frames.
+	/// </summary>
+	static float GetAverageFPS();
 	static float GetDeltaTime();
 
+	/// <summary>
+	/// Sort a copy of the frames kept, don't call it more than once a frame.
+	/// </summary>
+	static FrameTimeStats GetFrameTimeStats();
+
+	/// <summary>
+	/// Last frame times in millisecond, the oldest first.
+	/// </summary>
+	static std::vector<float> GetFrameTimes(uint32_t count = FRAME_TIME_CAPACITY);
+
+	/// <summary>
+	/// Frame count of the frames kept in each bin of binWidth millisecond, the last bin also has the slower frames.
+	/// </summary>
+	static std::vector<float> GetFrameTimeHistogram(uint32_t binCount, float binWidth);
+
+	static uint32_t GetSpikeCount();
+	static float GetLastSpikeTime();
+	static void SetSpikeFactor(float factor);
+
+	/// <summary>
+	/// Forget the frames kept and the spikes, to measure from a point of the game.
+	/// </summary>
+	static void Reset();
+
+	/// <summary>
+	/// Write the frames kept as CSV, one line per frame.
+	/// </summary>
+	/// <returns>Return false if the file can't be opened</returns>
+	static bool ExportCsv(const std::string& path);
+
 private:
 	FPSCounter();
-};
+};
\ No newline at end of file
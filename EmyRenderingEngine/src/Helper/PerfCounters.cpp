@@ -0,0 +1,140 @@
+#include "PerfCounters.h"
+#include "Helper/Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+std::array<std::atomic<uint64_t>, PerfCounters::COUNTER_COUNT> PerfCounters::current = {};
+std::array<PerfCounters::FrameValues, PerfCounters::HISTORY_CAPACITY> PerfCounters::history;
+uint64_t PerfCounters::frameCount = 0;
+std::atomic<bool> PerfCounters::paused{false};
+
+void PerfCounters::SetPaused(bool pause)
+{
+	paused.store(pause, std::memory_order_relaxed);
+}
+
+void PerfCounters::EndFrame()
+{
+	FrameValues& values = history[frameCount % HISTORY_CAPACITY];
+	for (size_t i = 0; i < COUNTER_COUNT; i++)
+		values[i] = current[i].exchange(0, std::memory_order_relaxed);
+
+	frameCount++;
+}
+
+uint64_t PerfCounters::GetCurrent(PerfCounter counter)
+{
+	return current[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+PerfCounters::Stats PerfCounters::GetStats(PerfCounter counter, uint32_t count)
+{
+	Stats stats;
+
+	std::vector<uint64_t> values = GetHistory(counter, count);
+	if (values.empty())
+		return stats;
+
+	uint64_t total = 0;
+	for (uint64_t value : values)
+		total += value;
+
+	stats.last = values.back();
+	stats.average = static_cast<double>(total) / values.size();
+	stats.min = *std::min_element(values.begin(), values.end());
+	stats.max = *std::max_element(values.begin(), values.end());
+
+	return stats;
+}
+
+std::vector<uint64_t> PerfCounters::GetHistory(PerfCounter counter, uint32_t count)
+{
+	uint64_t first = frameCount - std::min<uint64_t>(std::min(count, HISTORY_CAPACITY), frameCount);
+
+	std::vector<uint64_t> values;
+	values.reserve(static_cast<size_t>(frameCount - first));
+	for (uint64_t i = first; i < frameCount; i++)
+		values.push_back(history[i % HISTORY_CAPACITY][static_cast<size_t>(counter)]);
+
+	return values;
+}
+
+uint64_t PerfCounters::GetFrameCount()
+{
+	return frameCount;
+}
+
+const char* PerfCounters::GetName(PerfCounter counter)
+{
+	switch (counter)
+	{
+		case PerfCounter::DRAW_CALLS:
+			return "DrawCalls";
+		case PerfCounter::PIPELINE_BINDS:
+			return "PipelineBinds";
+		case PerfCounter::DESCRIPTOR_SET_BINDS:
+			return "DescriptorSetBinds";
+		case PerfCounter::VERTEX_BUFFER_BINDS:
+			return "VertexBufferBinds";
+		case PerfCounter::UPLOADS:
+			return "Uploads";
+		case PerfCounter::UPLOADED_BYTES:
+			return "UploadedBytes";
+		case PerfCounter::MEMORY_ALLOCATIONS:
+			return "MemoryAllocations";
+		case PerfCounter::SCENE_OBJECTS_UPDATED:
+			return "SceneObjectsUpdated";
+		default:
+			return "Unknown";
+	}
+}
+
+nlohmann::json PerfCounters::ToJson(uint32_t count, bool withHistory)
+{
+	nlohmann::json counters;
+	counters["Frames"] = std::min<uint64_t>(std::min(count, HISTORY_CAPACITY), frameCount);
+
+	for (size_t i = 0; i < COUNTER_COUNT; i++)
+	{
+		PerfCounter counter = static_cast<PerfCounter>(i);
+		Stats stats = GetStats(counter, count);
+
+		nlohmann::json& data = counters[GetName(counter)];
+		data["Last"] = stats.last;
+		data["Average"] = stats.average;
+		data["Min"] = stats.min;
+		data["Max"] = stats.max;
+		if (withHistory)
+			data["History"] = GetHistory(counter, count);
+	}
+
+	return counters;
+}
+
+bool PerfCounters::ExportJson(const std::string& path)
+{
+	std::ofstream output(path);
+	if (!output.is_open())
+	{
+		Logger::Log(LogSeverity::WARNING, "Can't write the performance counters to " + path);
+		return false;
+	}
+
+	output << std::setw(4) << ToJson(HISTORY_CAPACITY, true);
+
+	Logger::Log("Performance counters written to " + path);
+	return true;
+}
+
+void PerfCounters::Reset()
+{
+	frameCount = 0;
+	for (std::atomic<uint64_t>& value : current)
+		value.store(0, std::memory_order_relaxed);
+}
+
+PerfCounters::PerfCounters()
+{
+}
\ No newline at end of file
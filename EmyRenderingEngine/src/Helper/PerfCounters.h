@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <json.hpp>
+
+enum class PerfCounter
+{
+	DRAW_CALLS,
+	PIPELINE_BINDS,
+	DESCRIPTOR_SET_BINDS,
+	VERTEX_BUFFER_BINDS,
+	UPLOADS,
+	UPLOADED_BYTES,
+	MEMORY_ALLOCATIONS,
+	SCENE_OBJECTS_UPDATED,
+	COUNT
+};
+
+/// <summary>
+/// Counters of the work done in a frame, any module adds to them and EndFrame keeps their values in a history.
+/// Adding is a relaxed atomic add so it can be called from any thread and in the recording loops.
+/// </summary>
+class PerfCounters
+{
+public:
+	static constexpr uint32_t HISTORY_CAPACITY = 1024; // Frames kept, the oldest are overwritten
+	static constexpr size_t COUNTER_COUNT = static_cast<size_t>(PerfCounter::COUNT);
+
+	// Values of every counter in a frame
+	typedef std::array<uint64_t, COUNTER_COUNT> FrameValues;
+
+	struct Stats
+	{
+		uint64_t last = 0; // Last frame ended
+		double average = 0;
+		uint64_t min = 0;
+		uint64_t max = 0;
+	};
+
+private:
+	static std::array<std::atomic<uint64_t>, COUNTER_COUNT> current;
+	static std::array<FrameValues, HISTORY_CAPACITY> history;
+	static uint64_t frameCount;
+	static std::atomic<bool> paused;
+
+public:
+	static void Add(PerfCounter counter, uint64_t value = 1)
+	{
+		if (!paused.load(std::memory_order_relaxed))
+			current[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Ignore what is added meanwhile, for work repeated for other frames like the command buffers of the other swapchain images.
+	/// </summary>
+	static void SetPaused(bool pause);
+
+	/// <summary>
+	/// Keep the values of the frame in the history and start the next one from zero, call it once per frame from the main thread.
+	/// </summary>
+	static void EndFrame();
+
+	/// <summary>
+	/// Value of the frame running, not ended yet.
+	/// </summary>
+	static uint64_t GetCurrent(PerfCounter counter);
+
+	/// <summary>
+	/// Last, average, min and max over the last frames kept.
+	/// </summary>
+	static Stats GetStats(PerfCounter counter, uint32_t count = HISTORY_CAPACITY);
+
+	/// <summary>
+	/// Value of the last frames kept, the oldest first.
+	/// </summary>
+	static std::vector<uint64_t> GetHistory(PerfCounter counter, uint32_t count = HISTORY_CAPACITY);
+	static uint64_t GetFrameCount();
+
+	static const char* GetName(PerfCounter counter);
+
+	/// <summary>
+	/// Stats of every counter by name, with the history when withHistory is set.
+	/// </summary>
+	static nlohmann::json ToJson(uint32_t count = HISTORY_CAPACITY, bool withHistory = false);
+
+	/// <returns>Return false if the file can't be opened</returns>
+	static bool ExportJson(const std::string& path);
+
+	/// <summary>
+	/// Forget the frames kept and the frame running, to measure from a point of the game.
+	/// </summary>
+	static void Reset();
+
+private:
+	PerfCounters();
+};
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "PerformanceBaseline.h"
+#include "Helper/Log.h"
+#include "Game/Setting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+const std::string PerformanceBaseline::PATH = "Baselines/";
+
+bool PerformanceBaseline::Check(const std::string& suite, const Samples& samples, const nlohmann::json& context)
+{
+	std::string mode = Setting::Get("BaselineMode", "Compare").get<std::string>();
+	if (mode == "Off")
+		return true;
+
+	std::string path = GetPath(suite);
+	std::ifstream input(path);
+
+	if (mode == "Update" || input.fail())
+	{
+		input.close();
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+
+		nlohmann::json baseline;
+		baseline["Machine"] = GetMachineName();
+		baseline["Context"] = context;
+		baseline["Samples"] = samples;
+
+		std::ofstream output(path);
+		if (!output.is_open())
+		{
+			Logger::Log(LogSeverity::WARNING, "Can't write the baseline " + path);
+			return true;
+		}
+
+		output << std::setw(4) << baseline;
+		Logger::Log("Baseline written to " + path);
+		return true;
+	}
+
+	nlohmann::json baseline;
+	input >> baseline;
+
+	if (baseline["Context"] != context)
+	{
+		Logger::Log(LogSeverity::WARNING, "The baseline " + path + " was measured with other settings, not compared. Run with BaselineMode=Update to replace it.");
+		return true;
+	}
+
+	double threshold = Setting::Get("BaselineThreshold", 0.05).get<double>();
+	double significance = Setting::Get("BaselineSignificance", 0.01).get<double>();
+	std::vector<Comparison> comparisons = Compare(baseline["Samples"].get<Samples>(), samples, threshold, significance);
+
+	bool regressed = std::any_of(comparisons.begin(), comparisons.end(), [](const Comparison& comparison) { return comparison.regressed; });
+
+	Logger::Log("Compared with " + path + "\n" + FormatReport(comparisons));
+	if (regressed)
+		Logger::Log(LogSeverity::ERROR, "Performance regression against the baseline of " + GetMachineName());
+
+	return !regressed;
+}
+
+std::vector<PerformanceBaseline::Comparison> PerformanceBaseline::Compare(const Samples& baseline, const Samples& samples, double threshold, double significance)
+{
+	double noiseFactor = Setting::Get("BaselineNoiseFactor", 3.0).get<double>();
+
+	std::vector<Comparison> comparisons;
+	for (const auto& measure : samples)
+	{
+		Comparison comparison;
+		comparison.name = measure.first;
+		comparison.count = measure.second.size();
+
+		auto baselineMeasure = baseline.find(measure.first);
+		if (baselineMeasure == baseline.end() || baselineMeasure->second.empty() || measure.second.empty())
+		{
+			comparison.missing = true;
+			comparisons.push_back(comparison);
+			continue;
+		}
+
+		const std::vector<double>& baselineSamples = baselineMeasure->second;
+		comparison.baselineCount = baselineSamples.size();
+		comparison.baselineMedian = Median(baselineSamples);
+		comparison.median = Median(measure.second);
+		comparison.change = comparison.baselineMedian > 0 ? comparison.median / comparison.baselineMedian - 1.0 : 0.0;
+
+		// A noisy measure needs a larger change to count, so a few slow samples don't fail the run
+		double noise = std::sqrt(std::pow(MedianNoise(baselineSamples), 2) + std::pow(MedianNoise(measure.second), 2));
+		comparison.threshold = std::max(threshold, noiseFactor * noise);
+
+		comparison.pValue = MannWhitneyPValue(baselineSamples, measure.second);
+		comparison.regressed = comparison.change > comparison.threshold && comparison.pValue < significance;
+		comparison.improved = comparison.change < -comparison.threshold && MannWhitneyPValue(measure.second, baselineSamples) < significance;
+
+		comparisons.push_back(comparison);
+	}
+
+	return comparisons;
+}
+
+double PerformanceBaseline::MannWhitneyPValue(const std::vector<double>& baseline, const std::vector<double>& samples)
+{
+	size_t baselineCount = baseline.size();
+	size_t count = samples.size();
+	if (baselineCount == 0 || count == 0)
+		return 1;
+
+	// Both sets together, flagged when they come from the samples
+	std::vector<std::pair<double, bool>> values;
+	values.reserve(baselineCount + count);
+	for (double value : baseline)
+		values.push_back({ value, false });
+	for (double value : samples)
+		values.push_back({ value, true });
+	std::sort(values.begin(), values.end());
+
+	// Equal values share the average of their ranks
+	double rankSum = 0;
+	double tieCorrection = 0;
+	for (size_t i = 0; i < values.size();)
+	{
+		size_t end = i;
+		while (end < values.size() && values[end].first == values[i].first)
+			end++;
+
+		double rank = (i + 1 + end) / 2.0;
+		for (size_t j = i; j < end; j++)
+		{
+			if (values[j].second)
+				rankSum += rank;
+		}
+
+		double tieCount = static_cast<double>(end - i);
+		tieCorrection += tieCount * tieCount * tieCount - tieCount;
+		i = end;
+	}
+
+	double total = static_cast<double>(baselineCount + count);
+	double u = rankSum - count * (count + 1) / 2.0;
+	double mean = baselineCount * count / 2.0;
+	double variance = baselineCount * count / 12.0 * ((total + 1) - tieCorrection / (total * (total - 1)));
+	if (variance <= 0)
+		return 1;
+
+	// Continuity correction, then the upper tail of the normal distribution
+	double z = (u - mean - 0.5) / std::sqrt(variance);
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+std::string PerformanceBaseline::FormatReport(const std::vector<Comparison>& comparisons)
+{
+	std::stringstream ss;
+	ss << std::fixed;
+
+	for (const Comparison& comparison : comparisons)
+	{
+		ss << std::left << std::setw(40) << comparison.name << std::right;
+
+		if (comparison.missing)
+		{
+			ss << "  new measure, not in the baseline\n";
+			continue;
+		}
+
+		ss << std::setprecision(3) << std::setw(12) << comparison.baselineMedian << " ms -> " << std::setw(10) << comparison.median << " ms ";
+		ss << std::setprecision(1) << std::showpos << std::setw(7) << comparison.change * 100.0 << "%" << std::noshowpos;
+		ss << " (threshold " << comparison.threshold * 100.0 << "%, p " << std::setprecision(4) << comparison.pValue << ")";
+
+		if (comparison.regressed)
+			ss << "  REGRESSED";
+		else if (comparison.improved)
+			ss << "  improved";
+		ss << "\n";
+	}
+
+	return ss.str();
+}
+
+std::string PerformanceBaseline::GetMachineName()
+{
+	std::string name = Setting::Get("BaselineMachine", "").get<std::string>();
+	if (!name.empty())
+		return name;
+
+#ifdef _WIN32
+	char* computerName = nullptr;
+	size_t length = 0;
+	if (_dupenv_s(&computerName, &length, "COMPUTERNAME") == 0 && computerName != nullptr)
+	{
+		name = computerName;
+		free(computerName);
+	}
+#else
+	// HOSTNAME is a shell variable, it isn't exported to the processes
+	char hostName[256] = {};
+	if (gethostname(hostName, sizeof(hostName) - 1) == 0)
+		name = hostName;
+#endif
+
+	return name.empty() ? "Default" : name;
+}
+
+std::string PerformanceBaseline::GetPath(const std::string& suite)
+{
+#if RELEASE
+	std::string configuration = "Release";
+#else
+	std::string configuration = "Debug";
+#endif
+
+	return PATH + GetMachineName() + "/" + configuration + "/" + suite + ".json";
+}
+
+double PerformanceBaseline::Median(std::vector<double> values)
+{
+	if (values.empty())
+		return 0;
+
+	size_t middle = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + middle, values.end());
+	return values[middle];
+}
+
+double PerformanceBaseline::MedianNoise(const std::vector<double>& values)
+{
+	double median = Median(values);
+	if (values.size() < 2 || median <= 0)
+		return 0;
+
+	std::vector<double> deviations;
+	deviations.reserve(values.size());
+	for (double value : values)
+		deviations.push_back(std::abs(value - median));
+
+	// 1.4826 turns the median absolute deviation in a standard deviation, 1.2533 is the efficiency of the median
+	double standardDeviation = 1.4826 * Median(deviations);
+	return 1.2533 * standardDeviation / std::sqrt(static_cast<double>(values.size())) / median;
+}
+
+PerformanceBaseline::PerformanceBaseline()
+{
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include <json.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Baselines of benchmark samples stored per machine and build configuration, new runs are compared with them.
+/// A measure regresses when its median is slower by more than the threshold, more than its own noise,
+/// and a Mann-Whitney U test says the slowdown is unlikely to be chance.
+/// </summary>
+class PerformanceBaseline
+{
+public:
+	// Samples of each measure in millisecond, by name
+	typedef std::map<std::string, std::vector<double>> Samples;
+
+	struct Comparison
+	{
+		std::string name;
+		size_t baselineCount = 0;
+		size_t count = 0;
+		double baselineMedian = 0;
+		double median = 0;
+		double change = 0; // Relative change of the median, positive is slower
+		double threshold = 0; // Change needed to regress, the largest of the setting and the noise
+		double pValue = 1; // Probability of a slowdown at least this large by chance
+		bool regressed = false;
+		bool improved = false;
+		bool missing = false; // Not in the baseline
+	};
+
+private:
+	static const std::string PATH;
+
+public:
+	/// <summary>
+	/// Compare with the baseline of the suite or write it, as the setting BaselineMode says: Compare, Update or Off.
+	/// Compare writes the baseline when there is none yet.
+	/// </summary>
+	/// <param name="context">Saved with the baseline, a baseline with another context isn't compared</param>
+	/// <returns>Return false if a measure regressed</returns>
+	static bool Check(const std::string& suite, const Samples& samples, const nlohmann::json& context = nlohmann::json::object());
+
+	static std::vector<Comparison> Compare(const Samples& baseline, const Samples& samples, double threshold, double significance);
+
+	/// <summary>
+	/// One-sided p-value of the Mann-Whitney U test that the samples are slower than the baseline,
+	/// normal approximation with the tie correction.
+	/// </summary>
+	static double MannWhitneyPValue(const std::vector<double>& baseline, const std::vector<double>& samples);
+
+	/// <summary>
+	/// One line per measure, the regressions are marked.
+	/// </summary>
+	static std::string FormatReport(const std::vector<Comparison>& comparisons);
+
+	/// <summary>
+	/// BaselineMachine if set, otherwise the computer name.
+	/// </summary>
+	static std::string GetMachineName();
+	static std::string GetPath(const std::string& suite);
+
+private:
+	static double Median(std::vector<double> values);
+
+	/// <summary>
+	/// Relative standard error of the median, estimated from the median absolute deviation.
+	/// </summary>
+	static double MedianNoise(const std::vector<double>& values);
+
+	PerformanceBaseline();
+};
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "Helper/Profiler.h"
+#include "Helper/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <json.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#define PROFILER_TSC 1
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define PROFILER_TSC 1
+#include <x86intrin.h>
+#else
+#define PROFILER_TSC 0
+#endif
+
+namespace
+{
+	double GetClockMicroseconds()
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Give the buffer back when the thread exits
+	struct ThreadSlot
+	{
+		Profiler::ThreadBuffer* buffer = nullptr;
+
+		~ThreadSlot()
+		{
+			if (buffer != nullptr)
+				buffer->inUse = false;
+		}
+	};
+
+	thread_local ThreadSlot threadSlot;
+
+	// The TSC frequency is measured against the steady clock once it ran long enough to be precise
+	std::atomic<double> calibratedTicksPerMicrosecond{0};
+}
+
+std::mutex Profiler::threadsMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::threads;
+uint64_t Profiler::startTicks = Profiler::GetTicks();
+double Profiler::startMicroseconds = GetClockMicroseconds();
+std::array<uint64_t, Profiler::FRAME_CAPACITY> Profiler::frameStarts;
+std::atomic<uint64_t> Profiler::frameCount{0};
+
+uint64_t Profiler::GetTicks()
+{
+#if PROFILER_TSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double Profiler::TicksToMicroseconds(uint64_t ticks)
+{
+	return static_cast<double>(static_cast<int64_t>(ticks - startTicks)) / GetTicksPerMicrosecond();
+}
+
+uint64_t Profiler::BeginZone()
+{
+	GetThreadBuffer()->depth++;
+	return GetTicks();
+}
+
+void Profiler::EndZone(const char* name, uint64_t start)
+{
+	uint64_t end = GetTicks();
+	ThreadBuffer* buffer = GetThreadBuffer();
+	buffer->depth--;
+
+	// Only this thread writes the buffer, the release publishes the event to the readers
+	uint64_t index = buffer->count.load(std::memory_order_relaxed);
+	buffer->events[index % EVENT_CAPACITY] = {name, start, end, buffer->depth};
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	buffer->name = name;
+}
+
+void Profiler::MarkFrame()
+{
+	uint64_t index = frameCount.load(std::memory_order_relaxed);
+	frameStarts[index % FRAME_CAPACITY] = GetTicks();
+	frameCount.store(index + 1, std::memory_order_release);
+}
+
+std::vector<uint64_t> Profiler::GetFrameStarts(uint32_t count)
+{
+	uint64_t frames = frameCount.load(std::memory_order_acquire);
+	uint64_t first = frames - std::min<uint64_t>(std::min(count, FRAME_CAPACITY), frames);
+
+	std::vector<uint64_t> starts;
+	for (uint64_t i = first; i < frames; i++)
+		starts.push_back(frameStarts[i % FRAME_CAPACITY]);
+
+	return starts;
+}
+
+std::vector<Profiler::ThreadEvents> Profiler::CopyEvents(uint64_t start, uint64_t end)
+{
+	std::vector<ThreadEvents> threadEvents;
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const auto& buffer : threads)
+	{
+		ThreadEvents copy;
+		copy.id = buffer->id;
+		copy.name = buffer->name;
+
+		uint64_t count = buffer->count.load(std::memory_order_acquire);
+		uint64_t firstEvent = count > EVENT_CAPACITY ? count - EVENT_CAPACITY : 0;
+		for (uint64_t i = firstEvent; i < count; i++)
+		{
+			const Event& event = buffer->events[i % EVENT_CAPACITY];
+			if (event.end >= start && event.start <= end)
+				copy.events.push_back(event);
+		}
+
+		if (!copy.events.empty())
+			threadEvents.push_back(std::move(copy));
+	}
+
+	return threadEvents;
+}
+
+std::vector<const Profiler::ThreadBuffer*> Profiler::GetThreads()
+{
+	std::lock_guard<std::mutex> lock(threadsMutex);
+
+	std::vector<const ThreadBuffer*> buffers;
+	for (const auto& buffer : threads)
+		buffers.push_back(buffer.get());
+
+	return buffers;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+	std::ofstream output(path);
+	if (!output.is_open())
+	{
+		Logger::Log(LogSeverity::WARNING, "Can't write the CPU trace to " + path);
+		return false;
+	}
+
+	double ticksPerMicrosecond = GetTicksPerMicrosecond();
+	std::vector<const ThreadBuffer*> buffers = GetThreads();
+
+	output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const ThreadBuffer* buffer : buffers)
+	{
+		std::string threadName;
+		{
+			std::lock_guard<std::mutex> lock(threadsMutex);
+			threadName = buffer->name;
+		}
+
+		output << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->id << ",\"args\":{\"name\":" << nlohmann::json(threadName).dump() << "}}";
+		first = false;
+
+		uint64_t count = buffer->count.load(std::memory_order_acquire);
+		uint64_t firstEvent = count > EVENT_CAPACITY ? count - EVENT_CAPACITY : 0;
+		for (uint64_t i = firstEvent; i < count; i++)
+		{
+			const Event& event = buffer->events[i % EVENT_CAPACITY];
+			double start = static_cast<double>(static_cast<int64_t>(event.start - startTicks)) / ticksPerMicrosecond;
+			double duration = static_cast<double>(event.end - event.start) / ticksPerMicrosecond;
+
+			output << ",\n{\"name\":" << nlohmann::json(event.name).dump() << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->id << ",\"ts\":" << start << ",\"dur\":" << duration << "}";
+		}
+	}
+	output << "\n]}\n";
+
+	Logger::Log("CPU trace written to " + path);
+	return true;
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	if (threadSlot.buffer != nullptr)
+		return threadSlot.buffer;
+
+	// Once per thread, the buffer of an exited thread is reused before a new one is made
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const auto& buffer : threads)
+	{
+		bool expected = false;
+		if (buffer->inUse.compare_exchange_strong(expected, true))
+		{
+			buffer->depth = 0;
+			threadSlot.buffer = buffer.get();
+			return threadSlot.buffer;
+		}
+	}
+
+	threads.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+	ThreadBuffer* buffer = threads.back().get();
+	buffer->id = static_cast<uint32_t>(threads.size());
+	buffer->name = "Thread " + std::to_string(buffer->id);
+	buffer->inUse = true;
+
+	threadSlot.buffer = buffer;
+	return buffer;
+}
+
+double Profiler::GetTicksPerMicrosecond()
+{
+#if PROFILER_TSC
+	double calibrated = calibratedTicksPerMicrosecond.load();
+	if (calibrated > 0)
+		return calibrated;
+
+	double elapsed = GetClockMicroseconds() - startMicroseconds;
+	if (elapsed <= 0)
+		return 1;
+
+	double ticksPerMicrosecond = static_cast<double>(GetTicks() - startTicks) / elapsed;
+	if (elapsed > 1000000.0)
+		calibratedTicksPerMicrosecond = ticksPerMicrosecond;
+
+	return ticksPerMicrosecond;
+#else
+	return 1000.0;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Zones only exist when the project defines PROFILER, they compile to nothing otherwise.
+// The name of a zone is kept as a pointer so it needs to be a string literal.
+#if PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#define PROFILE_FRAME() Profiler::MarkFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#define PROFILE_FRAME()
+#endif
+
+/// <summary>
+/// CPU profiler of nested zones. Every thread writes the zones it closes in its own ring buffer without lock,
+/// timestamps are read from the TSC when the CPU has one.
+/// </summary>
+class Profiler
+{
+public:
+	static constexpr uint32_t EVENT_CAPACITY = 16384; // Zones kept per thread, the oldest are overwritten
+	static constexpr uint32_t FRAME_CAPACITY = 1024;
+
+	struct Event
+	{
+		const char* name = nullptr;
+		uint64_t start = 0; // Ticks
+		uint64_t end = 0;
+		uint32_t depth = 0; // Zones open around this one
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t id = 0;
+		std::string name;
+		std::array<Event, EVENT_CAPACITY> events;
+		std::atomic<uint64_t> count{0}; // Zones written since the buffer was created, only its thread writes
+		std::atomic<bool> inUse{false}; // A thread that exits gives its buffer to the next one
+		uint32_t depth = 0;
+	};
+
+	// Copy of the zones of a thread
+	struct ThreadEvents
+	{
+		uint32_t id = 0;
+		std::string name;
+		std::vector<Event> events;
+	};
+
+private:
+	static std::mutex threadsMutex;
+	static std::vector<std::unique_ptr<ThreadBuffer>> threads; // Never freed, the zones of exited threads are still exported
+	static uint64_t startTicks;
+	static double startMicroseconds;
+
+	// Start of the last frames, written by the main thread only
+	static std::array<uint64_t, FRAME_CAPACITY> frameStarts;
+	static std::atomic<uint64_t> frameCount;
+
+public:
+	static uint64_t GetTicks();
+
+	/// <summary>
+	/// Microseconds since the profiler started.
+	/// </summary>
+	static double TicksToMicroseconds(uint64_t ticks);
+	static double GetTicksPerMicrosecond();
+
+	static uint64_t BeginZone();
+	static void EndZone(const char* name, uint64_t start);
+
+	/// <summary>
+	/// Name of the calling thread in the exports.
+	/// </summary>
+	static void SetThreadName(const std::string& name);
+
+	/// <summary>
+	/// Start of a frame, call it from the main thread.
+	/// </summary>
+	static void MarkFrame();
+
+	/// <summary>
+	/// Start of the last frames in ticks, the oldest first. The last one is the frame running.
+	/// </summary>
+	static std::vector<uint64_t> GetFrameStarts(uint32_t count);
+
+	/// <summary>
+	/// Zones of every thread overlapping the range, same constraints than GetThreads.
+	/// </summary>
+	static std::vector<ThreadEvents> CopyEvents(uint64_t start, uint64_t end);
+
+	/// <summary>
+	/// Buffers of every thread that opened a zone. The zones of another thread can be overwritten while they are read,
+	/// read them when the other threads are idle.
+	/// </summary>
+	static std::vector<const ThreadBuffer*> GetThreads();
+
+	/// <summary>
+	/// Write the zones kept in every buffer in the Chrome trace event format, it opens in chrome://tracing and Perfetto.
+	/// </summary>
+	/// <returns>Return false if the file can't be opened</returns>
+	static bool ExportChromeTrace(const std::string& path);
+
+private:
+	static ThreadBuffer* GetThreadBuffer();
+
+	Profiler();
+};
+
+class ProfileZone
+{
+private:
+	const char* name;
+	uint64_t start;
+
+public:
+	explicit ProfileZone(const char* name) : name(name), start(Profiler::BeginZone()) {}
+	~ProfileZone() { Profiler::EndZone(name, start); }
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
\ No newline at end of file
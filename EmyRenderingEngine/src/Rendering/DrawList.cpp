@@ -0,0 +1,232 @@
+#include "Rendering/DrawList.h"
+
+#include "Helper/Profiler.h"
+#include <array>
+
+DrawList::Handle DrawList::Add(Model* model)
+{
+	Handle handle;
+	if (freeHandles.empty())
+	{
+		handle = static_cast<Handle>(handleIndices.size());
+		handleIndices.push_back(0);
+	}
+	else
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+
+	handleIndices[handle] = static_cast<uint32_t>(models.size());
+	models.push_back(std::unique_ptr<Model>(model));
+	modelHandles.push_back(handle);
+	modelKeyResources.emplace_back();
+	model->drawListHandle = handle;
+
+	// Its key is set by the next sort
+	if (packets.size() == models.size() - 1)
+	{
+		model->drawPacketIndex = static_cast<uint32_t>(packets.size());
+		packets.push_back({ 0, model });
+	}
+
+	return handle;
+}
+
+void DrawList::Remove(Handle handle)
+{
+	if (handle >= handleIndices.size() || handleIndices[handle] == UINT32_MAX)
+		return;
+
+	// Swap the last model in the hole then pop it
+	uint32_t index = handleIndices[handle];
+	uint32_t last = static_cast<uint32_t>(models.size()) - 1;
+
+	for (size_t field = 0; field < KEY_FIELD_COUNT; field++)
+		ReleaseKeyResource(keyIds[field], modelKeyResources[index][field]);
+
+	// Swap the last packet in the hole too, the next sort puts it back in order
+	uint32_t packetIndex = models[index]->drawPacketIndex;
+	if (packetIndex < packets.size())
+	{
+		packets[packetIndex] = packets.back();
+		packets[packetIndex].model->drawPacketIndex = packetIndex;
+		packets.pop_back();
+	}
+
+	if (index != last)
+	{
+		models[index] = std::move(models[last]);
+		modelHandles[index] = modelHandles[last];
+		modelKeyResources[index] = modelKeyResources[last];
+		handleIndices[modelHandles[index]] = index;
+	}
+
+	models.pop_back();
+	modelHandles.pop_back();
+	modelKeyResources.pop_back();
+	handleIndices[handle] = UINT32_MAX;
+	freeHandles.push_back(handle);
+}
+
+void DrawList::Clear()
+{
+	packets.clear();
+	models.clear();
+	modelHandles.clear();
+	modelKeyResources.clear();
+	handleIndices.clear();
+	freeHandles.clear();
+
+	for (KeyIds& ids : keyIds)
+	{
+		ids.entries.clear();
+		ids.freeIds.clear();
+	}
+}
+
+void DrawList::Sort(const glm::vec3& cameraPosition, float farDistance)
+{
+	PROFILE_FUNCTION();
+
+	const float maxDepth = static_cast<float>((1u << DEPTH_BITS) - 1);
+
+	// Only rebuilt after a Clear, otherwise the keys are updated in the order of the last sort
+	bool rebuilt = packets.size() != models.size();
+	if (rebuilt)
+	{
+		packets.resize(models.size());
+		for (size_t i = 0; i < models.size(); i++)
+			packets[i].model = models[i].get();
+	}
+
+	for (DrawPacket& packet : packets)
+	{
+		Model* model = packet.model;
+		std::array<KeyResource, KEY_FIELD_COUNT>& resources = modelKeyResources[handleIndices[model->drawListHandle]];
+
+		float distance = glm::length(glm::vec3(model->GetWorldBoundingSphere()) - cameraPosition);
+		uint64_t depth = static_cast<uint64_t>(glm::clamp(distance / farDistance, 0.0f, 1.0f) * maxDepth);
+
+		packet.key = UpdateKeyResource(keyIds[PIPELINE], resources[PIPELINE], model->graphicPipeline, 64 - PIPELINE_SHIFT) << PIPELINE_SHIFT
+			| UpdateKeyResource(keyIds[MATERIAL], resources[MATERIAL], model->texture, PIPELINE_SHIFT - MATERIAL_SHIFT) << MATERIAL_SHIFT
+			| UpdateKeyResource(keyIds[MESH], resources[MESH], model->mesh, MATERIAL_SHIFT - MESH_SHIFT) << MESH_SHIFT
+			| depth;
+	}
+
+	if (RadixSort(packets, scratchPackets) || rebuilt)
+	{
+		for (size_t i = 0; i < packets.size(); i++)
+			packets[i].model->drawPacketIndex = static_cast<uint32_t>(i);
+	}
+}
+
+const std::vector<DrawList::DrawPacket>& DrawList::GetPackets() const
+{
+	return packets;
+}
+
+const std::vector<std::unique_ptr<Model>>& DrawList::GetModels() const
+{
+	return models;
+}
+
+size_t DrawList::GetSize() const
+{
+	return models.size();
+}
+
+bool DrawList::RadixSort(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch)
+{
+	size_t count = packets.size();
+
+	// Most frames keep the order of the last one
+	bool sorted = true;
+	for (size_t i = 1; i < count && sorted; i++)
+		sorted = packets[i - 1].key <= packets[i].key;
+
+	if (sorted)
+		return false;
+
+	// Every histogram in one read of the keys
+	std::array<std::array<size_t, 256>, 8> histograms = {};
+	for (const DrawPacket& packet : packets)
+	{
+		for (size_t pass = 0; pass < 8; pass++)
+			histograms[pass][(packet.key >> (pass * 8)) & 0xFF]++;
+	}
+
+	scratch.resize(count);
+	std::vector<DrawPacket>* source = &packets;
+	std::vector<DrawPacket>* destination = &scratch;
+
+	for (size_t pass = 0; pass < 8; pass++)
+	{
+		std::array<size_t, 256>& histogram = histograms[pass];
+		uint32_t shift = static_cast<uint32_t>(pass * 8);
+
+		if (histogram[((*source)[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram)
+		{
+			size_t bucketSize = bucket;
+			bucket = offset;
+			offset += bucketSize;
+		}
+
+		for (const DrawPacket& packet : *source)
+			(*destination)[histogram[(packet.key >> shift) & 0xFF]++] = packet;
+
+		std::swap(source, destination);
+	}
+
+	if (source != &packets)
+		packets.swap(scratch);
+
+	return true;
+}
+
+uint64_t DrawList::UpdateKeyResource(KeyIds& ids, KeyResource& keyResource, const void* resource, uint32_t bitCount)
+{
+	if (!keyResource.acquired || keyResource.resource != resource)
+	{
+		ReleaseKeyResource(ids, keyResource);
+
+		auto entry = ids.entries.find(resource);
+		if (entry == ids.entries.end())
+		{
+			uint32_t id = static_cast<uint32_t>(ids.entries.size());
+			if (!ids.freeIds.empty())
+			{
+				id = ids.freeIds.back();
+				ids.freeIds.pop_back();
+			}
+
+			entry = ids.entries.emplace(resource, IdEntry{ id, 0 }).first;
+		}
+
+		entry->second.referenceCount++;
+		keyResource.resource = resource;
+		keyResource.id = entry->second.id;
+		keyResource.acquired = true;
+	}
+
+	return static_cast<uint64_t>(keyResource.id) & ((1ull << bitCount) - 1);
+}
+
+void DrawList::ReleaseKeyResource(KeyIds& ids, KeyResource& keyResource)
+{
+	if (!keyResource.acquired)
+		return;
+
+	auto entry = ids.entries.find(keyResource.resource);
+	if (--entry->second.referenceCount == 0)
+	{
+		ids.freeIds.push_back(entry->second.id);
+		ids.entries.erase(entry);
+	}
+
+	keyResource.acquired = false;
+}
\ No newline at end of file
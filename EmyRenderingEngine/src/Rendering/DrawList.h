@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "Rendering/Model.h"
+
+/// <summary>
+/// Own the models to render and sort their draws by a packed 64 bit key.
+/// Models and packets are stored contiguously and removed in constant time by swapping the last one in their place.
+/// </summary>
+class DrawList
+{
+public:
+	typedef uint32_t Handle;
+	static const Handle INVALID_HANDLE = UINT32_MAX;
+
+	// Key bits from the most to the least significant: pipeline 8, material 16, mesh 16, depth 24
+	static const uint32_t PIPELINE_SHIFT = 56;
+	static const uint32_t MATERIAL_SHIFT = 40;
+	static const uint32_t MESH_SHIFT = 24;
+	static const uint32_t DEPTH_BITS = 24;
+
+	struct DrawPacket
+	{
+		uint64_t key;
+		Model* model;
+	};
+
+private:
+	enum KeyField
+	{
+		PIPELINE,
+		MATERIAL,
+		MESH,
+		KEY_FIELD_COUNT
+	};
+
+	// Resource of a model packed in its key and the id it holds
+	struct KeyResource
+	{
+		const void* resource = nullptr;
+		uint32_t id = 0;
+		bool acquired = false;
+	};
+
+	struct IdEntry
+	{
+		uint32_t id;
+		uint32_t referenceCount;
+	};
+
+	// Small ids packed in the keys, counted by model so the ids of the resources no model use anymore are reused.
+	// Two resources only share an id once more than the bits of their field are in use.
+	struct KeyIds
+	{
+		std::unordered_map<const void*, IdEntry> entries;
+		std::vector<uint32_t> freeIds;
+	};
+
+	std::vector<std::unique_ptr<Model>> models;
+	std::vector<Handle> modelHandles; // Handle of each model
+	std::vector<std::array<KeyResource, KEY_FIELD_COUNT>> modelKeyResources; // Resources in the key of each model
+	std::vector<uint32_t> handleIndices; // Index in models of each handle
+	std::vector<Handle> freeHandles;
+
+	// Kept in the order of the last sort, a frame that changes no order then skips the sort
+	std::vector<DrawPacket> packets;
+	std::vector<DrawPacket> scratchPackets;
+
+	std::array<KeyIds, KEY_FIELD_COUNT> keyIds;
+
+public:
+	/// <summary>
+	/// Take the ownership of the model and store its handle in Model::drawListHandle.
+	/// </summary>
+	Handle Add(Model* model);
+
+	/// <summary>
+	/// Destroy the model of the handle, the last packet takes the place of its packet until the next Sort.
+	/// </summary>
+	void Remove(Handle handle);
+	void Clear();
+
+	/// <summary>
+	/// Update the keys of the packets in the order of the last sort and radix sort them, front to back inside a pipeline, material and mesh.
+	/// </summary>
+	/// <param name="farDistance">Distance mapped to the largest depth in the key</param>
+	void Sort(const glm::vec3& cameraPosition, float farDistance);
+
+	/// <summary>
+	/// The models in the order of the last Sort.
+	/// </summary>
+	const std::vector<DrawPacket>& GetPackets() const;
+
+	/// <summary>
+	/// Every model, in no particular order.
+	/// </summary>
+	const std::vector<std::unique_ptr<Model>>& GetModels() const;
+	size_t GetSize() const;
+
+	/// <summary>
+	/// Sort by key with 8 passes of 8 bits, the passes where every key share the same byte are skipped.
+	/// </summary>
+	/// <returns>Return false if the packets were already sorted and left untouched</returns>
+	static bool RadixSort(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch);
+
+private:
+	/// <summary>
+	/// Release the id of the last resource of the key and acquire the id of the new one if it changed.
+	/// </summary>
+	static uint64_t UpdateKeyResource(KeyIds& ids, KeyResource& keyResource, const void* resource, uint32_t bitCount);
+	static void ReleaseKeyResource(KeyIds& ids, KeyResource& keyResource);
+};
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "Rendering/Mesh.h"
 
 #include "Helper/Log.h"
+#include "Helper/Profiler.h"
+#include "Helper/PerfCounters.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 #define TINYGLTF_IMPLEMENTATION
@@ -11,29 +13,157 @@
 
 #include <unordered_map>
 #include <array>
+#include <algorithm>
+#include <limits>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include "Rendering/Vulkan/VulkanRenderer.h"
+#include "Rendering/MeshSimplifier.h"
+#include "Rendering/MeshletBuilder.h"
 
 const std::string Mesh::PATH = "Assets/Meshs/";
 
+namespace
+{
+	// Textures are loaded separately, don't decode the images embedded in the glTF
+	bool SkipGltfImage(tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn, int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+	{
+		return true;
+	}
+
+	// A mesh placed in the scene, its vertices are baked in the space of the scene
+	struct GltfMeshInstance
+	{
+		int mesh;
+		glm::mat4 transform;
+	};
+
+	glm::mat4 GetNodeTransform(const tinygltf::Node& node)
+	{
+		glm::mat4 transform = glm::mat4(1);
+		if (node.matrix.size() == 16)
+		{
+			for (size_t i = 0; i < 16; i++)
+				glm::value_ptr(transform)[i] = static_cast<float>(node.matrix[i]);
+
+			return transform;
+		}
+
+		// Translation * rotation * scale
+		if (node.translation.size() == 3)
+			transform[3] = glm::vec4(node.translation[0], node.translation[1], node.translation[2], 1);
+		if (node.rotation.size() == 4)
+			transform = transform * glm::mat4_cast(glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])));
+		if (node.scale.size() == 3)
+			transform = transform * glm::mat4(glm::vec4(node.scale[0], 0, 0, 0), glm::vec4(0, node.scale[1], 0, 0), glm::vec4(0, 0, node.scale[2], 0), glm::vec4(0, 0, 0, 1));
+
+		return transform;
+	}
+
+	void AddGltfMeshInstances(const tinygltf::Model& model, int nodeIndex, const glm::mat4& parentTransform, uint32_t depth, const std::string& meshPath, std::vector<GltfMeshInstance>& instances)
+	{
+		// The depth also stops the cycles of a malformed file
+		if (nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= model.nodes.size() || depth > model.nodes.size())
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has an invalid node hierarchy");
+
+		const tinygltf::Node& node = model.nodes[nodeIndex];
+		glm::mat4 transform = parentTransform * GetNodeTransform(node);
+
+		if (node.mesh >= 0)
+		{
+			if (static_cast<size_t>(node.mesh) >= model.meshes.size())
+				Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has a node with an invalid mesh");
+
+			instances.push_back({ node.mesh, transform });
+		}
+
+		for (int child : node.children)
+			AddGltfMeshInstances(model, child, transform, depth + 1, meshPath, instances);
+	}
+
+	const tinygltf::Accessor& GetAccessor(const tinygltf::Model& model, int accessorIndex, const std::string& meshPath)
+	{
+		if (accessorIndex < 0 || static_cast<size_t>(accessorIndex) >= model.accessors.size())
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has an invalid accessor");
+
+		return model.accessors[accessorIndex];
+	}
+
+	// First element of the accessor and the distance in byte between two elements.
+	// Every element must be inside the buffer view and the buffer view inside its buffer.
+	const unsigned char* GetAccessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t& stride, const std::string& meshPath)
+	{
+		if (accessor.bufferView < 0 || static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size())
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has an accessor without valid buffer view");
+
+		const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+		if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= model.buffers.size())
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has a buffer view without valid buffer");
+
+		const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+		int byteStride = accessor.ByteStride(bufferView);
+		size_t elementSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType)) * tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+
+		if (byteStride <= 0 || static_cast<int32_t>(elementSize) <= 0)
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has an accessor of invalid type or stride");
+
+		stride = static_cast<size_t>(byteStride);
+		size_t accessorSize = accessor.count == 0 ? 0 : (accessor.count - 1) * stride + elementSize;
+
+		if (bufferView.byteOffset > buffer.data.size() || bufferView.byteLength > buffer.data.size() - bufferView.byteOffset
+			|| accessor.byteOffset > bufferView.byteLength || accessorSize > bufferView.byteLength - accessor.byteOffset)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has an accessor out of its buffer");
+		}
+
+		return buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+	}
+
+	// Copy a float attribute in the interleaved vertices, extra components are dropped
+	template<typename T>
+	bool CopyGltfAttribute(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string& name, VulkanHelper::Vertex* vertices, uint32_t vertexCount, T VulkanHelper::Vertex::* member, const std::string& meshPath)
+	{
+		auto attribute = primitive.attributes.find(name);
+		if (attribute == primitive.attributes.end())
+			return false;
+
+		const tinygltf::Accessor& accessor = GetAccessor(model, attribute->second, meshPath);
+		if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.bufferView < 0)
+		{
+			Logger::Log(LogSeverity::WARNING, "glTF attribute " + name + " is not stored as float, ignored");
+			return false;
+		}
+
+		if (accessor.count != vertexCount)
+			Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has a " + name + " attribute of another count than POSITION");
+
+		size_t stride;
+		const unsigned char* data = GetAccessorData(model, accessor, stride, meshPath);
+		size_t size = std::min(sizeof(T), tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type)) * sizeof(float));
+
+		for (size_t i = 0; i < accessor.count; i++)
+			memcpy(&(vertices[i].*member), data + i * stride, size);
+
+		return true;
+	}
+}
+
 Mesh::Mesh(std::string meshName, MeshFormat meshFormat, bool isGltfBinary)
 {
+	PROFILE_FUNCTION();
+
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 	VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
 	VkQueue graphicQueue = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetGraphicsQueue();
 	VkCommandPool globalCommandPool = VulkanRenderer::GetInstance()->GetGlobalCommandPool();
 
-	// load mesh
-	std::string meshPath = PATH + meshName;
+	LoadFile(meshName, meshFormat, isGltfBinary);
 
-	switch (meshFormat)
-	{
-		case Mesh::OBJ:
-			ObjLoader(meshPath);
-			break;
-		case Mesh::GLTF:
-			GltfLoader(meshPath, isGltfBinary); // Not finished do not load
-			break;
-	}
+	ComputeBoundingSphere();
+	GenerateLods();
+	// After the lods, they are simplified from the triangles in their loaded order and only the submeshes, the full resolution lod, are reordered
+	BuildMeshlets();
+	BuildOccluder();
 
 	//Create buffer
 
@@ -42,45 +172,113 @@ Mesh::Mesh(std::string meshName, MeshFormat meshFormat, bool isGltfBinary)
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
-	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::STAGING);
 
 	void* data;
 	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
 	memcpy(data, vertices.data(), (size_t)bufferSize);
 	vkUnmapMemory(device, stagingBufferMemory);
 
-	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory, MemoryCategory::MESH);
 
 	VulkanHelper::CopyBuffer(stagingBuffer, vertexBuffer, bufferSize);
 
 	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	VulkanHelper::FreeMemory(device, stagingBufferMemory);
+
+	// Position, written straight in the staging buffer
+	bufferSize = sizeof(glm::vec3) * vertices.size();
+
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::STAGING);
+
+	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+	glm::vec3* positions = static_cast<glm::vec3*>(data);
+	for (size_t i = 0; i < vertices.size(); i++)
+		positions[i] = vertices[i].pos;
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, positionBuffer, positionBufferMemory, MemoryCategory::MESH);
+
+	VulkanHelper::CopyBuffer(stagingBuffer, positionBuffer, bufferSize);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, stagingBufferMemory);
 
 	// Index buffer
-	bufferSize = sizeof(indices[0]) * indices.size();
+	const void* indexData = indexType == VK_INDEX_TYPE_UINT16 ? static_cast<const void*>(indices16.data()) : static_cast<const void*>(indices.data());
+	bufferSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(indices16[0]) * indices16.size() : sizeof(indices[0]) * indices.size();
 
-	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::STAGING);
 
 	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
+	memcpy(data, indexData, (size_t)bufferSize);
 	vkUnmapMemory(device, stagingBufferMemory);
 
-	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory, MemoryCategory::MESH);
 
 	VulkanHelper::CopyBuffer(stagingBuffer, indexBuffer, bufferSize);
 
 	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	VulkanHelper::FreeMemory(device, stagingBufferMemory);
+
+	// Meshlet buffer
+	if (meshlets.empty())
+		return;
+
+	bufferSize = sizeof(meshlets[0]) * meshlets.size();
+
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::STAGING);
+
+	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+	memcpy(data, meshlets.data(), (size_t)bufferSize);
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshletBuffer, meshletBufferMemory, MemoryCategory::MESH);
+
+	VulkanHelper::CopyBuffer(stagingBuffer, meshletBuffer, bufferSize);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, stagingBufferMemory);
+}
+
+Mesh::Mesh()
+{
+}
+
+std::unique_ptr<Mesh> Mesh::LoadVertices(std::string meshName, MeshFormat meshFormat, bool isGltfBinary)
+{
+	std::unique_ptr<Mesh> mesh = std::unique_ptr<Mesh>(new Mesh());
+	mesh->LoadFile(meshName, meshFormat, isGltfBinary);
+
+	return mesh;
+}
+
+void Mesh::LoadFile(std::string meshName, MeshFormat meshFormat, bool isGltfBinary)
+{
+	std::string meshPath = PATH + meshName;
+
+	switch (meshFormat)
+	{
+		case Mesh::OBJ:
+			ObjLoader(meshPath);
+			break;
+		case Mesh::GLTF:
+			GltfLoader(meshPath, isGltfBinary);
+			break;
+	}
 }
 
 void Mesh::GltfLoader(std::string& meshPath, bool isGltfBinary)
 {
-	/*using namespace tinygltf;
-	Model model;
-	TinyGLTF loader;
+	PROFILE_FUNCTION();
+
+	tinygltf::Model model;
+	tinygltf::TinyGLTF loader;
 	std::string err;
 	std::string warn;
 
+	loader.SetImageLoader(SkipGltfImage, nullptr);
+
 	bool ret;
 
 	if (isGltfBinary)
@@ -89,17 +287,214 @@ void Mesh::GltfLoader(std::string& meshPath, bool isGltfBinary)
 		ret = loader.LoadASCIIFromFile(&model, &err, &warn, meshPath);
 
 	if (!warn.empty())
-		Logger::Log(LogSeverity::FATAL_ERROR, "Warn: " + warn);
-	if (!err.empty())
-		Logger::Log(LogSeverity::FATAL_ERROR, "Err: " + err);
+		Logger::Log(LogSeverity::WARNING, warn);
 	if (!ret)
-		Logger::Log(LogSeverity::FATAL_ERROR, "Failed to parse glTF");*/
+		Logger::Log(LogSeverity::FATAL_ERROR, "Failed to parse glTF " + meshPath + ": " + err);
+
+	// Every mesh where the nodes of the scene place it, or every mesh as is in a file without scene
+	std::vector<GltfMeshInstance> instances;
+	if (!model.scenes.empty())
+	{
+		bool validDefaultScene = model.defaultScene >= 0 && static_cast<size_t>(model.defaultScene) < model.scenes.size();
+		for (int node : model.scenes[validDefaultScene ? model.defaultScene : 0].nodes)
+			AddGltfMeshInstances(model, node, glm::mat4(1), 0, meshPath, instances);
+	}
+	else
+	{
+		for (size_t i = 0; i < model.meshes.size(); i++)
+			instances.push_back({ static_cast<int>(i), glm::mat4(1) });
+	}
+
+	// Size everything first and keep 16 bit indices if every primitive fit in them
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	indexType = VK_INDEX_TYPE_UINT16;
+
+	for (const GltfMeshInstance& instance : instances)
+	{
+		for (const auto& primitive : model.meshes[instance.mesh].primitives)
+		{
+			if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.attributes.count("POSITION") == 0)
+				continue;
+
+			size_t primitiveVertexCount = GetAccessor(model, primitive.attributes.at("POSITION"), meshPath).count;
+			vertexCount += primitiveVertexCount;
+
+			if (primitive.indices >= 0)
+			{
+				const tinygltf::Accessor& accessor = GetAccessor(model, primitive.indices, meshPath);
+				indexCount += accessor.count;
+
+				if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+					indexType = VK_INDEX_TYPE_UINT32;
+			}
+			else
+			{
+				indexCount += primitiveVertexCount;
+
+				if (primitiveVertexCount > std::numeric_limits<uint16_t>::max() + size_t(1))
+					indexType = VK_INDEX_TYPE_UINT32;
+			}
+		}
+	}
+
+	VulkanHelper::Vertex defaultVertex = {};
+	defaultVertex.normal = glm::vec3(0, 0, 1);
+	defaultVertex.color = glm::vec3(1);
+	vertices.resize(vertexCount, defaultVertex);
+
+	size_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	unsigned char* indexData;
+	if (indexType == VK_INDEX_TYPE_UINT16)
+	{
+		indices16.resize(indexCount);
+		indexData = reinterpret_cast<unsigned char*>(indices16.data());
+	}
+	else
+	{
+		indices.resize(indexCount);
+		indexData = reinterpret_cast<unsigned char*>(indices.data());
+	}
+
+	std::vector<size_t> submeshesWithoutTangent;
+
+	for (const GltfMeshInstance& instance : instances)
+	{
+		// A mirroring transform also flips the winding and the handedness of the tangent space
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.transform)));
+		float handedness = glm::determinant(glm::mat3(instance.transform)) < 0 ? -1.0f : 1.0f;
+
+		for (const auto& primitive : model.meshes[instance.mesh].primitives)
+		{
+			if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.attributes.count("POSITION") == 0)
+			{
+				Logger::Log(LogSeverity::WARNING, "glTF primitive without triangles or position in " + meshPath + " ignored");
+				continue;
+			}
+
+			Submesh submesh = {};
+			submesh.vertexOffset = submeshes.empty() ? 0 : submeshes.back().vertexOffset + submeshes.back().vertexCount;
+			submesh.firstIndex = submeshes.empty() ? 0 : submeshes.back().firstIndex + submeshes.back().indexCount;
+			submesh.vertexCount = static_cast<uint32_t>(GetAccessor(model, primitive.attributes.at("POSITION"), meshPath).count);
+
+			VulkanHelper::Vertex* primitiveVertices = vertices.data() + submesh.vertexOffset;
+
+			CopyGltfAttribute(model, primitive, "POSITION", primitiveVertices, submesh.vertexCount, &VulkanHelper::Vertex::pos, meshPath);
+			CopyGltfAttribute(model, primitive, "NORMAL", primitiveVertices, submesh.vertexCount, &VulkanHelper::Vertex::normal, meshPath);
+			CopyGltfAttribute(model, primitive, "TEXCOORD_0", primitiveVertices, submesh.vertexCount, &VulkanHelper::Vertex::texCoord, meshPath);
+			CopyGltfAttribute(model, primitive, "COLOR_0", primitiveVertices, submesh.vertexCount, &VulkanHelper::Vertex::color, meshPath);
+
+			// Bake the node transform
+			if (instance.transform != glm::mat4(1))
+			{
+				for (uint32_t i = 0; i < submesh.vertexCount; i++)
+				{
+					primitiveVertices[i].pos = glm::vec3(instance.transform * glm::vec4(primitiveVertices[i].pos, 1));
+					primitiveVertices[i].normal = glm::normalize(normalMatrix * primitiveVertices[i].normal);
+				}
+			}
+
+			auto tangentAttribute = primitive.attributes.find("TANGENT");
+			if (tangentAttribute != primitive.attributes.end() && GetAccessor(model, tangentAttribute->second, meshPath).componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+			{
+				const tinygltf::Accessor& accessor = model.accessors[tangentAttribute->second];
+				if (accessor.count != submesh.vertexCount || accessor.type != TINYGLTF_TYPE_VEC4)
+					Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has a TANGENT attribute that isn't a vec4 per vertex");
+
+				size_t stride;
+				const unsigned char* data = GetAccessorData(model, accessor, stride, meshPath);
+
+				for (size_t i = 0; i < submesh.vertexCount; i++)
+				{
+					// w is the handedness of the tangent space
+					glm::vec4 tangent;
+					memcpy(&tangent, data + i * stride, sizeof(tangent));
+					primitiveVertices[i].tangent = glm::normalize(glm::mat3(instance.transform) * glm::vec3(tangent));
+					primitiveVertices[i].biTangent = glm::cross(primitiveVertices[i].normal, primitiveVertices[i].tangent) * tangent.w * handedness;
+				}
+			}
+			else
+				submeshesWithoutTangent.push_back(submeshes.size());
+
+			unsigned char* primitiveIndices = indexData + submesh.firstIndex * indexSize;
+
+			if (primitive.indices >= 0)
+			{
+				const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
+				submesh.indexCount = static_cast<uint32_t>(accessor.count);
+
+				size_t stride;
+				const unsigned char* data = GetAccessorData(model, accessor, stride, meshPath);
+				size_t componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+
+				// Same layout as our index buffer, the buffer view is copied as is
+				if (componentSize == indexSize && stride == indexSize)
+					memcpy(primitiveIndices, data, accessor.count * indexSize);
+				else
+				{
+					for (size_t i = 0; i < accessor.count; i++)
+					{
+						uint32_t index = 0;
+						if (componentSize == sizeof(uint8_t))
+							index = data[i * stride];
+						else if (componentSize == sizeof(uint16_t))
+							index = *reinterpret_cast<const uint16_t*>(data + i * stride);
+						else
+							index = *reinterpret_cast<const uint32_t*>(data + i * stride);
+
+						if (indexType == VK_INDEX_TYPE_UINT16)
+							reinterpret_cast<uint16_t*>(primitiveIndices)[i] = static_cast<uint16_t>(index);
+						else
+							reinterpret_cast<uint32_t*>(primitiveIndices)[i] = index;
+					}
+				}
+			}
+			else
+			{
+				// Not indexed, every vertex is used once
+				submesh.indexCount = submesh.vertexCount;
+				for (uint32_t i = 0; i < submesh.vertexCount; i++)
+				{
+					if (indexType == VK_INDEX_TYPE_UINT16)
+						reinterpret_cast<uint16_t*>(primitiveIndices)[i] = static_cast<uint16_t>(i);
+					else
+						reinterpret_cast<uint32_t*>(primitiveIndices)[i] = i;
+				}
+			}
 
-	//model.meshes[0].primitives[0].
+			// The lods, meshlets and tangents read the vertices of every index
+			for (uint32_t i = 0; i < submesh.indexCount; i++)
+			{
+				uint32_t index = indexType == VK_INDEX_TYPE_UINT16 ? reinterpret_cast<uint16_t*>(primitiveIndices)[i] : reinterpret_cast<uint32_t*>(primitiveIndices)[i];
+				if (index >= submesh.vertexCount)
+					Logger::Log(LogSeverity::FATAL_ERROR, "glTF " + meshPath + " has an index out of its primitive vertices");
+			}
+
+			if (handedness < 0)
+			{
+				for (uint32_t i = 0; i + 2 < submesh.indexCount; i += 3)
+				{
+					if (indexType == VK_INDEX_TYPE_UINT16)
+						std::swap(reinterpret_cast<uint16_t*>(primitiveIndices)[i + 1], reinterpret_cast<uint16_t*>(primitiveIndices)[i + 2]);
+					else
+						std::swap(reinterpret_cast<uint32_t*>(primitiveIndices)[i + 1], reinterpret_cast<uint32_t*>(primitiveIndices)[i + 2]);
+				}
+			}
+
+			submeshes.push_back(submesh);
+		}
+	}
+
+	for (size_t submesh : submeshesWithoutTangent)
+		ComputeTangents(submeshes[submesh]);
+
+	Logger::Log("glTF loaded: " + meshPath + " " + std::to_string(submeshes.size()) + " submeshes");
 }
 
 void Mesh::ObjLoader(std::string& meshPath)
 {
+	PROFILE_FUNCTION();
+
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -161,14 +556,37 @@ void Mesh::ObjLoader(std::string& meshPath)
 		}
 	}
 
-	std::vector<std::vector<glm::vec3>> tangents = std::vector<std::vector<glm::vec3>>(vertices.size(), std::vector<glm::vec3>());
-	std::vector<std::vector<glm::vec3>> biTangents = std::vector<std::vector<glm::vec3>>(vertices.size(), std::vector<glm::vec3>());
+	Submesh submesh = {};
+	submesh.indexCount = static_cast<uint32_t>(indices.size());
+	submesh.vertexCount = static_cast<uint32_t>(vertices.size());
+	submeshes.push_back(submesh);
+
+	ComputeTangents(submesh);
+}
 
-	for (size_t i = 0; i < indices.size(); i += 3)
+void Mesh::ComputeTangents()
+{
+	for (const Submesh& submesh : submeshes)
+		ComputeTangents(submesh);
+}
+
+void Mesh::ComputeTangents(const Submesh& submesh)
+{
+	VulkanHelper::Vertex* submeshVertices = vertices.data() + submesh.vertexOffset;
+
+	std::vector<glm::vec3> tangents = std::vector<glm::vec3>(submesh.vertexCount, glm::vec3(0));
+	std::vector<glm::vec3> biTangents = std::vector<glm::vec3>(submesh.vertexCount, glm::vec3(0));
+	std::vector<uint32_t> triangleCounts = std::vector<uint32_t>(submesh.vertexCount, 0);
+
+	for (size_t i = submesh.firstIndex; i + 2 < submesh.firstIndex + submesh.indexCount; i += 3)
 	{
-		VulkanHelper::Vertex& vertex0 = vertices[indices[i + 0]];
-		VulkanHelper::Vertex& vertex1 = vertices[indices[i + 1]];
-		VulkanHelper::Vertex& vertex2 = vertices[indices[i + 2]];
+		uint32_t index0 = GetIndex(i + 0);
+		uint32_t index1 = GetIndex(i + 1);
+		uint32_t index2 = GetIndex(i + 2);
+
+		VulkanHelper::Vertex& vertex0 = submeshVertices[index0];
+		VulkanHelper::Vertex& vertex1 = submeshVertices[index1];
+		VulkanHelper::Vertex& vertex2 = submeshVertices[index2];
 
 		// Edges of the triangle : position delta
 		glm::vec3 deltaPos1 = vertex1.pos - vertex0.pos;
@@ -182,41 +600,48 @@ void Mesh::ObjLoader(std::string& meshPath)
 		glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
 		glm::vec3 biTangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
 
-		tangents[indices[i + 0]].push_back(tangent);
-		tangents[indices[i + 1]].push_back(tangent);
-		tangents[indices[i + 2]].push_back(tangent);
-		biTangents[indices[i + 0]].push_back(biTangent);
-		biTangents[indices[i + 1]].push_back(biTangent);
-		biTangents[indices[i + 2]].push_back(biTangent);
+		for (uint32_t index : {index0, index1, index2})
+		{
+			tangents[index] += tangent;
+			biTangents[index] += biTangent;
+			triangleCounts[index]++;
+		}
 	}
 
-	for (size_t i = 0; i < tangents.size(); i++)
+	// Average of the tangent of every triangle using the vertex
+	for (size_t i = 0; i < submesh.vertexCount; i++)
 	{
-		glm::vec3 average = glm::vec3(0);
-		for (size_t y = 0; y < tangents[i].size(); y++)
-		{
-			average += tangents[i][y];
-		}
-		vertices[i].tangent = average / (float)tangents[i].size();
+		if (triangleCounts[i] == 0)
+			continue;
 
-		average = glm::vec3(0);
-		for (size_t y = 0; y < biTangents[i].size(); y++)
-		{
-			average += biTangents[i][y];
-		}
-		vertices[i].biTangent = average / (float)biTangents[i].size();
+		submeshVertices[i].tangent = tangents[i] / (float)triangleCounts[i];
+		submeshVertices[i].biTangent = biTangents[i] / (float)triangleCounts[i];
 	}
 }
 
+uint32_t Mesh::GetIndex(size_t i) const
+{
+	return indexType == VK_INDEX_TYPE_UINT16 ? indices16[i] : indices[i];
+}
+
 Mesh::~Mesh()
 {
+	if (vertexBuffer == nullptr)
+		return;
+
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	VulkanHelper::FreeMemory(device, vertexBufferMemory);
+
+	vkDestroyBuffer(device, positionBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, positionBufferMemory);
 
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
+	VulkanHelper::FreeMemory(device, indexBufferMemory);
+
+	vkDestroyBuffer(device, meshletBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, meshletBufferMemory);
 
 	Logger::Log("Mesh destroyed");
 }
@@ -226,10 +651,250 @@ void Mesh::CmdBind(VkCommandBuffer commandBuffer)
 	VkBuffer vertexBuffers[] = {vertexBuffer};
 	VkDeviceSize offsets[] = {0};
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+	PerfCounters::Add(PerfCounter::VERTEX_BUFFER_BINDS);
 }
 
-void Mesh::CmdDraw(VkCommandBuffer commandBuffer)
+void Mesh::CmdBindPositions(VkCommandBuffer commandBuffer)
 {
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+	VkBuffer vertexBuffers[] = {positionBuffer};
+	VkDeviceSize offsets[] = {0};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+	PerfCounters::Add(PerfCounter::VERTEX_BUFFER_BINDS);
+}
+
+void Mesh::CmdDraw(VkCommandBuffer commandBuffer, uint32_t lod)
+{
+	if (lod == 0 || lods.size() <= 1)
+	{
+		for (const auto& submesh : submeshes)
+			vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, submesh.vertexOffset, 0);
+		PerfCounters::Add(PerfCounter::DRAW_CALLS, submeshes.size());
+		return;
+	}
+
+	const Lod& drawnLod = lods[std::min(lod, static_cast<uint32_t>(lods.size()) - 1)];
+	vkCmdDrawIndexed(commandBuffer, drawnLod.indexCount, 1, drawnLod.firstIndex, 0, 0);
+	PerfCounters::Add(PerfCounter::DRAW_CALLS);
+}
+
+void Mesh::GetDrawCommands(uint32_t lod, std::vector<VkDrawIndexedIndirectCommand>& drawCommands) const
+{
+	if (lod == 0 || lods.size() <= 1)
+	{
+		for (const auto& submesh : submeshes)
+			drawCommands.push_back({submesh.indexCount, 1, submesh.firstIndex, submesh.vertexOffset, 0});
+		return;
+	}
+
+	const Lod& drawnLod = lods[std::min(lod, static_cast<uint32_t>(lods.size()) - 1)];
+	drawCommands.push_back({drawnLod.indexCount, 1, drawnLod.firstIndex, 0, 0});
+}
+
+uint32_t Mesh::SelectLod(float screenSize, float screenHeight, float pixelError, float hysteresis, uint32_t currentLod) const
+{
+	// The object need to shrink a bit past the threshold before going coarser and grow a bit past it before going finer
+	uint32_t coarsestLodIfBigger = SelectLod(screenSize * (1.0f + hysteresis), screenHeight, pixelError);
+	uint32_t coarsestLodIfSmaller = SelectLod(screenSize * (1.0f - hysteresis), screenHeight, pixelError);
+
+	if (currentLod < coarsestLodIfBigger)
+		return coarsestLodIfBigger;
+	if (currentLod > coarsestLodIfSmaller)
+		return coarsestLodIfSmaller;
+
+	return currentLod;
 }
+
+uint32_t Mesh::SelectLod(float screenSize, float screenHeight, float pixelError) const
+{
+	if (boundingSphereRadius <= 0)
+		return 0;
+
+	// Projected error of a lod: its error relative to the object diameter times the object size on screen
+	float pixelPerUnit = screenSize * screenHeight / (2.0f * boundingSphereRadius);
+
+	for (uint32_t i = static_cast<uint32_t>(lods.size()) - 1; i > 0; i--)
+	{
+		if (lods[i].error * pixelPerUnit <= pixelError)
+			return i;
+	}
+
+	return 0;
+}
+
+uint32_t Mesh::GetLodCount() const
+{
+	return static_cast<uint32_t>(lods.size());
+}
+
+uint32_t Mesh::GetSubmeshCount() const
+{
+	return static_cast<uint32_t>(submeshes.size());
+}
+
+uint32_t Mesh::GetMeshletCount() const
+{
+	return static_cast<uint32_t>(meshlets.size());
+}
+
+VkBuffer Mesh::GetMeshletBuffer() const
+{
+	return meshletBuffer;
+}
+
+uint32_t Mesh::GetTriangleCount(uint32_t lod) const
+{
+	return lods[std::min(lod, static_cast<uint32_t>(lods.size()) - 1)].indexCount / 3;
+}
+
+uint32_t Mesh::GetVertexCount() const
+{
+	return static_cast<uint32_t>(vertices.size());
+}
+
+const std::vector<glm::vec3>& Mesh::GetOccluderVertices() const
+{
+	return occluderVertices;
+}
+
+const std::vector<uint32_t>& Mesh::GetOccluderIndices() const
+{
+	return occluderIndices;
+}
+
+glm::vec3 Mesh::GetBoundingSphereCenter() const
+{
+	return boundingSphereCenter;
+}
+
+float Mesh::GetBoundingSphereRadius() const
+{
+	return boundingSphereRadius;
+}
+
+void Mesh::ComputeBoundingSphere()
+{
+	if (vertices.empty())
+		return;
+
+	glm::vec3 min = vertices[0].pos;
+	glm::vec3 max = vertices[0].pos;
+
+	for (const auto& vertex : vertices)
+	{
+		min = glm::min(min, vertex.pos);
+		max = glm::max(max, vertex.pos);
+	}
+
+	boundingSphereCenter = (min + max) * 0.5f;
+
+	boundingSphereRadius = 0;
+	for (const auto& vertex : vertices)
+	{
+		boundingSphereRadius = std::max(boundingSphereRadius, glm::length(vertex.pos - boundingSphereCenter));
+	}
+}
+
+void Mesh::BuildMeshlets()
+{
+	PROFILE_FUNCTION();
+
+	for (const auto& submesh : submeshes)
+	{
+		std::vector<uint32_t> submeshIndices(submesh.indexCount);
+		for (uint32_t i = 0; i < submesh.indexCount; i++)
+			submeshIndices[i] = GetIndex(submesh.firstIndex + i);
+
+		std::vector<VulkanHelper::Meshlet> submeshMeshlets = MeshletBuilder::Build(vertices.data() + submesh.vertexOffset, submeshIndices);
+
+		// Write back the triangles in meshlet order
+		for (uint32_t i = 0; i < submesh.indexCount; i++)
+		{
+			if (indexType == VK_INDEX_TYPE_UINT16)
+				indices16[submesh.firstIndex + i] = static_cast<uint16_t>(submeshIndices[i]);
+			else
+				indices[submesh.firstIndex + i] = submeshIndices[i];
+		}
+
+		for (auto& meshlet : submeshMeshlets)
+		{
+			meshlet.firstIndex += submesh.firstIndex;
+			meshlet.vertexOffset = submesh.vertexOffset;
+			meshlets.push_back(meshlet);
+		}
+	}
+
+	Logger::Log("Mesh meshlets built: " + std::to_string(meshlets.size()));
+}
+
+void Mesh::GenerateLods()
+{
+	PROFILE_FUNCTION();
+
+	Lod fullResolution = {};
+	fullResolution.indexCount = static_cast<uint32_t>(indexType == VK_INDEX_TYPE_UINT16 ? indices16.size() : indices.size());
+	lods.push_back(fullResolution);
+
+	// Multi primitive meshes come from glTF, they are loaded as is
+	if (indexType != VK_INDEX_TYPE_UINT32 || submeshes.size() != 1)
+		return;
+
+	// Every lod is simplified from the previous one and appended to the same index buffer
+	std::vector<uint32_t> previousIndices = indices;
+	float maxError = boundingSphereRadius * 0.25f;
+
+	while (lods.size() < MAX_LOD_COUNT)
+	{
+		float error = 0;
+		std::vector<uint32_t> lodIndices = MeshSimplifier::Simplify(vertices, previousIndices, previousIndices.size() / 2, maxError, &error);
+
+		// Not worth a level if we barely removed anything
+		if (lodIndices.empty() || lodIndices.size() > previousIndices.size() * 3 / 4)
+			break;
+
+		Lod lod = {};
+		lod.firstIndex = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.error = lods.back().error + error;
+		lods.push_back(lod);
+
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		previousIndices = std::move(lodIndices);
+	}
+
+	Logger::Log("Mesh lod generated: " + std::to_string(lods.size()) + " levels");
+}
+
+void Mesh::BuildOccluder()
+{
+	PROFILE_FUNCTION();
+
+	const Lod& coarsestLod = lods.back();
+	if (coarsestLod.indexCount / 3 > MAX_OCCLUDER_TRIANGLES)
+		return;
+
+	// Only keep the position of the vertices used by the coarsest lod
+	std::unordered_map<uint32_t, uint32_t> remap;
+	auto addIndex = [&](uint32_t index)
+	{
+		auto inserted = remap.emplace(index, static_cast<uint32_t>(occluderVertices.size()));
+		if (inserted.second)
+			occluderVertices.push_back(vertices[index].pos);
+		occluderIndices.push_back(inserted.first->second);
+	};
+
+	if (lods.size() > 1)
+	{
+		for (uint32_t i = coarsestLod.firstIndex; i < coarsestLod.firstIndex + coarsestLod.indexCount; i++)
+			addIndex(indices[i]);
+	}
+	else
+	{
+		for (const auto& submesh : submeshes)
+		{
+			for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i++)
+				addIndex(GetIndex(i) + submesh.vertexOffset);
+		}
+	}
+}
\ No newline at end of file
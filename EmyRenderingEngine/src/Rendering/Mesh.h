@@ -5,6 +5,7 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <memory>
 
 class Mesh
 {
@@ -14,26 +15,113 @@ public:
 		OBJ,
 		GLTF
 	};
+
+	static const uint32_t MAX_LOD_COUNT = 5;
+	static const uint32_t MAX_OCCLUDER_TRIANGLES = 512;
+
+	// Range of the index buffer used by one level of detail
+	struct Lod
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0; // Distance from the full resolution surface in mesh unit
+	};
+
+	// One glTF primitive, indices are relative to vertexOffset
+	struct Submesh
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+	};
+
 private:
 	static const std::string PATH;
 
 	std::vector<VulkanHelper::Vertex> vertices;
 	std::vector<uint32_t> indices;
+	std::vector<uint16_t> indices16; // Used instead of indices when indexType is VK_INDEX_TYPE_UINT16
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	std::vector<Submesh> submeshes;
+	std::vector<Lod> lods;
+	std::vector<VulkanHelper::Meshlet> meshlets; // Clusters of the full resolution lod
+	std::vector<glm::vec3> occluderVertices; // Coarsest lod used by the software occlusion culling
+	std::vector<uint32_t> occluderIndices;
 
-	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
-	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
+	glm::vec3 boundingSphereCenter = glm::vec3(0);
+	float boundingSphereRadius = 0;
+
+	VkBuffer vertexBuffer = nullptr; // Null when only the vertices were loaded
+	VkDeviceMemory vertexBufferMemory = nullptr;
+	VkBuffer positionBuffer = nullptr; // Position only copy of the vertices for the depth prepass
+	VkDeviceMemory positionBufferMemory = nullptr;
+	VkBuffer indexBuffer = nullptr;
+	VkDeviceMemory indexBufferMemory = nullptr;
+	VkBuffer meshletBuffer = nullptr;
+	VkDeviceMemory meshletBufferMemory = nullptr;
 
 public:
 	Mesh(std::string meshName, MeshFormat meshFormat, bool isGltfBinary = true);
 	~Mesh();
 
+	/// <summary>
+	/// Only run the loader of the format, nothing is built nor uploaded so it works without a renderer.
+	/// The mesh can't be drawn, it's used to measure the loaders.
+	/// </summary>
+	static std::unique_ptr<Mesh> LoadVertices(std::string meshName, MeshFormat meshFormat, bool isGltfBinary = true);
+
+	/// <summary>
+	/// Compute again the tangents of every submesh.
+	/// </summary>
+	void ComputeTangents();
+
 	void CmdBind(VkCommandBuffer commandBuffer);
-	void CmdDraw(VkCommandBuffer commandBuffer);
+
+	/// <summary>
+	/// Bind the position only vertex stream and the index buffer, used by the depth prepass.
+	/// </summary>
+	void CmdBindPositions(VkCommandBuffer commandBuffer);
+	void CmdDraw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+
+	/// <summary>
+	/// Append the draws CmdDraw would record for this lod, with an instance count of 1.
+	/// </summary>
+	void GetDrawCommands(uint32_t lod, std::vector<VkDrawIndexedIndirectCommand>& drawCommands) const;
+
+	/// <summary>
+	/// Select the coarsest level of detail whose error stay under pixelError once projected.
+	/// </summary>
+	/// <param name="screenSize">Projected radius of the bounding sphere over half the viewport height, the diameter over the screen height</param>
+	/// <param name="screenHeight">Screen height in pixel</param>
+	/// <param name="pixelError">Max error allowed in pixel</param>
+	/// <param name="hysteresis">Fraction of screenSize the object need to move past a threshold before switching</param>
+	/// <param name="currentLod">The level of detail used last frame</param>
+	uint32_t SelectLod(float screenSize, float screenHeight, float pixelError, float hysteresis, uint32_t currentLod) const;
+
+	uint32_t GetLodCount() const;
+	uint32_t GetSubmeshCount() const;
+	uint32_t GetMeshletCount() const;
+	VkBuffer GetMeshletBuffer() const;
+	uint32_t GetTriangleCount(uint32_t lod = 0) const;
+	uint32_t GetVertexCount() const;
+	glm::vec3 GetBoundingSphereCenter() const;
+	const std::vector<glm::vec3>& GetOccluderVertices() const;
+	const std::vector<uint32_t>& GetOccluderIndices() const;
+	float GetBoundingSphereRadius() const;
 
 private:
+	Mesh();
+
+	void LoadFile(std::string meshName, MeshFormat meshFormat, bool isGltfBinary);
 	void GltfLoader(std::string& meshPath, bool isGltfBinary);
 	void ObjLoader(std::string& meshPath);
+	void ComputeTangents(const Submesh& submesh);
+	uint32_t GetIndex(size_t i) const;
+	void ComputeBoundingSphere();
+	void BuildMeshlets();
+	void GenerateLods();
+	void BuildOccluder();
+	uint32_t SelectLod(float screenSize, float screenHeight, float pixelError) const;
 
 };
\ No newline at end of file
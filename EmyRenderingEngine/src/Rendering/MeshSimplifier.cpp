@@ -0,0 +1,300 @@
+#include "Rendering/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+	// Symmetric 4x4 matrix of the sum of squared distance to a set of plane
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+		double weight = 0;
+
+		void AddPlane(const glm::dvec3& normal, double distance, double planeWeight)
+		{
+			a00 += planeWeight * normal.x * normal.x;
+			a01 += planeWeight * normal.x * normal.y;
+			a02 += planeWeight * normal.x * normal.z;
+			a03 += planeWeight * normal.x * distance;
+			a11 += planeWeight * normal.y * normal.y;
+			a12 += planeWeight * normal.y * normal.z;
+			a13 += planeWeight * normal.y * distance;
+			a22 += planeWeight * normal.z * normal.z;
+			a23 += planeWeight * normal.z * distance;
+			a33 += planeWeight * distance * distance;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+			a11 += other.a11; a12 += other.a12; a13 += other.a13;
+			a22 += other.a22; a23 += other.a23;
+			a33 += other.a33;
+			weight += other.weight;
+		}
+
+		// Weighted mean of the squared distance between the point and the planes
+		double Error(const glm::vec3& point) const
+		{
+			double x = point.x, y = point.y, z = point.z;
+
+			double error =
+				a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+				a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+				a22 * z * z + 2 * a23 * z +
+				a33;
+
+			return weight > 0 ? std::max(error, 0.0) / weight : 0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	// Do moving "from" onto "to" flip one of the triangle around "from"
+	bool HasFlip(const std::vector<VulkanHelper::Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangleOffsets, const std::vector<uint32_t>& triangleList, uint32_t from, uint32_t to)
+	{
+		const glm::vec3& newPosition = vertices[to].pos;
+
+		for (uint32_t i = triangleOffsets[from]; i < triangleOffsets[from + 1]; i++)
+		{
+			size_t triangle = triangleList[i] * 3;
+			uint32_t a = indices[triangle + 0];
+			uint32_t b = indices[triangle + 1];
+			uint32_t c = indices[triangle + 2];
+
+			// This triangle will be removed by the collapse
+			if (a == to || b == to || c == to)
+				continue;
+
+			glm::vec3 oldNormal = glm::cross(vertices[b].pos - vertices[a].pos, vertices[c].pos - vertices[a].pos);
+
+			glm::vec3 pa = a == from ? newPosition : vertices[a].pos;
+			glm::vec3 pb = b == from ? newPosition : vertices[b].pos;
+			glm::vec3 pc = c == from ? newPosition : vertices[c].pos;
+			glm::vec3 newNormal = glm::cross(pb - pa, pc - pa);
+
+			if (glm::dot(oldNormal, newNormal) <= 0.0f)
+				return true;
+		}
+
+		return false;
+	}
+}
+
+namespace MeshSimplifier
+{
+	std::vector<uint32_t> Simplify(const std::vector<VulkanHelper::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError, float* resultError)
+	{
+		std::vector<uint32_t> result = indices;
+		double worstError = 0;
+		double maxErrorSquared = double(maxError) * double(maxError);
+
+		size_t vertexCount = vertices.size();
+		std::vector<bool> locked(vertexCount, false);
+
+		// Lock vertices that share their position with another vertex (uv or normal seam)
+		std::unordered_map<glm::vec3, uint32_t> firstVertexAtPosition;
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			auto inserted = firstVertexAtPosition.emplace(vertices[i].pos, i);
+			if (!inserted.second)
+			{
+				locked[i] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+
+		// Lock vertices on an open border
+		std::unordered_map<uint64_t, uint32_t> edgeUseCount;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			edgeUseCount[EdgeKey(result[i + 0], result[i + 1])]++;
+			edgeUseCount[EdgeKey(result[i + 1], result[i + 2])]++;
+			edgeUseCount[EdgeKey(result[i + 2], result[i + 0])]++;
+		}
+		for (const auto& edge : edgeUseCount)
+		{
+			if (edge.second == 1)
+			{
+				locked[edge.first >> 32] = true;
+				locked[edge.first & 0xFFFFFFFF] = true;
+			}
+		}
+
+		// Area weighted quadric of the planes around each vertex
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			glm::dvec3 p0 = vertices[result[i + 0]].pos;
+			glm::dvec3 p1 = vertices[result[i + 1]].pos;
+			glm::dvec3 p2 = vertices[result[i + 2]].pos;
+
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			double length = glm::length(normal);
+
+			if (length <= 0)
+				continue;
+
+			normal /= length;
+			double distance = -glm::dot(normal, p0);
+			double area = length * 0.5;
+
+			for (size_t y = 0; y < 3; y++)
+				quadrics[result[i + y]].AddPlane(normal, distance, area);
+		}
+
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+		std::vector<uint32_t> triangleList;
+		std::vector<uint64_t> edges;
+		std::vector<Collapse> collapses;
+
+		bool errorLimitReached = false;
+
+		while (result.size() > targetIndexCount && !errorLimitReached)
+		{
+			// Unique edges of the current mesh
+			edges.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				edges.push_back(EdgeKey(result[i + 0], result[i + 1]));
+				edges.push_back(EdgeKey(result[i + 1], result[i + 2]));
+				edges.push_back(EdgeKey(result[i + 2], result[i + 0]));
+			}
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+			// Cheapest direction of each edge
+			collapses.clear();
+			for (uint64_t edge : edges)
+			{
+				uint32_t a = static_cast<uint32_t>(edge >> 32);
+				uint32_t b = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+
+				Quadric sum = quadrics[a];
+				sum.Add(quadrics[b]);
+
+				Collapse collapse = {0, 0, std::numeric_limits<double>::max()};
+
+				if (!locked[a])
+					collapse = {a, b, sum.Error(vertices[b].pos)};
+
+				if (!locked[b])
+				{
+					double error = sum.Error(vertices[a].pos);
+					if (error < collapse.error)
+						collapse = {b, a, error};
+				}
+
+				if (collapse.error != std::numeric_limits<double>::max())
+					collapses.push_back(collapse);
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			// Vertex to triangle adjacency
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint32_t index : result)
+				triangleOffsets[index + 1]++;
+			for (size_t i = 0; i < vertexCount; i++)
+				triangleOffsets[i + 1] += triangleOffsets[i];
+
+			triangleList.resize(result.size());
+			std::vector<uint32_t> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				triangleList[fillOffsets[result[i]]++] = static_cast<uint32_t>(i / 3);
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+				remap[i] = i;
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t triangleCount = result.size() / 3;
+			size_t targetTriangleCount = targetIndexCount / 3;
+			size_t removedTriangleCount = 0;
+			size_t collapseCount = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.error > maxErrorSquared)
+				{
+					errorLimitReached = true;
+					break;
+				}
+
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				if (HasFlip(vertices, result, triangleOffsets, triangleList, collapse.from, collapse.to))
+					continue;
+
+				// Everything around the collapse is now stale for this pass
+				for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++)
+				{
+					size_t triangle = triangleList[i] * 3;
+					uint32_t a = result[triangle + 0];
+					uint32_t b = result[triangle + 1];
+					uint32_t c = result[triangle + 2];
+
+					touched[a] = touched[b] = touched[c] = true;
+
+					if (a == collapse.to || b == collapse.to || c == collapse.to)
+						removedTriangleCount++;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				worstError = std::max(worstError, collapse.error);
+				collapseCount++;
+
+				if (triangleCount - removedTriangleCount <= targetTriangleCount)
+					break;
+			}
+
+			if (collapseCount == 0)
+				break;
+
+			// Apply the collapses and remove degenerated triangles
+			size_t writeIndex = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				uint32_t a = remap[result[i + 0]];
+				uint32_t b = remap[result[i + 1]];
+				uint32_t c = remap[result[i + 2]];
+
+				if (a == b || b == c || c == a)
+					continue;
+
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+			result.resize(writeIndex);
+		}
+
+		if (resultError != nullptr)
+			*resultError = static_cast<float>(std::sqrt(worstError));
+
+		return result;
+	}
+}
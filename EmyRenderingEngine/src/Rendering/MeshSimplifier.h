@@ -0,0 +1,20 @@
+#pragma once
+#include "Rendering/Vulkan/VulkanHelper.h"
+
+#include <vector>
+
+namespace MeshSimplifier
+{
+	/// <summary>
+	/// Simplify a triangle list with quadric error metric edge collapse.
+	/// Vertices are never moved or created so the result still index the same vertex buffer.
+	/// Vertices on a border or on an attribute seam are locked so the simplified mesh never crack.
+	/// </summary>
+	/// <param name="vertices">The vertex buffer indexed by indices</param>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="targetIndexCount">Index count we try to reach</param>
+	/// <param name="maxError">Max distance from the original surface allowed, in mesh unit</param>
+	/// <param name="resultError">Output the distance from the original surface of the simplified mesh, in mesh unit</param>
+	/// <returns>The simplified triangle list</returns>
+	std::vector<uint32_t> Simplify(const std::vector<VulkanHelper::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError, float* resultError = nullptr);
+}
@@ -0,0 +1,181 @@
+#include "Rendering/MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	void ComputeBounds(const VulkanHelper::Vertex* vertices, const uint32_t* indices, VulkanHelper::Meshlet& meshlet)
+	{
+		glm::vec3 min = vertices[indices[0]].pos;
+		glm::vec3 max = min;
+
+		for (uint32_t i = 0; i < meshlet.indexCount; i++)
+		{
+			min = glm::min(min, vertices[indices[i]].pos);
+			max = glm::max(max, vertices[indices[i]].pos);
+		}
+
+		meshlet.center = (min + max) * 0.5f;
+		meshlet.radius = 0;
+
+		for (uint32_t i = 0; i < meshlet.indexCount; i++)
+			meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].pos - meshlet.center));
+
+		// Normal cone of the triangles
+		std::vector<glm::vec3> normals;
+		glm::vec3 axis = glm::vec3(0);
+
+		for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+		{
+			glm::vec3 p0 = vertices[indices[i + 0]].pos;
+			glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+			float length = glm::length(normal);
+
+			if (length <= 0)
+				continue;
+
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		meshlet.coneAxis = glm::vec3(0, 0, 1);
+		meshlet.coneCutoff = 1;
+
+		float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength <= 0)
+			return;
+
+		axis /= axisLength;
+
+		float minDot = 1;
+		for (const auto& normal : normals)
+			minDot = std::min(minDot, glm::dot(axis, normal));
+
+		// Cone wider than a half sphere is never fully facing away
+		if (minDot <= 0.1f)
+			return;
+
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1 - minDot * minDot);
+	}
+}
+
+namespace MeshletBuilder
+{
+	std::vector<VulkanHelper::Meshlet> Build(const VulkanHelper::Vertex* vertices, std::vector<uint32_t>& indices)
+	{
+		std::vector<VulkanHelper::Meshlet> meshlets;
+
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return meshlets;
+
+		uint32_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+
+		// Vertex to triangle adjacency
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			triangleOffsets[indices[i] + 1]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			triangleOffsets[i + 1] += triangleOffsets[i];
+
+		std::vector<uint32_t> triangleList(triangleCount * 3);
+		std::vector<uint32_t> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			triangleList[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+		std::vector<uint32_t> reordered;
+		reordered.reserve(triangleCount * 3);
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> vertexMeshlet(vertexCount, std::numeric_limits<uint32_t>::max());
+		std::vector<uint32_t> candidates;
+		size_t seed = 0;
+
+		while (reordered.size() < triangleCount * 3)
+		{
+			while (emitted[seed])
+				seed++;
+
+			uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+			size_t meshletVertexCount = 0;
+			size_t meshletTriangleCount = 0;
+
+			VulkanHelper::Meshlet meshlet = {};
+			meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+
+			candidates.clear();
+			uint32_t triangle = static_cast<uint32_t>(seed);
+
+			// Grow the meshlet with the neighbour adding the less new vertices
+			while (true)
+			{
+				emitted[triangle] = true;
+				meshletTriangleCount++;
+
+				for (size_t y = 0; y < 3; y++)
+				{
+					uint32_t vertex = indices[triangle * 3 + y];
+					reordered.push_back(vertex);
+
+					if (vertexMeshlet[vertex] != meshletIndex)
+					{
+						vertexMeshlet[vertex] = meshletIndex;
+						meshletVertexCount++;
+
+						for (uint32_t i = triangleOffsets[vertex]; i < triangleOffsets[vertex + 1]; i++)
+						{
+							if (!emitted[triangleList[i]])
+								candidates.push_back(triangleList[i]);
+						}
+					}
+				}
+
+				if (meshletTriangleCount >= MAX_TRIANGLES)
+					break;
+
+				size_t bestCandidate = candidates.size();
+				size_t bestNewVertexCount = 4;
+
+				for (size_t i = 0; i < candidates.size(); i++)
+				{
+					if (emitted[candidates[i]])
+						continue;
+
+					size_t newVertexCount = 0;
+					for (size_t y = 0; y < 3; y++)
+					{
+						if (vertexMeshlet[indices[candidates[i] * 3 + y]] != meshletIndex)
+							newVertexCount++;
+					}
+
+					if (newVertexCount < bestNewVertexCount && meshletVertexCount + newVertexCount <= MAX_VERTICES)
+					{
+						bestCandidate = i;
+						bestNewVertexCount = newVertexCount;
+
+						if (newVertexCount == 0)
+							break;
+					}
+				}
+
+				if (bestCandidate == candidates.size())
+					break;
+
+				triangle = candidates[bestCandidate];
+				candidates[bestCandidate] = candidates.back();
+				candidates.pop_back();
+			}
+
+			meshlet.indexCount = static_cast<uint32_t>(reordered.size()) - meshlet.firstIndex;
+			ComputeBounds(vertices, reordered.data() + meshlet.firstIndex, meshlet);
+			meshlets.push_back(meshlet);
+		}
+
+		indices = std::move(reordered);
+
+		return meshlets;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include "Rendering/Vulkan/VulkanHelper.h"
+
+#include <vector>
+
+namespace MeshletBuilder
+{
+	const size_t MAX_VERTICES = 64;
+	const size_t MAX_TRIANGLES = 124;
+
+	/// <summary>
+	/// Split a triangle list in clusters of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles.
+	/// Triangles are reordered so every meshlet is a contiguous range of indices.
+	/// </summary>
+	/// <param name="vertices">The vertices indexed by indices</param>
+	/// <param name="indices">The triangle list, reordered in place</param>
+	/// <returns>The meshlets with firstIndex relative to the start of indices and a vertexOffset of 0</returns>
+	std::vector<VulkanHelper::Meshlet> Build(const VulkanHelper::Vertex* vertices, std::vector<uint32_t>& indices);
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Rendering/Model.h"
 #include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
 #include "Rendering/Vulkan/VulkanRenderer.h"
 
 Model::Model(Mesh* mesh, Texture* texture, Texture* normalTexture, VulkanGraphicPipeline* graphicPipeline)
@@ -14,10 +15,103 @@ Model::~Model()
 	Logger::Log("Model deleted");
 }
 
+void Model::CmdCull(VkCommandBuffer commandBuffer, int i)
+{
+	VulkanRenderer* renderer = VulkanRenderer::GetInstance();
+	drawIndirect = false;
+
+	// Meshlets only cover the full resolution lod
+	if (cullDescriptor == nullptr || currentLod != 0 || !renderer->meshletCulling)
+		return;
+
+	uint32_t meshletCount = mesh->GetMeshletCount();
+	if (!renderer->AllocateIndirectDraws(meshletCount, firstIndirectDraw))
+		return;
+
+	VkPipelineLayout pipelineLayout = renderer->GetMeshletCullPipeline()->GetVkPipelineLayout();
+	cullDescriptor->CmdBind(commandBuffer, pipelineLayout, i, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	uint32_t pushConstants[2] = {firstIndirectDraw, meshletCount};
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), pushConstants);
+
+	vkCmdDispatch(commandBuffer, (meshletCount + 63) / 64, 1, 1);
+
+	drawIndirect = true;
+}
+
 void Model::Draw(VkCommandBuffer commandBuffer, int i)
 {
 	descriptor->CmdBind(commandBuffer, graphicPipeline->GetVkPipelineLayout(), i);
-	mesh->CmdDraw(commandBuffer);
+
+	if (!drawIndirect)
+	{
+		mesh->CmdDraw(commandBuffer, currentLod);
+		return;
+	}
+
+	// Culled meshlets have an instance count of 0
+	CmdDrawIndirect(commandBuffer, VulkanRenderer::GetInstance()->GetIndirectBuffers()[i], firstIndirectDraw, mesh->GetMeshletCount());
+}
+
+void Model::DrawIndirect(VkCommandBuffer commandBuffer, int i, VkBuffer indirectBuffer, uint32_t firstDraw, uint32_t drawCount)
+{
+	descriptor->CmdBind(commandBuffer, graphicPipeline->GetVkPipelineLayout(), i);
+	CmdDrawIndirect(commandBuffer, indirectBuffer, firstDraw, drawCount);
+}
+
+void Model::DrawShadow(VkCommandBuffer commandBuffer, int i, VkPipelineLayout pipelineLayout)
+{
+	// The meshlets were culled for the camera, the shadow draw the whole lod
+	descriptor->CmdBind(commandBuffer, pipelineLayout, i);
+	mesh->CmdDraw(commandBuffer, currentLod);
+}
+
+void Model::UpdateLod(const glm::mat4& modelMatrix, const glm::vec3& cameraPosition, float fov, float screenHeight, float pixelError, float hysteresis)
+{
+	glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh->GetBoundingSphereCenter(), 1.0f));
+	float maxScale = glm::max(glm::abs(scale.x), glm::max(glm::abs(scale.y), glm::abs(scale.z)));
+	float radius = mesh->GetBoundingSphereRadius() * maxScale;
+	float distance = glm::length(center - cameraPosition);
+	worldBoundingSphere = glm::vec4(center, radius);
+	moved = modelMatrix != this->modelMatrix;
+	this->modelMatrix = modelMatrix;
+
+	// Camera inside the bounding sphere
+	if (distance <= radius)
+	{
+		currentLod = 0;
+		return;
+	}
+
+	// Projected radius over half the viewport height, as SelectLod expects
+	float screenSize = radius / (distance * glm::tan(fov * 0.5f));
+
+	currentLod = mesh->SelectLod(screenSize, screenHeight, pixelError, hysteresis, currentLod);
+}
+
+uint32_t Model::GetCurrentLod() const
+{
+	return currentLod;
+}
+
+glm::vec4 Model::GetWorldBoundingSphere() const
+{
+	return worldBoundingSphere;
+}
+
+glm::mat4 Model::GetModelMatrix() const
+{
+	return modelMatrix;
+}
+
+bool Model::HasMoved() const
+{
+	return moved;
+}
+
+void Model::UpdateTextureDescriptors()
+{
+	descriptor->UpdateTextures(texture, normalTexture);
 }
 
 void Model::UpdateUniformBuffer(uint32_t currentImage, VulkanHelper::UniformBufferObject* ubo)
@@ -50,11 +144,32 @@ void Model::Create()
 
 	for (size_t i = 0; i < swapchainImagesSize; i++)
 	{
-		VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+		VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i], MemoryCategory::UNIFORM);
 	}
 
 
 	descriptor = std::unique_ptr<VulkanDescriptor>(new VulkanDescriptor(device, swapchainImagesSize, uniformBuffers, graphicPipeline->layoutBinding.GetVkDescriptorSetLayout(), texture, normalTexture));
+
+	VulkanComputePipeline* cullPipeline = VulkanRenderer::GetInstance()->GetMeshletCullPipeline();
+	if (cullPipeline != nullptr && mesh->GetMeshletCount() > 0)
+		cullDescriptor = std::unique_ptr<VulkanDescriptor>(new VulkanDescriptor(device, swapchainImagesSize, uniformBuffers, mesh->GetMeshletBuffer(), VulkanRenderer::GetInstance()->GetIndirectBuffers(), cullPipeline->layoutBinding.GetVkDescriptorSetLayout()));
+}
+
+void Model::CmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer, uint32_t firstDraw, uint32_t drawCount)
+{
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetSupportedFeatures().multiDrawIndirect)
+	{
+		vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, firstDraw * stride, drawCount, stride);
+		PerfCounters::Add(PerfCounter::DRAW_CALLS);
+	}
+	else
+	{
+		for (uint32_t y = 0; y < drawCount; y++)
+			vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, (firstDraw + y) * stride, 1, stride);
+		PerfCounters::Add(PerfCounter::DRAW_CALLS, drawCount);
+	}
 }
 
 void Model::Cleanup()
@@ -63,7 +178,8 @@ void Model::Cleanup()
 	for (size_t i = 0; i < uniformBuffers.size(); i++)
 	{
 		vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-		vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+		VulkanHelper::FreeMemory(device, uniformBuffersMemory[i]);
 	}
 	descriptor.reset();
+	cullDescriptor.reset();
 }
@@ -21,21 +21,46 @@ public:
 	glm::vec3 scale = glm::vec3(1);
 	std::string meshName = "Cube";
 	std::string textureName = "Debug.jpg";
+	uint32_t occlusionSlot = UINT32_MAX; // Index in the occlusion culling buffers of the frame being recorded
+	bool occlusionVisible = true; // Visible in the last occlusion test, drawn before building the Hi-Z
+	bool occluder = true; // Rendered by the software occlusion culling to hide the models behind
+	bool softwareOccluded = false; // Hidden by the software occlusion culling this frame
+	uint32_t drawListHandle = UINT32_MAX; // Set by the DrawList owning the model
+	uint32_t drawPacketIndex = UINT32_MAX; // Index of its packet in the DrawList, updated by its sort
+	bool isStatic = true; // Kept in the cached shadow cascades, moving it redraw them
+	bool castShadows = true;
 
 private:
 	std::vector<VkBuffer> uniformBuffers;
 	std::vector<VkDeviceMemory> uniformBuffersMemory;
 	std::unique_ptr <VulkanDescriptor> descriptor;
+	std::unique_ptr <VulkanDescriptor> cullDescriptor;
+	uint32_t currentLod = 0;
+	glm::vec4 worldBoundingSphere = glm::vec4(0); // xyz center, w radius
+	glm::mat4 modelMatrix = glm::mat4(1);
+	bool moved = false; // Model matrix changed in the last UpdateLod
+	bool drawIndirect = false; // Meshlets were culled in the command buffer being recorded
+	uint32_t firstIndirectDraw = 0;
 
 public:
 	Model(Mesh* mesh, Texture* texture, Texture* normalTexture, VulkanGraphicPipeline* graphicPipeline);
 	~Model();
 
+	void CmdCull(VkCommandBuffer commandBuffer, int i);
 	void Draw(VkCommandBuffer commandBuffer, int i);
+	void DrawIndirect(VkCommandBuffer commandBuffer, int i, VkBuffer indirectBuffer, uint32_t firstDraw, uint32_t drawCount);
+	void DrawShadow(VkCommandBuffer commandBuffer, int i, VkPipelineLayout pipelineLayout);
 	void UpdateUniformBuffer(uint32_t currentImage, VulkanHelper::UniformBufferObject* ubo);
+	void UpdateLod(const glm::mat4& modelMatrix, const glm::vec3& cameraPosition, float fov, float screenHeight, float pixelError, float hysteresis);
+	uint32_t GetCurrentLod() const;
+	glm::vec4 GetWorldBoundingSphere() const;
+	glm::mat4 GetModelMatrix() const;
+	bool HasMoved() const;
+	void UpdateTextureDescriptors();
 	void Recreate();
 
 private:
 	void Create();
 	void Cleanup();
+	void CmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer, uint32_t firstDraw, uint32_t drawCount);
 };
\ No newline at end of file
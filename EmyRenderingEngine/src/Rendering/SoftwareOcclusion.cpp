@@ -0,0 +1,467 @@
+#include "Rendering/SoftwareOcclusion.h"
+
+#include "Helper/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SOFTWARE_OCCLUSION_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#else
+#define SOFTWARE_OCCLUSION_AVX2 0
+#endif
+
+namespace
+{
+	// Edge function of the edge a to b, positive on the inside of a counter clockwise triangle
+	struct Edge
+	{
+		float stepX;
+		float stepY;
+		float origin; // Value at pixel (0, 0)
+
+		Edge(const glm::vec3& a, const glm::vec3& b)
+		{
+			stepX = a.y - b.y;
+			stepY = b.x - a.x;
+			origin = -(a.x - 0.5f) * stepX - (a.y - 0.5f) * stepY;
+		}
+
+		float At(int x, int y) const
+		{
+			return origin + x * stepX + y * stepY;
+		}
+	};
+
+	// Depth as a plane in screen space
+	struct DepthPlane
+	{
+		float stepX;
+		float stepY;
+		float origin;
+
+		DepthPlane(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float area)
+		{
+			stepX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+			stepY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+			origin = v0.z - (v0.x - 0.5f) * stepX - (v0.y - 0.5f) * stepY;
+		}
+
+		float At(int x, int y) const
+		{
+			return origin + x * stepX + y * stepY;
+		}
+	};
+
+	float Area(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+	{
+		return (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	}
+}
+
+SoftwareOcclusion::SoftwareOcclusion(uint32_t width, uint32_t height, uint32_t threadCount)
+	: width(width), height(height)
+{
+	stride = (width + 7) & ~7u;
+	depth.resize(static_cast<size_t>(stride) * height, 1.0f);
+
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	this->threadCount = std::max(std::min(threadCount, height), 1u);
+	rowsPerThread = (height + this->threadCount - 1) / this->threadCount;
+
+	useAvx2 = HasAvx2();
+
+	// Started once, a thread per frame costs more than the rasterization of a small buffer
+	for (uint32_t band = 1; band < this->threadCount; band++)
+		workers.emplace_back(&SoftwareOcclusion::WorkerLoop, this, band);
+}
+
+SoftwareOcclusion::~SoftwareOcclusion()
+{
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		stopWorkers = true;
+	}
+	workStarted.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void SoftwareOcclusion::Begin(const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	triangles.clear();
+}
+
+void SoftwareOcclusion::AddOccluder(const glm::mat4& model, const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices)
+{
+	glm::mat4 modelViewProjection = viewProjection * model;
+
+	clipVertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+		clipVertices[i] = modelViewProjection * glm::vec4(vertices[i], 1.0f);
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const glm::vec4& a = clipVertices[indices[i + 0]];
+		const glm::vec4& b = clipVertices[indices[i + 1]];
+		const glm::vec4& c = clipVertices[indices[i + 2]];
+
+		// Clip against the near plane (z = 0), one or two triangles are left
+		bool insideA = a.z >= 0, insideB = b.z >= 0, insideC = c.z >= 0;
+		int insideCount = insideA + insideB + insideC;
+
+		if (insideCount == 0)
+			continue;
+
+		if (insideCount == 3)
+		{
+			AddTriangle(a, b, c);
+			continue;
+		}
+
+		// Rotate so the vertex alone on its side is first, the winding is kept
+		const glm::vec4* v[3] = {&a, &b, &c};
+		bool alone = insideCount == 1;
+		int first = insideA == alone ? 0 : insideB == alone ? 1 : 2;
+		const glm::vec4& p0 = *v[first];
+		const glm::vec4& p1 = *v[(first + 1) % 3];
+		const glm::vec4& p2 = *v[(first + 2) % 3];
+
+		glm::vec4 p01 = glm::mix(p0, p1, p0.z / (p0.z - p1.z));
+		glm::vec4 p02 = glm::mix(p0, p2, p0.z / (p0.z - p2.z));
+
+		if (insideCount == 1)
+			AddTriangle(p0, p01, p02);
+		else
+		{
+			AddTriangle(p01, p1, p2);
+			AddTriangle(p01, p2, p02);
+		}
+	}
+}
+
+void SoftwareOcclusion::Rasterize()
+{
+	PROFILE_FUNCTION();
+
+	// Each thread own a band of rows and go through every triangle
+	if (!workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(workMutex);
+			pendingWorkers = static_cast<uint32_t>(workers.size());
+			workGeneration++;
+		}
+		workStarted.notify_all();
+	}
+
+	RasterizeBand(0);
+
+	std::unique_lock<std::mutex> lock(workMutex);
+	workDone.wait(lock, [this]() { return pendingWorkers == 0; });
+}
+
+bool SoftwareOcclusion::IsVisible(const glm::vec4& boundingSphere) const
+{
+	glm::vec2 minPixel = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 maxPixel = glm::vec2(-std::numeric_limits<float>::max());
+	float nearestDepth = 1.0f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = glm::vec3(boundingSphere) + boundingSphere.w * glm::vec3(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+		// Crossing the camera plane, can't be tested
+		if (clip.w <= 0 || clip.z < 0)
+			return true;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 pixel = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(width, height);
+		minPixel = glm::min(minPixel, pixel);
+		maxPixel = glm::max(maxPixel, pixel);
+		nearestDepth = std::min(nearestDepth, ndc.z);
+	}
+
+	if (maxPixel.x < 0 || maxPixel.y < 0 || minPixel.x > width || minPixel.y > height)
+		return false;
+
+	int minX = std::max(static_cast<int>(minPixel.x), 0);
+	int minY = std::max(static_cast<int>(minPixel.y), 0);
+	int maxX = std::min(static_cast<int>(maxPixel.x), static_cast<int>(width) - 1);
+	int maxY = std::min(static_cast<int>(maxPixel.y), static_cast<int>(height) - 1);
+
+#if SOFTWARE_OCCLUSION_AVX2
+	if (useAvx2)
+		return IsRectVisibleAvx2(minX, minY, maxX, maxY, nearestDepth);
+#endif
+
+	return IsRectVisible(minX, minY, maxX, maxY, nearestDepth);
+}
+
+uint32_t SoftwareOcclusion::GetWidth() const
+{
+	return width;
+}
+
+uint32_t SoftwareOcclusion::GetHeight() const
+{
+	return height;
+}
+
+uint32_t SoftwareOcclusion::GetTriangleCount() const
+{
+	return static_cast<uint32_t>(triangles.size());
+}
+
+bool SoftwareOcclusion::IsUsingAvx2() const
+{
+	return useAvx2;
+}
+
+void SoftwareOcclusion::SetAvx2(bool enabled)
+{
+	useAvx2 = enabled && HasAvx2();
+}
+
+float SoftwareOcclusion::GetDepth(uint32_t x, uint32_t y) const
+{
+	return depth[static_cast<size_t>(y) * stride + x];
+}
+
+bool SoftwareOcclusion::HasAvx2()
+{
+#if SOFTWARE_OCCLUSION_AVX2 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osSaveAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	if (!osSaveAvx)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif SOFTWARE_OCCLUSION_AVX2
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+void SoftwareOcclusion::AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	glm::vec2 size = glm::vec2(width, height);
+	Triangle triangle;
+	triangle.v0 = glm::vec3((glm::vec2(a) / a.w * 0.5f + 0.5f) * size, a.z / a.w);
+	triangle.v1 = glm::vec3((glm::vec2(b) / b.w * 0.5f + 0.5f) * size, b.z / b.w);
+	triangle.v2 = glm::vec3((glm::vec2(c) / c.w * 0.5f + 0.5f) * size, c.z / c.w);
+
+	// The y axis point down so counter clockwise front faces have a negative area, they are flipped to positive
+	if (Area(triangle.v0, triangle.v1, triangle.v2) >= 0)
+		return;
+	std::swap(triangle.v1, triangle.v2);
+
+	glm::vec3 minPosition = glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2));
+	glm::vec3 maxPosition = glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2));
+	if (maxPosition.x < 0 || maxPosition.y < 0 || minPosition.x > width || minPosition.y > height || minPosition.z > 1)
+		return;
+
+	triangles.push_back(triangle);
+}
+
+void SoftwareOcclusion::WorkerLoop(uint32_t band)
+{
+	PROFILE_THREAD("Software occlusion " + std::to_string(band));
+
+	uint64_t doneGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(workMutex);
+			workStarted.wait(lock, [this, doneGeneration]() { return stopWorkers || workGeneration != doneGeneration; });
+			if (stopWorkers)
+				return;
+			doneGeneration = workGeneration;
+		}
+
+		RasterizeBand(band);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(workMutex);
+			last = --pendingWorkers == 0;
+		}
+		if (last)
+			workDone.notify_one();
+	}
+}
+
+void SoftwareOcclusion::RasterizeBand(uint32_t band)
+{
+	uint32_t firstRow = band * rowsPerThread;
+	if (firstRow < height)
+		RasterizeRows(firstRow, std::min(firstRow + rowsPerThread, height) - 1);
+}
+
+void SoftwareOcclusion::RasterizeRows(uint32_t firstRow, uint32_t lastRow)
+{
+	PROFILE_FUNCTION();
+
+	for (const Triangle& triangle : triangles)
+	{
+#if SOFTWARE_OCCLUSION_AVX2
+		if (useAvx2)
+		{
+			RasterizeTriangleAvx2(triangle, firstRow, lastRow);
+			continue;
+		}
+#endif
+		RasterizeTriangle(triangle, firstRow, lastRow);
+	}
+}
+
+void SoftwareOcclusion::RasterizeTriangle(const Triangle& triangle, int firstRow, int lastRow)
+{
+	float area = Area(triangle.v0, triangle.v1, triangle.v2);
+	Edge edge0(triangle.v1, triangle.v2);
+	Edge edge1(triangle.v2, triangle.v0);
+	Edge edge2(triangle.v0, triangle.v1);
+	DepthPlane plane(triangle.v0, triangle.v1, triangle.v2, area);
+
+	int minX = std::max(static_cast<int>(std::min(triangle.v0.x, std::min(triangle.v1.x, triangle.v2.x))), 0);
+	int maxX = std::min(static_cast<int>(std::max(triangle.v0.x, std::max(triangle.v1.x, triangle.v2.x))), static_cast<int>(width) - 1);
+	int minY = std::max(static_cast<int>(std::min(triangle.v0.y, std::min(triangle.v1.y, triangle.v2.y))), firstRow);
+	int maxY = std::min(static_cast<int>(std::max(triangle.v0.y, std::max(triangle.v1.y, triangle.v2.y))), lastRow);
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float* row = depth.data() + static_cast<size_t>(y) * stride;
+
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (edge0.At(x, y) < 0 || edge1.At(x, y) < 0 || edge2.At(x, y) < 0)
+				continue;
+
+			row[x] = std::min(row[x], plane.At(x, y));
+		}
+	}
+}
+
+bool SoftwareOcclusion::IsRectVisible(int minX, int minY, int maxX, int maxY, float nearestDepth) const
+{
+	for (int y = minY; y <= maxY; y++)
+	{
+		const float* row = depth.data() + static_cast<size_t>(y) * stride;
+
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (nearestDepth <= row[x])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+#if SOFTWARE_OCCLUSION_AVX2
+AVX2_FUNCTION void SoftwareOcclusion::RasterizeTriangleAvx2(const Triangle& triangle, int firstRow, int lastRow)
+{
+	float area = Area(triangle.v0, triangle.v1, triangle.v2);
+	Edge edge0(triangle.v1, triangle.v2);
+	Edge edge1(triangle.v2, triangle.v0);
+	Edge edge2(triangle.v0, triangle.v1);
+	DepthPlane plane(triangle.v0, triangle.v1, triangle.v2, area);
+
+	// Blocks of 8 pixels aligned on the row, the padding of the last block can be written
+	int minX = std::max(static_cast<int>(std::min(triangle.v0.x, std::min(triangle.v1.x, triangle.v2.x))), 0) & ~7;
+	int maxX = std::min(static_cast<int>(std::max(triangle.v0.x, std::max(triangle.v1.x, triangle.v2.x))), static_cast<int>(width) - 1);
+	int minY = std::max(static_cast<int>(std::min(triangle.v0.y, std::min(triangle.v1.y, triangle.v2.y))), firstRow);
+	int maxY = std::min(static_cast<int>(std::max(triangle.v0.y, std::max(triangle.v1.y, triangle.v2.y))), lastRow);
+
+	const __m256 laneOffsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256 edge0Step = _mm256_mul_ps(_mm256_set1_ps(edge0.stepX), laneOffsets);
+	const __m256 edge1Step = _mm256_mul_ps(_mm256_set1_ps(edge1.stepX), laneOffsets);
+	const __m256 edge2Step = _mm256_mul_ps(_mm256_set1_ps(edge2.stepX), laneOffsets);
+	const __m256 depthStep = _mm256_mul_ps(_mm256_set1_ps(plane.stepX), laneOffsets);
+	const __m256 edge0Block = _mm256_set1_ps(edge0.stepX * 8);
+	const __m256 edge1Block = _mm256_set1_ps(edge1.stepX * 8);
+	const __m256 edge2Block = _mm256_set1_ps(edge2.stepX * 8);
+	const __m256 depthBlock = _mm256_set1_ps(plane.stepX * 8);
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float* row = depth.data() + static_cast<size_t>(y) * stride;
+
+		__m256 e0 = _mm256_add_ps(_mm256_set1_ps(edge0.At(minX, y)), edge0Step);
+		__m256 e1 = _mm256_add_ps(_mm256_set1_ps(edge1.At(minX, y)), edge1Step);
+		__m256 e2 = _mm256_add_ps(_mm256_set1_ps(edge2.At(minX, y)), edge2Step);
+		__m256 z = _mm256_add_ps(_mm256_set1_ps(plane.At(minX, y)), depthStep);
+
+		for (int x = minX; x <= maxX; x += 8)
+		{
+			// The sign bit is set on the pixels outside of one of the edges
+			__m256 outside = _mm256_or_ps(e0, _mm256_or_ps(e1, e2));
+
+			if (_mm256_movemask_ps(outside) != 0xFF)
+			{
+				__m256 current = _mm256_loadu_ps(row + x);
+				__m256 nearest = _mm256_min_ps(current, z);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(nearest, current, outside));
+			}
+
+			e0 = _mm256_add_ps(e0, edge0Block);
+			e1 = _mm256_add_ps(e1, edge1Block);
+			e2 = _mm256_add_ps(e2, edge2Block);
+			z = _mm256_add_ps(z, depthBlock);
+		}
+	}
+}
+
+AVX2_FUNCTION bool SoftwareOcclusion::IsRectVisibleAvx2(int minX, int minY, int maxX, int maxY, float nearestDepth) const
+{
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256 nearest = _mm256_set1_ps(nearestDepth);
+	int firstBlock = minX & ~7;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		const float* row = depth.data() + static_cast<size_t>(y) * stride;
+
+		for (int x = firstBlock; x <= maxX; x += 8)
+		{
+			// Lanes of the block outside of the rectangle are ignored
+			__m256i lanes = _mm256_add_epi32(_mm256_set1_epi32(x), laneOffsets);
+			__m256i inRect = _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(minX), lanes), _mm256_cmpgt_epi32(_mm256_set1_epi32(maxX + 1), lanes));
+
+			__m256 inFront = _mm256_cmp_ps(nearest, _mm256_loadu_ps(row + x), _CMP_LE_OQ);
+
+			if (_mm256_movemask_ps(_mm256_and_ps(inFront, _mm256_castsi256_ps(inRect))) != 0)
+				return true;
+		}
+	}
+
+	return false;
+}
+#else
+void SoftwareOcclusion::RasterizeTriangleAvx2(const Triangle& triangle, int firstRow, int lastRow)
+{
+	RasterizeTriangle(triangle, firstRow, lastRow);
+}
+
+bool SoftwareOcclusion::IsRectVisibleAvx2(int minX, int minY, int maxX, int maxY, float nearestDepth) const
+{
+	return IsRectVisible(minX, minY, maxX, maxY, nearestDepth);
+}
+#endif
\ No newline at end of file
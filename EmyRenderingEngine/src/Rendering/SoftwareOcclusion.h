@@ -0,0 +1,100 @@
+#pragma once
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Depth only rasterizer running on the CPU, used to cull models before recording their draws.
+/// Low poly occluders are rendered into a small depth buffer then bounding spheres are tested against it.
+/// Rows are split between threads kept for its lifetime and 8 pixels are processed at once with AVX2 when the CPU support it.
+/// </summary>
+class SoftwareOcclusion
+{
+private:
+	// Screen space triangle, xy in pixel and z the depth between 0 and 1
+	struct Triangle
+	{
+		glm::vec3 v0;
+		glm::vec3 v1;
+		glm::vec3 v2;
+	};
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t stride = 0; // Row size in pixel, padded to 8
+	uint32_t threadCount = 1;
+	uint32_t rowsPerThread = 0;
+	bool useAvx2 = false;
+
+	// Each worker rasterize the band of rows of its index, the caller does the first one
+	std::vector<std::thread> workers;
+	std::mutex workMutex;
+	std::condition_variable workStarted;
+	std::condition_variable workDone;
+	uint64_t workGeneration = 0; // Incremented by every Rasterize
+	uint32_t pendingWorkers = 0;
+	bool stopWorkers = false;
+
+	glm::mat4 viewProjection = glm::mat4(1);
+	std::vector<float> depth; // Nearest occluder depth, 1 where there is none
+	std::vector<Triangle> triangles;
+	std::vector<glm::vec4> clipVertices;
+
+public:
+	/// <param name="threadCount">Thread count used by Rasterize, 0 to use every core</param>
+	SoftwareOcclusion(uint32_t width, uint32_t height, uint32_t threadCount = 0);
+	~SoftwareOcclusion();
+
+	/// <summary>
+	/// Clear the depth buffer and the occluders, the next occluders and tests use this camera.
+	/// </summary>
+	void Begin(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Clip and project the counter clockwise triangles of an occluder. Back faces are dropped.
+	/// </summary>
+	void AddOccluder(const glm::mat4& model, const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices);
+
+	/// <summary>
+	/// Render every occluder added since Begin in the depth buffer.
+	/// </summary>
+	void Rasterize();
+
+	/// <summary>
+	/// Is the bounding box of the sphere in front of the occluders on at least one pixel.
+	/// Spheres outside of the screen are not visible, spheres crossing the camera plane always are.
+	/// </summary>
+	/// <param name="boundingSphere">xyz center, w radius, in world space</param>
+	bool IsVisible(const glm::vec4& boundingSphere) const;
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	uint32_t GetTriangleCount() const;
+	bool IsUsingAvx2() const;
+
+	/// <summary>
+	/// Use AVX2 if the CPU support it, false forces the scalar path to compare them.
+	/// </summary>
+	void SetAvx2(bool enabled);
+	float GetDepth(uint32_t x, uint32_t y) const;
+
+	/// <summary>
+	/// Does the CPU and the OS support AVX2.
+	/// </summary>
+	static bool HasAvx2();
+
+private:
+	void AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	void WorkerLoop(uint32_t band);
+	void RasterizeBand(uint32_t band);
+	void RasterizeRows(uint32_t firstRow, uint32_t lastRow);
+	void RasterizeTriangle(const Triangle& triangle, int firstRow, int lastRow);
+	void RasterizeTriangleAvx2(const Triangle& triangle, int firstRow, int lastRow);
+	bool IsRectVisible(int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+	bool IsRectVisibleAvx2(int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+};
\ No newline at end of file
@@ -6,70 +6,94 @@
 #include "Helper/Log.h"
 #include <cmath>
 #include <algorithm>
-#include "Helper/Log.h"
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include "Rendering/Vulkan/VulkanRenderer.h"
+#include "Rendering/TextureStreamer.h"
 
 #include "Rendering/Vulkan/VulkanHelper.h"
+#include "Helper/Profiler.h"
+#include "Helper/PerfCounters.h"
 
 const std::string Texture::PATH = "Assets/Textures/";
 
-Texture::Texture(std::string name, bool createMipMap)
+namespace
 {
-	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	// Box filter, the last row and column are repeated on odd sizes
+	void Downsample(const std::vector<uint8_t>& src, uint32_t srcWidth, uint32_t srcHeight, std::vector<uint8_t>& dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		dst.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
 
-	std::string filename = PATH + name;
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			uint32_t y0 = std::min(y * 2, srcHeight - 1);
+			uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
 
-	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				uint32_t x0 = std::min(x * 2, srcWidth - 1);
+				uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
 
-	if (createMipMap)
-		mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+				const uint8_t* p00 = &src[(static_cast<size_t>(y0) * srcWidth + x0) * 4];
+				const uint8_t* p01 = &src[(static_cast<size_t>(y0) * srcWidth + x1) * 4];
+				const uint8_t* p10 = &src[(static_cast<size_t>(y1) * srcWidth + x0) * 4];
+				const uint8_t* p11 = &src[(static_cast<size_t>(y1) * srcWidth + x1) * 4];
+				uint8_t* out = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4];
+
+				for (uint32_t c = 0; c < 4; c++)
+					out[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+			}
+		}
+	}
 
-	if (!pixels)
+	// The whole mip, its extent reaches the edges so it doesn't need to be a multiple of the granularity
+	VkSparseImageMemoryBind MipBind(uint32_t mip, uint32_t width, uint32_t height, VkDeviceMemory memory)
 	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to load: "+ filename +" texture image!");
+		VkSparseImageMemoryBind bind = {};
+		bind.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0};
+		bind.offset = {0, 0, 0};
+		bind.extent = {width, height, 1};
+		bind.memory = memory;
+		bind.memoryOffset = 0;
+		return bind;
 	}
+}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	VulkanHelper::CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+Texture::Texture(std::string name, bool createMipMap)
+{
+	PROFILE_FUNCTION();
 
-	// Move texture data to the GPU
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(device, stagingBufferMemory);
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	std::string filename = PATH + name;
 
-	//Maybe we can keep the data?
+	std::ifstream file(filename, std::ios::binary);
+	if (file.is_open())
+		source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
 
-	VkExtent2D extent =
+	int texWidth, texHeight, texChannels;
+	if (source.empty() || !stbi_info_from_memory(source.data(), static_cast<int>(source.size()), &texWidth, &texHeight, &texChannels))
 	{
-		static_cast<uint32_t>(texWidth),
-		static_cast<uint32_t>(texHeight)
-	};
-	
-	VulkanHelper::CreateTextureParameter textureParameter = {};
-	textureParameter.extent = extent;
-	textureParameter.mipLevels = mipLevels;
-	textureParameter.msaaSample = VK_SAMPLE_COUNT_1_BIT;
-	textureParameter.imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
-	textureParameter.tiling = VK_IMAGE_TILING_OPTIMAL;
-	textureParameter.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-	textureParameter.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	textureParameter.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
-	textureParameter.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	textureParameter.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to load: "+ filename +" texture image!");
+	}
 
-	VulkanHelper::CreateTexture(textureParameter, textureImage, textureImageView, textureImageMemory);
+	if (createMipMap)
+		mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-	VulkanHelper::CopyBufferToImage(stagingBuffer, textureImage, extent);
-	//transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+	ComputeLevels(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	// Only the mip tail is loaded, the streamer bring the detailed mips when they are seen
+	TextureStreamer* streamer = VulkanRenderer::GetInstance()->GetTextureStreamer();
+	CreateImage(streamer != nullptr);
+	residentMip = streamer != nullptr ? tailMip : 0;
 
-	VulkanHelper::GenerateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_UNORM, extent, mipLevels);
+	Upload(Decode(residentMip, mipLevels - 1), residentMip);
+	textureImageView = VulkanHelper::CreateImageView(textureImage, FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - residentMip, residentMip);
+
+	// Kept compressed to decode the mips again when they are streamed in
+	if (streamer == nullptr)
+		std::vector<uint8_t>().swap(source);
 
 	VkSamplerCreateInfo samplerInfo = {};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -93,15 +117,33 @@ Texture::Texture(std::string name, bool createMipMap)
 	{
 		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create texture sampler!");
 	}
+
+	if (streamer != nullptr)
+		streamer->Register(this);
 }
 
 Texture::~Texture()
 {
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 
-	vkDestroyImage(device, textureImage, nullptr);
-	vkFreeMemory(device, textureImageMemory, nullptr);
+	TextureStreamer* streamer = VulkanRenderer::GetInstance()->GetTextureStreamer();
+	if (streamer != nullptr)
+		streamer->Unregister(this);
+
+	for (const RetiredView& retired : retiredViews)
+		vkDestroyImageView(device, retired.imageView, nullptr);
 	vkDestroyImageView(device, textureImageView, nullptr);
+
+	// Destroying the image unbinds every mip
+	vkDestroyImage(device, textureImage, nullptr);
+	VulkanHelper::FreeMemory(device, textureImageMemory);
+	for (VkDeviceMemory memory : mipMemory)
+		VulkanHelper::FreeMemory(device, memory);
+	for (const RetiredMip& retired : retiredMips)
+		VulkanHelper::FreeMemory(device, retired.memory);
+	for (VkDeviceMemory memory : unboundMemory)
+		VulkanHelper::FreeMemory(device, memory);
+
 	vkDestroySampler(device, textureSampler, nullptr);
 
 	Logger::Log("Texture destroyed");
@@ -117,6 +159,31 @@ uint32_t Texture::GetMipLevels() const
 	return mipLevels;
 }
 
+uint32_t Texture::GetTailMip() const
+{
+	return tailMip;
+}
+
+uint32_t Texture::GetResidentMip() const
+{
+	return residentMip;
+}
+
+VkExtent2D Texture::GetExtent() const
+{
+	return {levels[0].width, levels[0].height};
+}
+
+VkDeviceSize Texture::GetMipSize(uint32_t mip) const
+{
+	return levels[mip].memorySize;
+}
+
+bool Texture::IsStreamingIn() const
+{
+	return pendingMip != UINT32_MAX;
+}
+
 VkImage Texture::GetTextureImage() const
 {
 	return textureImage;
@@ -131,3 +198,417 @@ VkSampler Texture::GetTextureSampler() const
 {
 	return textureSampler;
 }
+
+void Texture::CmdBeginStreamIn(VkCommandBuffer commandBuffer)
+{
+	if (IsStreamingIn() || residentMip == 0)
+		return;
+
+	uint32_t mip = residentMip - 1;
+
+	// Evicted recently, its memory is still bound
+	auto retired = std::find_if(retiredMips.begin(), retiredMips.end(), [mip](const RetiredMip& retired) { return retired.mip == mip; });
+	if (retired != retiredMips.end())
+	{
+		mipMemory[mip] = retired->memory;
+		retiredMips.erase(retired);
+	}
+	else
+	{
+		// A range can only be bound once by a submit, the new memory replaces the unbind not submitted yet
+		pendingBinds.erase(std::remove_if(pendingBinds.begin(), pendingBinds.end(), [mip](const VkSparseImageMemoryBind& bind) { return bind.subresource.mipLevel == mip; }), pendingBinds.end());
+
+		VkMemoryRequirements memRequirements = {levels[mip].memorySize, sparseBlockSize, memoryTypeBits};
+		VulkanHelper::AllocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::TEXTURE, mipMemory[mip]);
+		pendingBinds.push_back(MipBind(mip, levels[mip].width, levels[mip].height, mipMemory[mip]));
+	}
+
+	pendingMip = mip;
+	pendingPixels = Decode(mip, mip);
+	uploadedRows = 0;
+
+	CmdTransition(commandBuffer, textureImage, mip, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+}
+
+bool Texture::CmdStreamIn(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, uint8_t* stagingData, VkDeviceSize& stagingOffset, VkDeviceSize stagingSize)
+{
+	if (!IsStreamingIn())
+		return false;
+
+	uint32_t mip = pendingMip;
+	const MipLevel& level = levels[mip];
+	VkDeviceSize rowSize = static_cast<VkDeviceSize>(level.width) * 4;
+
+	// Big mips are split over several frames so a frame never upload more than the staging buffer
+	uint32_t rowCount = static_cast<uint32_t>(std::min<VkDeviceSize>(level.height - uploadedRows, (stagingSize - stagingOffset) / rowSize));
+
+	if (rowCount > 0)
+	{
+		memcpy(stagingData + stagingOffset, pendingPixels.data() + static_cast<size_t>(uploadedRows) * level.width * 4, static_cast<size_t>(rowCount * rowSize));
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = stagingOffset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mip;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {0, static_cast<int32_t>(uploadedRows), 0};
+		region.imageExtent = {level.width, rowCount, 1};
+
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		stagingOffset += rowCount * rowSize;
+		uploadedRows += rowCount;
+
+		PerfCounters::Add(PerfCounter::UPLOADS);
+		PerfCounters::Add(PerfCounter::UPLOADED_BYTES, rowCount * rowSize);
+	}
+
+	if (uploadedRows < level.height)
+		return false;
+
+	CmdTransition(commandBuffer, textureImage, mip, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	RetireView();
+	textureImageView = VulkanHelper::CreateImageView(textureImage, FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - mip, mip);
+	residentMip = mip;
+
+	pendingMip = UINT32_MAX;
+	std::vector<uint8_t>().swap(pendingPixels);
+
+	return true;
+}
+
+void Texture::Evict()
+{
+	if (IsStreamingIn() || residentMip >= tailMip)
+		return;
+
+	// The frames in flight can still sample it through the old view
+	uint32_t mip = residentMip;
+	retiredMips.push_back({mip, mipMemory[mip], VulkanRenderer::MAX_FRAMES_IN_FLIGHT});
+	mipMemory[mip] = nullptr;
+
+	RetireView();
+	textureImageView = VulkanHelper::CreateImageView(textureImage, FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - mip - 1, mip + 1);
+	residentMip = mip + 1;
+}
+
+const std::vector<VkSparseImageMemoryBind>& Texture::GetPendingBinds() const
+{
+	return pendingBinds;
+}
+
+void Texture::ClearPendingBinds()
+{
+	pendingBinds.clear();
+}
+
+void Texture::ReleaseRetired(bool all)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// Unbound by the binds submitted with the last streaming commands
+	if (pendingBinds.empty())
+	{
+		for (VkDeviceMemory memory : unboundMemory)
+			VulkanHelper::FreeMemory(device, memory);
+		unboundMemory.clear();
+	}
+
+	// Released once the fence of the last frame that could use them was waited
+	for (size_t i = 0; i < retiredViews.size();)
+	{
+		if (all || --retiredViews[i].framesLeft == 0)
+		{
+			vkDestroyImageView(device, retiredViews[i].imageView, nullptr);
+			retiredViews[i] = retiredViews.back();
+			retiredViews.pop_back();
+		}
+		else
+			i++;
+	}
+
+	for (size_t i = 0; i < retiredMips.size();)
+	{
+		if (all || --retiredMips[i].framesLeft == 0)
+		{
+			const MipLevel& level = levels[retiredMips[i].mip];
+			pendingBinds.push_back(MipBind(retiredMips[i].mip, level.width, level.height, VK_NULL_HANDLE));
+			unboundMemory.push_back(retiredMips[i].memory);
+			retiredMips[i] = retiredMips.back();
+			retiredMips.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+void Texture::ComputeLevels(uint32_t width, uint32_t height)
+{
+	levels.resize(mipLevels);
+	levels[0] = {width, height, 0, static_cast<VkDeviceSize>(width) * height * 4};
+
+	for (uint32_t mip = 1; mip < mipLevels; mip++)
+	{
+		const MipLevel& src = levels[mip - 1];
+		MipLevel& dst = levels[mip];
+		dst.width = std::max(src.width / 2, 1u);
+		dst.height = std::max(src.height / 2, 1u);
+		dst.offset = src.offset + static_cast<size_t>(src.width) * src.height;
+		dst.memorySize = static_cast<VkDeviceSize>(dst.width) * dst.height * 4;
+	}
+
+	tailMip = mipLevels - 1;
+	while (tailMip > 0 && std::max(levels[tailMip - 1].width, levels[tailMip - 1].height) <= MIP_TAIL_SIZE)
+		tailMip--;
+}
+
+std::vector<uint8_t> Texture::Decode(uint32_t firstMip, uint32_t lastMip) const
+{
+	PROFILE_FUNCTION();
+
+	int width, height, channels;
+	stbi_uc* data = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels, STBI_rgb_alpha);
+	if (!data)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to decode a texture image!");
+	}
+
+	std::vector<uint8_t> mipPixels(data, data + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(data);
+
+	// Only the current mip and the next one are decoded at once, the mips before firstMip aren't kept
+	const MipLevel& last = levels[lastMip];
+	std::vector<uint8_t> pixels((last.offset + static_cast<size_t>(last.width) * last.height - levels[firstMip].offset) * 4);
+	std::vector<uint8_t> nextPixels;
+
+	for (uint32_t mip = 0; mip <= lastMip; mip++)
+	{
+		if (mip >= firstMip)
+			std::copy(mipPixels.begin(), mipPixels.end(), pixels.begin() + (levels[mip].offset - levels[firstMip].offset) * 4);
+
+		if (mip < lastMip)
+		{
+			Downsample(mipPixels, levels[mip].width, levels[mip].height, nextPixels, levels[mip + 1].width, levels[mip + 1].height);
+			mipPixels.swap(nextPixels);
+		}
+	}
+
+	return pixels;
+}
+
+void Texture::CreateImage(bool sparse)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	if (!sparse)
+	{
+		VulkanHelper::CreateTextureParameter textureParameter = {};
+		textureParameter.extent = {levels[0].width, levels[0].height};
+		textureParameter.mipLevels = mipLevels;
+		textureParameter.msaaSample = VK_SAMPLE_COUNT_1_BIT;
+		textureParameter.imageFormat = FORMAT;
+		textureParameter.tiling = VK_IMAGE_TILING_OPTIMAL;
+		textureParameter.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		textureParameter.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		textureParameter.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+		textureParameter.category = MemoryCategory::TEXTURE;
+
+		VulkanHelper::CreateImage(textureParameter, textureImage, textureImageMemory);
+		return;
+	}
+
+	// Created once with every mip, the memory of each mip is bound when it becomes resident
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = {levels[0].width, levels[0].height, 1};
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = FORMAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &textureImage) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create sparse image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
+	sparseBlockSize = memRequirements.alignment;
+	memoryTypeBits = memRequirements.memoryTypeBits;
+
+	uint32_t requirementCount = 0;
+	vkGetImageSparseMemoryRequirements(device, textureImage, &requirementCount, nullptr);
+	std::vector<VkSparseImageMemoryRequirements> sparseRequirements(requirementCount);
+	vkGetImageSparseMemoryRequirements(device, textureImage, &requirementCount, sparseRequirements.data());
+
+	auto colorRequirements = std::find_if(sparseRequirements.begin(), sparseRequirements.end(), [](const VkSparseImageMemoryRequirements& requirements)
+		{
+			return (requirements.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0;
+		});
+	if (colorRequirements == sparseRequirements.end())
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "no sparse memory requirements for the texture image!");
+	}
+
+	sparseGranularity = {colorRequirements->formatProperties.imageGranularity.width, colorRequirements->formatProperties.imageGranularity.height};
+	uint32_t sparseTailMip = std::min(colorRequirements->imageMipTailFirstLod, mipLevels);
+	for (uint32_t mip = 0; mip < sparseTailMip; mip++)
+	{
+		VkDeviceSize blockCount = static_cast<VkDeviceSize>((levels[mip].width + sparseGranularity.width - 1) / sparseGranularity.width) * ((levels[mip].height + sparseGranularity.height - 1) / sparseGranularity.height);
+		levels[mip].memorySize = blockCount * sparseBlockSize;
+	}
+
+	// The mips of the sparse mip tail share their memory, they can't be evicted
+	tailMip = std::min(tailMip, sparseTailMip);
+	mipMemory.resize(mipLevels, nullptr);
+
+	BindMipTail(*colorRequirements);
+}
+
+void Texture::BindMipTail(const VkSparseImageMemoryRequirements& requirements)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	uint32_t sparseTailMip = std::min(requirements.imageMipTailFirstLod, mipLevels);
+
+	std::vector<VkSparseImageMemoryBind> mipBinds;
+	for (uint32_t mip = tailMip; mip < sparseTailMip; mip++)
+	{
+		VkMemoryRequirements memRequirements = {levels[mip].memorySize, sparseBlockSize, memoryTypeBits};
+		VulkanHelper::AllocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::TEXTURE, mipMemory[mip]);
+		mipBinds.push_back(MipBind(mip, levels[mip].width, levels[mip].height, mipMemory[mip]));
+	}
+
+	VkSparseImageMemoryBindInfo imageBindInfo = {};
+	imageBindInfo.image = textureImage;
+	imageBindInfo.bindCount = static_cast<uint32_t>(mipBinds.size());
+	imageBindInfo.pBinds = mipBinds.data();
+
+	VkSparseMemoryBind tailBind = {};
+	if (sparseTailMip < mipLevels)
+	{
+		VkMemoryRequirements memRequirements = {requirements.imageMipTailSize, sparseBlockSize, memoryTypeBits};
+		VulkanHelper::AllocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::TEXTURE, textureImageMemory);
+
+		tailBind.resourceOffset = requirements.imageMipTailOffset;
+		tailBind.size = requirements.imageMipTailSize;
+		tailBind.memory = textureImageMemory;
+		tailBind.memoryOffset = 0;
+	}
+
+	VkSparseImageOpaqueMemoryBindInfo opaqueBindInfo = {};
+	opaqueBindInfo.image = textureImage;
+	opaqueBindInfo.bindCount = 1;
+	opaqueBindInfo.pBinds = &tailBind;
+
+	VkBindSparseInfo bindSparseInfo = {};
+	bindSparseInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+	bindSparseInfo.imageBindCount = mipBinds.empty() ? 0 : 1;
+	bindSparseInfo.pImageBinds = &imageBindInfo;
+	bindSparseInfo.imageOpaqueBindCount = sparseTailMip < mipLevels ? 1 : 0;
+	bindSparseInfo.pImageOpaqueBinds = &opaqueBindInfo;
+
+	// Bound before the upload of the tail, at load only
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create sparse bind fence!");
+	}
+
+	if (vkQueueBindSparse(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetGraphicsQueue(), 1, &bindSparseInfo, fence) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to bind the texture mip tail!");
+	}
+
+	vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	vkDestroyFence(device, fence, nullptr);
+}
+
+void Texture::Upload(const std::vector<uint8_t>& pixels, uint32_t firstMip)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// The mips are contiguous, a single staging buffer hold all of them
+	size_t firstPixel = levels[firstMip].offset;
+	VkDeviceSize imageSize = pixels.size();
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	VulkanHelper::CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::STAGING);
+
+	// Move texture data to the GPU
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+	memcpy(data, pixels.data(), static_cast<size_t>(imageSize));
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	std::vector<VkBufferImageCopy> regions;
+	for (uint32_t mip = firstMip; mip < mipLevels; mip++)
+	{
+		VkBufferImageCopy region = {};
+		region.bufferOffset = (levels[mip].offset - firstPixel) * 4;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mip;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {levels[mip].width, levels[mip].height, 1};
+		regions.push_back(region);
+	}
+
+	VkCommandBuffer commandBuffer = VulkanHelper::BeginSingleTimeCommands();
+
+	CmdTransition(commandBuffer, textureImage, firstMip, mipLevels - firstMip, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	CmdTransition(commandBuffer, textureImage, firstMip, mipLevels - firstMip, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	VulkanHelper::EndSingleTimeCommands(commandBuffer);
+
+	PerfCounters::Add(PerfCounter::UPLOADS);
+	PerfCounters::Add(PerfCounter::UPLOADED_BYTES, imageSize);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, stagingBufferMemory);
+}
+
+void Texture::RetireView()
+{
+	retiredViews.push_back({textureImageView, VulkanRenderer::MAX_FRAMES_IN_FLIGHT});
+}
+
+void Texture::CmdTransition(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = baseMip;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = srcAccessMask;
+	barrier.dstAccessMask = dstAccessMask;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
\ No newline at end of file
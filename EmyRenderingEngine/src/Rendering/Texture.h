@@ -2,28 +2,137 @@
 #include "Header/GLFWHeader.h"
 
 #include <string>
+#include <vector>
 
+/// <summary>
+/// RGBA texture. With a TextureStreamer the image is sparse, its whole mip chain is created once and only the mips
+/// from residentMip have memory bound, the streamer move it one mip at a time. The view starts at residentMip so the
+/// other mips are never sampled. The pixels aren't kept, a mip being streamed in is decoded again from the file kept compressed.
+/// Without a streamer every mip is resident.
+/// </summary>
 class Texture
 {
 private:
 	static const std::string PATH;
+	static const VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+	// Mips this size or smaller are uploaded at load and never evicted
+	static const uint32_t MIP_TAIL_SIZE = 128;
+
+	struct MipLevel
+	{
+		uint32_t width;
+		uint32_t height;
+		size_t offset; // In pixels, from the start of the mip chain
+		VkDeviceSize memorySize; // Sparse blocks bound for the mip
+	};
+
+	// Views and memory of evicted mips, they can still be used by the frames in flight
+	struct RetiredView
+	{
+		VkImageView imageView;
+		uint32_t framesLeft;
+	};
+
+	struct RetiredMip
+	{
+		uint32_t mip;
+		VkDeviceMemory memory;
+		uint32_t framesLeft;
+	};
 
 	bool hasAlpha = false;
 	uint32_t mipLevels = 1;
+	uint32_t tailMip = 0;
+	uint32_t residentMip = 0; // First mip of the view
+
+	std::vector<MipLevel> levels;
+	std::vector<uint8_t> source; // Compressed file, only kept for the streamed textures
 
 	VkImage textureImage = nullptr;
 	VkImageView textureImageView = nullptr;
-	VkDeviceMemory textureImageMemory = nullptr;
+	VkDeviceMemory textureImageMemory = nullptr; // Whole image, or the sparse mip tail
 	VkSampler textureSampler;
 
+	// Memory bound to each mip above the sparse mip tail
+	std::vector<VkDeviceMemory> mipMemory;
+	VkExtent2D sparseGranularity = {};
+	VkDeviceSize sparseBlockSize = 0;
+	uint32_t memoryTypeBits = 0;
+
+	// Mip being uploaded, its memory is bound and its pixels decoded
+	uint32_t pendingMip = UINT32_MAX;
+	std::vector<uint8_t> pendingPixels;
+	uint32_t uploadedRows = 0;
+
+	// Sparse binds waiting for the next submit of the streamer, and the memory they unbind freed once it is done
+	std::vector<VkSparseImageMemoryBind> pendingBinds;
+	std::vector<VkDeviceMemory> unboundMemory;
+
+	std::vector<RetiredView> retiredViews;
+	std::vector<RetiredMip> retiredMips;
+
 public:
 	Texture(std::string name, bool createMipMap = true);
 	~Texture();
 
 	bool GetHasAlpha() const;
 	uint32_t GetMipLevels() const;
+	uint32_t GetTailMip() const;
+	uint32_t GetResidentMip() const;
+	VkExtent2D GetExtent() const;
+
+	/// <summary>
+	/// Device memory used by the mip.
+	/// </summary>
+	VkDeviceSize GetMipSize(uint32_t mip) const;
+	bool IsStreamingIn() const;
 
 	VkImage GetTextureImage() const;
 	VkImageView GetTextureImageView() const;
 	VkSampler GetTextureSampler() const;
+
+	/// <summary>
+	/// Bind memory to the next more detailed mip and decode its pixels, the bind is done by the next submit of the streamer.
+	/// </summary>
+	void CmdBeginStreamIn(VkCommandBuffer commandBuffer);
+
+	/// <summary>
+	/// Upload the rows of the pending mip fitting in the staging buffer from stagingOffset.
+	/// Once the whole mip is uploaded the image view change, the descriptors using it need to be updated.
+	/// </summary>
+	/// <returns>Return true when the pending mip became resident</returns>
+	bool CmdStreamIn(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, uint8_t* stagingData, VkDeviceSize& stagingOffset, VkDeviceSize stagingSize);
+
+	/// <summary>
+	/// Drop the most detailed resident mip, the image view change. Its memory is unbound once the frames in flight are done.
+	/// </summary>
+	void Evict();
+
+	/// <summary>
+	/// Sparse binds to submit before the streaming commands, cleared by ClearPendingBinds once submitted.
+	/// </summary>
+	const std::vector<VkSparseImageMemoryBind>& GetPendingBinds() const;
+	void ClearPendingBinds();
+
+	/// <summary>
+	/// Free the memory unbound by the last submitted binds and count a frame for the retired views and mips.
+	/// Those no frame in flight can use anymore are destroyed or unbound. Called once per frame after the streaming fence.
+	/// </summary>
+	/// <param name="all">Release everything retired, the device need to be idle</param>
+	void ReleaseRetired(bool all = false);
+
+private:
+	void ComputeLevels(uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// Decode the file and box filter it down to lastMip, only the mips from firstMip are returned.
+	/// </summary>
+	std::vector<uint8_t> Decode(uint32_t firstMip, uint32_t lastMip) const;
+	void CreateImage(bool sparse);
+	void BindMipTail(const VkSparseImageMemoryRequirements& requirements);
+	void Upload(const std::vector<uint8_t>& pixels, uint32_t firstMip);
+	void RetireView();
+
+	static void CmdTransition(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
 };
\ No newline at end of file
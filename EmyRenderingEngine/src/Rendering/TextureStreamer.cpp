@@ -0,0 +1,435 @@
+#include "Rendering/TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Helper/Log.h"
+#include "Helper/Profiler.h"
+#include "Rendering/Texture.h"
+#include "Rendering/Model.h"
+#include "Rendering/Vulkan/VulkanRenderer.h"
+#include "Rendering/Vulkan/VulkanHelper.h"
+
+TextureStreamer::TextureStreamer(VkDeviceSize budget, VkDeviceSize bytesPerFrame)
+	: budget(budget), stagingSize(std::max<VkDeviceSize>(bytesPerFrame, 1024 * 1024))
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	VulkanHelper::QueueFamilyIndices queueFamilyIndices = VulkanHelper::FindQueueFamilies();
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create texture streaming command pool!");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate texture streaming command buffer!");
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create texture streaming fence!");
+	}
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &bindSemaphore) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create texture streaming semaphore!");
+	}
+
+	VulkanHelper::CreateBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, MemoryCategory::STAGING);
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, stagingSize, 0, &data);
+	stagingData = static_cast<uint8_t*>(data);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	if (submitted)
+		vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	vkUnmapMemory(device, stagingBufferMemory);
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, stagingBufferMemory);
+	vkDestroyFence(device, fence, nullptr);
+	vkDestroySemaphore(device, bindSemaphore, nullptr);
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+
+	Logger::Log("Texture streamer destroyed");
+}
+
+bool TextureStreamer::IsSupported()
+{
+	if (!VulkanRenderer::GetInstance()->GetLogicalDevice()->HasSparseResidency())
+		return false;
+
+	uint32_t propertyCount = 0;
+	vkGetPhysicalDeviceSparseImageFormatProperties(VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk(), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TYPE_2D,
+		VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_TILING_OPTIMAL, &propertyCount, nullptr);
+
+	return propertyCount > 0;
+}
+
+void TextureStreamer::Register(Texture* texture)
+{
+	entries[texture] = Entry();
+	usedBytes += GetResidentSize(texture);
+}
+
+void TextureStreamer::Unregister(Texture* texture)
+{
+	auto it = entries.find(texture);
+	if (it == entries.end())
+		return;
+
+	// The texture images can be used by the streaming commands
+	if (submitted)
+	{
+		VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+		vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+
+	usedBytes -= GetResidentSize(texture);
+	if (texture->IsStreamingIn())
+	{
+		usedBytes -= texture->GetMipSize(texture->GetResidentMip() - 1);
+		pendingCount--;
+	}
+	entries.erase(it);
+}
+
+void TextureStreamer::Update(const std::vector<std::unique_ptr<Model>>& models, const glm::vec3& cameraPosition, float fov, float screenHeight)
+{
+	PROFILE_FUNCTION();
+
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// The staging buffer and the unbound memory are free once the last streaming commands are done
+	if (submitted)
+	{
+		vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		vkResetFences(device, 1, &fence);
+		submitted = false;
+	}
+
+	frame++;
+	for (auto& entry : entries)
+	{
+		entry.first->ReleaseRetired();
+		entry.second.requestedMip = entry.first->GetTailMip();
+	}
+
+	// The textures can use the free space of the device budget
+	VkDeviceSize limit = std::min(budget, usedBytes + VulkanRenderer::GetInstance()->GetMemoryTracker()->GetDeviceLocalAvailable());
+
+	// Most detailed mip needed by a model, one texel per pixel covered by its bounding sphere
+	float tanHalfFov = glm::tan(fov * 0.5f);
+	for (const std::unique_ptr<Model>& model : models)
+	{
+		glm::vec4 sphere = model->GetWorldBoundingSphere();
+		float distance = glm::length(glm::vec3(sphere) - cameraPosition);
+		float pixels = distance <= sphere.w ? std::numeric_limits<float>::max() : sphere.w / (distance * tanHalfFov) * screenHeight;
+
+		for (Texture* texture : {model->texture, model->normalTexture})
+		{
+			if (texture == nullptr)
+				continue;
+
+			VkExtent2D extent = texture->GetExtent();
+			float texels = static_cast<float>(std::max(extent.width, extent.height));
+			uint32_t mip = texels <= pixels ? 0 : static_cast<uint32_t>(std::floor(std::log2(texels / std::max(pixels, 1.0f))));
+			RequestMip(texture, mip);
+		}
+	}
+
+	VkDeviceSize stagingOffset = 0;
+
+	// Continue the mips already being uploaded
+	for (auto& entry : entries)
+	{
+		Texture* texture = entry.first;
+		if (!texture->IsStreamingIn())
+			continue;
+
+		BeginCommandBuffer();
+		VkDeviceSize previousOffset = stagingOffset;
+		if (texture->CmdStreamIn(commandBuffer, stagingBuffer, stagingData, stagingOffset, stagingSize))
+		{
+			entry.second.changed = true;
+			pendingCount--;
+		}
+		streamedBytes += stagingOffset - previousOffset;
+	}
+
+	// Start the new uploads, the textures missing the most mips first
+	std::vector<Texture*> upgrades;
+	for (auto& entry : entries)
+	{
+		if (!entry.first->IsStreamingIn() && entry.first->GetResidentMip() > entry.second.requestedMip)
+			upgrades.push_back(entry.first);
+	}
+
+	std::sort(upgrades.begin(), upgrades.end(), [this](Texture* a, Texture* b)
+		{
+			return a->GetResidentMip() - entries[a].requestedMip > b->GetResidentMip() - entries[b].requestedMip;
+		});
+
+	for (Texture* texture : upgrades)
+	{
+		if (stagingOffset >= stagingSize)
+			break;
+
+		VkDeviceSize mipSize = texture->GetMipSize(texture->GetResidentMip() - 1);
+		if (usedBytes + mipSize > limit && !EvictFor(usedBytes + mipSize - limit, texture))
+			break;
+
+		BeginCommandBuffer();
+		texture->CmdBeginStreamIn(commandBuffer);
+		usedBytes += mipSize;
+		pendingCount++;
+
+		VkDeviceSize previousOffset = stagingOffset;
+		if (texture->CmdStreamIn(commandBuffer, stagingBuffer, stagingData, stagingOffset, stagingSize))
+		{
+			entries[texture].changed = true;
+			pendingCount--;
+		}
+		streamedBytes += stagingOffset - previousOffset;
+	}
+
+	// The budget can be lowered at runtime and the other resources can take the device memory
+	if (usedBytes > limit)
+		EvictFor(usedBytes - limit, nullptr);
+
+	Submit();
+
+	for (const std::unique_ptr<Model>& model : models)
+	{
+		auto texture = entries.find(model->texture);
+		auto normalTexture = entries.find(model->normalTexture);
+		if ((texture != entries.end() && texture->second.changed) || (normalTexture != entries.end() && normalTexture->second.changed))
+			model->UpdateTextureDescriptors();
+	}
+
+	for (auto& entry : entries)
+		entry.second.changed = false;
+}
+
+VkDeviceSize TextureStreamer::Trim(VkDeviceSize bytes)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// The last frame can still sample the evicted mips
+	VulkanRenderer::GetInstance()->WaitForIdle();
+	if (submitted)
+	{
+		vkResetFences(device, 1, &fence);
+		submitted = false;
+	}
+
+	VkDeviceSize previousUsedBytes = usedBytes;
+	EvictFor(bytes, nullptr, true);
+
+	// Unbind the evicted mips right away, their memory is freed once the binds are done
+	for (auto& entry : entries)
+		entry.first->ReleaseRetired(true);
+
+	Submit();
+	if (submitted)
+	{
+		vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		vkResetFences(device, 1, &fence);
+		submitted = false;
+	}
+
+	for (auto& entry : entries)
+		entry.first->ReleaseRetired(true);
+
+	return previousUsedBytes - usedBytes;
+}
+
+VkDeviceSize TextureStreamer::GetUsedBytes() const
+{
+	return usedBytes;
+}
+
+VkDeviceSize TextureStreamer::GetBudget() const
+{
+	return budget;
+}
+
+void TextureStreamer::SetBudget(VkDeviceSize budget)
+{
+	this->budget = budget;
+}
+
+uint32_t TextureStreamer::GetTextureCount() const
+{
+	return static_cast<uint32_t>(entries.size());
+}
+
+uint32_t TextureStreamer::GetPendingCount() const
+{
+	return pendingCount;
+}
+
+uint32_t TextureStreamer::GetEvictionCount() const
+{
+	return evictionCount;
+}
+
+VkDeviceSize TextureStreamer::GetStreamedBytes() const
+{
+	return streamedBytes;
+}
+
+void TextureStreamer::RequestMip(Texture* texture, uint32_t mip)
+{
+	auto it = entries.find(texture);
+	if (it == entries.end())
+		return;
+
+	Entry& entry = it->second;
+	entry.requestedMip = std::min(entry.requestedMip, mip);
+
+	if (entry.requestedMip <= texture->GetResidentMip())
+		entry.lastUsedFrame = frame;
+}
+
+bool TextureStreamer::EvictFor(VkDeviceSize bytes, Texture* exclude, bool force)
+{
+	// Mips more detailed than needed, the least recently used first
+	std::vector<Texture*> victims;
+	for (auto& entry : entries)
+	{
+		Texture* texture = entry.first;
+		if (texture != exclude && !texture->IsStreamingIn() && texture->GetResidentMip() < texture->GetTailMip() && (force || texture->GetResidentMip() < entry.second.requestedMip))
+			victims.push_back(texture);
+	}
+
+	std::sort(victims.begin(), victims.end(), [this](Texture* a, Texture* b)
+		{
+			return entries[a].lastUsedFrame < entries[b].lastUsedFrame;
+		});
+
+	VkDeviceSize freed = 0;
+	for (Texture* texture : victims)
+	{
+		Entry& entry = entries[texture];
+
+		while (freed < bytes && (force || texture->GetResidentMip() < entry.requestedMip) && texture->GetResidentMip() < texture->GetTailMip())
+		{
+			freed += texture->GetMipSize(texture->GetResidentMip());
+			texture->Evict();
+			entry.changed = true;
+			evictionCount++;
+		}
+
+		if (freed >= bytes)
+			break;
+	}
+
+	usedBytes -= freed;
+	return freed >= bytes;
+}
+
+void TextureStreamer::BeginCommandBuffer()
+{
+	if (recording)
+		return;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to begin texture streaming command buffer!");
+	}
+	recording = true;
+}
+
+void TextureStreamer::Submit()
+{
+	VkQueue queue = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetGraphicsQueue();
+
+	std::vector<VkSparseImageMemoryBindInfo> imageBinds;
+	for (auto& entry : entries)
+	{
+		const std::vector<VkSparseImageMemoryBind>& binds = entry.first->GetPendingBinds();
+		if (!binds.empty())
+			imageBinds.push_back({ entry.first->GetTextureImage(), static_cast<uint32_t>(binds.size()), binds.data() });
+	}
+
+	if (!imageBinds.empty())
+	{
+		// The copies wait for the binds of their mip, without copies the fence tells when the unbound memory can be freed
+		VkBindSparseInfo bindSparseInfo = {};
+		bindSparseInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+		bindSparseInfo.imageBindCount = static_cast<uint32_t>(imageBinds.size());
+		bindSparseInfo.pImageBinds = imageBinds.data();
+		bindSparseInfo.signalSemaphoreCount = recording ? 1 : 0;
+		bindSparseInfo.pSignalSemaphores = &bindSemaphore;
+
+		if (vkQueueBindSparse(queue, 1, &bindSparseInfo, recording ? nullptr : fence) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to bind texture mips!");
+		}
+
+		for (auto& entry : entries)
+			entry.first->ClearPendingBinds();
+
+		if (!recording)
+			submitted = true;
+	}
+
+	if (!recording)
+		return;
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to record texture streaming command buffer!");
+	}
+
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = imageBinds.empty() ? 0 : 1;
+	submitInfo.pWaitSemaphores = &bindSemaphore;
+	submitInfo.pWaitDstStageMask = &waitStage;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	// Submitted before the frame on the same queue, the barriers of the textures make the frame wait for the copies
+	if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to submit texture streaming command buffer!");
+	}
+	recording = false;
+	submitted = true;
+}
+
+VkDeviceSize TextureStreamer::GetResidentSize(const Texture* texture)
+{
+	VkDeviceSize size = 0;
+	for (uint32_t mip = texture->GetResidentMip(); mip < texture->GetMipLevels(); mip++)
+		size += texture->GetMipSize(mip);
+
+	return size;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+class Texture;
+class Model;
+
+/// <summary>
+/// Keep the mips of the textures resident when their projected size on screen need them.
+/// Textures are sparse images loaded with their mip tail only, the more detailed mips are decoded from the file, bound and
+/// uploaded one at a time within a bandwidth per frame. When the budget is reached the most detailed mips that are not
+/// needed anymore are evicted, the least recently used first, and their memory is unbound once the frames in flight are done.
+/// Only created when the device supports sparse residency for the texture format, see IsSupported.
+/// </summary>
+class TextureStreamer
+{
+private:
+	struct Entry
+	{
+		uint32_t requestedMip = 0; // Most detailed mip needed by the models this frame
+		uint64_t lastUsedFrame = 0; // Last frame the most detailed resident mip was needed
+		bool changed = false; // Image view replaced, the descriptors need to be updated
+	};
+
+	VkDeviceSize budget = 0;
+	VkDeviceSize stagingSize = 0;
+
+	VkCommandPool commandPool = nullptr;
+	VkCommandBuffer commandBuffer = nullptr;
+	VkFence fence = nullptr;
+	VkSemaphore bindSemaphore = nullptr; // The streaming commands wait for the sparse binds
+	bool submitted = false;
+	bool recording = false;
+
+	// Host visible, persistently mapped. It is reused once the fence is signaled
+	VkBuffer stagingBuffer = nullptr;
+	VkDeviceMemory stagingBufferMemory = nullptr;
+	uint8_t* stagingData = nullptr;
+
+	std::unordered_map<Texture*, Entry> entries;
+	uint64_t frame = 0;
+	VkDeviceSize usedBytes = 0;
+	uint32_t pendingCount = 0;
+	uint32_t evictionCount = 0;
+	VkDeviceSize streamedBytes = 0;
+
+public:
+	/// <param name="budget">Video memory the textures can use in byte, the mip tails are always resident even over it.
+	/// It is lowered when the device memory budget is reached.</param>
+	/// <param name="bytesPerFrame">Most bytes uploaded each frame</param>
+	TextureStreamer(VkDeviceSize budget, VkDeviceSize bytesPerFrame);
+	~TextureStreamer();
+
+	/// <summary>
+	/// Check the device can bind the memory of each mip of a sparse RGBA texture.
+	/// </summary>
+	static bool IsSupported();
+
+	void Register(Texture* texture);
+	void Unregister(Texture* texture);
+
+	/// <summary>
+	/// Find the mips needed by the models, upload and evict mips then update the descriptors of the models whose texture changed.
+	/// Need to be called once per frame after the models bounding sphere are updated, before recording the command buffers.
+	/// </summary>
+	void Update(const std::vector<std::unique_ptr<Model>>& models, const glm::vec3& cameraPosition, float fov, float screenHeight);
+
+	/// <summary>
+	/// Evict the least recently used mips above the mip tails right away, even the needed ones, and wait for the device.
+	/// The descriptors are updated by the next Update. Not to be called from Update or while recording a frame.
+	/// </summary>
+	/// <returns>Return the freed bytes</returns>
+	VkDeviceSize Trim(VkDeviceSize bytes);
+
+	VkDeviceSize GetUsedBytes() const;
+	VkDeviceSize GetBudget() const;
+	void SetBudget(VkDeviceSize budget);
+	uint32_t GetTextureCount() const;
+	uint32_t GetPendingCount() const;
+	uint32_t GetEvictionCount() const;
+
+	/// <summary>
+	/// Bytes uploaded since the start.
+	/// </summary>
+	VkDeviceSize GetStreamedBytes() const;
+
+private:
+	void RequestMip(Texture* texture, uint32_t mip);
+	/// <param name="force">Also evict the mips needed this frame</param>
+	bool EvictFor(VkDeviceSize bytes, Texture* exclude, bool force = false);
+	void BeginCommandBuffer();
+	void Submit();
+	static VkDeviceSize GetResidentSize(const Texture* texture);
+};
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "ImguiBase.h"
+#include "Helper/Profiler.h"
 
 void ImguiBase::EndFrame()
 {
+	PROFILE_FUNCTION();
+
 	ImGui::Render(); // Also endFrame. Do not draw. Just setup draw data.
 }
\ No newline at end of file
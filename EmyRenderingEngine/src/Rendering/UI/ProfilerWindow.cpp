@@ -0,0 +1,252 @@
+#include "ProfilerWindow.h"
+
+#include "Header/ImguiHeader.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Same name, same colour from a frame to another
+	ImU32 GetZoneColor(const char* name)
+	{
+		uint32_t hash = 2166136261u;
+		for (const char* c = name; *c != '\0'; c++)
+			hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+
+		return ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.85f);
+	}
+}
+
+bool ProfilerWindow::windowOpen = false;
+
+int ProfilerWindow::frameCount = 10;
+bool ProfilerWindow::frozen = false;
+bool ProfilerWindow::freezeOnSpike = false;
+float ProfilerWindow::spikeThreshold = 33.3f;
+bool ProfilerWindow::showWorstFrame = false;
+
+ProfilerWindow::Capture ProfilerWindow::liveCapture;
+ProfilerWindow::Capture ProfilerWindow::worstCapture;
+double ProfilerWindow::worstFrameTime = 0;
+uint64_t ProfilerWindow::lastFrameStart = 0;
+
+double ProfilerWindow::viewStart = 0;
+double ProfilerWindow::viewDuration = 0;
+
+void ProfilerWindow::GUI()
+{
+	Update();
+
+	if (!windowOpen)
+		return;
+
+	ImGui::SetNextWindowSize(ImVec2(900, 400), ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Profiler", &windowOpen))
+	{
+#if PROFILER
+		ImGui::PushItemWidth(ImGui::GetFontSize() * 8);
+
+		ImGui::SliderInt("Frames", &frameCount, 1, 60);
+		ImGui::SameLine();
+		ImGui::Checkbox("Freeze", &frozen);
+		ImGui::SameLine();
+		ImGui::Checkbox("Freeze on spike", &freezeOnSpike);
+		ImGui::SameLine();
+		ImGui::SliderFloat("Spike (ms)", &spikeThreshold, 1.0f, 200.0f, "%.1f");
+
+		ImGui::Checkbox("Worst frame", &showWorstFrame);
+		ImGui::SameLine();
+		ImGui::Text("%.2f ms", worstFrameTime);
+		ImGui::SameLine();
+		if (ImGui::Button("Reset worst"))
+		{
+			worstFrameTime = 0;
+			worstCapture = Capture();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Fit"))
+			viewDuration = 0;
+		ImGui::SameLine();
+		ImGui::TextDisabled("Wheel to zoom, drag to pan");
+
+		ImGui::PopItemWidth();
+
+		DrawTimeline(showWorstFrame ? worstCapture : liveCapture);
+#else
+		ImGui::Text("Built without PROFILER, no zone is recorded");
+#endif
+	}
+	ImGui::End();
+}
+
+void ProfilerWindow::Update()
+{
+	// The last start is the frame running, the one before it just ended
+	std::vector<uint64_t> lastStarts = Profiler::GetFrameStarts(2);
+	if (lastStarts.size() < 2 || lastStarts[0] == lastFrameStart)
+		return;
+
+	// The first frame also counts the loading, it's never the worst
+	bool firstFrame = lastFrameStart == 0;
+	lastFrameStart = lastStarts[0];
+	if (firstFrame)
+		return;
+
+	double frameTime = (lastStarts[1] - lastStarts[0]) / Profiler::GetTicksPerMicrosecond() / 1000.0;
+
+	if (frameTime > worstFrameTime)
+	{
+		worstFrameTime = frameTime;
+		worstCapture = MakeCapture(lastStarts);
+	}
+
+	if (freezeOnSpike && !frozen && frameTime > spikeThreshold)
+	{
+		frozen = true;
+		liveCapture = MakeCapture(Profiler::GetFrameStarts(frameCount + 1));
+	}
+	else if (windowOpen && !frozen)
+	{
+		liveCapture = MakeCapture(Profiler::GetFrameStarts(frameCount + 1));
+	}
+}
+
+ProfilerWindow::Capture ProfilerWindow::MakeCapture(const std::vector<uint64_t>& frameStarts)
+{
+	Capture capture;
+	if (frameStarts.size() < 2)
+		return capture;
+
+	capture.start = frameStarts.front();
+	capture.end = frameStarts.back();
+	capture.frameStarts = frameStarts;
+	capture.threads = Profiler::CopyEvents(capture.start, capture.end);
+
+	return capture;
+}
+
+void ProfilerWindow::DrawTimeline(const Capture& capture)
+{
+	if (capture.frameStarts.size() < 2)
+	{
+		ImGui::Text("No frame captured");
+		return;
+	}
+
+	double ticksPerMicrosecond = Profiler::GetTicksPerMicrosecond();
+	auto toMicroseconds = [&](uint64_t ticks) { return static_cast<double>(static_cast<int64_t>(ticks - capture.start)) / ticksPerMicrosecond; };
+	double captureDuration = toMicroseconds(capture.end);
+
+	float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+
+	// A row for the thread name then a row per depth of its zones
+	std::vector<uint32_t> threadDepths;
+	float contentHeight = rowHeight;
+	for (const Profiler::ThreadEvents& thread : capture.threads)
+	{
+		uint32_t depth = 0;
+		for (const Profiler::Event& event : thread.events)
+			depth = std::max(depth, event.depth + 1);
+
+		threadDepths.push_back(depth);
+		contentHeight += rowHeight * (depth + 1) + rowHeight * 0.5f;
+	}
+
+	// The wheel zooms, the child scrolls with its scrollbar only
+	ImGui::BeginChild("Timeline", ImVec2(0, 0), true, ImGuiWindowFlags_NoScrollWithMouse);
+
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImVec2 size = ImVec2(std::max(ImGui::GetContentRegionAvail().x, 50.0f), std::max(ImGui::GetContentRegionAvail().y, contentHeight));
+	ImGui::InvisibleButton("TimelineCanvas", size);
+	bool hovered = ImGui::IsItemHovered();
+
+	double start = viewStart;
+	double duration = viewDuration;
+	if (duration <= 0 || duration > captureDuration)
+	{
+		start = 0;
+		duration = captureDuration;
+	}
+
+	ImGuiIO& io = ImGui::GetIO();
+	if (hovered && io.MouseWheel != 0)
+	{
+		// Zoom around the time under the mouse
+		double mouseRatio = (io.MousePos.x - origin.x) / size.x;
+		double mouseTime = start + mouseRatio * duration;
+		duration = std::min(std::max(duration * std::pow(0.8, io.MouseWheel), 1.0), captureDuration);
+		start = mouseTime - mouseRatio * duration;
+	}
+	if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left))
+		start -= io.MouseDelta.x * duration / size.x;
+
+	start = std::min(std::max(start, 0.0), captureDuration - duration);
+	if (viewDuration > 0 || duration < captureDuration)
+	{
+		viewStart = start;
+		viewDuration = duration;
+	}
+
+	auto toX = [&](double time) { return origin.x + static_cast<float>((time - start) / duration * size.x); };
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+
+	ImU32 textColor = ImGui::GetColorU32(ImGuiCol_Text);
+	ImU32 lineColor = ImGui::GetColorU32(ImGuiCol_Border);
+
+	for (size_t frame = 0; frame < capture.frameStarts.size(); frame++)
+	{
+		float x = toX(toMicroseconds(capture.frameStarts[frame]));
+		drawList->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + size.y), lineColor);
+
+		if (frame + 1 < capture.frameStarts.size())
+		{
+			double frameTime = (capture.frameStarts[frame + 1] - capture.frameStarts[frame]) / ticksPerMicrosecond / 1000.0;
+			char label[32];
+			snprintf(label, sizeof(label), "%.2f ms", frameTime);
+			drawList->AddText(ImVec2(x + 4, origin.y), textColor, label);
+		}
+	}
+
+	float y = origin.y + rowHeight;
+	for (size_t t = 0; t < capture.threads.size(); t++)
+	{
+		const Profiler::ThreadEvents& thread = capture.threads[t];
+		drawList->AddText(ImVec2(origin.x + 4, y), textColor, thread.name.c_str());
+		y += rowHeight;
+
+		for (const Profiler::Event& event : thread.events)
+		{
+			float x0 = toX(toMicroseconds(event.start));
+			float x1 = std::max(toX(toMicroseconds(event.end)), x0 + 1.0f);
+			if (x1 < origin.x || x0 > origin.x + size.x)
+				continue;
+
+			ImVec2 min = ImVec2(x0, y + event.depth * rowHeight);
+			ImVec2 max = ImVec2(x1, min.y + rowHeight - 1);
+			drawList->AddRectFilled(min, max, GetZoneColor(event.name));
+
+			// Only the zones wide enough get their name, cut at their end
+			if (x1 - x0 > ImGui::GetFontSize())
+			{
+				ImVec4 clipRect = ImVec4(std::max(x0, origin.x), min.y, std::min(x1, origin.x + size.x), max.y);
+				drawList->AddText(ImGui::GetFont(), ImGui::GetFontSize(), ImVec2(std::max(x0, origin.x) + 2, min.y), IM_COL32_BLACK, event.name, nullptr, 0, &clipRect);
+			}
+
+			if (hovered && ImGui::IsMouseHoveringRect(min, max))
+				ImGui::SetTooltip("%s\n%.3f ms", event.name, (event.end - event.start) / ticksPerMicrosecond / 1000.0);
+		}
+
+		y += rowHeight * threadDepths[t] + rowHeight * 0.5f;
+	}
+
+	drawList->PopClipRect();
+
+	ImGui::EndChild();
+}
+
+ProfilerWindow::ProfilerWindow()
+{
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include "Helper/Profiler.h"
+
+#include <vector>
+
+/// <summary>
+/// Timeline of the CPU zones of the last frames, one row per thread.
+/// The capture can be frozen by hand or on a frame over the spike threshold, the slowest frame seen is kept to be looked at later.
+/// </summary>
+class ProfilerWindow
+{
+public:
+	static bool windowOpen;
+
+private:
+	struct Capture
+	{
+		uint64_t start = 0; // Ticks
+		uint64_t end = 0;
+		std::vector<uint64_t> frameStarts;
+		std::vector<Profiler::ThreadEvents> threads;
+	};
+
+	static int frameCount;
+	static bool frozen;
+	static bool freezeOnSpike;
+	static float spikeThreshold; // Millisecond
+	static bool showWorstFrame;
+
+	static Capture liveCapture;
+	static Capture worstCapture;
+	static double worstFrameTime;
+	static uint64_t lastFrameStart;
+
+	// Visible part of the capture in microsecond from its start, the whole capture when the duration is 0
+	static double viewStart;
+	static double viewDuration;
+
+public:
+	/// <summary>
+	/// Look for spikes and draw the window when it's open, call it every frame.
+	/// </summary>
+	static void GUI();
+
+private:
+	static void Update();
+	static Capture MakeCapture(const std::vector<uint64_t>& frameStarts);
+	static void DrawTimeline(const Capture& capture);
+
+	ProfilerWindow();
+};
\ No newline at end of file
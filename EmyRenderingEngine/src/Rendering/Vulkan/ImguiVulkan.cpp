@@ -2,6 +2,7 @@
 
 #include "Rendering/Vulkan/VulkanHelper.h"
 #include "Helper/Log.h"
+#include "Helper/Profiler.h"
 #include "Rendering/Vulkan/VulkanRenderer.h"
 
 ImguiVulkan::ImguiVulkan(GLFWwindow* window, uint32_t queueFamily)
@@ -10,7 +11,7 @@ ImguiVulkan::ImguiVulkan(GLFWwindow* window, uint32_t queueFamily)
 	VkInstance instance = VulkanRenderer::GetInstance()->GetVulkanInstance()->GetVk();
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 	VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
-	VkRenderPass renderPass = VulkanRenderer::GetInstance()->GetRenderPass()->GetVk();
+	VkRenderPass renderPass = VulkanRenderer::GetInstance()->GetPresentRenderPass()->GetVk(); // Drawn after the upscale at native resolution
 	VkQueue graphicQueue = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetGraphicsQueue();
 
 	// Create Descriptor Pool
@@ -65,7 +66,7 @@ ImguiVulkan::ImguiVulkan(GLFWwindow* window, uint32_t queueFamily)
 	init_info.PipelineCache = g_PipelineCache;
 	init_info.DescriptorPool = g_DescriptorPool;
 	init_info.Allocator = nullptr;
-	init_info.MSAASamples = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetMsaaSample();
+	init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 	init_info.MinImageCount = VulkanHelper::QuerySwapChainSupport().capabilities.minImageCount + 1;;
 	init_info.ImageCount = VulkanRenderer::GetInstance()->GetSwapChain()->GetVkImages().size();
 	init_info.CheckVkResultFn = nullptr;
@@ -102,6 +103,8 @@ ImguiVulkan::~ImguiVulkan()
 
 void ImguiVulkan::StartFrame()
 {
+	PROFILE_FUNCTION();
+
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
@@ -109,6 +112,8 @@ void ImguiVulkan::StartFrame()
 
 void ImguiVulkan::Draw(VkCommandBuffer commandBuffer)
 {
+	PROFILE_FUNCTION();
+
 	// Record Imgui Draw Data and draw funcs into command buffer
 	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
 }
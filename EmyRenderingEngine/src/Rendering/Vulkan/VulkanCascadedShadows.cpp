@@ -0,0 +1,619 @@
+#include "Rendering/Vulkan/VulkanCascadedShadows.h"
+
+#include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
+#include "VulkanRenderer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+VulkanCascadedShadows::VulkanCascadedShadows(uint32_t cascadeCount, uint32_t size, float shadowDistance, uint32_t firstCachedCascade)
+	: cascadeCount(std::clamp(cascadeCount, 2u, MAX_CASCADES)), size(std::max(size, 1u)), shadowDistance(shadowDistance)
+{
+	this->firstCachedCascade = std::min(firstCachedCascade, this->cascadeCount);
+
+	cascades.resize(this->cascadeCount);
+	for (uint32_t c = 0; c < this->cascadeCount; c++)
+		cascades[c].cached = c >= this->firstCachedCascade;
+
+	CreateImages();
+	CreateRenderPasses();
+	CreateFramebuffers();
+	CreatePipeline();
+	CreateDescriptors();
+}
+
+VulkanCascadedShadows::~VulkanCascadedShadows()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	shadowPipeline.reset();
+	shadowVertexShader.reset();
+
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	for (size_t f = 0; f < infoBuffers.size(); f++)
+	{
+		vkUnmapMemory(device, infoBufferMemories[f]);
+		vkDestroyBuffer(device, infoBuffers[f], nullptr);
+		VulkanHelper::FreeMemory(device, infoBufferMemories[f]);
+	}
+
+	for (VkFramebuffer framebuffer : shadowFramebuffers)
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	for (VkFramebuffer framebuffer : cacheFramebuffers)
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+	vkDestroyRenderPass(device, clearRenderPass, nullptr);
+	vkDestroyRenderPass(device, cacheRenderPass, nullptr);
+	vkDestroyRenderPass(device, loadRenderPass, nullptr);
+
+	vkDestroySampler(device, shadowSampler, nullptr);
+	vkDestroyImageView(device, shadowArrayView, nullptr);
+	for (VkImageView view : shadowLayerViews)
+		vkDestroyImageView(device, view, nullptr);
+	for (VkImageView view : cacheLayerViews)
+		vkDestroyImageView(device, view, nullptr);
+
+	vkDestroyImage(device, shadowImage, nullptr);
+	VulkanHelper::FreeMemory(device, shadowImageMemory);
+	vkDestroyImage(device, cacheImage, nullptr);
+	VulkanHelper::FreeMemory(device, cacheImageMemory);
+
+	Logger::Log("Cascaded shadows destroyed");
+}
+
+void VulkanCascadedShadows::Update(const glm::mat4& view, float fov, float aspect, float nearPlane, const glm::vec3& lightDirection, const std::vector<std::unique_ptr<Model>>& models, uint32_t frame)
+{
+	ShadowInfo* info = infos[frame];
+
+	glm::vec3 direction = glm::normalize(lightDirection);
+	glm::vec3 up = std::abs(direction.z) > 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1);
+	lightView = glm::lookAt(glm::vec3(0), -direction, up);
+
+	bool invalidate = direction != cachedLightDirection;
+	cachedLightDirection = direction;
+
+	// Adding, removing or moving a static model redraw every cache
+	size_t count = 0;
+	size_t hash = 0;
+	for (const auto& model : models)
+	{
+		if (!model->isStatic || !model->castShadows)
+			continue;
+
+		count++;
+		hash += std::hash<Model*>()(model.get());
+		invalidate |= model->HasMoved();
+	}
+
+	invalidate |= count != staticModelCount || hash != staticModelHash;
+	staticModelCount = count;
+	staticModelHash = hash;
+
+	glm::mat4 inverseView = glm::inverse(view);
+	float tanHalfFov = std::tan(fov * 0.5f);
+	float splitNear = nearPlane;
+
+	for (uint32_t c = 0; c < cascadeCount; c++)
+	{
+		float ratio = static_cast<float>(c + 1) / cascadeCount;
+		float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, ratio);
+		float uniformSplit = nearPlane + (shadowDistance - nearPlane) * ratio;
+		float splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+
+		Cascade& cascade = cascades[c];
+		if (invalidate)
+			cascade.cacheValid = false;
+
+		bool moved = FitCascade(cascade, inverseView, tanHalfFov, aspect, splitNear, splitFar);
+		cascade.splitDepth = splitFar;
+
+		// The command buffer recorded this frame redraws it and leaves the cache valid
+		cascade.redrawCache = cascade.cached && (moved || !cascade.cacheValid);
+		cascade.cacheValid = cascade.cached;
+		if (cascade.redrawCache)
+			cacheRedrawCount++;
+
+		info->lightViewProjection[c] = cascade.viewProjection;
+		splitNear = splitFar;
+	}
+
+	info->cascadeCount = glm::uvec4(cascadeCount, 0, 0, 0);
+}
+
+void VulkanCascadedShadows::Disable(uint32_t frame)
+{
+	infos[frame]->cascadeCount = glm::uvec4(0);
+
+	// Static models aren't tracked while disabled
+	for (Cascade& cascade : cascades)
+		cascade.cacheValid = false;
+}
+
+void VulkanCascadedShadows::CmdRender(VkCommandBuffer commandBuffer, uint32_t i, const std::vector<DrawList::DrawPacket>& packets)
+{
+	for (uint32_t c = 0; c < cascadeCount; c++)
+	{
+		const Cascade& cascade = cascades[c];
+
+		if (!cascade.cached)
+		{
+			CmdBeginRenderPass(commandBuffer, clearRenderPass, shadowFramebuffers[c]);
+			CmdDrawCasters(commandBuffer, i, cascade, packets, true, true);
+			vkCmdEndRenderPass(commandBuffer);
+			continue;
+		}
+
+		uint32_t cacheLayer = c - firstCachedCascade;
+
+		if (cascade.redrawCache)
+		{
+			CmdBeginRenderPass(commandBuffer, cacheRenderPass, cacheFramebuffers[cacheLayer]);
+			CmdDrawCasters(commandBuffer, i, cascade, packets, true, false);
+			vkCmdEndRenderPass(commandBuffer);
+		}
+
+		// Start from the static depth then add the dynamic models
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = shadowImage;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = c;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageCopy region = {};
+		region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, cacheLayer, 1};
+		region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, c, 1};
+		region.extent = {size, size, 1};
+
+		vkCmdCopyImage(commandBuffer, cacheImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadowImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		CmdBeginRenderPass(commandBuffer, loadRenderPass, shadowFramebuffers[c]);
+		CmdDrawCasters(commandBuffer, i, cascade, packets, false, true);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+}
+
+void VulkanCascadedShadows::CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frame)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 2, 1, &descriptorSets[frame], 0, nullptr);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+}
+
+VkDescriptorSetLayout VulkanCascadedShadows::GetDescriptorSetLayout() const
+{
+	return layoutBinding.GetVkDescriptorSetLayout();
+}
+
+VkImage VulkanCascadedShadows::GetShadowImage() const
+{
+	return shadowImage;
+}
+
+uint32_t VulkanCascadedShadows::GetCascadeCount() const
+{
+	return cascadeCount;
+}
+
+uint32_t VulkanCascadedShadows::GetFirstCachedCascade() const
+{
+	return firstCachedCascade;
+}
+
+float VulkanCascadedShadows::GetSplitDepth(uint32_t cascade) const
+{
+	return cascades[cascade].splitDepth;
+}
+
+uint32_t VulkanCascadedShadows::GetCacheRedrawCount() const
+{
+	return cacheRedrawCount;
+}
+
+bool VulkanCascadedShadows::FitCascade(Cascade& cascade, const glm::mat4& inverseView, float tanHalfFov, float aspect, float splitNear, float splitFar)
+{
+	// Bounding sphere of the frustum slice, its size doesn't change when the camera turn so the edges don't shimmer
+	std::array<glm::vec3, 8> corners;
+	glm::vec3 center = glm::vec3(0);
+	for (uint32_t i = 0; i < corners.size(); i++)
+	{
+		float depth = (i & 4) ? splitFar : splitNear;
+		float x = ((i & 1) ? 1.0f : -1.0f) * depth * tanHalfFov * aspect;
+		float y = ((i & 2) ? 1.0f : -1.0f) * depth * tanHalfFov;
+
+		corners[i] = glm::vec3(inverseView * glm::vec4(x, y, -depth, 1.0f));
+		center += corners[i] / static_cast<float>(corners.size());
+	}
+
+	float radius = 0;
+	for (const glm::vec3& corner : corners)
+		radius = std::max(radius, glm::length(corner - center));
+	radius = std::ceil(radius * 16.0f) / 16.0f;
+
+	glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+	float extent = cascade.cached ? radius * (1.0f + cacheMargin) : radius;
+
+	// Cached cascades only follow the camera once the slice leave their margin
+	glm::vec3 offset = glm::abs(lightCenter - cascade.center);
+	if (cascade.cached && cascade.cacheValid && radius == cascade.radius && std::max(offset.x, std::max(offset.y, offset.z)) <= extent - radius)
+		return false;
+
+	// Moving by whole texels keep the rasterized edges in place
+	float texelSize = 2.0f * extent / size;
+	lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+	lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+	cascade.center = lightCenter;
+	cascade.radius = radius;
+	cascade.boundsMin = lightCenter - glm::vec3(extent);
+	cascade.boundsMax = lightCenter + glm::vec3(extent, extent, extent + casterDistance);
+
+	// The light space look toward -z, the near plane is on the light side. Bottom and top are swapped for the y axis of Vulkan
+	glm::mat4 projection = glm::ortho(cascade.boundsMin.x, cascade.boundsMax.x, cascade.boundsMax.y, cascade.boundsMin.y, -cascade.boundsMax.z, -cascade.boundsMin.z);
+	cascade.viewProjection = projection * lightView;
+
+	return true;
+}
+
+void VulkanCascadedShadows::CmdBeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer)
+{
+	VkClearValue clearValue = {};
+	clearValue.depthStencil = {1.0f, 0};
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = framebuffer;
+	renderPassInfo.renderArea.offset = {0, 0};
+	renderPassInfo.renderArea.extent = {size, size};
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void VulkanCascadedShadows::CmdDrawCasters(VkCommandBuffer commandBuffer, uint32_t i, const Cascade& cascade, const std::vector<DrawList::DrawPacket>& packets, bool staticCasters, bool dynamicCasters)
+{
+	VkPipelineLayout pipelineLayout = shadowPipeline->GetVkPipelineLayout();
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline->GetVkPipeline());
+	PerfCounters::Add(PerfCounter::PIPELINE_BINDS);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &cascade.viewProjection);
+
+	Mesh* boundMesh = nullptr;
+
+	for (const DrawList::DrawPacket& packet : packets)
+	{
+		Model* model = packet.model;
+
+		if (!model->castShadows || !(model->isStatic ? staticCasters : dynamicCasters))
+			continue;
+
+		// Models between the cascade and the light are kept since they can cast in it
+		glm::vec4 boundingSphere = model->GetWorldBoundingSphere();
+		glm::vec3 center = glm::vec3(lightView * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+		if (glm::any(glm::lessThan(center + boundingSphere.w, cascade.boundsMin)) || glm::any(glm::greaterThan(center - boundingSphere.w, cascade.boundsMax)))
+			continue;
+
+		if (model->mesh != boundMesh)
+		{
+			boundMesh = model->mesh;
+			boundMesh->CmdBindPositions(commandBuffer);
+		}
+
+		model->DrawShadow(commandBuffer, static_cast<int>(i), pipelineLayout);
+	}
+}
+
+void VulkanCascadedShadows::CreateImages()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	CreateImage(cascadeCount, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, shadowImage, shadowImageMemory);
+
+	shadowArrayView = CreateLayerView(shadowImage, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, cascadeCount);
+	for (uint32_t c = 0; c < cascadeCount; c++)
+		shadowLayerViews.push_back(CreateLayerView(shadowImage, VK_IMAGE_VIEW_TYPE_2D, c, 1));
+
+	uint32_t cachedCount = cascadeCount - firstCachedCascade;
+	if (cachedCount > 0)
+	{
+		CreateImage(cachedCount, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, cacheImage, cacheImageMemory);
+
+		for (uint32_t c = 0; c < cachedCount; c++)
+			cacheLayerViews.push_back(CreateLayerView(cacheImage, VK_IMAGE_VIEW_TYPE_2D, c, 1));
+	}
+
+	// Sampled before the first render when the shadows start disabled
+	VkCommandBuffer commandBuffer = VulkanHelper::BeginSingleTimeCommands();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = shadowImage;
+	barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, cascadeCount};
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VulkanHelper::EndSingleTimeCommands(commandBuffer);
+
+	// Hardware PCF, outside of the cascade is lit
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.minLod = 0;
+	samplerInfo.maxLod = 0;
+	samplerInfo.mipLodBias = 0;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &shadowSampler) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create shadow sampler!");
+	}
+}
+
+void VulkanCascadedShadows::CreateRenderPasses()
+{
+	clearRenderPass = CreateRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+	cacheRenderPass = CreateRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	loadRenderPass = CreateRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+}
+
+void VulkanCascadedShadows::CreateFramebuffers()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// The three render passes are compatible, one framebuffer per layer is enough
+	auto createFramebuffer = [&](VkImageView view) {
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = clearRenderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &view;
+		framebufferInfo.width = size;
+		framebufferInfo.height = size;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer = nullptr;
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to create shadow framebuffer!");
+		}
+
+		return framebuffer;
+	};
+
+	for (VkImageView view : shadowLayerViews)
+		shadowFramebuffers.push_back(createFramebuffer(view));
+	for (VkImageView view : cacheLayerViews)
+		cacheFramebuffers.push_back(createFramebuffer(view));
+}
+
+void VulkanCascadedShadows::CreatePipeline()
+{
+	shadowVertexShader = std::unique_ptr<VulkanShader>(new VulkanShader("ShadowDepthVert", VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT));
+
+	shadowPipeline = std::unique_ptr<VulkanGraphicPipeline>(new VulkanGraphicPipeline());
+	shadowPipeline->AddShader(shadowVertexShader.get());
+	shadowPipeline->SetRenderTarget(clearRenderPass, {size, size}, VK_SAMPLE_COUNT_1_BIT, false);
+	shadowPipeline->SetPushConstantSize(sizeof(glm::mat4));
+	shadowPipeline->SetDepthBias(1.25f, 1.75f);
+	shadowPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL, VK_COMPARE_OP_LESS, true);
+}
+
+void VulkanCascadedShadows::CreateDescriptors()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);// Cascade matrices
+	layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);// Shadow maps
+	layoutBinding.Create(device);
+
+	uint32_t frameCount = VulkanRenderer::MAX_FRAMES_IN_FLIGHT;
+	infoBuffers.resize(frameCount);
+	infoBufferMemories.resize(frameCount);
+	infos.resize(frameCount);
+	for (uint32_t f = 0; f < frameCount; f++)
+	{
+		VulkanHelper::CreateBuffer(sizeof(ShadowInfo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, infoBuffers[f], infoBufferMemories[f], MemoryCategory::UNIFORM);
+
+		// Stay mapped for the lifetime of the buffer
+		vkMapMemory(device, infoBufferMemories[f], 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&infos[f]));
+		*infos[f] = {};
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = frameCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = frameCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = frameCount;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create shadow descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(frameCount, GetDescriptorSetLayout());
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = frameCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	descriptorSets.resize(frameCount);
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate shadow descriptor sets!");
+	}
+
+	for (uint32_t f = 0; f < frameCount; f++)
+	{
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = infoBuffers[f];
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = shadowArrayView;
+		imageInfo.sampler = shadowSampler;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = descriptorSets[f];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = descriptorSets[f];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[1].pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+VkRenderPass VulkanCascadedShadows::CreateRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = loadOp;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = initialLayout;
+	depthAttachment.finalLayout = finalLayout;
+
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 0;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 0;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// Wait for the cache copy and last frame sampling, then make the depth visible to the copy and the lit draws
+	std::array<VkSubpassDependency, 2> dependencies = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	VkRenderPass renderPass = nullptr;
+	if (vkCreateRenderPass(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create shadow render pass!");
+	}
+
+	return renderPass;
+}
+
+void VulkanCascadedShadows::CreateImage(uint32_t layerCount, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = {size, size, 1};
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = layerCount;
+	imageInfo.format = depthFormat;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = usage;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create shadow image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	VulkanHelper::AllocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::ATTACHMENT, imageMemory);
+
+	vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+VkImageView VulkanCascadedShadows::CreateLayerView(VkImage image, VkImageViewType viewType, uint32_t firstLayer, uint32_t layerCount)
+{
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = viewType;
+	viewInfo.format = depthFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = firstLayer;
+	viewInfo.subresourceRange.layerCount = layerCount;
+
+	VkImageView imageView = nullptr;
+	if (vkCreateImageView(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create shadow image view!");
+	}
+
+	return imageView;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <memory>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "VulkanShader.h"
+#include "VulkanLayoutBinding.h"
+#include "Rendering/Vulkan/VulkanGraphicPipeline.h"
+#include "Rendering/DrawList.h"
+
+/// <summary>
+/// Cascaded shadow maps of the directional light. The camera frustum is split in 2 to 4 slices each covered by a cascade.
+/// The far cascades keep the depth of the static models in a cache that is only redrawn when the light, the cascade
+/// or a static model move, every frame the cache is copied then only the dynamic models are drawn over it.
+/// </summary>
+class VulkanCascadedShadows
+{
+public:
+	static const uint32_t MAX_CASCADES = 4; // Same as Base.frag
+
+	// Same layout as the ShadowInfo of Base.frag
+	struct ShadowInfo
+	{
+		glm::mat4 lightViewProjection[MAX_CASCADES];
+		glm::uvec4 cascadeCount; // x cascade count, 0 when the shadows are disabled
+	};
+
+private:
+	struct Cascade
+	{
+		glm::mat4 viewProjection = glm::mat4(1);
+		glm::vec3 center = glm::vec3(0); // In light space, snapped to the texels
+		glm::vec3 boundsMin = glm::vec3(0); // Light space box rendered by the cascade, toward the light along +z
+		glm::vec3 boundsMax = glm::vec3(0);
+		float radius = 0; // Bounding sphere of the frustum slice
+		float splitDepth = 0; // Far view depth of the frustum slice
+		bool cached = false; // Static models are kept in the cache
+		bool cacheValid = false;
+		bool redrawCache = false; // Cache redrawn by the command buffer recorded this frame
+	};
+
+	uint32_t cascadeCount = 0;
+	uint32_t firstCachedCascade = 0;
+	uint32_t size = 0;
+	float shadowDistance = 0;
+	float splitLambda = 0.75f; // Blend between logarithmic and uniform splits
+	float cacheMargin = 0.25f; // Cached cascades cover this much more than their slice so they move less often
+	float casterDistance = 200.0f; // Distance toward the light where the models still cast in a cascade
+	VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
+
+	VkImage shadowImage = nullptr;
+	VkDeviceMemory shadowImageMemory = nullptr;
+	VkImageView shadowArrayView = nullptr; // Every cascade, sampled by the lit pipelines
+	std::vector<VkImageView> shadowLayerViews;
+	std::vector<VkFramebuffer> shadowFramebuffers;
+	VkSampler shadowSampler = nullptr;
+
+	// One layer per cached cascade
+	VkImage cacheImage = nullptr;
+	VkDeviceMemory cacheImageMemory = nullptr;
+	std::vector<VkImageView> cacheLayerViews;
+	std::vector<VkFramebuffer> cacheFramebuffers;
+
+	VkRenderPass clearRenderPass = nullptr; // Cascades without a cache
+	VkRenderPass cacheRenderPass = nullptr; // Static models, the result is copied every frame
+	VkRenderPass loadRenderPass = nullptr; // Dynamic models over the copied cache
+
+	std::unique_ptr<VulkanShader> shadowVertexShader;
+	std::unique_ptr<VulkanGraphicPipeline> shadowPipeline;
+
+	VulkanLayoutBinding layoutBinding; // Set 2 of the lit graphic pipelines
+	VkDescriptorPool descriptorPool = nullptr;
+	std::vector<VkDescriptorSet> descriptorSets; // One per frame in flight
+
+	// Host visible, one per frame in flight written once its fence signaled
+	std::vector<VkBuffer> infoBuffers;
+	std::vector<VkDeviceMemory> infoBufferMemories;
+	std::vector<ShadowInfo*> infos;
+
+	std::vector<Cascade> cascades;
+	glm::mat4 lightView = glm::mat4(1);
+	glm::vec3 cachedLightDirection = glm::vec3(0);
+	size_t staticModelCount = 0;
+	size_t staticModelHash = 0;
+	uint32_t cacheRedrawCount = 0;
+
+public:
+	/// <param name="cascadeCount">Clamped between 2 and MAX_CASCADES</param>
+	/// <param name="size">Width and height of each cascade in texel</param>
+	/// <param name="shadowDistance">View depth covered by the last cascade</param>
+	/// <param name="firstCachedCascade">This cascade and the farther ones cache the static models</param>
+	VulkanCascadedShadows(uint32_t cascadeCount, uint32_t size, float shadowDistance, uint32_t firstCachedCascade);
+	~VulkanCascadedShadows();
+
+	/// <summary>
+	/// Fit the cascades to the camera frustum and find the caches to redraw.
+	/// Need to be called once per frame after the models bounding sphere are updated.
+	/// </summary>
+	/// <param name="lightDirection">Toward the light</param>
+	/// <param name="frame">Frame in flight whose fence signaled, its matrices are written</param>
+	void Update(const glm::mat4& view, float fov, float aspect, float nearPlane, const glm::vec3& lightDirection, const std::vector<std::unique_ptr<Model>>& models, uint32_t frame);
+
+	/// <summary>
+	/// Nothing is shadowed until the next Update and the caches are redrawn then.
+	/// </summary>
+	void Disable(uint32_t frame);
+
+	/// <summary>
+	/// Render the cascades, record it outside of a render pass before the lit draws.
+	/// </summary>
+	void CmdRender(VkCommandBuffer commandBuffer, uint32_t i, const std::vector<DrawList::DrawPacket>& packets);
+
+	/// <summary>
+	/// Bind the shadow maps and the matrices of the frame in flight as the set 2 of a graphic pipeline layout.
+	/// </summary>
+	void CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frame);
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const;
+
+	/// <summary>
+	/// Depth array with one layer per cascade, in the depth read only layout outside of CmdRender.
+	/// </summary>
+	VkImage GetShadowImage() const;
+	uint32_t GetCascadeCount() const;
+	uint32_t GetFirstCachedCascade() const;
+	float GetSplitDepth(uint32_t cascade) const;
+
+	/// <summary>
+	/// Number of time a cascade cache was redrawn since the start.
+	/// </summary>
+	uint32_t GetCacheRedrawCount() const;
+
+private:
+	/// <returns>Return true if the light space box of the cascade moved</returns>
+	bool FitCascade(Cascade& cascade, const glm::mat4& inverseView, float tanHalfFov, float aspect, float splitNear, float splitFar);
+	void CmdBeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer);
+	void CmdDrawCasters(VkCommandBuffer commandBuffer, uint32_t i, const Cascade& cascade, const std::vector<DrawList::DrawPacket>& packets, bool staticCasters, bool dynamicCasters);
+	void CreateImages();
+	void CreateRenderPasses();
+	void CreateFramebuffers();
+	void CreatePipeline();
+	void CreateDescriptors();
+	void CreateImage(uint32_t layerCount, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory);
+	VkRenderPass CreateRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout);
+	VkImageView CreateLayerView(VkImage image, VkImageViewType viewType, uint32_t firstLayer, uint32_t layerCount);
+};
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "Rendering/Vulkan/VulkanClusteredLighting.h"
+
+#include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+VulkanClusteredLighting::VulkanClusteredLighting(uint32_t maxLights)
+	: maxLights(std::max(maxLights, 1u))
+{
+	// The fragment shaders read the same set as the cluster build
+	VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	clusterBuildShader = std::unique_ptr<VulkanShader>(new VulkanShader("ClusterBuildComp", VkShaderStageFlagBits::VK_SHADER_STAGE_COMPUTE_BIT));
+
+	clusterBuildPipeline = std::unique_ptr<VulkanComputePipeline>(new VulkanComputePipeline(clusterBuildShader.get()));
+	clusterBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, stages);// Cluster info
+	clusterBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages);// Lights
+	clusterBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages);// Light count of each cluster
+	clusterBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages);// Light indices of each cluster
+	clusterBuildPipeline->Create();
+
+	CreateBuffers();
+	CreateDescriptors();
+	CreateQueryPool();
+}
+
+VulkanClusteredLighting::~VulkanClusteredLighting()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+	for (Frame& frame : frames)
+	{
+		vkUnmapMemory(device, frame.infoBufferMemory);
+		vkUnmapMemory(device, frame.lightBufferMemory);
+
+		vkDestroyBuffer(device, frame.infoBuffer, nullptr);
+		VulkanHelper::FreeMemory(device, frame.infoBufferMemory);
+		vkDestroyBuffer(device, frame.lightBuffer, nullptr);
+		VulkanHelper::FreeMemory(device, frame.lightBufferMemory);
+		vkDestroyBuffer(device, frame.clusterLightCountBuffer, nullptr);
+		VulkanHelper::FreeMemory(device, frame.clusterLightCountBufferMemory);
+		vkDestroyBuffer(device, frame.clusterLightIndexBuffer, nullptr);
+		VulkanHelper::FreeMemory(device, frame.clusterLightIndexBufferMemory);
+	}
+
+	clusterBuildPipeline.reset();
+	clusterBuildShader.reset();
+
+	Logger::Log("Clustered lighting destroyed");
+}
+
+void VulkanClusteredLighting::AddLight(const Light& light)
+{
+	if (lights.size() >= maxLights)
+	{
+		if (!overflowLogged)
+			Logger::Log(LogSeverity::WARNING, "More than " + std::to_string(maxLights) + " lights, the others are ignored");
+		overflowLogged = true;
+		return;
+	}
+
+	lights.push_back(light);
+}
+
+void VulkanClusteredLighting::Update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, VkExtent2D extent, uint32_t frame)
+{
+	updatedFrame = frame;
+	Frame& current = frames[frame];
+
+	lightCount = static_cast<uint32_t>(lights.size());
+	std::copy(lights.begin(), lights.end(), current.lightData);
+	lights.clear();
+
+	ClusterInfo* info = current.info;
+	info->view = view;
+	info->inverseProjection = glm::inverse(projection);
+	info->gridSize = glm::uvec4(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, lightCount);
+	info->screenSizeNearFar = glm::vec4(extent.width, extent.height, nearPlane, farPlane);
+}
+
+void VulkanClusteredLighting::CmdBuildClusters(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (timestampQueryPool != nullptr)
+	{
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, frame * 2, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, frame * 2);
+	}
+
+	clusterBuildPipeline->CmdBind(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterBuildPipeline->GetVkPipelineLayout(), 0, 1, &frames[frame].descriptorSet, 0, nullptr);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+	vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + 63) / 64, 1, 1);
+
+	if (timestampQueryPool != nullptr)
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, frame * 2 + 1);
+}
+
+void VulkanClusteredLighting::CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frame)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &frames[frame].descriptorSet, 0, nullptr);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+}
+
+void VulkanClusteredLighting::ReadTimings(uint32_t frame)
+{
+	if (timestampQueryPool == nullptr)
+		return;
+
+	std::array<uint64_t, 2> timestamps = {};
+	if (vkGetQueryPoolResults(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk(), timestampQueryPool, frame * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	double period = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetProperties().limits.timestampPeriod;
+	clusterBuildTime = (timestamps[1] - timestamps[0]) * period / 1000000.0;
+}
+
+VkDescriptorSetLayout VulkanClusteredLighting::GetDescriptorSetLayout() const
+{
+	return clusterBuildPipeline->layoutBinding.GetVkDescriptorSetLayout();
+}
+
+uint32_t VulkanClusteredLighting::GetLightCount() const
+{
+	return lightCount;
+}
+
+std::vector<VulkanClusteredLighting::Light> VulkanClusteredLighting::GetLights() const
+{
+	const Light* lightData = frames[updatedFrame].lightData;
+	return std::vector<Light>(lightData, lightData + lightCount);
+}
+
+uint32_t VulkanClusteredLighting::GetMaxLights() const
+{
+	return maxLights;
+}
+
+double VulkanClusteredLighting::GetClusterBuildTime() const
+{
+	return clusterBuildTime;
+}
+
+VulkanClusteredLighting::Light VulkanClusteredLighting::CreatePointLight(const glm::vec3& position, const glm::vec3& color, float intensity, float range)
+{
+	Light light = {};
+	light.positionRange = glm::vec4(position, range);
+	light.colorIntensity = glm::vec4(color, intensity);
+	light.spotDirection = glm::vec4(0, 0, -1, -1);
+
+	return light;
+}
+
+VulkanClusteredLighting::Light VulkanClusteredLighting::CreateSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float intensity, float range, float coneAngle)
+{
+	Light light = {};
+	light.positionRange = glm::vec4(position, range);
+	light.colorIntensity = glm::vec4(color, intensity);
+	light.spotDirection = glm::vec4(glm::normalize(direction), std::cos(coneAngle));
+
+	return light;
+}
+
+void VulkanClusteredLighting::CreateBuffers()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	frames.resize(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
+	for (Frame& frame : frames)
+	{
+		VulkanHelper::CreateBuffer(sizeof(ClusterInfo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, properties, frame.infoBuffer, frame.infoBufferMemory, MemoryCategory::UNIFORM);
+		VulkanHelper::CreateBuffer(sizeof(Light) * maxLights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, properties, frame.lightBuffer, frame.lightBufferMemory);
+
+		// Only touched by the GPU
+		VulkanHelper::CreateBuffer(sizeof(uint32_t) * CLUSTER_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.clusterLightCountBuffer, frame.clusterLightCountBufferMemory);
+		VulkanHelper::CreateBuffer(sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.clusterLightIndexBuffer, frame.clusterLightIndexBufferMemory);
+
+		// Stay mapped for the lifetime of the buffers
+		vkMapMemory(device, frame.infoBufferMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&frame.info));
+		vkMapMemory(device, frame.lightBufferMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&frame.lightData));
+
+		*frame.info = {};
+	}
+}
+
+void VulkanClusteredLighting::CreateDescriptors()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	uint32_t frameCount = static_cast<uint32_t>(frames.size());
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = frameCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = 3 * frameCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = frameCount;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create clustered lighting descriptor pool!");
+	}
+
+	for (Frame& frame : frames)
+	{
+		VkDescriptorSetLayout layout = GetDescriptorSetLayout();
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate clustered lighting descriptor set!");
+		}
+
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+		bufferInfos[0].buffer = frame.infoBuffer;
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = frame.lightBuffer;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		bufferInfos[2].buffer = frame.clusterLightCountBuffer;
+		bufferInfos[2].range = VK_WHOLE_SIZE;
+		bufferInfos[3].buffer = frame.clusterLightIndexBuffer;
+		bufferInfos[3].range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++)
+		{
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = frame.descriptorSet;
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+void VulkanClusteredLighting::CreateQueryPool()
+{
+	VulkanRenderer* renderer = VulkanRenderer::GetInstance();
+
+	if (!renderer->GetPhysicalDevice()->GetProperties().limits.timestampComputeAndGraphics)
+	{
+		Logger::Log(LogSeverity::WARNING, "Timestamps not supported, the cluster build won't be timed");
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = VulkanRenderer::MAX_FRAMES_IN_FLIGHT * 2;
+
+	if (vkCreateQueryPool(renderer->GetLogicalDevice()->GetVk(), &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create timestamp query pool!");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "VulkanShader.h"
+#include "VulkanComputePipeline.h"
+
+/// <summary>
+/// Clustered forward lighting. The view frustum is split in screen tiles and logarithmic depth slices,
+/// a compute pass list the point and spot lights touching each cluster and the fragment shaders only
+/// iterate the lights of their cluster.
+/// </summary>
+class VulkanClusteredLighting
+{
+public:
+	static const uint32_t CLUSTER_X = 16;
+	static const uint32_t CLUSTER_Y = 9;
+	static const uint32_t CLUSTER_Z = 24;
+	static const uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+	static const uint32_t MAX_LIGHTS_PER_CLUSTER = 128; // Same as ClusterBuild.comp and Base.frag
+
+	// Same layout as the Light of ClusterBuild.comp and Base.frag
+	struct Light
+	{
+		glm::vec4 positionRange; // xyz position in world space, w range
+		glm::vec4 colorIntensity; // rgb color, w intensity
+		glm::vec4 spotDirection; // xyz direction, w cosine of the cone half angle, -1 for point lights
+	};
+
+	// Same layout as the ClusterInfo of ClusterBuild.comp and Base.frag
+	struct ClusterInfo
+	{
+		glm::mat4 view;
+		glm::mat4 inverseProjection;
+		glm::uvec4 gridSize; // xyz cluster count, w light count
+		glm::vec4 screenSizeNearFar;
+	};
+
+private:
+	// Buffers of one frame in flight, the next frame builds its clusters on the compute queue while this one is still lit
+	struct Frame
+	{
+		VkDescriptorSet descriptorSet = nullptr;
+
+		// Host visible, written once the fence of the frame signaled
+		VkBuffer infoBuffer = nullptr;
+		VkDeviceMemory infoBufferMemory = nullptr;
+		ClusterInfo* info = nullptr;
+		VkBuffer lightBuffer = nullptr;
+		VkDeviceMemory lightBufferMemory = nullptr;
+		Light* lightData = nullptr;
+
+		VkBuffer clusterLightCountBuffer = nullptr;
+		VkDeviceMemory clusterLightCountBufferMemory = nullptr;
+		VkBuffer clusterLightIndexBuffer = nullptr;
+		VkDeviceMemory clusterLightIndexBufferMemory = nullptr;
+	};
+
+	std::unique_ptr<VulkanShader> clusterBuildShader;
+	std::unique_ptr<VulkanComputePipeline> clusterBuildPipeline; // Its set layout is also the set 1 of the graphic pipelines
+
+	VkDescriptorPool descriptorPool = nullptr;
+
+	uint32_t maxLights = 0;
+	std::vector<Frame> frames;
+	uint32_t updatedFrame = 0; // Frame of the last Update
+
+	// Two timestamps around the cluster build of each frame in flight
+	VkQueryPool timestampQueryPool = nullptr;
+	double clusterBuildTime = 0;
+
+	std::vector<Light> lights; // Added since the last Update
+	uint32_t lightCount = 0;
+	bool overflowLogged = false;
+
+public:
+	/// <param name="maxLights">Lights past this count are ignored</param>
+	VulkanClusteredLighting(uint32_t maxLights);
+	~VulkanClusteredLighting();
+
+	/// <summary>
+	/// Light the next frame, lights need to be added again every frame.
+	/// </summary>
+	void AddLight(const Light& light);
+
+	/// <summary>
+	/// Upload the lights added since the last call and the camera used to build the clusters.
+	/// </summary>
+	/// <param name="frame">Frame in flight whose fence signaled, its buffers are written</param>
+	void Update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, VkExtent2D extent, uint32_t frame);
+
+	/// <summary>
+	/// Fill the light list of every cluster, record it outside of a render pass before the lit draws.
+	/// The writes are made visible to the fragment shaders by the caller.
+	/// </summary>
+	/// <param name="frame">Frame in flight the buffers and the timestamps of the build belong to</param>
+	void CmdBuildClusters(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	/// <summary>
+	/// Bind the lights and the clusters of the frame in flight as the set 1 of a graphic pipeline layout.
+	/// </summary>
+	void CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frame);
+
+	/// <summary>
+	/// Read the GPU time of the cluster build of the frame in flight once its fence signaled.
+	/// </summary>
+	void ReadTimings(uint32_t frame);
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const;
+	uint32_t GetLightCount() const;
+
+	/// <summary>
+	/// Copy of the lights uploaded by the last Update.
+	/// </summary>
+	std::vector<Light> GetLights() const;
+	uint32_t GetMaxLights() const;
+
+	/// <summary>
+	/// GPU time of the last measured cluster build in millisecond, 0 if timestamps aren't supported.
+	/// </summary>
+	double GetClusterBuildTime() const;
+
+	static Light CreatePointLight(const glm::vec3& position, const glm::vec3& color, float intensity, float range);
+	/// <param name="coneAngle">Half angle of the cone in radian</param>
+	static Light CreateSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float intensity, float range, float coneAngle);
+
+private:
+	void CreateBuffers();
+	void CreateDescriptors();
+	void CreateQueryPool();
+};
\ No newline at end of file
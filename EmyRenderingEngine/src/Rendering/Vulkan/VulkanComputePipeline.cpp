@@ -0,0 +1,71 @@
+#include "Rendering/Vulkan/VulkanComputePipeline.h"
+
+#include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
+#include "VulkanRenderer.h"
+
+VulkanComputePipeline::VulkanComputePipeline(VulkanShader* shader)
+{
+	shaderStage = shader->GetShaderStageInfo();
+}
+
+VulkanComputePipeline::~VulkanComputePipeline()
+{
+	vkDestroyPipeline(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk(), computePipeline, nullptr);
+	vkDestroyPipelineLayout(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk(), pipelineLayout, nullptr);
+
+	Logger::Log("Compute pipeline destroyed");
+}
+
+void VulkanComputePipeline::Create(uint32_t pushConstantSize)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	layoutBinding.Create(device);
+
+	VkDescriptorSetLayout dsl = layoutBinding.GetVkDescriptorSetLayout();
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &dsl;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create compute pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStage;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create compute pipeline!");
+	}
+}
+
+void VulkanComputePipeline::CmdBind(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	PerfCounters::Add(PerfCounter::PIPELINE_BINDS);
+}
+
+VkPipelineLayout VulkanComputePipeline::GetVkPipelineLayout() const
+{
+	return pipelineLayout;
+}
+
+VkPipeline VulkanComputePipeline::GetVkPipeline() const
+{
+	return computePipeline;
+}
\ No newline at end of file
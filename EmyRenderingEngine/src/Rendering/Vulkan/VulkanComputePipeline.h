@@ -0,0 +1,32 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include "VulkanLayoutBinding.h"
+#include "VulkanShader.h"
+
+class VulkanComputePipeline
+{
+public:
+	VulkanLayoutBinding layoutBinding;
+
+private:
+	VkPipelineShaderStageCreateInfo shaderStage = {};
+
+	VkPipelineLayout pipelineLayout = nullptr;
+	VkPipeline computePipeline = nullptr;
+
+public:
+	VulkanComputePipeline(VulkanShader* shader);
+	~VulkanComputePipeline();
+
+	/// <summary>
+	/// Create the pipeline, the layout bindings need to be added before.
+	/// </summary>
+	/// <param name="pushConstantSize">Size in byte of the push constant block, 0 if there none</param>
+	void Create(uint32_t pushConstantSize = 0);
+
+	void CmdBind(VkCommandBuffer commandBuffer);
+
+	VkPipelineLayout GetVkPipelineLayout() const;
+	VkPipeline GetVkPipeline() const;
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <array>
 #include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
 #include "Rendering/Vulkan/VulkanHelper.h"
 
 VulkanDescriptor::VulkanDescriptor(VkDevice device, size_t swapchainImageCount, std::vector<VkBuffer> uniformBuffers, VkDescriptorSetLayout descriptorSetLayout, Texture* texture, Texture* normalTexture)
@@ -9,7 +10,7 @@ VulkanDescriptor::VulkanDescriptor(VkDevice device, size_t swapchainImageCount,
 	this->device = device;
 
 	//TODO: Unhardcode that couple that with shader. Maybe a shader type
-	std::array<VkDescriptorPoolSize, 3> poolSizes = {};
+	std::vector<VkDescriptorPoolSize> poolSizes(3);
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	poolSizes[0].descriptorCount = static_cast<uint32_t>(swapchainImageCount);
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -17,29 +18,7 @@ VulkanDescriptor::VulkanDescriptor(VkDevice device, size_t swapchainImageCount,
 	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	poolSizes[2].descriptorCount = static_cast<uint32_t>(swapchainImageCount);
 
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<uint32_t>(swapchainImageCount);
-
-	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create descriptor pool!");
-	}
-
-	std::vector<VkDescriptorSetLayout> layouts(swapchainImageCount, descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImageCount);
-	allocInfo.pSetLayouts = layouts.data();
-
-	descriptorSets.resize(swapchainImageCount);
-	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate descriptor sets!");
-	}
+	CreatePool(poolSizes, swapchainImageCount, descriptorSetLayout);
 
 	for (size_t i = 0; i < swapchainImageCount; i++)
 	{
@@ -88,6 +67,48 @@ VulkanDescriptor::VulkanDescriptor(VkDevice device, size_t swapchainImageCount,
 	}
 }
 
+VulkanDescriptor::VulkanDescriptor(VkDevice device, size_t swapchainImageCount, std::vector<VkBuffer> uniformBuffers, VkBuffer meshletBuffer, std::vector<VkBuffer> indirectBuffers, VkDescriptorSetLayout descriptorSetLayout)
+{
+	this->device = device;
+
+	std::vector<VkDescriptorPoolSize> poolSizes(2);
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(swapchainImageCount);
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = static_cast<uint32_t>(swapchainImageCount * 2);
+
+	CreatePool(poolSizes, swapchainImageCount, descriptorSetLayout);
+
+	for (size_t i = 0; i < swapchainImageCount; i++)
+	{
+		std::array<VkDescriptorBufferInfo, 3> bufferInfos = {};
+		bufferInfos[0].buffer = uniformBuffers[i];
+		bufferInfos[0].offset = 0;
+		bufferInfos[0].range = sizeof(VulkanHelper::UniformBufferObject);
+		bufferInfos[1].buffer = meshletBuffer;
+		bufferInfos[1].offset = 0;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		bufferInfos[2].buffer = indirectBuffers[i];
+		bufferInfos[2].offset = 0;
+		bufferInfos[2].range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
+
+		for (size_t y = 0; y < descriptorWrites.size(); y++)
+		{
+			descriptorWrites[y].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[y].dstSet = descriptorSets[i];
+			descriptorWrites[y].dstBinding = static_cast<uint32_t>(y);
+			descriptorWrites[y].dstArrayElement = 0;
+			descriptorWrites[y].descriptorType = y == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[y].descriptorCount = 1;
+			descriptorWrites[y].pBufferInfo = &bufferInfos[y];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
 VulkanDescriptor::~VulkanDescriptor()
 {
 	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
@@ -95,7 +116,81 @@ VulkanDescriptor::~VulkanDescriptor()
 	Logger::Log("Descriptor destroyed");
 }
 
-void VulkanDescriptor::CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, int i)
+void VulkanDescriptor::CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, int i, VkPipelineBindPoint bindPoint)
+{
+	if (!staleTextures.empty() && staleTextures[i])
+	{
+		WriteTextures(i);
+		staleTextures[i] = false;
+	}
+
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+}
+
+void VulkanDescriptor::UpdateTextures(Texture* texture, Texture* normalTexture)
 {
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+	this->texture = texture;
+	this->normalTexture = normalTexture;
+	staleTextures.assign(descriptorSets.size(), true);
+}
+
+void VulkanDescriptor::WriteTextures(size_t i)
+{
+	VkDescriptorImageInfo textureImageInfo = {};
+	textureImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	textureImageInfo.imageView = texture->GetTextureImageView();
+	textureImageInfo.sampler = texture->GetTextureSampler();
+
+	VkDescriptorImageInfo normalTextureImageInfo = {};
+	normalTextureImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	normalTextureImageInfo.imageView = normalTexture->GetTextureImageView();
+	normalTextureImageInfo.sampler = normalTexture->GetTextureSampler();
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+
+	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[0].dstSet = descriptorSets[i];
+	descriptorWrites[0].dstBinding = 1;
+	descriptorWrites[0].dstArrayElement = 0;
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[0].descriptorCount = 1;
+	descriptorWrites[0].pImageInfo = &textureImageInfo;
+
+	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[1].dstSet = descriptorSets[i];
+	descriptorWrites[1].dstBinding = 2;
+	descriptorWrites[1].dstArrayElement = 0;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[1].descriptorCount = 1;
+	descriptorWrites[1].pImageInfo = &normalTextureImageInfo;
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void VulkanDescriptor::CreatePool(const std::vector<VkDescriptorPoolSize>& poolSizes, size_t swapchainImageCount, VkDescriptorSetLayout descriptorSetLayout)
+{
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = static_cast<uint32_t>(swapchainImageCount);
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(swapchainImageCount, descriptorSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImageCount);
+	allocInfo.pSetLayouts = layouts.data();
+
+	descriptorSets.resize(swapchainImageCount);
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate descriptor sets!");
+	}
 }
@@ -13,9 +13,26 @@ private:
 	VkDescriptorPool descriptorPool;
 	std::vector<VkDescriptorSet> descriptorSets;
 
+	// Textures to write in the sets marked stale when they are next bound, a set may still be in flight before
+	Texture* texture = nullptr;
+	Texture* normalTexture = nullptr;
+	std::vector<bool> staleTextures;
+
 public:
 	VulkanDescriptor(VkDevice device, size_t swapchainImageCount, std::vector<VkBuffer> uniformBuffers, VkDescriptorSetLayout descriptorSetLayout, Texture* texture, Texture* normalTexture);
+	// Meshlet culling: uniform buffer, meshlets storage buffer and indirect draws storage buffer
+	VulkanDescriptor(VkDevice device, size_t swapchainImageCount, std::vector<VkBuffer> uniformBuffers, VkBuffer meshletBuffer, std::vector<VkBuffer> indirectBuffers, VkDescriptorSetLayout descriptorSetLayout);
 	~VulkanDescriptor();
 
-	void CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, int i);
+	void CmdBind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, int i, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+	/// <summary>
+	/// Rewrite the texture bindings after their image view changed.
+	/// Each set is written the next time it is bound, once the frame that last drew in its swapchain image is done.
+	/// </summary>
+	void UpdateTextures(Texture* texture, Texture* normalTexture);
+
+private:
+	void WriteTextures(size_t i);
+	void CreatePool(const std::vector<VkDescriptorPoolSize>& poolSizes, size_t swapchainImageCount, VkDescriptorSetLayout descriptorSetLayout);
 };
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "Rendering/Vulkan/VulkanDynamicResolution.h"
+
+#include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Same layout as the UpscaleInfo of Upscale.frag
+	struct UpscaleConstants
+	{
+		glm::vec2 renderSize;
+		glm::vec2 textureSize;
+	};
+}
+
+VulkanDynamicResolution::VulkanDynamicResolution(bool enabled, float budget, float minScale)
+	: enabled(enabled), budget(std::max(budget, 0.1f)), minScale(std::min(std::max(minScale, 0.1f), 1.0f))
+{
+	extent = VulkanRenderer::GetInstance()->GetSwapChain()->GetVkExtent2D();
+
+	CreateQueryPool();
+	CreatePipeline();
+	CreateDescriptors();
+}
+
+VulkanDynamicResolution::~VulkanDynamicResolution()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroySampler(device, sampler, nullptr);
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+
+	upscaleVertexShader.reset();
+	upscaleFragShader.reset();
+
+	Logger::Log("Dynamic resolution destroyed");
+}
+
+void VulkanDynamicResolution::CmdBeginScene(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (timestampQueryPool == nullptr)
+		return;
+
+	vkCmdResetQueryPool(commandBuffer, timestampQueryPool, frame * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, frame * 2);
+}
+
+void VulkanDynamicResolution::CmdEndScene(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (timestampQueryPool != nullptr)
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, frame * 2 + 1);
+}
+
+void VulkanDynamicResolution::Update(uint32_t frame)
+{
+	if (timestampQueryPool == nullptr)
+		return;
+
+	std::array<uint64_t, 2> timestamps = {};
+	if (vkGetQueryPoolResults(VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk(), timestampQueryPool, frame * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	double period = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetProperties().limits.timestampPeriod;
+	sceneTime = (timestamps[1] - timestamps[0]) * period / 1000000.0;
+
+	if (!enabled)
+	{
+		scale = 1;
+		return;
+	}
+
+	if (sceneTime <= 0)
+		return;
+
+	// The cost of the scene mostly follows its pixel count, so the scale on each axis follows the square root of the time
+	float target = budget * (1.0f - headroom);
+	float wantedScale = std::min(std::max(scale * std::sqrt(target / static_cast<float>(sceneTime)), minScale), 1.0f);
+
+	// Drop at once when over the budget, grow slowly when well under it and keep the scale in between so it doesn't oscillate
+	if (sceneTime > budget)
+		scale = wantedScale;
+	else if (sceneTime < target)
+		scale += (wantedScale - scale) * increaseRate;
+}
+
+void VulkanDynamicResolution::CmdUpscale(VkCommandBuffer commandBuffer, VkImageView sceneColor)
+{
+	// A new scene color is only created once the device is idle, the set isn't used by a frame in flight
+	if (sceneColor != sceneView)
+		WriteDescriptors(sceneColor);
+
+	VkExtent2D renderExtent = GetRenderExtent();
+
+	VkViewport viewport = {0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f};
+	VkRect2D scissor = {{0, 0}, extent};
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	UpscaleConstants constants = {};
+	constants.renderSize = glm::vec2(renderExtent.width, renderExtent.height);
+	constants.textureSize = glm::vec2(extent.width, extent.height);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	PerfCounters::Add(PerfCounter::PIPELINE_BINDS);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+
+	// Fullscreen triangle generated by the vertex shader
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	PerfCounters::Add(PerfCounter::DRAW_CALLS);
+}
+
+VkExtent2D VulkanDynamicResolution::GetRenderExtent() const
+{
+	VkExtent2D renderExtent = {};
+	renderExtent.width = std::min(std::max(static_cast<uint32_t>(extent.width * scale + 0.5f), 1u), extent.width);
+	renderExtent.height = std::min(std::max(static_cast<uint32_t>(extent.height * scale + 0.5f), 1u), extent.height);
+
+	return renderExtent;
+}
+
+float VulkanDynamicResolution::GetScale() const
+{
+	return scale;
+}
+
+double VulkanDynamicResolution::GetSceneTime() const
+{
+	return sceneTime;
+}
+
+bool VulkanDynamicResolution::IsEnabled() const
+{
+	return enabled;
+}
+
+void VulkanDynamicResolution::SetEnabled(bool enabled)
+{
+	this->enabled = enabled && timestampQueryPool != nullptr;
+	if (!this->enabled)
+		scale = 1;
+}
+
+float VulkanDynamicResolution::GetBudget() const
+{
+	return budget;
+}
+
+void VulkanDynamicResolution::SetBudget(float budget)
+{
+	this->budget = std::max(budget, 0.1f);
+}
+
+void VulkanDynamicResolution::CreateQueryPool()
+{
+	VulkanRenderer* renderer = VulkanRenderer::GetInstance();
+
+	if (!renderer->GetPhysicalDevice()->GetProperties().limits.timestampComputeAndGraphics)
+	{
+		Logger::Log(LogSeverity::WARNING, "Timestamps not supported, the scene is rendered at native resolution");
+		enabled = false;
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = VulkanRenderer::MAX_FRAMES_IN_FLIGHT * 2;
+
+	if (vkCreateQueryPool(renderer->GetLogicalDevice()->GetVk(), &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create timestamp query pool!");
+	}
+}
+
+void VulkanDynamicResolution::CreatePipeline()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	upscaleVertexShader = std::unique_ptr<VulkanShader>(new VulkanShader("UpscaleVert", VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT));
+	upscaleFragShader = std::unique_ptr<VulkanShader>(new VulkanShader("UpscaleFrag", VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT));
+
+	layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);// Scene color
+	layoutBinding.Create(device);
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {upscaleVertexShader->GetShaderStageInfo(), upscaleFragShader->GetShaderStageInfo()};
+
+	// No vertex buffer, the vertex shader makes the triangle from the vertex index
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkDescriptorSetLayout setLayout = layoutBinding.GetVkDescriptorSetLayout();
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(UpscaleConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create upscale pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.renderPass = VulkanRenderer::GetInstance()->GetPresentRenderPass()->GetVk();
+	pipelineInfo.subpass = 0;
+
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create upscale pipeline!");
+	}
+
+	// Bilinear taps of the bicubic filter, the shader keeps them inside the render extent
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.minLod = 0;
+	samplerInfo.maxLod = 0;
+	samplerInfo.mipLodBias = 0;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create upscale sampler!");
+	}
+}
+
+void VulkanDynamicResolution::CreateDescriptors()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create upscale descriptor pool!");
+	}
+
+	VkDescriptorSetLayout layout = layoutBinding.GetVkDescriptorSetLayout();
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate upscale descriptor set!");
+	}
+}
+
+void VulkanDynamicResolution::WriteDescriptors(VkImageView sceneColor)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	sceneView = sceneColor;
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = sceneColor;
+	imageInfo.sampler = sampler;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <memory>
+
+#include "VulkanShader.h"
+#include "VulkanLayoutBinding.h"
+
+/// <summary>
+/// Dynamic resolution scaling. The scene is rendered in the top left corner of the scene color,
+/// the size of this area follows the GPU time of the scene measured with timestamps so it stays under a frame time budget.
+/// The area is then upscaled to the swapchain image with a Catmull-Rom filter and the UI is drawn over it at native resolution.
+/// </summary>
+class VulkanDynamicResolution
+{
+private:
+	VkExtent2D extent = {}; // Swapchain extent, the largest render extent
+	bool enabled = false;
+	float budget = 0; // Millisecond
+	float minScale = 0;
+	float scale = 1;
+	float headroom = 0.1f; // The scale only grows when the scene is this much under the budget
+	float increaseRate = 0.1f; // Part of the way to the wanted scale done each frame when it grows
+	double sceneTime = 0;
+
+	// Two timestamps around the scene passes of each frame in flight
+	VkQueryPool timestampQueryPool = nullptr;
+
+	std::unique_ptr<VulkanShader> upscaleVertexShader;
+	std::unique_ptr<VulkanShader> upscaleFragShader;
+	VulkanLayoutBinding layoutBinding;
+	VkPipelineLayout pipelineLayout = nullptr;
+	VkPipeline pipeline = nullptr;
+	VkSampler sampler = nullptr;
+	VkDescriptorPool descriptorPool = nullptr;
+	VkDescriptorSet descriptorSet = nullptr;
+	VkImageView sceneView = nullptr; // Scene color the set was written with
+
+public:
+	/// <param name="enabled">Render at the swapchain extent when disabled, the scene is still upscaled</param>
+	/// <param name="budget">GPU time of the scene to stay under in millisecond</param>
+	/// <param name="minScale">Lowest scale of the render extent on each axis</param>
+	VulkanDynamicResolution(bool enabled, float budget, float minScale);
+	~VulkanDynamicResolution();
+
+	/// <summary>
+	/// Timestamp before the scene passes, record it at the start of the command buffer.
+	/// </summary>
+	void CmdBeginScene(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	/// <summary>
+	/// Timestamp once the scene passes are done, record it before the upscale.
+	/// </summary>
+	void CmdEndScene(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	/// <summary>
+	/// Read the scene time of the last submit of the frame in flight once its fence signaled and pick the scale of the next frame from it.
+	/// </summary>
+	void Update(uint32_t frame);
+
+	/// <summary>
+	/// Draw the render extent of the scene color over the whole render pass, record it in the present render pass.
+	/// The scene color needs to be in the shader read only layout.
+	/// </summary>
+	/// <param name="sceneColor">Transient image of the render graph, the descriptor is rewritten when it changed</param>
+	void CmdUpscale(VkCommandBuffer commandBuffer, VkImageView sceneColor);
+
+	/// <summary>
+	/// Area of the scene color the scene is rendered in this frame.
+	/// </summary>
+	VkExtent2D GetRenderExtent() const;
+	float GetScale() const;
+
+	/// <summary>
+	/// GPU time of the last measured scene in millisecond, 0 if timestamps aren't supported.
+	/// </summary>
+	double GetSceneTime() const;
+
+	bool IsEnabled() const;
+	void SetEnabled(bool enabled);
+	float GetBudget() const;
+	void SetBudget(float budget);
+
+private:
+	void CreateQueryPool();
+	void CreatePipeline();
+	void CreateDescriptors();
+	void WriteDescriptors(VkImageView sceneColor);
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "VulkanFrameCapture.h"
+#include "VulkanRenderer.h"
+#include "Helper/Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	nlohmann::json ToJson(const glm::vec3& vector)
+	{
+		return { vector.x, vector.y, vector.z };
+	}
+
+	glm::vec3 ToVec3(const nlohmann::json& data)
+	{
+		return glm::vec3(data[0].get<float>(), data[1].get<float>(), data[2].get<float>());
+	}
+
+	nlohmann::json ToJson(const glm::vec4& vector)
+	{
+		return { vector.x, vector.y, vector.z, vector.w };
+	}
+
+	glm::vec4 ToVec4(const nlohmann::json& data)
+	{
+		return glm::vec4(data[0].get<float>(), data[1].get<float>(), data[2].get<float>(), data[3].get<float>());
+	}
+}
+
+std::unique_ptr<VulkanFrameCapture> VulkanFrameCapture::Capture(const VulkanRenderer* renderer)
+{
+	std::unique_ptr<VulkanFrameCapture> capture = std::unique_ptr<VulkanFrameCapture>(new VulkanFrameCapture());
+
+	const std::vector<std::unique_ptr<Model>>& rendererModels = renderer->GetDrawList().GetModels();
+	capture->models.reserve(rendererModels.size());
+
+	for (const std::unique_ptr<Model>& model : rendererModels)
+	{
+		ModelState state;
+		state.mesh = GetNameIndex(capture->meshNames, model->meshName);
+		state.texture = GetNameIndex(capture->textureNames, model->textureName);
+		state.position = model->position;
+		state.rotation = model->rotation;
+		state.scale = model->scale;
+		state.isStatic = model->isStatic;
+		state.occluder = model->occluder;
+		state.castShadows = model->castShadows;
+
+		capture->models.push_back(state);
+	}
+
+	capture->lights = renderer->GetClusteredLighting()->GetLights();
+
+	capture->camPos = renderer->camPos;
+	capture->camDir = renderer->camDir;
+	capture->extent = renderer->GetSwapChain()->GetVkExtent2D();
+
+	nlohmann::json& settings = capture->renderSettings;
+	settings["ClearColor"] = ToJson(renderer->clearColor);
+	settings["LightDir"] = ToJson(renderer->lightDir);
+	settings["LightSetting"] = { renderer->lightSetting.x, renderer->lightSetting.y };
+	settings["LightColor"] = ToJson(renderer->lightColor);
+	settings["LodPixelError"] = renderer->lodPixelError;
+	settings["LodHysteresis"] = renderer->lodHysteresis;
+	settings["MeshletCulling"] = renderer->meshletCulling;
+	settings["OcclusionCulling"] = renderer->occlusionCulling;
+	settings["SoftwareOcclusionCulling"] = renderer->softwareOcclusionCulling;
+	settings["DepthPrepass"] = renderer->depthPrepass;
+	settings["Shadows"] = renderer->shadows;
+	settings["DynamicResolution"] = renderer->GetDynamicResolution()->IsEnabled();
+
+	return capture;
+}
+
+std::unique_ptr<VulkanFrameCapture> VulkanFrameCapture::Load(const std::string& path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (input.fail())
+	{
+		Logger::Log(LogSeverity::ERROR, "Unable to open the frame capture " + path);
+		return nullptr;
+	}
+
+	std::vector<uint8_t> bytes = std::vector<uint8_t>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	nlohmann::json data = nlohmann::json::from_cbor(bytes, true, false);
+
+	if (!data.is_object() || data.value("Version", 0u) != VERSION)
+	{
+		Logger::Log(LogSeverity::ERROR, path + " isn't a frame capture of version " + std::to_string(VERSION));
+		return nullptr;
+	}
+
+	std::unique_ptr<VulkanFrameCapture> capture = std::unique_ptr<VulkanFrameCapture>(new VulkanFrameCapture());
+	capture->meshNames = data["Meshes"].get<std::vector<std::string>>();
+	capture->textureNames = data["Textures"].get<std::vector<std::string>>();
+
+	// One flat array per model, the names are indices in the tables above
+	for (const nlohmann::json& modelData : data["Models"])
+	{
+		ModelState state;
+		state.mesh = modelData[0];
+		state.texture = modelData[1];
+		state.position = glm::vec3(modelData[2].get<float>(), modelData[3].get<float>(), modelData[4].get<float>());
+		state.rotation = glm::vec3(modelData[5].get<float>(), modelData[6].get<float>(), modelData[7].get<float>());
+		state.scale = glm::vec3(modelData[8].get<float>(), modelData[9].get<float>(), modelData[10].get<float>());
+
+		uint32_t flags = modelData[11];
+		state.isStatic = flags & 1;
+		state.occluder = flags & 2;
+		state.castShadows = flags & 4;
+
+		if (state.mesh >= capture->meshNames.size() || state.texture >= capture->textureNames.size())
+		{
+			Logger::Log(LogSeverity::ERROR, path + " has a model without mesh or texture");
+			return nullptr;
+		}
+
+		capture->models.push_back(state);
+	}
+
+	for (const nlohmann::json& lightData : data["Lights"])
+	{
+		VulkanClusteredLighting::Light light;
+		light.positionRange = ToVec4(lightData[0]);
+		light.colorIntensity = ToVec4(lightData[1]);
+		light.spotDirection = ToVec4(lightData[2]);
+
+		capture->lights.push_back(light);
+	}
+
+	capture->camPos = ToVec3(data["CamPos"]);
+	capture->camDir = ToVec3(data["CamDir"]);
+	capture->extent = { data["Extent"][0].get<uint32_t>(), data["Extent"][1].get<uint32_t>() };
+	capture->renderSettings = data["RenderSettings"];
+
+	return capture;
+}
+
+bool VulkanFrameCapture::Save(const std::string& path) const
+{
+	nlohmann::json data;
+	data["Version"] = VERSION;
+	data["Meshes"] = meshNames;
+	data["Textures"] = textureNames;
+
+	data["Models"] = nlohmann::json::array();
+	for (const ModelState& state : models)
+	{
+		uint32_t flags = (state.isStatic ? 1 : 0) | (state.occluder ? 2 : 0) | (state.castShadows ? 4 : 0);
+		data["Models"].push_back({ state.mesh, state.texture,
+			state.position.x, state.position.y, state.position.z,
+			state.rotation.x, state.rotation.y, state.rotation.z,
+			state.scale.x, state.scale.y, state.scale.z, flags });
+	}
+
+	data["Lights"] = nlohmann::json::array();
+	for (const VulkanClusteredLighting::Light& light : lights)
+		data["Lights"].push_back({ ToJson(light.positionRange), ToJson(light.colorIntensity), ToJson(light.spotDirection) });
+
+	data["CamPos"] = ToJson(camPos);
+	data["CamDir"] = ToJson(camDir);
+	data["Extent"] = { extent.width, extent.height };
+	data["RenderSettings"] = renderSettings;
+
+	std::ofstream output(path, std::ios::binary);
+	if (!output.is_open())
+	{
+		Logger::Log(LogSeverity::WARNING, "Can't write the frame capture to " + path);
+		return false;
+	}
+
+	std::vector<uint8_t> bytes = nlohmann::json::to_cbor(data);
+	output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+	Logger::Log("Frame captured to " + path + ": " + std::to_string(models.size()) + " models, " + std::to_string(lights.size()) + " lights");
+	return true;
+}
+
+void VulkanFrameCapture::LoadModels(VulkanRenderer* renderer) const
+{
+	for (const ModelState& state : models)
+	{
+		Model* model = renderer->BasicLoadModel(meshNames[state.mesh], textureNames[state.texture], state.position, state.rotation, state.scale);
+		model->isStatic = state.isStatic;
+		model->occluder = state.occluder;
+		model->castShadows = state.castShadows;
+	}
+}
+
+void VulkanFrameCapture::Apply(VulkanRenderer* renderer) const
+{
+	renderer->camPos = camPos;
+	renderer->camDir = camDir;
+
+	renderer->clearColor = ToVec3(renderSettings["ClearColor"]);
+	renderer->lightDir = ToVec3(renderSettings["LightDir"]);
+	renderer->lightSetting = glm::vec2(renderSettings["LightSetting"][0].get<float>(), renderSettings["LightSetting"][1].get<float>());
+	renderer->lightColor = ToVec3(renderSettings["LightColor"]);
+	renderer->lodPixelError = renderSettings["LodPixelError"];
+	renderer->lodHysteresis = renderSettings["LodHysteresis"];
+	renderer->meshletCulling = renderSettings["MeshletCulling"];
+	renderer->occlusionCulling = renderSettings["OcclusionCulling"];
+	renderer->softwareOcclusionCulling = renderSettings["SoftwareOcclusionCulling"];
+	renderer->depthPrepass = renderSettings["DepthPrepass"];
+	renderer->shadows = renderSettings["Shadows"];
+	renderer->GetDynamicResolution()->SetEnabled(renderSettings["DynamicResolution"]);
+
+	VulkanClusteredLighting* clusteredLighting = renderer->GetClusteredLighting();
+	for (const VulkanClusteredLighting::Light& light : lights)
+		clusteredLighting->AddLight(light);
+}
+
+VkExtent2D VulkanFrameCapture::GetExtent() const
+{
+	return extent;
+}
+
+size_t VulkanFrameCapture::GetModelCount() const
+{
+	return models.size();
+}
+
+size_t VulkanFrameCapture::GetLightCount() const
+{
+	return lights.size();
+}
+
+VulkanFrameCapture::VulkanFrameCapture()
+{
+}
+
+uint32_t VulkanFrameCapture::GetNameIndex(std::vector<std::string>& names, const std::string& name)
+{
+	auto it = std::find(names.begin(), names.end(), name);
+	if (it != names.end())
+		return static_cast<uint32_t>(it - names.begin());
+
+	names.push_back(name);
+	return static_cast<uint32_t>(names.size() - 1);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <json.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Rendering/Vulkan/VulkanClusteredLighting.h"
+
+class VulkanRenderer;
+
+/// <summary>
+/// What the renderer drew in a frame: the models and their transforms, the camera, the lights and the render settings.
+/// Saved as CBOR so a slow frame can be attached to a bug report and replayed without the scene it came from.
+/// </summary>
+class VulkanFrameCapture
+{
+public:
+	static const uint32_t VERSION = 1;
+
+	struct ModelState
+	{
+		uint32_t mesh = 0; // Index in meshNames
+		uint32_t texture = 0; // Index in textureNames
+		glm::vec3 position = glm::vec3(0);
+		glm::vec3 rotation = glm::vec3(0);
+		glm::vec3 scale = glm::vec3(1);
+		bool isStatic = true;
+		bool occluder = true;
+		bool castShadows = true;
+	};
+
+private:
+	std::vector<std::string> meshNames;
+	std::vector<std::string> textureNames;
+	std::vector<ModelState> models;
+	std::vector<VulkanClusteredLighting::Light> lights;
+
+	glm::vec3 camPos = glm::vec3(0);
+	glm::vec3 camDir = glm::vec3(0, -1, 0);
+	VkExtent2D extent = {};
+	nlohmann::json renderSettings; // Public settings of the renderer, by name
+
+public:
+	/// <summary>
+	/// Capture the last frame presented by the renderer.
+	/// </summary>
+	static std::unique_ptr<VulkanFrameCapture> Capture(const VulkanRenderer* renderer);
+
+	/// <returns>Return null if the file can't be read or is from another version</returns>
+	static std::unique_ptr<VulkanFrameCapture> Load(const std::string& path);
+
+	/// <returns>Return false if the file can't be opened</returns>
+	bool Save(const std::string& path) const;
+
+	/// <summary>
+	/// Add the models of the capture to the renderer, once before replaying.
+	/// </summary>
+	void LoadModels(VulkanRenderer* renderer) const;
+
+	/// <summary>
+	/// Set the camera and the render settings and add the lights, before every replayed frame since the lights only last a frame.
+	/// </summary>
+	void Apply(VulkanRenderer* renderer) const;
+
+	/// <summary>
+	/// Extent of the swapchain when captured, the replay is comparable when it renders at the same extent.
+	/// </summary>
+	VkExtent2D GetExtent() const;
+	size_t GetModelCount() const;
+	size_t GetLightCount() const;
+
+private:
+	VulkanFrameCapture();
+
+	static uint32_t GetNameIndex(std::vector<std::string>& names, const std::string& name);
+};
\ No newline at end of file
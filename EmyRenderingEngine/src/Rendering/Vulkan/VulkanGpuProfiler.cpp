@@ -0,0 +1,259 @@
+#include "Rendering/Vulkan/VulkanGpuProfiler.h"
+
+#include "Helper/Log.h"
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+VulkanGpuProfiler::VulkanGpuProfiler(uint32_t frameCount, uint32_t maxPasses, uint32_t maxBuckets, bool pipelineStatistics)
+	: maxPasses(std::max(maxPasses, 1u)), maxBuckets(maxBuckets)
+{
+	recordedPasses.resize(frameCount);
+	recordedBuckets.resize(frameCount);
+	measuringPass.resize(frameCount, false);
+
+	CreateQueryPools(frameCount, pipelineStatistics);
+}
+
+VulkanGpuProfiler::~VulkanGpuProfiler()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
+
+	Logger::Log("GPU profiler destroyed");
+}
+
+void VulkanGpuProfiler::CmdBegin(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	recordedPasses[frame].clear();
+	recordedBuckets[frame].clear();
+
+	if (!enabled)
+		return;
+
+	vkCmdResetQueryPool(commandBuffer, timestampQueryPool, GetFirstTimestamp(frame), (maxPasses + maxBuckets) * 2);
+	if (statisticsQueryPool != nullptr)
+		vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, frame * maxPasses, maxPasses);
+}
+
+bool VulkanGpuProfiler::CmdBeginPass(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& name)
+{
+	if (!enabled || recordedPasses[frame].size() >= maxPasses)
+		return false;
+
+	uint32_t pass = static_cast<uint32_t>(recordedPasses[frame].size());
+	recordedPasses[frame].push_back(name);
+	measuringPass[frame] = true;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, GetFirstTimestamp(frame) + pass * 2);
+	if (statisticsQueryPool != nullptr)
+		vkCmdBeginQuery(commandBuffer, statisticsQueryPool, frame * maxPasses + pass, 0);
+
+	return true;
+}
+
+void VulkanGpuProfiler::CmdEndPass(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	uint32_t pass = static_cast<uint32_t>(recordedPasses[frame].size()) - 1;
+	measuringPass[frame] = false;
+
+	if (statisticsQueryPool != nullptr)
+		vkCmdEndQuery(commandBuffer, statisticsQueryPool, frame * maxPasses + pass);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, GetFirstTimestamp(frame) + pass * 2 + 1);
+}
+
+bool VulkanGpuProfiler::CmdBeginBucket(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& name)
+{
+	if (!enabled || !measuringPass[frame] || recordedBuckets[frame].size() >= maxBuckets)
+		return false;
+
+	uint32_t bucket = static_cast<uint32_t>(recordedBuckets[frame].size());
+	recordedBuckets[frame].push_back({recordedPasses[frame].back(), name});
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, GetFirstTimestamp(frame) + (maxPasses + bucket) * 2);
+
+	return true;
+}
+
+void VulkanGpuProfiler::CmdEndBucket(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	uint32_t bucket = static_cast<uint32_t>(recordedBuckets[frame].size()) - 1;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, GetFirstTimestamp(frame) + (maxPasses + bucket) * 2 + 1);
+}
+
+void VulkanGpuProfiler::Read(uint32_t frame)
+{
+	const std::vector<std::string>& names = recordedPasses[frame];
+	if (!enabled || names.empty())
+		return;
+
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	uint32_t passCount = static_cast<uint32_t>(names.size());
+	uint32_t bucketCount = static_cast<uint32_t>(recordedBuckets[frame].size());
+
+	// The fence of the frame signaled, the wait bit never blocks
+	std::vector<uint64_t> timestamps(passCount * 2);
+	if (vkGetQueryPoolResults(device, timestampQueryPool, GetFirstTimestamp(frame), passCount * 2, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		return;
+
+	std::vector<uint64_t> bucketTimestamps(bucketCount * 2);
+	if (bucketCount > 0 && vkGetQueryPoolResults(device, timestampQueryPool, GetFirstTimestamp(frame) + maxPasses * 2, bucketCount * 2, bucketTimestamps.size() * sizeof(uint64_t), bucketTimestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		bucketCount = 0;
+
+	// Vertex then fragment invocations, in the order of their bits
+	std::vector<std::array<uint64_t, 2>> statistics(passCount);
+	bool hasStatistics = statisticsQueryPool != nullptr && vkGetQueryPoolResults(device, statisticsQueryPool, frame * maxPasses, passCount, statistics.size() * sizeof(statistics[0]), statistics.data(), sizeof(statistics[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS;
+
+	double period = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetProperties().limits.timestampPeriod;
+
+	// The passes of the graph change with the settings, the averages follow them by name
+	std::vector<PassTiming> readPasses(passCount);
+	for (uint32_t pass = 0; pass < passCount; pass++)
+	{
+		PassTiming& timing = readPasses[pass];
+		timing.name = names[pass];
+		timing.time = (timestamps[pass * 2 + 1] - timestamps[pass * 2]) * period / 1000000.0;
+		timing.averageTime = timing.time;
+
+		auto previous = std::find_if(passes.begin(), passes.end(), [&timing](const PassTiming& p) { return p.name == timing.name; });
+		if (previous != passes.end())
+			timing.averageTime = previous->averageTime + (timing.time - previous->averageTime) * averageWeight;
+
+		if (hasStatistics)
+		{
+			timing.vertexInvocations = statistics[pass][0];
+			timing.fragmentInvocations = statistics[pass][1];
+		}
+	}
+	passes = std::move(readPasses);
+
+	// A pipeline can have a bucket in several passes, the averages follow them by pass and name
+	std::vector<BucketTiming> readBuckets(bucketCount);
+	for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+	{
+		BucketTiming& timing = readBuckets[bucket];
+		timing.pass = recordedBuckets[frame][bucket].pass;
+		timing.name = recordedBuckets[frame][bucket].name;
+		timing.time = (bucketTimestamps[bucket * 2 + 1] - bucketTimestamps[bucket * 2]) * period / 1000000.0;
+		timing.averageTime = timing.time;
+
+		auto previous = std::find_if(buckets.begin(), buckets.end(), [&timing](const BucketTiming& b) { return b.pass == timing.pass && b.name == timing.name; });
+		if (previous != buckets.end())
+			timing.averageTime = previous->averageTime + (timing.time - previous->averageTime) * averageWeight;
+	}
+	buckets = std::move(readBuckets);
+
+	frameTime = (timestamps[passCount * 2 - 1] - timestamps[0]) * period / 1000000.0;
+	averageFrameTime = averageFrameTime == 0 ? frameTime : averageFrameTime + (frameTime - averageFrameTime) * averageWeight;
+}
+
+bool VulkanGpuProfiler::ExportCsv(const std::string& path) const
+{
+	std::ofstream output(path);
+	if (!output.is_open())
+	{
+		Logger::Log(LogSeverity::WARNING, "Can't write the GPU timings to " + path);
+		return false;
+	}
+
+	output << "pass,time_ms,average_ms,vertex_invocations,fragment_invocations\n";
+	for (const PassTiming& pass : passes)
+		output << pass.name << "," << pass.time << "," << pass.averageTime << "," << pass.vertexInvocations << "," << pass.fragmentInvocations << "\n";
+	output << "Frame," << frameTime << "," << averageFrameTime << ",,\n";
+	for (const BucketTiming& bucket : buckets)
+		output << bucket.pass << " / " << bucket.name << "," << bucket.time << "," << bucket.averageTime << ",,\n";
+
+	return true;
+}
+
+const std::vector<VulkanGpuProfiler::PassTiming>& VulkanGpuProfiler::GetPasses() const
+{
+	return passes;
+}
+
+double VulkanGpuProfiler::GetFrameTime() const
+{
+	return frameTime;
+}
+
+double VulkanGpuProfiler::GetAverageFrameTime() const
+{
+	return averageFrameTime;
+}
+
+const std::vector<VulkanGpuProfiler::BucketTiming>& VulkanGpuProfiler::GetBuckets() const
+{
+	return buckets;
+}
+
+uint64_t VulkanGpuProfiler::GetFragmentInvocations() const
+{
+	uint64_t invocations = 0;
+	for (const PassTiming& pass : passes)
+		invocations += pass.fragmentInvocations;
+
+	return invocations;
+}
+
+bool VulkanGpuProfiler::IsEnabled() const
+{
+	return enabled;
+}
+
+bool VulkanGpuProfiler::HasPipelineStatistics() const
+{
+	return statisticsQueryPool != nullptr;
+}
+
+void VulkanGpuProfiler::CreateQueryPools(uint32_t frameCount, bool pipelineStatistics)
+{
+	VulkanRenderer* renderer = VulkanRenderer::GetInstance();
+	VkDevice device = renderer->GetLogicalDevice()->GetVk();
+
+	if (!renderer->GetPhysicalDevice()->GetProperties().limits.timestampComputeAndGraphics)
+	{
+		Logger::Log(LogSeverity::WARNING, "Timestamps not supported, the passes won't be profiled");
+		enabled = false;
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = frameCount * (maxPasses + maxBuckets) * 2;
+
+	if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create profiler timestamp query pool!");
+	}
+
+	if (!pipelineStatistics)
+		return;
+
+	if (!renderer->GetPhysicalDevice()->GetSupportedFeatures().pipelineStatisticsQuery)
+	{
+		Logger::Log(LogSeverity::WARNING, "Pipeline statistics query not supported, shader invocations won't be measured");
+		return;
+	}
+
+	VkQueryPoolCreateInfo statisticsPoolInfo = {};
+	statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	statisticsPoolInfo.queryCount = frameCount * maxPasses;
+	statisticsPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	if (vkCreateQueryPool(device, &statisticsPoolInfo, nullptr, &statisticsQueryPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create profiler statistics query pool!");
+	}
+}
+
+uint32_t VulkanGpuProfiler::GetFirstTimestamp(uint32_t frame) const
+{
+	return frame * (maxPasses + maxBuckets) * 2;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <string>
+
+/// <summary>
+/// GPU time and shader invocations of each pass of the render graph, and GPU time of the draw list buckets inside the passes.
+/// Every frame in flight has its own queries, they are read MAX_FRAMES_IN_FLIGHT frames later once the fence of the frame signaled
+/// so reading them never stalls.
+/// </summary>
+class VulkanGpuProfiler
+{
+public:
+	struct PassTiming
+	{
+		std::string name;
+		double time = 0; // Millisecond
+		double averageTime = 0;
+		uint64_t vertexInvocations = 0;
+		uint64_t fragmentInvocations = 0;
+	};
+
+	// Draws of a pass sharing the same pipeline. Consecutive buckets can overlap on the GPU, their times are approximate.
+	struct BucketTiming
+	{
+		std::string pass;
+		std::string name;
+		double time = 0; // Millisecond
+		double averageTime = 0;
+	};
+
+private:
+	struct RecordedBucket
+	{
+		std::string pass;
+		std::string name;
+	};
+
+	uint32_t maxPasses = 0;
+	uint32_t maxBuckets = 0;
+	bool enabled = true;
+
+	// Two timestamps per pass then two per bucket, and one statistics query per pass, of each frame in flight
+	VkQueryPool timestampQueryPool = nullptr;
+	VkQueryPool statisticsQueryPool = nullptr;
+	std::vector<std::vector<std::string>> recordedPasses; // Passes recorded by each frame
+	std::vector<std::vector<RecordedBucket>> recordedBuckets; // Buckets recorded by each frame
+	std::vector<bool> measuringPass; // A pass of the frame is being recorded and measured, its buckets can be measured
+
+	std::vector<PassTiming> passes;
+	std::vector<BucketTiming> buckets;
+	double frameTime = 0;
+	double averageFrameTime = 0;
+	float averageWeight = 0.05f; // Weight of the new frame in the averages
+
+public:
+	/// <param name="frameCount">Frames in flight, each has its own queries</param>
+	/// <param name="maxPasses">Passes past this count in a frame aren't measured</param>
+	/// <param name="maxBuckets">Buckets past this count in a frame aren't measured</param>
+	/// <param name="pipelineStatistics">Also count the vertex and fragment shader invocations when the device supports it</param>
+	VulkanGpuProfiler(uint32_t frameCount, uint32_t maxPasses, uint32_t maxBuckets, bool pipelineStatistics);
+	~VulkanGpuProfiler();
+
+	/// <summary>
+	/// Reset the queries of the frame, record it before the first pass.
+	/// </summary>
+	void CmdBegin(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	/// <returns>Return false if the pass isn't measured, CmdEndPass must then not be recorded for it</returns>
+	bool CmdBeginPass(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& name);
+	void CmdEndPass(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	/// <summary>
+	/// Measure the following draws as a bucket of the pass being measured. Buckets don't nest.
+	/// </summary>
+	/// <returns>Return false if the bucket isn't measured, CmdEndBucket must then not be recorded for it</returns>
+	bool CmdBeginBucket(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& name);
+	void CmdEndBucket(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	/// <summary>
+	/// Read the queries of the last submit of the frame, its fence needs to have signaled.
+	/// </summary>
+	void Read(uint32_t frame);
+
+	/// <summary>
+	/// Write the timings of the last read frame as CSV.
+	/// </summary>
+	/// <returns>Return false if the file can't be opened</returns>
+	bool ExportCsv(const std::string& path) const;
+
+	const std::vector<PassTiming>& GetPasses() const;
+	const std::vector<BucketTiming>& GetBuckets() const;
+
+	/// <summary>
+	/// GPU time from the start of the first pass to the end of the last one in millisecond.
+	/// </summary>
+	double GetFrameTime() const;
+	double GetAverageFrameTime() const;
+
+	/// <summary>
+	/// Fragment shader invocations of every pass of the last read frame, 0 without pipeline statistics.
+	/// </summary>
+	uint64_t GetFragmentInvocations() const;
+
+	bool IsEnabled() const;
+	bool HasPipelineStatistics() const;
+
+private:
+	void CreateQueryPools(uint32_t frameCount, bool pipelineStatistics);
+
+	/// <summary>
+	/// First timestamp query of the frame.
+	/// </summary>
+	uint32_t GetFirstTimestamp(uint32_t frame) const;
+};
\ No newline at end of file
@@ -4,13 +4,25 @@
 #include "Rendering/Vulkan/VulkanHelper.h"
 #include "VulkanRenderer.h"
 
-void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode)
+#include <array>
+
+void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode, VkCompareOp depthCompareOp, bool depthOnly)
 {
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 	VkExtent2D swapChainExtent = VulkanRenderer::GetInstance()->GetSwapChain()->GetVkExtent2D();
 	VkRenderPass renderPass = VulkanRenderer::GetInstance()->GetRenderPass()->GetVk();
 	VkSampleCountFlagBits msaaSamples = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetMsaaSample();
 
+	// The scene render passes only draw in the render extent of the dynamic resolution, set when they begin
+	bool dynamicViewport = this->renderPass == nullptr || sceneRenderPass;
+	if (this->renderPass != nullptr)
+	{
+		if (!sceneRenderPass)
+			swapChainExtent = extent;
+		renderPass = this->renderPass;
+		msaaSamples = samples;
+	}
+
 	layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);// Uniform binding for matrix
 	layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);// Sampler for texture
 	layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);// Sampler for texture
@@ -30,6 +42,14 @@ void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode)
 	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
+	// Position only stream bound by Mesh::CmdBindPositions
+	if (depthOnly)
+	{
+		bindingDescription.stride = sizeof(glm::vec3);
+		attributeDescriptions[0].offset = 0;
+		vertexInputInfo.vertexAttributeDescriptionCount = 1;
+	}
+
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -54,6 +74,12 @@ void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode)
 	viewportState.scissorCount = 1;
 	viewportState.pScissors = &scissor;
 
+	std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
 	VkPipelineRasterizationStateCreateInfo rasterizer = {};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterizer.depthClampEnable = VK_FALSE;
@@ -62,7 +88,9 @@ void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode)
 	rasterizer.lineWidth = 1.0f;
 	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
 	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
+	rasterizer.depthBiasEnable = depthBias ? VK_TRUE : VK_FALSE;
+	rasterizer.depthBiasConstantFactor = depthBiasConstant;
+	rasterizer.depthBiasSlopeFactor = depthBiasSlope;
 
 	VkPipelineMultisampleStateCreateInfo multisampling = {};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -73,32 +101,41 @@ void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode)
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencil.depthTestEnable = VK_TRUE;
 
-	depthStencil.depthWriteEnable = VK_TRUE;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthWriteEnable = depthCompareOp == VK_COMPARE_OP_EQUAL ? VK_FALSE : VK_TRUE;
+	depthStencil.depthCompareOp = depthCompareOp;
 	depthStencil.depthBoundsTestEnable = VK_FALSE;
 	depthStencil.stencilTestEnable = VK_FALSE;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.colorWriteMask = depthOnly ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.blendEnable = VK_FALSE;
 
 	VkPipelineColorBlendStateCreateInfo colorBlending = {};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
+	colorBlending.attachmentCount = colorAttachment ? 1 : 0;
 	colorBlending.pAttachments = &colorBlendAttachment;
 	colorBlending.blendConstants[0] = 0.0f;
 	colorBlending.blendConstants[1] = 0.0f;
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	VkDescriptorSetLayout dsl = layoutBinding.GetVkDescriptorSetLayout();
+	std::vector<VkDescriptorSetLayout> dsl = {layoutBinding.GetVkDescriptorSetLayout()};
+	dsl.insert(dsl.end(), setLayouts.begin(), setLayouts.end());
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &dsl;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(dsl.size());
+	pipelineLayoutInfo.pSetLayouts = dsl.data();
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
 	{
@@ -116,6 +153,7 @@ void VulkanGraphicPipeline::Create(VkPolygonMode polygonMode)
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = dynamicViewport ? &dynamicState : nullptr;
 	pipelineInfo.layout = pipelineLayout;
 	pipelineInfo.renderPass = renderPass;
 	pipelineInfo.subpass = 0;
@@ -157,6 +195,38 @@ bool VulkanGraphicPipeline::AddShader(VulkanShader* shader, bool replace)
 	return true;
 }
 
+void VulkanGraphicPipeline::AddSetLayout(VkDescriptorSetLayout setLayout)
+{
+	setLayouts.push_back(setLayout);
+}
+
+void VulkanGraphicPipeline::SetRenderTarget(VkRenderPass renderPass, VkExtent2D extent, VkSampleCountFlagBits samples, bool colorAttachment)
+{
+	this->renderPass = renderPass;
+	this->extent = extent;
+	this->samples = samples;
+	this->colorAttachment = colorAttachment;
+}
+
+void VulkanGraphicPipeline::SetSceneRenderPass(VkRenderPass renderPass, VkSampleCountFlagBits samples)
+{
+	this->renderPass = renderPass;
+	this->samples = samples;
+	sceneRenderPass = true;
+}
+
+void VulkanGraphicPipeline::SetPushConstantSize(uint32_t size)
+{
+	pushConstantSize = size;
+}
+
+void VulkanGraphicPipeline::SetDepthBias(float constantFactor, float slopeFactor)
+{
+	depthBias = true;
+	depthBiasConstant = constantFactor;
+	depthBiasSlope = slopeFactor;
+}
+
 VkPipelineLayout VulkanGraphicPipeline::GetVkPipelineLayout() const
 {
 	return pipelineLayout;
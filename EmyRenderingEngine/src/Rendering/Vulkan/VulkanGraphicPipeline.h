@@ -15,12 +15,26 @@ public:
 
 private:
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	std::vector<VkDescriptorSetLayout> setLayouts; // Sets after the model set, owned by their system
+
+	// Render pass of the renderer with a dynamic viewport and scissor when not set
+	VkRenderPass renderPass = nullptr;
+	bool sceneRenderPass = false; // Set render pass drawn over the render extent, the viewport stays dynamic
+	VkExtent2D extent = {};
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	bool colorAttachment = true;
+	uint32_t pushConstantSize = 0;
+	bool depthBias = false;
+	float depthBiasConstant = 0;
+	float depthBiasSlope = 0;
 
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkPipeline graphicsPipeline = nullptr;
 
 public:
-	void Create(VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL);
+	/// <param name="depthCompareOp">Depth write is disabled with VK_COMPARE_OP_EQUAL, the depth is expected to come from a depth prepass</param>
+	/// <param name="depthOnly">Only read the vertex position from a vec3 stream and write no color</param>
+	void Create(VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL, VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS, bool depthOnly = false);
 	~VulkanGraphicPipeline();
 
 	/// <summary>
@@ -31,6 +45,34 @@ public:
 	/// <returns>Return false if there already a shader state of the type provided unless replace is enable</returns>
 	bool AddShader(VulkanShader* shader, bool replace = false);
 
+	/// <summary>
+	/// Add a descriptor set after the set 0 of the model, need to be called before Create.
+	/// </summary>
+	void AddSetLayout(VkDescriptorSetLayout setLayout);
+
+	/// <summary>
+	/// Render in another render pass than the one of the renderer, need to be called before Create.
+	/// The viewport and scissor are then static and cover the extent.
+	/// </summary>
+	/// <param name="colorAttachment">False when the render pass only has a depth attachment</param>
+	void SetRenderTarget(VkRenderPass renderPass, VkExtent2D extent, VkSampleCountFlagBits samples, bool colorAttachment = true);
+
+	/// <summary>
+	/// Render in another scene render pass than the one of the renderer, need to be called before Create.
+	/// The viewport and scissor stay dynamic like in the render pass of the renderer.
+	/// </summary>
+	void SetSceneRenderPass(VkRenderPass renderPass, VkSampleCountFlagBits samples);
+
+	/// <summary>
+	/// Push constants read by the vertex shader, need to be called before Create.
+	/// </summary>
+	void SetPushConstantSize(uint32_t size);
+
+	/// <summary>
+	/// Offset the depth written by the rasterizer, need to be called before Create.
+	/// </summary>
+	void SetDepthBias(float constantFactor, float slopeFactor);
+
 	VkPipelineLayout GetVkPipelineLayout() const;
 	VkPipeline GetVkPipeline() const;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Rendering/Vulkan/VulkanHelper.h"
 
 #include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
 #include "VulkanRenderer.h"
 
 namespace VulkanHelper
@@ -24,20 +25,34 @@ namespace VulkanHelper
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies)
 		{
-			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			if (!indices.IsComplete())
 			{
-				indices.graphicsFamily = i;
+				// Culling run in compute on the graphics queue when there is no async compute
+				if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)
+				{
+					indices.graphicsFamily = i;
+				}
+
+				// Nothing is presented in headless mode, the graphics queue stands for the present queue
+				VkBool32 presentSupport = false;
+				if (surface != nullptr)
+					vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+				else
+					presentSupport = indices.graphicsFamily.has_value() && indices.graphicsFamily.value() == i;
+
+				if (queueFamily.queueCount > 0 && presentSupport)
+				{
+					indices.presentFamily = i;
+				}
 			}
 
-			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
-
-			if (queueFamily.queueCount > 0 && presentSupport)
+			// A family without graphics runs beside the graphics queue, the cluster build is timed on it
+			if (!indices.computeFamily.has_value() && queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && queueFamily.timestampValidBits > 0)
 			{
-				indices.presentFamily = i;
+				indices.computeFamily = i;
 			}
 
-			if (indices.IsComplete())
+			if (indices.IsComplete() && indices.computeFamily.has_value())
 			{
 				break;
 			}
@@ -58,6 +73,8 @@ namespace VulkanHelper
 		VkSurfaceKHR surface = VulkanRenderer::GetInstance()->GetVkSurfaceKHR();
 
 		SwapChainSupportDetails details;
+		if (surface == nullptr)
+			return details;
 
 		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
 
@@ -84,6 +101,10 @@ namespace VulkanHelper
 
 	VkSurfaceFormatKHR VulkanHelper::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 	{
+		// Headless, the offscreen images take the format a surface would mostly be given
+		if (availableFormats.empty())
+			return {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+
 		for (const auto& availableFormat : availableFormats)
 		{
 			if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
@@ -93,7 +114,7 @@ namespace VulkanHelper
 		return availableFormats[0];
 	}
 
-	VkImageView VulkanHelper::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
+	VkImageView VulkanHelper::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t baseMipLevel)
 	{
 		VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 
@@ -103,7 +124,7 @@ namespace VulkanHelper
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		viewInfo.format = format;
 		viewInfo.subresourceRange.aspectMask = aspectFlags;
-		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
 		viewInfo.subresourceRange.levelCount = mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
@@ -145,17 +166,60 @@ namespace VulkanHelper
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device, image, &memRequirements);
 
+		// Lazily allocated memory mostly exists on tiled GPUs, the others use device local memory
+		VkMemoryPropertyFlags properties = parameter.properties;
+		if ((properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !HasMemoryType(memRequirements.memoryTypeBits, properties))
+			properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+		AllocateMemory(memRequirements, properties, parameter.category, imageMemory);
+
+		vkBindImageMemory(device, image, imageMemory, 0);
+	}
+
+	void VulkanHelper::AllocateMemory(const VkMemoryRequirements& memRequirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkDeviceMemory& memory)
+	{
+		VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+		VulkanMemoryTracker* memoryTracker = VulkanRenderer::GetInstance()->GetMemoryTracker();
+
 		VkMemoryAllocateInfo allocInfo = {};
 		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, parameter.properties);
+		allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
+
+		memoryTracker->Reserve(allocInfo.allocationSize, allocInfo.memoryTypeIndex);
 
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
 		{
-			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate image memory!");
+			Logger::Log(LogSeverity::FATAL_ERROR, std::string("failed to allocate ") + VulkanMemoryTracker::GetCategoryName(category) + " memory of " + std::to_string(allocInfo.allocationSize) + " bytes!");
 		}
 
-		vkBindImageMemory(device, image, imageMemory, 0);
+		memoryTracker->Track(memory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, category);
+		PerfCounters::Add(PerfCounter::MEMORY_ALLOCATIONS);
+	}
+
+	void VulkanHelper::FreeMemory(VkDevice device, VkDeviceMemory memory)
+	{
+		if (memory == nullptr)
+			return;
+
+		VulkanRenderer::GetInstance()->GetMemoryTracker()->Untrack(memory);
+		vkFreeMemory(device, memory, nullptr);
+	}
+
+	bool VulkanHelper::HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
+
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				return true;
+		}
+
+		return false;
 	}
 
 	uint32_t VulkanHelper::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -198,7 +262,7 @@ namespace VulkanHelper
 		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		barrier.image = image;
 
-		if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+		if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL || newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL)
 		{
 			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 
@@ -217,44 +281,12 @@ namespace VulkanHelper
 		barrier.subresourceRange.baseArrayLayer = 0;
 		barrier.subresourceRange.layerCount = 1;
 
+		// Wait for the writes of the old layout before the accesses of the new one
 		VkPipelineStageFlags sourceStage;
 		VkPipelineStageFlags destinationStage;
-
-		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-		{
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		}
-		else
-		{
-			throw std::invalid_argument("unsupported layout transition!");
-		}
+		GetLayoutAccess(oldLayout, barrier.srcAccessMask, sourceStage);
+		GetLayoutAccess(newLayout, barrier.dstAccessMask, destinationStage);
+		barrier.srcAccessMask &= VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
 
 		vkCmdPipelineBarrier(
 			commandBuffer,
@@ -268,7 +300,52 @@ namespace VulkanHelper
 		EndSingleTimeCommands(commandBuffer);
 	}
 
-	void VulkanHelper::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+	void VulkanHelper::GetLayoutAccess(VkImageLayout layout, VkAccessFlags& access, VkPipelineStageFlags& stage)
+	{
+		switch (layout)
+		{
+			case VK_IMAGE_LAYOUT_UNDEFINED:
+				access = 0;
+				stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_GENERAL:
+				access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+				stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+				access = VK_ACCESS_TRANSFER_READ_BIT;
+				stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+				access = VK_ACCESS_TRANSFER_WRITE_BIT;
+				stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+				access = VK_ACCESS_SHADER_READ_BIT;
+				stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+				access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+				access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+				access = VK_ACCESS_SHADER_READ_BIT;
+				stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+				break;
+			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+				access = 0;
+				stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+				break;
+			default:
+				throw std::invalid_argument("unsupported layout transition!");
+		}
+	}
+
+	void VulkanHelper::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory, MemoryCategory category)
 	{
 		VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
 		VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
@@ -279,6 +356,16 @@ namespace VulkanHelper
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+		// Buffers are shared with the compute queue so they need no ownership transfer, images stay on the graphics queue
+		const VulkanLogicalDevice* logicalDevice = VulkanRenderer::GetInstance()->GetLogicalDevice();
+		std::array<uint32_t, 2> queueFamilies = {logicalDevice->GetGraphicsFamily(), logicalDevice->GetComputeFamily()};
+		if (logicalDevice->HasAsyncCompute())
+		{
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+			bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+		}
+
 		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
 		{
 			Logger::Log(LogSeverity::FATAL_ERROR, "failed to create buffer!");
@@ -287,15 +374,7 @@ namespace VulkanHelper
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-		{
-			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate buffer memory!");
-		}
+		AllocateMemory(memRequirements, properties, category, bufferMemory);
 
 		vkBindBufferMemory(device, buffer, bufferMemory, 0);
 	}
@@ -319,6 +398,10 @@ namespace VulkanHelper
 		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
 		EndSingleTimeCommands(commandBuffer);
+
+		// The images uploaded this way are RGBA8
+		PerfCounters::Add(PerfCounter::UPLOADS);
+		PerfCounters::Add(PerfCounter::UPLOADED_BYTES, static_cast<uint64_t>(extent.width) * extent.height * 4);
 	}
 
 	void VulkanHelper::GenerateMipmaps(VkImage image, VkFormat imageFormat, VkExtent2D extent, uint32_t mipLevels)
@@ -422,6 +505,9 @@ namespace VulkanHelper
 		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
 		EndSingleTimeCommands(commandBuffer);
+
+		PerfCounters::Add(PerfCounter::UPLOADS);
+		PerfCounters::Add(PerfCounter::UPLOADED_BYTES, size);
 	}
 
 	VkCommandBuffer VulkanHelper::BeginSingleTimeCommands()
@@ -9,12 +9,16 @@
 #include <optional>
 #include <vector>
 #include <array>
+
+#include "Rendering/Vulkan/VulkanMemoryTracker.h"
+
 namespace VulkanHelper
 {
 	struct QueueFamilyIndices
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		std::optional<uint32_t> computeFamily; // Compute only family with timestamps, empty if the device has none
 
 		bool IsComplete() const;
 	};
@@ -41,23 +45,40 @@ namespace VulkanHelper
 
 		VkImageLayout oldLayout;
 		VkImageLayout newLayout;
+
+		MemoryCategory category = MemoryCategory::OTHER;
 	};
 
 	QueueFamilyIndices FindQueueFamilies();
 	QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physicalDevice);
+	/// <summary>
+	/// Empty without surface, in headless mode.
+	/// </summary>
 	SwapChainSupportDetails QuerySwapChainSupport();
 	SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
 
 	VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
+	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t baseMipLevel = 0);
 	void CreateImage(CreateTextureParameter& parameter, VkImage& image, VkDeviceMemory& imageMemory);
 	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	bool HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+	/// <summary>
+	/// Allocate device memory tracked by the VulkanMemoryTracker. Texture mips are evicted when it does not fit.
+	/// </summary>
+	void AllocateMemory(const VkMemoryRequirements& memRequirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkDeviceMemory& memory);
+	void FreeMemory(VkDevice device, VkDeviceMemory memory);
 
 	//TODO: Shorten parameter list
 	void CreateTexture(CreateTextureParameter& parameter, VkImage& image, VkImageView& imageView, VkDeviceMemory& imageMemory);
 	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	/// <summary>
+	/// Accesses and stages an image in this layout is used with.
+	/// </summary>
+	void GetLayoutAccess(VkImageLayout layout, VkAccessFlags& access, VkPipelineStageFlags& stage);
+
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory, MemoryCategory category = MemoryCategory::OTHER);
 
 	void CopyBufferToImage(VkBuffer buffer, VkImage image, VkExtent2D extent);
 
@@ -99,6 +120,19 @@ namespace VulkanHelper
 		alignas(16) glm::vec2 lightSetting;
 		alignas(16) glm::vec3 lightColor;
 	};
+
+	// Cluster of triangles culled as a whole, same layout as the Meshlet of MeshletCull.comp
+	struct Meshlet
+	{
+		glm::vec3 center;
+		float radius;
+		glm::vec3 coneAxis;
+		float coneCutoff; // Sine of the normal cone angle, 1 if the cone can't be culled
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
 }
 
 namespace std
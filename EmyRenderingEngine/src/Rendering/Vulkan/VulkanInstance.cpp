@@ -10,7 +10,7 @@ const std::vector<const char*> VulkanInstance::VALIDATION_LAYERS =
 	"VK_LAYER_KHRONOS_validation"
 };
 
-VulkanInstance::VulkanInstance(VkDebugUtilsMessageSeverityFlagBitsEXT validationLayerMessageMinSeverity)
+VulkanInstance::VulkanInstance(VkDebugUtilsMessageSeverityFlagBitsEXT validationLayerMessageMinSeverity, bool headless) : headless(headless)
 {
 	Logger::Log("Creating instance");
 
@@ -32,6 +32,9 @@ VulkanInstance::VulkanInstance(VkDebugUtilsMessageSeverityFlagBitsEXT validation
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.apiVersion = VK_API_VERSION_1_0;
 
+	// Needed to query the memory budget, it is optional
+	physicalDeviceProperties2 = IsExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
 	auto extensions = GetRequiredExtensions();
 
 	// Info for creating our instance
@@ -80,19 +83,48 @@ VkInstance VulkanInstance::GetVk() const
 	return instance;
 }
 
+bool VulkanInstance::HasPhysicalDeviceProperties2() const
+{
+	return physicalDeviceProperties2;
+}
+
 std::vector<const char*> VulkanInstance::GetRequiredExtensions() const
 {
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> extensions;
+	if (!headless)
+	{
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (enableValidationLayers)
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
+	if (physicalDeviceProperties2)
+		extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
 	return extensions;
 }
 
+bool VulkanInstance::IsExtensionAvailable(const char* extensionName) const
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extension : availableExtensions)
+	{
+		if (strcmp(extensionName, extension.extensionName) == 0)
+			return true;
+	}
+
+	return false;
+}
+
 void VulkanInstance::SetupDebugMessenger()
 {
 	if (!enableValidationLayers) return;
@@ -10,18 +10,23 @@ public:
 
 private:
 	VkInstance instance;
+	bool physicalDeviceProperties2 = false; // VK_KHR_get_physical_device_properties2 enabled
+	bool headless = false;
 
 	VkDebugUtilsMessengerEXT debugMessenger;
 	static VkDebugUtilsMessageSeverityFlagBitsEXT validationLayerMessageMinSeverity;
 
 public:
-	VulkanInstance(VkDebugUtilsMessageSeverityFlagBitsEXT validationLayerMessageMinSeverity);
+	/// <param name="headless">No window surface, the extensions of GLFW aren't needed</param>
+	VulkanInstance(VkDebugUtilsMessageSeverityFlagBitsEXT validationLayerMessageMinSeverity, bool headless);
 	~VulkanInstance();
 
 	VkInstance GetVk() const;
+	bool HasPhysicalDeviceProperties2() const;
 
 private:
 	std::vector<const char*> GetRequiredExtensions() const;
+	bool IsExtensionAvailable(const char* extensionName) const;
 
 	//Validation Layer Stuff
 	void SetupDebugMessenger();
@@ -9,7 +9,7 @@
 #include <set>
 #include "Helper/Log.h"
 
-VulkanLogicalDevice::VulkanLogicalDevice()
+VulkanLogicalDevice::VulkanLogicalDevice(bool asyncCompute)
 {
 	Logger::Log("Creating logicalDevice");
 	VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
@@ -18,6 +18,12 @@ VulkanLogicalDevice::VulkanLogicalDevice()
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+	if (asyncCompute && !indices.computeFamily.has_value())
+		Logger::Log(LogSeverity::WARNING, "No compute only queue family, culling stays on the graphics queue");
+
+	asyncCompute = asyncCompute && indices.computeFamily.has_value();
+	if (asyncCompute)
+		uniqueQueueFamilies.insert(indices.computeFamily.value());
 
 	// Make queue family create info
 	float queuePriority = 1.0f;
@@ -34,14 +40,28 @@ VulkanLogicalDevice::VulkanLogicalDevice()
 	// device feature to enable
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetSupportedFeatures().multiDrawIndirect;
+	deviceFeatures.pipelineStatisticsQuery = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetSupportedFeatures().pipelineStatisticsQuery;
+
+	// The texture streamer binds the memory of each mip on the graphics queue
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	VkPhysicalDeviceFeatures supportedFeatures = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetSupportedFeatures();
+	sparseResidency = supportedFeatures.sparseBinding && supportedFeatures.sparseResidencyImage2D && (queueFamilies[indices.graphicsFamily.value()].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) != 0;
+	deviceFeatures.sparseBinding = sparseResidency;
+	deviceFeatures.sparseResidencyImage2D = sparseResidency;
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(VulkanPhysicalDevice::DEVICE_EXTENSIONS.size());
-	createInfo.ppEnabledExtensionNames = VulkanPhysicalDevice::DEVICE_EXTENSIONS.data();
+	const std::vector<const char*>& extensions = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetEnabledExtensions();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
 
 	if (VulkanInstance::enableValidationLayers)
 	{
@@ -60,6 +80,13 @@ VulkanLogicalDevice::VulkanLogicalDevice()
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+	graphicsFamily = indices.graphicsFamily.value();
+	if (asyncCompute)
+	{
+		computeFamily = indices.computeFamily.value();
+		vkGetDeviceQueue(device, computeFamily, 0, &computeQueue);
+	}
 }
 
 VulkanLogicalDevice::~VulkanLogicalDevice()
@@ -83,3 +110,29 @@ VkQueue VulkanLogicalDevice::GetPresentQueue() const
 {
 	return presentQueue;
 }
+
+
+VkQueue VulkanLogicalDevice::GetComputeQueue() const
+{
+	return computeQueue;
+}
+
+uint32_t VulkanLogicalDevice::GetGraphicsFamily() const
+{
+	return graphicsFamily;
+}
+
+uint32_t VulkanLogicalDevice::GetComputeFamily() const
+{
+	return computeFamily;
+}
+
+bool VulkanLogicalDevice::HasAsyncCompute() const
+{
+	return computeQueue != nullptr;
+}
+
+bool VulkanLogicalDevice::HasSparseResidency() const
+{
+	return sparseResidency;
+}
\ No newline at end of file
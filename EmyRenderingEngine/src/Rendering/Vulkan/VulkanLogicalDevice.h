@@ -7,12 +7,30 @@ private:
 	VkDevice device = nullptr;
 	VkQueue graphicsQueue = nullptr;
 	VkQueue presentQueue = nullptr;
+	VkQueue computeQueue = nullptr; // Null without async compute
+	uint32_t graphicsFamily = 0;
+	uint32_t computeFamily = 0;
+	bool sparseResidency = false;
 
 public:
-	VulkanLogicalDevice();
+	/// <param name="asyncCompute">Create a queue on a compute only family when the device has one</param>
+	VulkanLogicalDevice(bool asyncCompute);
 	~VulkanLogicalDevice();
 
 	VkDevice GetVk() const;
 	VkQueue GetGraphicsQueue() const;
 	VkQueue GetPresentQueue() const;
+	VkQueue GetComputeQueue() const;
+	uint32_t GetGraphicsFamily() const;
+	uint32_t GetComputeFamily() const;
+
+	/// <summary>
+	/// True when the compute queue is on another family than the graphics queue and can run beside it.
+	/// </summary>
+	bool HasAsyncCompute() const;
+
+	/// <summary>
+	/// True when 2D images can be partially resident and the graphics queue binds their memory.
+	/// </summary>
+	bool HasSparseResidency() const;
 };
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "Rendering/Vulkan/VulkanMemoryTracker.h"
+
+#include <string>
+#include <algorithm>
+#include "Helper/Log.h"
+#include "Rendering/Vulkan/VulkanRenderer.h"
+#include "Helper/Profiler.h"
+
+VulkanMemoryTracker::VulkanMemoryTracker()
+{
+	VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
+
+	memoryBudgetSupported = VulkanRenderer::GetInstance()->GetPhysicalDevice()->IsMemoryBudgetSupported();
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	heaps.resize(memoryProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		heaps[i].size = memoryProperties.memoryHeaps[i].size;
+		heaps[i].deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	QueryBudgets();
+
+	Logger::Log(memoryBudgetSupported ? "Memory budget from VK_EXT_memory_budget" : "VK_EXT_memory_budget not supported, memory budget from the tracked allocations");
+}
+
+void VulkanMemoryTracker::Update()
+{
+	PROFILE_FUNCTION();
+
+	QueryBudgets();
+
+	// The budget can also be exceeded by another process
+	VkDeviceSize overrun = pendingEviction;
+	for (const HeapInfo& heap : heaps)
+	{
+		if (heap.deviceLocal && heap.usage > heap.budget)
+			overrun = std::max(overrun, heap.usage - heap.budget);
+	}
+
+	pendingEviction = 0;
+	if (overrun > 0)
+		Evict(overrun);
+}
+
+void VulkanMemoryTracker::QueryBudgets()
+{
+	if (memoryBudgetSupported)
+	{
+		VkInstance instance = VulkanRenderer::GetInstance()->GetVulkanInstance()->GetVk();
+		auto func = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+
+		if (func != nullptr)
+		{
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+			budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+			VkPhysicalDeviceMemoryProperties2KHR properties = {};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+			properties.pNext = &budgetProperties;
+
+			func(VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk(), &properties);
+
+			for (size_t i = 0; i < heaps.size(); i++)
+			{
+				heaps[i].budget = budgetProperties.heapBudget[i];
+				heaps[i].usage = budgetProperties.heapUsage[i];
+			}
+			return;
+		}
+
+		memoryBudgetSupported = false;
+		Logger::Log(LogSeverity::WARNING, "vkGetPhysicalDeviceMemoryProperties2KHR not found, memory budget from the tracked allocations");
+	}
+
+	for (HeapInfo& heap : heaps)
+	{
+		heap.budget = static_cast<VkDeviceSize>(heap.size * FALLBACK_BUDGET_RATIO);
+		heap.usage = heap.tracked;
+	}
+}
+
+void VulkanMemoryTracker::Track(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category)
+{
+	uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	allocations[memory] = {size, heapIndex, category};
+
+	// The driver usage is only queried once per frame
+	heaps[heapIndex].tracked += size;
+	heaps[heapIndex].usage += size;
+	categoryUsage[static_cast<size_t>(category)] += size;
+	categoryAllocationCount[static_cast<size_t>(category)]++;
+}
+
+void VulkanMemoryTracker::Untrack(VkDeviceMemory memory)
+{
+	auto it = allocations.find(memory);
+	if (it == allocations.end())
+		return;
+
+	const Allocation& allocation = it->second;
+	HeapInfo& heap = heaps[allocation.heapIndex];
+	heap.tracked -= allocation.size;
+	heap.usage -= std::min(heap.usage, allocation.size);
+	categoryUsage[static_cast<size_t>(allocation.category)] -= allocation.size;
+	categoryAllocationCount[static_cast<size_t>(allocation.category)]--;
+
+	allocations.erase(it);
+}
+
+void VulkanMemoryTracker::Reserve(VkDeviceSize size, uint32_t memoryTypeIndex)
+{
+	const HeapInfo& heap = heaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+
+	// Only the textures can be evicted and they are in device local memory
+	if (!heap.deviceLocal || heap.usage + size <= heap.budget)
+		return;
+
+	pendingEviction = std::max(pendingEviction, heap.usage + size - heap.budget);
+}
+
+bool VulkanMemoryTracker::IsMemoryBudgetSupported() const
+{
+	return memoryBudgetSupported;
+}
+
+const std::vector<VulkanMemoryTracker::HeapInfo>& VulkanMemoryTracker::GetHeaps() const
+{
+	return heaps;
+}
+
+VkDeviceSize VulkanMemoryTracker::GetCategoryUsage(MemoryCategory category) const
+{
+	return categoryUsage[static_cast<size_t>(category)];
+}
+
+uint32_t VulkanMemoryTracker::GetCategoryAllocationCount(MemoryCategory category) const
+{
+	return categoryAllocationCount[static_cast<size_t>(category)];
+}
+
+VkDeviceSize VulkanMemoryTracker::GetDeviceLocalAvailable() const
+{
+	VkDeviceSize available = 0;
+	for (const HeapInfo& heap : heaps)
+	{
+		if (heap.deviceLocal && heap.budget > heap.usage)
+			available += heap.budget - heap.usage;
+	}
+
+	return available;
+}
+
+uint32_t VulkanMemoryTracker::GetEvictionCount() const
+{
+	return evictionCount;
+}
+
+const char* VulkanMemoryTracker::GetCategoryName(MemoryCategory category)
+{
+	switch (category)
+	{
+		case MemoryCategory::MESH:
+			return "Mesh";
+		case MemoryCategory::TEXTURE:
+			return "Texture";
+		case MemoryCategory::UNIFORM:
+			return "Uniform";
+		case MemoryCategory::ATTACHMENT:
+			return "Attachment";
+		case MemoryCategory::STAGING:
+			return "Staging";
+		default:
+			return "Other";
+	}
+}
+
+VkDeviceSize VulkanMemoryTracker::Evict(VkDeviceSize size)
+{
+	TextureStreamer* textureStreamer = VulkanRenderer::GetInstance()->GetTextureStreamer();
+	if (textureStreamer == nullptr)
+		return 0;
+
+	VkDeviceSize freed = textureStreamer->Trim(size);
+	if (freed > 0)
+		evictionCount++;
+
+	return freed;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+
+enum class MemoryCategory
+{
+	OTHER,
+	MESH,
+	TEXTURE,
+	UNIFORM,
+	ATTACHMENT,
+	STAGING,
+	COUNT
+};
+
+/// <summary>
+/// Account every device memory allocation by category and memory heap.
+/// The heap budget and usage come from VK_EXT_memory_budget when it is supported, otherwise from this accounting.
+/// Allocations going over the budget are recorded and the least recently used texture mips are evicted by the next Update,
+/// never in the allocation itself since it can happen while a frame is recorded.
+/// </summary>
+class VulkanMemoryTracker
+{
+public:
+	struct HeapInfo
+	{
+		VkDeviceSize size = 0;
+		VkDeviceSize budget = 0; // Memory the application can use without degrading the performance
+		VkDeviceSize usage = 0; // By the whole process, or the tracked allocations without VK_EXT_memory_budget
+		VkDeviceSize tracked = 0; // Allocated through VulkanHelper
+		bool deviceLocal = false;
+	};
+
+private:
+	// Without VK_EXT_memory_budget, the part of a heap used before evicting
+	static constexpr float FALLBACK_BUDGET_RATIO = 0.8f;
+
+	struct Allocation
+	{
+		VkDeviceSize size;
+		uint32_t heapIndex;
+		MemoryCategory category;
+	};
+
+	bool memoryBudgetSupported = false;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	std::vector<HeapInfo> heaps;
+	std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::COUNT)> categoryUsage = {};
+	std::array<uint32_t, static_cast<size_t>(MemoryCategory::COUNT)> categoryAllocationCount = {};
+	std::unordered_map<VkDeviceMemory, Allocation> allocations;
+	VkDeviceSize pendingEviction = 0; // Over the budget since the last Update
+	uint32_t evictionCount = 0;
+
+public:
+	VulkanMemoryTracker();
+
+	/// <summary>
+	/// Query the heap budgets and evict what is over them, need to be called once per frame before recording the command buffers.
+	/// </summary>
+	void Update();
+
+	void Track(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category);
+	void Untrack(VkDeviceMemory memory);
+
+	/// <summary>
+	/// Record how much an allocation of this size in this memory type goes over the heap budget, it is evicted by the next Update.
+	/// </summary>
+	void Reserve(VkDeviceSize size, uint32_t memoryTypeIndex);
+
+	bool IsMemoryBudgetSupported() const;
+	const std::vector<HeapInfo>& GetHeaps() const;
+	VkDeviceSize GetCategoryUsage(MemoryCategory category) const;
+	uint32_t GetCategoryAllocationCount(MemoryCategory category) const;
+
+	/// <summary>
+	/// Free space in the budget of the device local heaps.
+	/// </summary>
+	VkDeviceSize GetDeviceLocalAvailable() const;
+	uint32_t GetEvictionCount() const;
+
+	static const char* GetCategoryName(MemoryCategory category);
+
+private:
+	void QueryBudgets();
+	VkDeviceSize Evict(VkDeviceSize size);
+};
\ No newline at end of file
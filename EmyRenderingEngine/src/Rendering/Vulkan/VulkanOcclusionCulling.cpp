@@ -0,0 +1,583 @@
+#include "Rendering/Vulkan/VulkanOcclusionCulling.h"
+
+#include "Helper/Log.h"
+#include "Helper/PerfCounters.h"
+#include "VulkanRenderer.h"
+#include "Rendering/Model.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+	struct HiZBuildConstants
+	{
+		glm::ivec2 srcSize;
+		glm::ivec2 dstSize;
+	};
+
+	// Same layout as the ResolveInfo of DepthResolve.frag
+	struct DepthResolveConstants
+	{
+		int32_t sampleCount;
+	};
+
+	struct OcclusionTestConstants
+	{
+		glm::mat4 viewProjection;
+		glm::vec2 screenSize;
+		uint32_t objectCount;
+		uint32_t mipCount;
+	};
+
+	uint32_t GetMipCount(VkExtent2D extent)
+	{
+		return static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+	}
+}
+
+VulkanOcclusionCulling::VulkanOcclusionCulling()
+{
+	VulkanRenderer* renderer = VulkanRenderer::GetInstance();
+	extent = renderer->GetSwapChain()->GetVkExtent2D();
+	mipCount = GetMipCount(extent);
+
+	hiZBuildShader = std::unique_ptr<VulkanShader>(new VulkanShader("HiZBuildComp", VkShaderStageFlagBits::VK_SHADER_STAGE_COMPUTE_BIT));
+	occlusionTestShader = std::unique_ptr<VulkanShader>(new VulkanShader("OcclusionTestComp", VkShaderStageFlagBits::VK_SHADER_STAGE_COMPUTE_BIT));
+
+	hiZBuildPipeline = std::unique_ptr<VulkanComputePipeline>(new VulkanComputePipeline(hiZBuildShader.get()));
+	hiZBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);// Depth
+	hiZBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);// Previous mip
+	hiZBuildPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);// Mip being built
+	hiZBuildPipeline->Create(sizeof(HiZBuildConstants));
+
+	occlusionTestPipeline = std::unique_ptr<VulkanComputePipeline>(new VulkanComputePipeline(occlusionTestShader.get()));
+	occlusionTestPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);// Hi-Z
+	occlusionTestPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);// Objects
+	occlusionTestPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);// Draw commands
+	occlusionTestPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);// Visibility
+	occlusionTestPipeline->Create(sizeof(OcclusionTestConstants));
+
+	frames.resize(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
+	for (Frame& frame : frames)
+		CreateBuffers(frame, 64, 256);
+	CreateSamplers();
+
+	// A multisampled depth is resolved by the first phase render pass, the Hi-Z is built from the single sample one
+	if (renderer->GetRenderPass()->IsDepthResolved())
+		CreateDepthResolve(renderer->GetRenderPass()->GetVk());
+	CreateDescriptors();
+}
+
+VulkanOcclusionCulling::~VulkanOcclusionCulling()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	if (depthResolvePipeline != nullptr)
+	{
+		vkDestroyPipeline(device, depthResolvePipeline, nullptr);
+		vkDestroyPipelineLayout(device, depthResolvePipelineLayout, nullptr);
+	}
+
+	vkDestroySampler(device, depthSampler, nullptr);
+	vkDestroySampler(device, hiZSampler, nullptr);
+	for (Frame& frame : frames)
+		DestroyBuffers(frame);
+
+	hiZBuildPipeline.reset();
+	occlusionTestPipeline.reset();
+	hiZBuildShader.reset();
+	occlusionTestShader.reset();
+	depthResolveVertexShader.reset();
+	depthResolveFragShader.reset();
+
+	Logger::Log("Occlusion culling destroyed");
+}
+
+void VulkanOcclusionCulling::Prepare(const std::vector<Model*>& models, size_t frame)
+{
+	Frame& current = frames[frame];
+
+	// The fence of the slot was waited, its last test is complete. The slots changed since, the results are matched by draw list handle.
+	// A handle reused by a new model only gives it a wrong first phase, the second phase still draws it if it is visible.
+	std::fill(handleVisibility.begin(), handleVisibility.end(), static_cast<uint8_t>(0));
+	for (size_t slot = 0; slot < current.testedHandles.size(); slot++)
+	{
+		uint32_t handle = current.testedHandles[slot];
+		if (handle >= handleVisibility.size())
+			handleVisibility.resize(handle + 1, 0);
+
+		handleVisibility[handle] = current.visibility[slot] != 0 ? 2 : 1;
+	}
+
+	// Models the slot didn't test are drawn in the first phase
+	occludedCount = 0;
+	for (Model* model : models)
+	{
+		model->occlusionVisible = model->drawListHandle >= handleVisibility.size() || handleVisibility[model->drawListHandle] != 1;
+
+		if (!model->occlusionVisible)
+			occludedCount++;
+	}
+
+	objectList.clear();
+	commandList.clear();
+	current.testedHandles.clear();
+
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		Model* model = models[i];
+		model->occlusionSlot = static_cast<uint32_t>(i);
+
+		Object object = {};
+		object.boundingSphere = model->GetWorldBoundingSphere();
+		object.firstCommand = static_cast<uint32_t>(commandList.size());
+		model->mesh->GetDrawCommands(model->GetCurrentLod(), commandList);
+		object.commandCount = static_cast<uint32_t>(commandList.size()) - object.firstCommand;
+		object.drawnInFirstPhase = model->occlusionVisible ? 1 : 0;
+
+		objectList.push_back(object);
+		current.testedHandles.push_back(model->drawListHandle);
+	}
+
+	objectCount = static_cast<uint32_t>(objectList.size());
+
+	// Only the frame slot waited for uses the buffers, the other frames in flight have their own
+	if (objectCount > current.capacity || commandList.size() > current.commandCapacity)
+	{
+		DestroyBuffers(current);
+		CreateBuffers(current, std::max(objectCount, current.capacity * 2), std::max(static_cast<uint32_t>(commandList.size()), current.commandCapacity * 2));
+		current.descriptorsStale = true;
+	}
+
+	std::copy(objectList.begin(), objectList.end(), current.objects);
+	std::copy(commandList.begin(), commandList.end(), current.drawCommands);
+}
+
+void VulkanOcclusionCulling::Reset()
+{
+	for (Frame& frame : frames)
+		frame.testedHandles.clear();
+
+	occludedCount = 0;
+}
+
+void VulkanOcclusionCulling::CmdResolveDepth(VkCommandBuffer commandBuffer, VkImageView msaaDepth)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// A new depth is only created once the device is idle, the set isn't used by a frame in flight
+	if (msaaDepth != depthResolveView)
+	{
+		depthResolveView = msaaDepth;
+
+		VkDescriptorImageInfo depthInfo = {};
+		depthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthInfo.imageView = msaaDepth;
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = depthResolveDescriptorSet;
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		descriptorWrite.pImageInfo = &depthInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+	}
+
+	DepthResolveConstants constants = {};
+	constants.sampleCount = static_cast<int32_t>(VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetMsaaSample());
+
+	// The viewport and scissor of the render pass are kept, only the render extent is resolved
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthResolvePipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthResolvePipelineLayout, 0, 1, &depthResolveDescriptorSet, 0, nullptr);
+	PerfCounters::Add(PerfCounter::PIPELINE_BINDS);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+	vkCmdPushConstants(commandBuffer, depthResolvePipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	PerfCounters::Add(PerfCounter::DRAW_CALLS);
+}
+
+void VulkanOcclusionCulling::CmdBuildHiZ(VkCommandBuffer commandBuffer, size_t frame, VkExtent2D renderExtent, VkImageView depthView, VkImageView hiZView, const std::vector<VkImageView>& hiZMipViews)
+{
+	// The sets of the frame slot aren't used by a frame in flight anymore, its fence was waited
+	Frame& current = frames[frame];
+	if (current.descriptorsStale || current.depthView != depthView || current.hiZView != hiZView)
+		WriteDescriptors(current, depthView, hiZView, hiZMipViews);
+
+	hiZBuildPipeline->CmdBind(commandBuffer);
+
+	VkMemoryBarrier mipBarrier = {};
+	mipBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	// Only the top left area the scene was rendered in, the mips past its size are never read
+	uint32_t renderMipCount = std::min(GetMipCount(renderExtent), mipCount);
+	for (uint32_t mip = 0; mip < renderMipCount; mip++)
+	{
+		HiZBuildConstants constants = {};
+		constants.srcSize = mip == 0 ? glm::ivec2(renderExtent.width, renderExtent.height) : glm::ivec2(std::max(renderExtent.width >> (mip - 1), 1u), std::max(renderExtent.height >> (mip - 1), 1u));
+		constants.dstSize = glm::ivec2(std::max(renderExtent.width >> mip, 1u), std::max(renderExtent.height >> mip, 1u));
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZBuildPipeline->GetVkPipelineLayout(), 0, 1, &current.hiZBuildDescriptorSets[mip], 0, nullptr);
+		PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+		vkCmdPushConstants(commandBuffer, hiZBuildPipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (constants.dstSize.x + 7) / 8, (constants.dstSize.y + 7) / 8, 1);
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &mipBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+void VulkanOcclusionCulling::CmdTest(VkCommandBuffer commandBuffer, size_t frame, const glm::mat4& viewProjection, VkExtent2D renderExtent)
+{
+	if (objectCount == 0)
+		return;
+
+	occlusionTestPipeline->CmdBind(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, occlusionTestPipeline->GetVkPipelineLayout(), 0, 1, &frames[frame].occlusionTestDescriptorSet, 0, nullptr);
+	PerfCounters::Add(PerfCounter::DESCRIPTOR_SET_BINDS);
+
+	OcclusionTestConstants constants = {};
+	constants.viewProjection = viewProjection;
+	constants.screenSize = glm::vec2(renderExtent.width, renderExtent.height);
+	constants.objectCount = objectCount;
+	constants.mipCount = std::min(GetMipCount(renderExtent), mipCount);
+	vkCmdPushConstants(commandBuffer, occlusionTestPipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	vkCmdDispatch(commandBuffer, (objectCount + 63) / 64, 1, 1);
+}
+
+void VulkanOcclusionCulling::CmdDrawSecondPhase(VkCommandBuffer commandBuffer, size_t frame, Model* model, int i)
+{
+	if (model->occlusionVisible || model->occlusionSlot >= objectCount)
+		return;
+
+	const Object& object = objectList[model->occlusionSlot];
+	model->DrawIndirect(commandBuffer, i, frames[frame].drawCommandBuffer, object.firstCommand, object.commandCount);
+}
+
+uint32_t VulkanOcclusionCulling::GetOccludedCount() const
+{
+	return occludedCount;
+}
+
+VulkanRenderGraph::ImageDescription VulkanOcclusionCulling::GetHiZDescription() const
+{
+	VulkanRenderGraph::ImageDescription description;
+	description.extent = extent;
+	description.format = VK_FORMAT_R32_SFLOAT;
+	description.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	description.mipLevels = mipCount;
+	return description;
+}
+
+void VulkanOcclusionCulling::CreateSamplers()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// Only texelFetch is used, the samplers never filter
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.minLod = 0;
+	samplerInfo.maxLod = 0;
+	samplerInfo.mipLodBias = 0;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &depthSampler) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create depth sampler!");
+	}
+
+	samplerInfo.maxLod = static_cast<float>(mipCount);
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &hiZSampler) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create Hi-Z sampler!");
+	}
+}
+
+void VulkanOcclusionCulling::CreateDepthResolve(VkRenderPass renderPass)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	depthResolveVertexShader = std::unique_ptr<VulkanShader>(new VulkanShader("UpscaleVert", VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT));
+	depthResolveFragShader = std::unique_ptr<VulkanShader>(new VulkanShader("DepthResolveFrag", VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT));
+
+	depthResolveLayoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT);// Multisampled depth
+	depthResolveLayoutBinding.Create(device);
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {depthResolveVertexShader->GetShaderStageInfo(), depthResolveFragShader->GetShaderStageInfo()};
+
+	// No vertex buffer, the vertex shader makes the triangle from the vertex index
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// Every pixel is written whatever the depth held
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 0;
+
+	std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkDescriptorSetLayout setLayout = depthResolveLayoutBinding.GetVkDescriptorSetLayout();
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DepthResolveConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &depthResolvePipelineLayout) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create depth resolve pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = depthResolvePipelineLayout;
+	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = 1;
+
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &depthResolvePipeline) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create depth resolve pipeline!");
+	}
+}
+
+void VulkanOcclusionCulling::CreateDescriptors()
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	uint32_t frameCount = static_cast<uint32_t>(frames.size());
+	std::array<VkDescriptorPoolSize, 4> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = (mipCount + 1) * frameCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = mipCount * 2 * frameCount;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = 3 * frameCount;
+	poolSizes[3].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	poolSizes[3].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = (mipCount + 1) * frameCount + 1;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create occlusion culling descriptor pool!");
+	}
+
+	for (Frame& frame : frames)
+	{
+		std::vector<VkDescriptorSetLayout> layouts(mipCount, hiZBuildPipeline->layoutBinding.GetVkDescriptorSetLayout());
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = mipCount;
+		allocInfo.pSetLayouts = layouts.data();
+
+		frame.hiZBuildDescriptorSets.resize(mipCount);
+		if (vkAllocateDescriptorSets(device, &allocInfo, frame.hiZBuildDescriptorSets.data()) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate Hi-Z descriptor sets!");
+		}
+
+		VkDescriptorSetLayout testLayout = occlusionTestPipeline->layoutBinding.GetVkDescriptorSetLayout();
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &testLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &frame.occlusionTestDescriptorSet) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate occlusion test descriptor set!");
+		}
+	}
+
+	// The depth resolve has a single set, its input attachment only changes once the device is idle
+	if (depthResolvePipeline != nullptr)
+	{
+		VkDescriptorSetLayout resolveLayout = depthResolveLayoutBinding.GetVkDescriptorSetLayout();
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &resolveLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &depthResolveDescriptorSet) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate depth resolve descriptor set!");
+		}
+	}
+}
+
+void VulkanOcclusionCulling::CreateBuffers(Frame& frame, uint32_t objectCapacity, uint32_t drawCommandCapacity)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	frame.capacity = objectCapacity;
+	frame.commandCapacity = drawCommandCapacity;
+
+	VulkanHelper::CreateBuffer(sizeof(Object) * frame.capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, properties, frame.objectBuffer, frame.objectBufferMemory);
+	VulkanHelper::CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * frame.commandCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, properties, frame.drawCommandBuffer, frame.drawCommandBufferMemory);
+	VulkanHelper::CreateBuffer(sizeof(uint32_t) * frame.capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, properties, frame.visibilityBuffer, frame.visibilityBufferMemory);
+
+	// Stay mapped for the lifetime of the buffers
+	vkMapMemory(device, frame.objectBufferMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&frame.objects));
+	vkMapMemory(device, frame.drawCommandBufferMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&frame.drawCommands));
+	vkMapMemory(device, frame.visibilityBufferMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&frame.visibility));
+}
+
+void VulkanOcclusionCulling::DestroyBuffers(Frame& frame)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	vkUnmapMemory(device, frame.objectBufferMemory);
+	vkUnmapMemory(device, frame.drawCommandBufferMemory);
+	vkUnmapMemory(device, frame.visibilityBufferMemory);
+
+	vkDestroyBuffer(device, frame.objectBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, frame.objectBufferMemory);
+	vkDestroyBuffer(device, frame.drawCommandBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, frame.drawCommandBufferMemory);
+	vkDestroyBuffer(device, frame.visibilityBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, frame.visibilityBufferMemory);
+}
+
+void VulkanOcclusionCulling::WriteDescriptors(Frame& frame, VkImageView depthView, VkImageView hiZView, const std::vector<VkImageView>& hiZMipViews)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	frame.depthView = depthView;
+	frame.hiZView = hiZView;
+	frame.descriptorsStale = false;
+
+	for (uint32_t i = 0; i < mipCount; i++)
+	{
+		VkDescriptorImageInfo depthInfo = {};
+		depthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthInfo.imageView = depthView;
+		depthInfo.sampler = depthSampler;
+
+		// The first mip read the depth, its source is never read
+		VkDescriptorImageInfo srcInfo = {};
+		srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		srcInfo.imageView = hiZMipViews[i == 0 ? 0 : i - 1];
+
+		VkDescriptorImageInfo dstInfo = {};
+		dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		dstInfo.imageView = hiZMipViews[i];
+
+		std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
+		for (uint32_t y = 0; y < descriptorWrites.size(); y++)
+		{
+			descriptorWrites[y].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[y].dstSet = frame.hiZBuildDescriptorSets[i];
+			descriptorWrites[y].dstBinding = y;
+			descriptorWrites[y].dstArrayElement = 0;
+			descriptorWrites[y].descriptorCount = 1;
+		}
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].pImageInfo = &depthInfo;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].pImageInfo = &srcInfo;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[2].pImageInfo = &dstInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	VkDescriptorImageInfo hiZInfo = {};
+	hiZInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	hiZInfo.imageView = hiZView;
+	hiZInfo.sampler = hiZSampler;
+
+	std::array<VkDescriptorBufferInfo, 3> bufferInfos = {};
+	bufferInfos[0].buffer = frame.objectBuffer;
+	bufferInfos[0].range = VK_WHOLE_SIZE;
+	bufferInfos[1].buffer = frame.drawCommandBuffer;
+	bufferInfos[1].range = VK_WHOLE_SIZE;
+	bufferInfos[2].buffer = frame.visibilityBuffer;
+	bufferInfos[2].range = VK_WHOLE_SIZE;
+
+	std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+	for (uint32_t i = 0; i < descriptorWrites.size(); i++)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = frame.occlusionTestDescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		if (i > 0)
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i - 1];
+	}
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[0].pImageInfo = &hiZInfo;
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
\ No newline at end of file
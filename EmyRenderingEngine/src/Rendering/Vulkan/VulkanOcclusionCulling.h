@@ -0,0 +1,150 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "VulkanShader.h"
+#include "VulkanComputePipeline.h"
+#include "VulkanLayoutBinding.h"
+#include "VulkanRenderGraph.h"
+
+class Model;
+
+/// <summary>
+/// Two phase occlusion culling against a hierarchical depth buffer.
+/// Models visible last frame are drawn first, their depth is reduced to a Hi-Z mip pyramid
+/// then every model is tested against it and the newly visible ones are drawn in a second phase.
+/// </summary>
+class VulkanOcclusionCulling
+{
+public:
+	// Same layout as the Object of OcclusionTest.comp
+	struct Object
+	{
+		glm::vec4 boundingSphere; // xyz center, w radius, in world space
+		uint32_t firstCommand;
+		uint32_t commandCount;
+		uint32_t drawnInFirstPhase;
+		uint32_t padding;
+	};
+
+private:
+	// Resources of one frame in flight, reused once the fence of the frame is signaled so a frame never writes what another one still reads
+	struct Frame
+	{
+		std::vector<VkDescriptorSet> hiZBuildDescriptorSets; // One per mip
+		VkDescriptorSet occlusionTestDescriptorSet = nullptr;
+
+		// Views the sets were written with, the depth and the Hi-Z are transient images of the render graph
+		VkImageView depthView = nullptr;
+		VkImageView hiZView = nullptr;
+		bool descriptorsStale = true; // The buffers were recreated
+
+		// Host visible so the visibility can be read back and the objects written without staging
+		uint32_t capacity = 0;
+		uint32_t commandCapacity = 0;
+		VkBuffer objectBuffer = nullptr;
+		VkDeviceMemory objectBufferMemory = nullptr;
+		Object* objects = nullptr;
+		VkBuffer drawCommandBuffer = nullptr;
+		VkDeviceMemory drawCommandBufferMemory = nullptr;
+		VkDrawIndexedIndirectCommand* drawCommands = nullptr;
+		VkBuffer visibilityBuffer = nullptr;
+		VkDeviceMemory visibilityBufferMemory = nullptr;
+		uint32_t* visibility = nullptr;
+
+		std::vector<uint32_t> testedHandles; // Draw list handle of the model tested in each slot, empty if the test didn't run
+	};
+
+	VkExtent2D extent = {}; // Swapchain extent, the Hi-Z is built for the render extent of the frame in its top left corner
+	uint32_t mipCount = 0;
+
+	std::vector<Frame> frames;
+	VkSampler depthSampler = nullptr;
+	VkSampler hiZSampler = nullptr;
+
+	std::unique_ptr<VulkanShader> hiZBuildShader;
+	std::unique_ptr<VulkanShader> occlusionTestShader;
+	std::unique_ptr<VulkanComputePipeline> hiZBuildPipeline;
+	std::unique_ptr<VulkanComputePipeline> occlusionTestPipeline;
+
+	// Fullscreen triangle writing the farthest sample of the multisampled depth, in the second subpass of the first phase. Null without MSAA
+	std::unique_ptr<VulkanShader> depthResolveVertexShader;
+	std::unique_ptr<VulkanShader> depthResolveFragShader;
+	VulkanLayoutBinding depthResolveLayoutBinding;
+	VkPipelineLayout depthResolvePipelineLayout = nullptr;
+	VkPipeline depthResolvePipeline = nullptr;
+	VkDescriptorSet depthResolveDescriptorSet = nullptr;
+	VkImageView depthResolveView = nullptr; // Multisampled depth the set was written with
+
+	VkDescriptorPool descriptorPool = nullptr;
+
+	std::vector<Object> objectList;
+	std::vector<VkDrawIndexedIndirectCommand> commandList;
+	std::vector<uint8_t> handleVisibility; // Per draw list handle, 0 if untested else the test result plus one
+	uint32_t objectCount = 0;
+	uint32_t occludedCount = 0;
+
+public:
+	VulkanOcclusionCulling();
+	~VulkanOcclusionCulling();
+
+	/// <summary>
+	/// Read back the visibility the frame slot tested MAX_FRAMES_IN_FLIGHT frames ago into Model::occlusionVisible and upload the models bounds and draws.
+	/// Need to be called once per frame before recording, after the fence of the frame slot. The models need an up to date lod and bounding sphere.
+	/// </summary>
+	/// <param name="frame">Frame in flight the buffers of the frame belong to</param>
+	void Prepare(const std::vector<Model*>& models, size_t frame);
+
+	/// <summary>
+	/// Forget the visibility of every frame slot, every model will be drawn in the first phase next time.
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Write the farthest sample of each pixel of the multisampled depth to the single sample depth.
+	/// Record it in the second subpass of a render pass whose depth is resolved.
+	/// </summary>
+	/// <param name="msaaDepth">Input attachment of the subpass, the descriptor is rewritten when it changed</param>
+	void CmdResolveDepth(VkCommandBuffer commandBuffer, VkImageView msaaDepth);
+
+	/// <summary>
+	/// Reduce the depth of the first phase to the Hi-Z. Record it after the first render pass,
+	/// the single sample depth need to be in the depth read only layout and the Hi-Z in the general layout.
+	/// </summary>
+	/// <param name="renderExtent">Area of the depth the render passes drew in</param>
+	/// <param name="hiZView">Every mip of an image of the Hi-Z description, the mip views one mip each</param>
+	void CmdBuildHiZ(VkCommandBuffer commandBuffer, size_t frame, VkExtent2D renderExtent, VkImageView depthView, VkImageView hiZView, const std::vector<VkImageView>& hiZMipViews);
+
+	/// <summary>
+	/// Test every model against the Hi-Z and write the draws of the second phase, record it after CmdBuildHiZ.
+	/// The caller makes them visible to the indirect draws and the visibility to the host.
+	/// </summary>
+	void CmdTest(VkCommandBuffer commandBuffer, size_t frame, const glm::mat4& viewProjection, VkExtent2D renderExtent);
+
+	/// <summary>
+	/// Draw the model if the test found it visible and it wasn't drawn in the first phase.
+	/// The model graphic pipeline and mesh need to be bound.
+	/// </summary>
+	void CmdDrawSecondPhase(VkCommandBuffer commandBuffer, size_t frame, Model* model, int i);
+
+	/// <summary>
+	/// Model count found occluded by the last test.
+	/// </summary>
+	uint32_t GetOccludedCount() const;
+
+	/// <summary>
+	/// Hi-Z image the render graph creates for the build, a mip pyramid over the swapchain extent.
+	/// </summary>
+	VulkanRenderGraph::ImageDescription GetHiZDescription() const;
+
+private:
+	void CreateSamplers();
+	void CreateDepthResolve(VkRenderPass renderPass);
+	void CreateDescriptors();
+	void CreateBuffers(Frame& frame, uint32_t objectCapacity, uint32_t drawCommandCapacity);
+	void DestroyBuffers(Frame& frame);
+	void WriteDescriptors(Frame& frame, VkImageView depthView, VkImageView hiZView, const std::vector<VkImageView>& hiZMipViews);
+};
\ No newline at end of file
@@ -33,13 +33,19 @@ VulkanPhysicalDevice::VulkanPhysicalDevice(VkSampleCountFlagBits msaaSamples)
 		if (IsDeviceSuitable(device))
 		{
 			physicalDevice = device;
-
-			VkSampleCountFlagBits maxMsaaSample = GetMaxUsableSampleCount();
-
-			if (msaaSamples <= maxMsaaSample)
-				this->msaaSamples = msaaSamples;
-			else
-				this->msaaSamples = maxMsaaSample;
+			vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+			// Highest count supported by the color and depth attachments that is not above the requested one
+			VkSampleCountFlags counts = GetUsableSampleCounts();
+			for (uint32_t count = VK_SAMPLE_COUNT_64_BIT; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+			{
+				if (count <= static_cast<uint32_t>(msaaSamples) && (counts & count))
+				{
+					this->msaaSamples = static_cast<VkSampleCountFlagBits>(count);
+					break;
+				}
+			}
 
 			break;
 		}
@@ -49,14 +55,26 @@ VulkanPhysicalDevice::VulkanPhysicalDevice(VkSampleCountFlagBits msaaSamples)
 	{
 		Logger::Log(LogSeverity::FATAL_ERROR, "failed to find a suitable GPU!");
 	}
+
+	Logger::Log("MSAA samples: " + std::to_string(this->msaaSamples));
+
+	// Nothing to present to in headless mode
+	if (!VulkanRenderer::GetInstance()->IsHeadless())
+		enabledExtensions = DEVICE_EXTENSIONS;
+
+	memoryBudgetSupported = VulkanRenderer::GetInstance()->GetVulkanInstance()->HasPhysicalDeviceProperties2() && IsExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudgetSupported)
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 }
 
-VkSampleCountFlagBits VulkanPhysicalDevice::GetMaxUsableSampleCount() const
+VkSampleCountFlags VulkanPhysicalDevice::GetUsableSampleCounts() const
 {
-	VkPhysicalDeviceProperties physicalDeviceProperties;
-	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	return properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+}
 
-	VkSampleCountFlags counts = std::min(physicalDeviceProperties.limits.framebufferColorSampleCounts, physicalDeviceProperties.limits.framebufferDepthSampleCounts);
+VkSampleCountFlagBits VulkanPhysicalDevice::GetMaxUsableSampleCount() const
+{
+	VkSampleCountFlags counts = GetUsableSampleCounts();
 
 	if (counts & VK_SAMPLE_COUNT_64_BIT)
 		return VK_SAMPLE_COUNT_64_BIT;
@@ -79,6 +97,26 @@ VkPhysicalDevice VulkanPhysicalDevice::GetVk() const
 	return physicalDevice;
 }
 
+VkPhysicalDeviceFeatures VulkanPhysicalDevice::GetSupportedFeatures() const
+{
+	return supportedFeatures;
+}
+
+const VkPhysicalDeviceProperties& VulkanPhysicalDevice::GetProperties() const
+{
+	return properties;
+}
+
+const std::vector<const char*>& VulkanPhysicalDevice::GetEnabledExtensions() const
+{
+	return enabledExtensions;
+}
+
+bool VulkanPhysicalDevice::IsMemoryBudgetSupported() const
+{
+	return memoryBudgetSupported;
+}
+
 VkSampleCountFlagBits VulkanPhysicalDevice::GetMsaaSample() const
 {
 	return msaaSamples;
@@ -88,10 +126,12 @@ bool VulkanPhysicalDevice::IsDeviceSuitable(VkPhysicalDevice device)
 {
 	VulkanHelper::QueueFamilyIndices indices = VulkanHelper::FindQueueFamilies(device);
 
-	bool extensionsSupported = CheckDeviceExtensionSupport(device);
+	// Nothing is presented in headless mode, a software driver like lavapipe is enough
+	bool headless = VulkanRenderer::GetInstance()->IsHeadless();
+	bool extensionsSupported = headless || CheckDeviceExtensionSupport(device);
 
-	bool swapChainAdequate = false;
-	if (extensionsSupported)
+	bool swapChainAdequate = headless;
+	if (extensionsSupported && !headless)
 	{
 		VulkanHelper::SwapChainSupportDetails swapChainSupport = VulkanHelper::QuerySwapChainSupport(device);
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -121,6 +161,23 @@ bool VulkanPhysicalDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 	return requiredExtensions.empty();
 }
 
+bool VulkanPhysicalDevice::IsExtensionAvailable(VkPhysicalDevice device, const char* extensionName) const
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extension : availableExtensions)
+	{
+		if (std::string(extensionName) == extension.extensionName)
+			return true;
+	}
+
+	return false;
+}
+
 bool VulkanHelper::QueueFamilyIndices::IsComplete() const
 {
 	return graphicsFamily.has_value() && presentFamily.has_value();
@@ -13,15 +13,30 @@ private:
 	VkPhysicalDevice physicalDevice = nullptr;
 
 	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	VkPhysicalDeviceFeatures supportedFeatures = {};
+	VkPhysicalDeviceProperties properties = {};
+	std::vector<const char*> enabledExtensions; // DEVICE_EXTENSIONS and the supported optional extensions
+	bool memoryBudgetSupported = false;
 
 public:
+	/// <param name="msaaSamples">Lowered to the highest count the device supports</param>
 	VulkanPhysicalDevice(VkSampleCountFlagBits msaaSamples);
 
 	VkSampleCountFlagBits GetMsaaSample() const;
+	VkSampleCountFlags GetUsableSampleCounts() const;
 	VkSampleCountFlagBits GetMaxUsableSampleCount() const;
 	VkPhysicalDevice GetVk() const;
+	VkPhysicalDeviceFeatures GetSupportedFeatures() const;
+	const VkPhysicalDeviceProperties& GetProperties() const;
+	const std::vector<const char*>& GetEnabledExtensions() const;
+
+	/// <summary>
+	/// VK_EXT_memory_budget is enabled, the driver report the memory usage and budget of each heap.
+	/// </summary>
+	bool IsMemoryBudgetSupported() const;
 
 private:
 	bool IsDeviceSuitable(VkPhysicalDevice device);
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice device) const;
+	bool IsExtensionAvailable(VkPhysicalDevice device, const char* extensionName) const;
 };
\ No newline at end of file
@@ -0,0 +1,630 @@
+#include "Rendering/Vulkan/VulkanRenderGraph.h"
+
+#include "Helper/Log.h"
+#include "VulkanRenderer.h"
+#include "Rendering/Vulkan/VulkanHelper.h"
+#include "Rendering/Vulkan/VulkanGpuProfiler.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+namespace
+{
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	bool IsAttachment(VulkanRenderGraph::ResourceUsage usage)
+	{
+		return usage == VulkanRenderGraph::ResourceUsage::COLOR_ATTACHMENT || usage == VulkanRenderGraph::ResourceUsage::DEPTH_ATTACHMENT;
+	}
+}
+
+bool VulkanRenderGraph::ImageDescription::operator==(const ImageDescription& other) const
+{
+	return extent.width == other.extent.width && extent.height == other.extent.height && format == other.format
+		&& usage == other.usage && samples == other.samples && aspect == other.aspect && mipLevels == other.mipLevels;
+}
+
+VulkanRenderGraph::~VulkanRenderGraph()
+{
+	DestroyTransientImages();
+}
+
+void VulkanRenderGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+	exports.clear();
+	exportBarrier = {};
+}
+
+uint32_t VulkanRenderGraph::ImportImage(const std::string& name, VkImage image, VkImageAspectFlags aspect, VkImageLayout layout, uint32_t layerCount)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.image = image;
+	resource.aspect = aspect;
+	resource.layerCount = layerCount;
+	resource.initialState.layout = layout;
+	CarryState(resource);
+
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t VulkanRenderGraph::ImportBuffer(const std::string& name)
+{
+	Resource resource;
+	resource.name = name;
+	CarryState(resource);
+
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t VulkanRenderGraph::CreateImage(const std::string& name, const ImageDescription& description)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.transient = true;
+	resource.aspect = description.aspect;
+	resource.description = description;
+
+	// The transient images keep their order between frames so the allocation can be reused
+	for (const Resource& other : resources)
+	{
+		if (other.transient)
+			resource.transientIndex++;
+	}
+
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t VulkanRenderGraph::AddPass(const std::string& name, const std::function<void(VkCommandBuffer)>& record)
+{
+	Pass pass;
+	pass.name = name;
+	pass.record = record;
+
+	passes.push_back(pass);
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void VulkanRenderGraph::Read(uint32_t pass, uint32_t resource, ResourceUsage usage)
+{
+	passes[pass].accesses.push_back({resource, usage, false, VK_IMAGE_LAYOUT_UNDEFINED});
+}
+
+void VulkanRenderGraph::Write(uint32_t pass, uint32_t resource, ResourceUsage usage, VkImageLayout finalLayout)
+{
+	passes[pass].accesses.push_back({resource, usage, true, finalLayout});
+}
+
+void VulkanRenderGraph::SetSideEffect(uint32_t pass)
+{
+	passes[pass].sideEffect = true;
+}
+
+void VulkanRenderGraph::Export(uint32_t resource, ResourceUsage usage)
+{
+	exports.push_back({resource, usage, false, VK_IMAGE_LAYOUT_UNDEFINED});
+}
+
+void VulkanRenderGraph::Compile()
+{
+	CullPasses();
+	AllocateTransientImages();
+	ComputeBarriers();
+}
+
+void VulkanRenderGraph::Execute(VkCommandBuffer commandBuffer, VulkanGpuProfiler* profiler, uint32_t i)
+{
+	barrierCount = 0;
+
+	if (profiler != nullptr)
+		profiler->CmdBegin(commandBuffer, i);
+
+	for (const Pass& pass : passes)
+	{
+		if (pass.culled)
+			continue;
+
+		bool measured = profiler != nullptr && profiler->CmdBeginPass(commandBuffer, i, pass.name);
+
+		CmdBarrier(commandBuffer, pass.barrier);
+		pass.record(commandBuffer);
+
+		if (measured)
+			profiler->CmdEndPass(commandBuffer, i);
+	}
+
+	CmdBarrier(commandBuffer, exportBarrier);
+}
+
+VkImage VulkanRenderGraph::GetImage(uint32_t resource) const
+{
+	const Resource& r = resources[resource];
+	return r.transient ? transientImages[r.transientIndex].image : r.image;
+}
+
+VkImageView VulkanRenderGraph::GetImageView(uint32_t resource) const
+{
+	const Resource& r = resources[resource];
+	return r.transient ? transientImages[r.transientIndex].view : nullptr;
+}
+
+const std::vector<VkImageView>& VulkanRenderGraph::GetImageMipViews(uint32_t resource) const
+{
+	static const std::vector<VkImageView> noMipViews;
+
+	const Resource& r = resources[resource];
+	return r.transient ? transientImages[r.transientIndex].mipViews : noMipViews;
+}
+
+uint32_t VulkanRenderGraph::GetPassCount() const
+{
+	return static_cast<uint32_t>(passes.size());
+}
+
+uint32_t VulkanRenderGraph::GetCulledPassCount() const
+{
+	return culledPassCount;
+}
+
+uint32_t VulkanRenderGraph::GetBarrierCount() const
+{
+	return barrierCount;
+}
+
+VkDeviceSize VulkanRenderGraph::GetTransientMemorySize() const
+{
+	VkDeviceSize size = 0;
+	for (const MemoryBlock& block : memoryBlocks)
+		size += block.requirements.size;
+
+	return size;
+}
+
+VkDeviceSize VulkanRenderGraph::GetTransientRequestedSize() const
+{
+	VkDeviceSize size = 0;
+	for (const TransientImage& transientImage : transientImages)
+		size += transientImage.size;
+
+	return size;
+}
+
+VulkanRenderGraph::UsageInfo VulkanRenderGraph::GetUsageInfo(ResourceUsage usage)
+{
+	switch (usage)
+	{
+		case ResourceUsage::COMPUTE_READ:
+			return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+		case ResourceUsage::COMPUTE_WRITE:
+			return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+		case ResourceUsage::COMPUTE_SAMPLED:
+			return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+		case ResourceUsage::COMPUTE_DEPTH_SAMPLED:
+			return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false};
+		case ResourceUsage::FRAGMENT_READ:
+			return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+		case ResourceUsage::FRAGMENT_SAMPLED:
+			return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+		case ResourceUsage::FRAGMENT_DEPTH_SAMPLED:
+			return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false};
+		case ResourceUsage::INDIRECT_READ:
+			return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+		case ResourceUsage::COLOR_ATTACHMENT:
+			return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+		case ResourceUsage::DEPTH_ATTACHMENT:
+			return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true};
+		case ResourceUsage::TRANSFER_READ:
+			return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+		case ResourceUsage::TRANSFER_WRITE:
+			return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+		case ResourceUsage::HOST_READ:
+			return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+		default:
+			return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false};
+	}
+}
+
+void VulkanRenderGraph::CullPasses()
+{
+	// Walk back from the exported resources, a pass is kept when a kept pass reads what it writes
+	std::vector<bool> needed(resources.size(), false);
+	for (const Access& access : exports)
+		needed[access.resource] = true;
+
+	culledPassCount = 0;
+	for (size_t p = passes.size(); p-- > 0;)
+	{
+		Pass& pass = passes[p];
+
+		pass.culled = !pass.sideEffect;
+		for (const Access& access : pass.accesses)
+		{
+			if (access.write && needed[access.resource])
+				pass.culled = false;
+		}
+
+		if (pass.culled)
+		{
+			culledPassCount++;
+			continue;
+		}
+
+		// Attachments are loaded so the previous writes are needed too
+		for (const Access& access : pass.accesses)
+		{
+			if (!access.write || IsAttachment(access.usage))
+				needed[access.resource] = true;
+		}
+	}
+}
+
+void VulkanRenderGraph::AllocateTransientImages()
+{
+	std::vector<TransientImage> images;
+
+	for (uint32_t r = 0; r < resources.size(); r++)
+	{
+		if (!resources[r].transient)
+			continue;
+
+		TransientImage transientImage;
+		transientImage.description = resources[r].description;
+		transientImage.firstPass = UINT32_MAX;
+		for (uint32_t p = 0; p < passes.size(); p++)
+		{
+			if (passes[p].culled)
+				continue;
+
+			for (const Access& access : passes[p].accesses)
+			{
+				if (access.resource == r)
+				{
+					transientImage.firstPass = std::min(transientImage.firstPass, p);
+					transientImage.lastPass = std::max(transientImage.lastPass, p);
+				}
+			}
+		}
+
+		images.push_back(transientImage);
+	}
+
+	// Same images with the same lifetimes as the last frame
+	bool changed = images.size() != transientImages.size();
+	for (size_t t = 0; t < images.size() && !changed; t++)
+	{
+		changed = !(images[t].description == transientImages[t].description)
+			|| images[t].firstPass != transientImages[t].firstPass || images[t].lastPass != transientImages[t].lastPass;
+	}
+
+	if (!changed)
+		return;
+
+	DestroyTransientImages();
+	transientImages = images;
+
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	std::vector<VkMemoryRequirements> requirements(transientImages.size());
+	for (size_t t = 0; t < transientImages.size(); t++)
+	{
+		TransientImage& transientImage = transientImages[t];
+
+		// Not used by a kept pass, it only keeps its place in the order
+		if (transientImage.firstPass == UINT32_MAX)
+			continue;
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = transientImage.description.extent.width;
+		imageInfo.extent.height = transientImage.description.extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = transientImage.description.mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = transientImage.description.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = transientImage.description.usage;
+		imageInfo.samples = transientImage.description.samples;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &transientImage.image) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to create render graph transient image!");
+		}
+
+		vkGetImageMemoryRequirements(device, transientImage.image, &requirements[t]);
+		transientImage.size = requirements[t].size;
+	}
+
+	// Biggest images first, each one goes in the first block whose images are never alive at the same time
+	std::vector<uint32_t> order(transientImages.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+	for (uint32_t t : order)
+	{
+		TransientImage& transientImage = transientImages[t];
+		if (transientImage.image == nullptr)
+			continue;
+
+		// Lazily allocated images only share their memory with each other
+		bool lazy = (transientImage.description.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+			&& VulkanHelper::HasMemoryType(requirements[t].memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+		uint32_t blockIndex = static_cast<uint32_t>(memoryBlocks.size());
+		for (uint32_t b = 0; b < memoryBlocks.size(); b++)
+		{
+			if (memoryBlocks[b].lazy != lazy || (memoryBlocks[b].requirements.memoryTypeBits & requirements[t].memoryTypeBits) == 0)
+				continue;
+
+			bool overlap = false;
+			for (uint32_t other : memoryBlocks[b].images)
+			{
+				if (transientImage.firstPass <= transientImages[other].lastPass && transientImages[other].firstPass <= transientImage.lastPass)
+					overlap = true;
+			}
+
+			if (!overlap)
+			{
+				blockIndex = b;
+				break;
+			}
+		}
+
+		if (blockIndex == memoryBlocks.size())
+		{
+			MemoryBlock block;
+			block.requirements = requirements[t];
+			block.lazy = lazy;
+			memoryBlocks.push_back(block);
+		}
+		else
+		{
+			VkMemoryRequirements& blockRequirements = memoryBlocks[blockIndex].requirements;
+			blockRequirements.size = std::max(blockRequirements.size, requirements[t].size);
+			blockRequirements.alignment = std::max(blockRequirements.alignment, requirements[t].alignment);
+			blockRequirements.memoryTypeBits &= requirements[t].memoryTypeBits;
+		}
+
+		memoryBlocks[blockIndex].images.push_back(t);
+		transientImage.block = blockIndex;
+	}
+
+	for (MemoryBlock& block : memoryBlocks)
+	{
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		if (block.lazy)
+			properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		VulkanHelper::AllocateMemory(block.requirements, properties, MemoryCategory::ATTACHMENT, block.memory);
+
+		for (uint32_t t : block.images)
+		{
+			TransientImage& transientImage = transientImages[t];
+			const ImageDescription& description = transientImage.description;
+			vkBindImageMemory(device, transientImage.image, block.memory, 0);
+
+			// Sampled depth views can only have one aspect, the framebuffers accept a depth only view too
+			VkImageAspectFlags viewAspect = (description.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : description.aspect;
+			transientImage.view = VulkanHelper::CreateImageView(transientImage.image, description.format, viewAspect, description.mipLevels);
+
+			for (uint32_t mip = 0; mip < description.mipLevels && description.mipLevels > 1; mip++)
+				transientImage.mipViews.push_back(VulkanHelper::CreateImageView(transientImage.image, description.format, viewAspect, 1, mip));
+		}
+	}
+
+	Logger::Log("Render graph transient images: " + std::to_string(GetTransientMemorySize() / 1024) + " KB in " + std::to_string(memoryBlocks.size())
+		+ " blocks, " + std::to_string(GetTransientRequestedSize() / 1024) + " KB without aliasing");
+}
+
+void VulkanRenderGraph::DestroyTransientImages()
+{
+	if (transientImages.empty() && memoryBlocks.empty())
+		return;
+
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+
+	// The command buffers of the last frame may still use them
+	vkDeviceWaitIdle(device);
+
+	for (TransientImage& transientImage : transientImages)
+	{
+		for (VkImageView mipView : transientImage.mipViews)
+			vkDestroyImageView(device, mipView, nullptr);
+		if (transientImage.view != nullptr)
+			vkDestroyImageView(device, transientImage.view, nullptr);
+		if (transientImage.image != nullptr)
+			vkDestroyImage(device, transientImage.image, nullptr);
+	}
+
+	for (MemoryBlock& block : memoryBlocks)
+		VulkanHelper::FreeMemory(device, block.memory);
+
+	transientImages.clear();
+	memoryBlocks.clear();
+}
+
+void VulkanRenderGraph::ComputeBarriers()
+{
+	std::vector<State> states(resources.size());
+	for (size_t r = 0; r < resources.size(); r++)
+		states[r] = resources[r].initialState;
+
+	// The memory blocks keep the accesses of the last frame, its images may still be in use when this one starts
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		pass.barrier = {};
+		if (pass.culled)
+			continue;
+
+		// Every access is compared to the state before the pass, the hazards inside a pass are its own
+		for (const Access& access : pass.accesses)
+			AddAccessBarrier(access, p, states, pass.barrier);
+
+		for (const Access& access : pass.accesses)
+			UpdateState(access, states);
+	}
+
+	exportBarrier = {};
+	for (const Access& access : exports)
+		AddAccessBarrier(access, static_cast<uint32_t>(passes.size()), states, exportBarrier);
+
+	for (size_t r = 0; r < resources.size(); r++)
+	{
+		if (!resources[r].transient)
+			importedStates[resources[r].name] = {resources[r].image, states[r]};
+	}
+}
+
+void VulkanRenderGraph::CarryState(Resource& resource)
+{
+	auto imported = importedStates.find(resource.name);
+	if (imported == importedStates.end() || imported->second.image != resource.image)
+		return;
+
+	// The layout is the one given by the caller, nothing is visible to this command buffer yet
+	const State& last = imported->second.state;
+	resource.initialState.writeStages = last.writeStages;
+	resource.initialState.writeAccess = last.writeAccess;
+	resource.initialState.readStages = last.readStages;
+	resource.initialState.visibleStages = 0;
+}
+
+void VulkanRenderGraph::AddAccessBarrier(const Access& access, uint32_t pass, std::vector<State>& states, Barrier& barrier)
+{
+	const Resource& resource = resources[access.resource];
+	const State& state = states[access.resource];
+	UsageInfo info = GetUsageInfo(access.usage);
+
+	VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+	VkAccessFlags srcAccess = state.writeAccess;
+
+	// The image takes the memory of the previous image of its block
+	bool firstUse = IsFirstUse(access.resource, pass);
+	if (firstUse)
+	{
+		MemoryBlock& block = memoryBlocks[transientImages[resource.transientIndex].block];
+		srcStages |= block.lastStages;
+		srcAccess |= block.lastWriteAccess;
+		block.lastStages = 0;
+		block.lastWriteAccess = 0;
+	}
+
+	bool transition = resource.isImage && access.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED && info.layout != VK_IMAGE_LAYOUT_UNDEFINED
+		&& (info.layout != state.layout || firstUse);
+
+	if (transition)
+	{
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.oldLayout = firstUse ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+		imageBarrier.newLayout = info.layout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = GetImage(access.resource);
+		imageBarrier.subresourceRange.aspectMask = resource.aspect;
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = resource.layerCount;
+		imageBarrier.srcAccessMask = srcAccess;
+		imageBarrier.dstAccessMask = info.access;
+
+		barrier.images.push_back(imageBarrier);
+		barrier.srcStage |= srcStages;
+		barrier.dstStage |= info.stage;
+		return;
+	}
+
+	if (info.write || access.write)
+	{
+		// Write after read only needs an execution dependency, write after write also the memory
+		if (srcStages == 0)
+			return;
+
+		barrier.srcStage |= srcStages;
+		barrier.dstStage |= info.stage;
+		if (srcAccess != 0)
+		{
+			barrier.memory.srcAccessMask |= srcAccess;
+			barrier.memory.dstAccessMask |= info.access;
+		}
+		return;
+	}
+
+	// Reads without memory access, like the presentation, are synchronized by semaphores.
+	// Reads from a stage the last write is already visible to need nothing
+	if (info.access == 0 || state.writeAccess == 0 || (info.stage & ~state.visibleStages) == 0)
+		return;
+
+	barrier.srcStage |= state.writeStages;
+	barrier.dstStage |= info.stage;
+	barrier.memory.srcAccessMask |= state.writeAccess;
+	barrier.memory.dstAccessMask |= info.access;
+}
+
+void VulkanRenderGraph::UpdateState(const Access& access, std::vector<State>& states)
+{
+	const Resource& resource = resources[access.resource];
+	State& state = states[access.resource];
+	UsageInfo info = GetUsageInfo(access.usage);
+
+	if (resource.isImage && info.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		state.layout = access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? access.finalLayout : info.layout;
+
+	if (info.write || access.write)
+	{
+		state.writeStages = info.stage;
+		state.writeAccess = info.access & WRITE_ACCESS;
+		state.readStages = 0;
+		state.visibleStages = 0;
+	}
+	else
+	{
+		state.readStages |= info.stage;
+		state.visibleStages |= info.stage;
+	}
+
+	if (resource.transient)
+	{
+		MemoryBlock& block = memoryBlocks[transientImages[resource.transientIndex].block];
+		block.lastStages |= info.stage;
+		block.lastWriteAccess |= info.access & WRITE_ACCESS;
+	}
+}
+
+bool VulkanRenderGraph::IsFirstUse(uint32_t resource, uint32_t pass) const
+{
+	const Resource& r = resources[resource];
+	return r.transient && transientImages[r.transientIndex].firstPass == pass;
+}
+
+void VulkanRenderGraph::CmdBarrier(VkCommandBuffer commandBuffer, const Barrier& barrier)
+{
+	if (barrier.dstStage == 0)
+		return;
+
+	VkMemoryBarrier memoryBarrier = barrier.memory;
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	bool hasMemoryBarrier = memoryBarrier.srcAccessMask != 0 || memoryBarrier.dstAccessMask != 0;
+
+	// Nothing to wait for, only the layout transitions
+	VkPipelineStageFlags srcStage = barrier.srcStage != 0 ? barrier.srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, barrier.dstStage, 0,
+		hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(barrier.images.size()), barrier.images.data());
+
+	barrierCount++;
+}
\ No newline at end of file
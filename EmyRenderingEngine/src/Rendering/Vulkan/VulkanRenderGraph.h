@@ -0,0 +1,246 @@
+#pragma once
+#include "Header/GLFWHeader.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+
+class VulkanGpuProfiler;
+
+/// <summary>
+/// Frame graph recording the passes of a command buffer.
+/// Passes declare the resources they read and write, Compile then culls the passes nothing depends on,
+/// computes one batched pipeline barrier per pass and places the transient images whose lifetimes don't overlap in the same memory.
+/// Barriers between the commands of a same pass stay in the pass.
+/// The imported resources start from the accesses the last frame ended with, the previous frame may still be in flight.
+/// </summary>
+class VulkanRenderGraph
+{
+public:
+	enum class ResourceUsage
+	{
+		COMPUTE_READ, // Storage buffer or image
+		COMPUTE_WRITE,
+		COMPUTE_SAMPLED,
+		COMPUTE_DEPTH_SAMPLED,
+		FRAGMENT_READ,
+		FRAGMENT_SAMPLED,
+		FRAGMENT_DEPTH_SAMPLED,
+		INDIRECT_READ,
+		COLOR_ATTACHMENT,
+		DEPTH_ATTACHMENT,
+		TRANSFER_READ,
+		TRANSFER_WRITE,
+		HOST_READ,
+		PRESENT
+	};
+
+	struct ImageDescription
+	{
+		VkExtent2D extent = {};
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkImageUsageFlags usage = 0;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		uint32_t mipLevels = 1;
+
+		bool operator==(const ImageDescription& other) const;
+	};
+
+private:
+	struct UsageInfo
+	{
+		VkPipelineStageFlags stage;
+		VkAccessFlags access;
+		VkImageLayout layout; // Undefined for the usages of buffers
+		bool write;
+	};
+
+	// Synchronization state of a resource while the barriers are computed
+	struct State
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags readStages = 0; // Since the last write
+		VkPipelineStageFlags visibleStages = 0; // Stages the last write was made visible to
+	};
+
+	struct Resource
+	{
+		std::string name;
+		bool isImage = false;
+		bool transient = false;
+		VkImage image = nullptr;
+		VkImageAspectFlags aspect = 0;
+		uint32_t layerCount = 1;
+		State initialState;
+		ImageDescription description; // Transient images only
+		uint32_t transientIndex = 0;
+	};
+
+	struct Access
+	{
+		uint32_t resource;
+		ResourceUsage usage;
+		bool write;
+		VkImageLayout finalLayout; // Set when the pass transitions the image itself
+	};
+
+	struct Barrier
+	{
+		VkPipelineStageFlags srcStage = 0;
+		VkPipelineStageFlags dstStage = 0;
+		VkMemoryBarrier memory = {};
+		std::vector<VkImageMemoryBarrier> images;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::function<void(VkCommandBuffer)> record;
+		std::vector<Access> accesses;
+		bool sideEffect = false;
+		bool culled = false;
+		Barrier barrier;
+	};
+
+	struct TransientImage
+	{
+		ImageDescription description;
+		uint32_t firstPass = 0;
+		uint32_t lastPass = 0;
+		VkImage image = nullptr;
+		VkImageView view = nullptr; // Every mip, the depth aspect only for a depth stencil format
+		std::vector<VkImageView> mipViews; // One mip each, empty with a single mip
+		VkDeviceSize size = 0;
+		uint32_t block = 0;
+	};
+
+	// Memory shared by the transient images whose lifetimes don't overlap
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory = nullptr;
+		VkMemoryRequirements requirements = {};
+		bool lazy = false; // Transient attachments in lazily allocated memory, they may never be backed by memory
+		std::vector<uint32_t> images;
+		// Accesses of the last image using the block, the next one waits for them even in the next frame
+		VkPipelineStageFlags lastStages = 0;
+		VkAccessFlags lastWriteAccess = 0;
+	};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<Access> exports;
+	Barrier exportBarrier;
+
+	// Kept between frames, recreated when the transient images or their lifetimes change
+	std::vector<TransientImage> transientImages;
+	std::vector<MemoryBlock> memoryBlocks;
+
+	// State of the imported resources after the last compiled frame, by name
+	struct ImportedState
+	{
+		VkImage image = nullptr;
+		State state;
+	};
+	std::unordered_map<std::string, ImportedState> importedStates;
+
+	uint32_t culledPassCount = 0;
+	uint32_t barrierCount = 0;
+
+public:
+	~VulkanRenderGraph();
+
+	/// <summary>
+	/// Remove the passes and resources to declare the next frame. The transient memory is kept.
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Image living between frames. The first access waits for the last access of the previous frame to the same image.
+	/// </summary>
+	/// <param name="layout">Layout of the image when the command buffer starts</param>
+	uint32_t ImportImage(const std::string& name, VkImage image, VkImageAspectFlags aspect, VkImageLayout layout, uint32_t layerCount = 1);
+
+	/// <summary>
+	/// Buffer living between frames. The first access waits for the last access of the previous frame to the same name.
+	/// </summary>
+	uint32_t ImportBuffer(const std::string& name);
+
+	/// <summary>
+	/// Image only living during the frame, its memory can be shared with the other transient images.
+	/// Its content isn't kept between frames. It is only recreated, with new views, after waiting for the device to be idle.
+	/// Images with the transient attachment usage go in lazily allocated memory when there is some.
+	/// </summary>
+	uint32_t CreateImage(const std::string& name, const ImageDescription& description);
+
+	uint32_t AddPass(const std::string& name, const std::function<void(VkCommandBuffer)>& record);
+
+	void Read(uint32_t pass, uint32_t resource, ResourceUsage usage);
+
+	/// <param name="finalLayout">Layout the render pass of the pass leaves the image in.
+	/// The render pass then does the layout transitions and the graph only waits for the previous accesses.</param>
+	void Write(uint32_t pass, uint32_t resource, ResourceUsage usage, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	/// <summary>
+	/// The pass is never culled, even when nothing reads what it writes.
+	/// </summary>
+	void SetSideEffect(uint32_t pass);
+
+	/// <summary>
+	/// The resource is used after the command buffer, the passes writing it are kept and it is synchronized with this usage at the end.
+	/// </summary>
+	void Export(uint32_t resource, ResourceUsage usage);
+
+	void Compile();
+
+	/// <summary>
+	/// Record the passes that weren't culled with their barriers.
+	/// </summary>
+	/// <param name="profiler">Measure each pass with its barrier, its queries are the ones of the command buffer i</param>
+	void Execute(VkCommandBuffer commandBuffer, VulkanGpuProfiler* profiler = nullptr, uint32_t i = 0);
+
+	/// <summary>
+	/// Transient image, valid after Compile.
+	/// </summary>
+	VkImage GetImage(uint32_t resource) const;
+	VkImageView GetImageView(uint32_t resource) const;
+	const std::vector<VkImageView>& GetImageMipViews(uint32_t resource) const;
+
+	uint32_t GetPassCount() const;
+	uint32_t GetCulledPassCount() const;
+
+	/// <summary>
+	/// Pipeline barriers recorded by the last Execute.
+	/// </summary>
+	uint32_t GetBarrierCount() const;
+
+	/// <summary>
+	/// Memory allocated for the transient images, and what they would use without aliasing.
+	/// </summary>
+	VkDeviceSize GetTransientMemorySize() const;
+	VkDeviceSize GetTransientRequestedSize() const;
+
+private:
+	static UsageInfo GetUsageInfo(ResourceUsage usage);
+
+	void CullPasses();
+	void AllocateTransientImages();
+	void DestroyTransientImages();
+	void ComputeBarriers();
+
+	/// <summary>
+	/// Start the resource from the accesses the previous frame left on it, they are on the same queue but may still run.
+	/// </summary>
+	void CarryState(Resource& resource);
+
+	/// <summary>
+	/// Add to the barrier what the access needs against the state of the resource before the pass.
+	/// </summary>
+	void AddAccessBarrier(const Access& access, uint32_t pass, std::vector<State>& states, Barrier& barrier);
+	void UpdateState(const Access& access, std::vector<State>& states);
+	bool IsFirstUse(uint32_t resource, uint32_t pass) const;
+	void CmdBarrier(VkCommandBuffer commandBuffer, const Barrier& barrier);
+};
\ No newline at end of file
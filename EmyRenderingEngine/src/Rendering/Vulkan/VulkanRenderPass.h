@@ -7,10 +7,28 @@ class VulkanRenderPass
 {
 private:
 	VkRenderPass renderPass = nullptr;
+	bool depthResolved = false;
 
 public:
-	VulkanRenderPass();
+	enum class Target
+	{
+		SCENE, // Color and depth attachments of the render graph, the color ends in the scene color to be upscaled
+		PRESENT // Swapchain image only, for the upscale and the UI at native resolution. Left ready to be copied in headless mode
+	};
+
+	/// <param name="loadAttachments">Keep what a previous render pass drew instead of clearing, in single sample attachments</param>
+	/// <param name="storeAttachments">Keep the depth for a following render pass, otherwise it is discarded.
+	/// With MSAA the samples are discarded either way, a second subpass resolves the depth to a single sample attachment</param>
+	VulkanRenderPass(Target target = Target::SCENE, bool loadAttachments = false, bool storeAttachments = false);
 	~VulkanRenderPass();
 
 	VkRenderPass GetVk() const;
+
+	/// <summary>
+	/// True when the multisampled depth is resolved in a second subpass, attachment 3 then holds its farthest sample.
+	/// </summary>
+	bool IsDepthResolved() const;
+
+private:
+	void CreatePresent(VkFormat format);
 };
\ No newline at end of file
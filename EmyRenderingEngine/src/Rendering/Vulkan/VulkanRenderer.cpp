@@ -1,6 +1,9 @@
 #include "VulkanRenderer.h"
 
 #include "Helper/Log.h"
+#include "Game/Setting.h"
+#include "Helper/Profiler.h"
+#include "Helper/PerfCounters.h"
 
 #include "Rendering/Vulkan/VulkanHelper.h"
 #include <glm/gtc/matrix_transform.hpp>
@@ -9,6 +12,8 @@
 
 #include <chrono>
 #include <algorithm>
+#include <filesystem>
+#include <stb_image_write.h>
 #include <Rendering\Vulkan\ImguiVulkan.h>
 
 VulkanRenderer* VulkanRenderer::instance = nullptr;
@@ -23,16 +28,24 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* window) : Renderer(window)
 
 	Logger::Log("Start creating vulkan state");
 
-	vulkanInstance = std::unique_ptr<VulkanInstance>(new VulkanInstance(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT));
+	vulkanInstance = std::unique_ptr<VulkanInstance>(new VulkanInstance(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, IsHeadless()));
 
-	Logger::Log("Creating surface");
-	if (glfwCreateWindowSurface(vulkanInstance->GetVk(), window, nullptr, &surface) != VK_SUCCESS)
+	if (IsHeadless())
 	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create window surface!");
+		Logger::Log("Headless, rendering offscreen without surface");
+	}
+	else
+	{
+		Logger::Log("Creating surface");
+		if (glfwCreateWindowSurface(vulkanInstance->GetVk(), window, nullptr, &surface) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to create window surface!");
+		}
 	}
 
-	physicalDevice = std::unique_ptr<VulkanPhysicalDevice>(new VulkanPhysicalDevice(VkSampleCountFlagBits::VK_SAMPLE_COUNT_8_BIT));
-	logicalDevice = std::unique_ptr<VulkanLogicalDevice>(new VulkanLogicalDevice());
+	physicalDevice = std::unique_ptr<VulkanPhysicalDevice>(new VulkanPhysicalDevice(static_cast<VkSampleCountFlagBits>(Setting::Get("MsaaSamples", 8))));
+	logicalDevice = std::unique_ptr<VulkanLogicalDevice>(new VulkanLogicalDevice(Setting::Get("AsyncCompute", true)));
+	memoryTracker = std::unique_ptr<VulkanMemoryTracker>(new VulkanMemoryTracker());
 
 	Logger::Log("Creating globalCommandPool");
 	VulkanHelper::QueueFamilyIndices queueFamilyIndices = VulkanHelper::FindQueueFamilies();
@@ -44,9 +57,37 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* window) : Renderer(window)
 		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create graphics command pool!");
 	}
 
-	renderPass = std::unique_ptr<VulkanRenderPass>(new VulkanRenderPass());
+	// Created before any texture so they are loaded with their mip tail only
+	if (Setting::Get("TextureStreaming", true))
+	{
+		if (TextureStreamer::IsSupported())
+		{
+			VkDeviceSize textureBudget = static_cast<VkDeviceSize>(Setting::Get("TextureBudgetMB", 512)) * 1024 * 1024;
+			VkDeviceSize textureBytesPerFrame = static_cast<VkDeviceSize>(Setting::Get("TextureStreamingMBPerFrame", 8)) * 1024 * 1024;
+			textureStreamer = std::unique_ptr<TextureStreamer>(new TextureStreamer(textureBudget, textureBytesPerFrame));
+		}
+		else
+			Logger::Log(LogSeverity::WARNING, "No sparse residency for the textures, every mip stays resident");
+	}
+
+	// The occlusion culling build its Hi-Z from the depth of the first render pass, resolved to single sample with MSAA, the second one loads it
+	occlusionCulling = Setting::Get("OcclusionCulling", true);
+	renderPass = std::unique_ptr<VulkanRenderPass>(new VulkanRenderPass(VulkanRenderPass::Target::SCENE, false, occlusionCulling));
+	if (occlusionCulling)
+		loadRenderPass = std::unique_ptr<VulkanRenderPass>(new VulkanRenderPass(VulkanRenderPass::Target::SCENE, true));
+	presentRenderPass = std::unique_ptr<VulkanRenderPass>(new VulkanRenderPass(VulkanRenderPass::Target::PRESENT));
 	swapChain = std::unique_ptr<VulkanSwapChain>(new VulkanSwapChain(window));
 
+	// The scene resolution follows its GPU time, the UI stays at the swapchain resolution
+	Logger::Log("Creating dynamic resolution");
+	dynamicResolution = std::unique_ptr<VulkanDynamicResolution>(new VulkanDynamicResolution(Setting::Get("DynamicResolution", true), Setting::Get("DynamicResolutionBudgetMs", 14.0f), Setting::Get("DynamicResolutionMinScale", 0.5f)));
+
+	// Low resolution depth buffer with the aspect of the swapchain
+	softwareOcclusionCulling = Setting::Get("SoftwareOcclusionCulling", false);
+	uint32_t softwareOcclusionWidth = Setting::Get("SoftwareOcclusionWidth", 256);
+	uint32_t softwareOcclusionHeight = std::max(softwareOcclusionWidth * swapChain->GetVkExtent2D().height / swapChain->GetVkExtent2D().width, 1u);
+	softwareOcclusion = std::unique_ptr<SoftwareOcclusion>(new SoftwareOcclusion(softwareOcclusionWidth, softwareOcclusionHeight, Setting::Get("SoftwareOcclusionThreads", 0)));
+
 	Logger::Log("Creating drawCommandPools");
 	drawCommandPool.resize(swapChain->GetSwapChainFramebuffers().size());
 	for (size_t i = 0; i < swapChain->GetSwapChainFramebuffers().size(); i++)
@@ -57,7 +98,26 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* window) : Renderer(window)
 		}
 	}
 
-	imgui = std::unique_ptr<ImguiVulkan>(new ImguiVulkan(window, queueFamilyIndices.graphicsFamily.value()));
+	if (logicalDevice->HasAsyncCompute())
+	{
+		Logger::Log("Creating computeCommandPools");
+		VkCommandPoolCreateInfo computePoolInfo = {};
+		computePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		computePoolInfo.queueFamilyIndex = logicalDevice->GetComputeFamily();
+
+		computeCommandPool.resize(swapChain->GetSwapChainFramebuffers().size());
+		for (size_t i = 0; i < computeCommandPool.size(); i++)
+		{
+			if (vkCreateCommandPool(logicalDevice->GetVk(), &computePoolInfo, nullptr, &computeCommandPool[i]) != VK_SUCCESS)
+			{
+				Logger::Log(LogSeverity::FATAL_ERROR, "failed to create compute command pool!");
+			}
+		}
+	}
+
+	// The UI needs the GLFW window for its inputs
+	if (!IsHeadless())
+		imgui = std::unique_ptr<ImguiVulkan>(new ImguiVulkan(window, queueFamilyIndices.graphicsFamily.value()));
 
 	Logger::Log("Creating test shader");
 	// TestMesh and shader
@@ -65,17 +125,50 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* window) : Renderer(window)
 	baseFragShader = std::unique_ptr<VulkanShader>(new VulkanShader("BaseFrag", VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT));
 	textureColorFragShader = std::unique_ptr<VulkanShader>(new VulkanShader("TextureColorFrag", VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT));
 
+	Logger::Log("Creating clustered lighting");
+	clusteredLighting = std::unique_ptr<VulkanClusteredLighting>(new VulkanClusteredLighting(Setting::Get("MaxLights", 4096)));
+
+	Logger::Log("Creating cascaded shadows");
+	shadows = Setting::Get("Shadows", true);
+	cascadedShadows = std::unique_ptr<VulkanCascadedShadows>(new VulkanCascadedShadows(Setting::Get("ShadowCascades", 4), Setting::Get("ShadowMapSize", 2048), Setting::Get("ShadowDistance", 150.0f), Setting::Get("ShadowFirstCachedCascade", 2)));
+
+	renderGraph = std::unique_ptr<VulkanRenderGraph>(new VulkanRenderGraph());
+
+	Logger::Log("Creating GPU profiler");
+	gpuProfiler = std::unique_ptr<VulkanGpuProfiler>(new VulkanGpuProfiler(MAX_FRAMES_IN_FLIGHT, Setting::Get("GpuProfilerMaxPasses", 32), Setting::Get("GpuProfilerMaxBuckets", 64), Setting::Get("GpuProfilerStatistics", true)));
+
 	Logger::Log("Creating test GraphicPipeline");
 	basicGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
 	basicGraphicPipeline->AddShader(baseVertexShader.get());
 	basicGraphicPipeline->AddShader(baseFragShader.get());
+	basicGraphicPipeline->AddSetLayout(clusteredLighting->GetDescriptorSetLayout());
+	basicGraphicPipeline->AddSetLayout(cascadedShadows->GetDescriptorSetLayout());
 	basicGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL);
 
 	textureColorGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
 	textureColorGraphicPipeline->AddShader(baseVertexShader.get());
 	textureColorGraphicPipeline->AddShader(textureColorFragShader.get());
+	textureColorGraphicPipeline->AddSetLayout(clusteredLighting->GetDescriptorSetLayout());
+	textureColorGraphicPipeline->AddSetLayout(cascadedShadows->GetDescriptorSetLayout());
 	textureColorGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL);
 
+	Logger::Log("Creating depth prepass");
+	CreateDepthPrepass();
+
+	if (occlusionCulling && renderPass->IsDepthResolved())
+	{
+		Logger::Log("Creating second phase pipelines");
+		CreateSecondPhasePipelines();
+	}
+
+	Logger::Log("Creating meshlet culling");
+	CreateMeshletCulling();
+
+	if (occlusionCulling)
+	{
+		Logger::Log("Creating occlusion culling");
+		occlusionCullingPass = std::unique_ptr<VulkanOcclusionCulling>(new VulkanOcclusionCulling());
+	}
 
 	Logger::Log("Creating test skybox");
 	skyboxTexture = std::unique_ptr<Texture>(new Texture("Debug.jpg"));
@@ -83,6 +176,7 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* window) : Renderer(window)
 	skyboxMesh = std::unique_ptr<Mesh>(new Mesh("SkyBoxTest.obj", Mesh::MeshFormat::OBJ));
 	Model* testModel = new Model(skyboxMesh.get(), skyboxTexture.get(), debugNormalTexture.get(), textureColorGraphicPipeline.get());
 	testModel->position = glm::vec3(0);
+	testModel->castShadows = false;
 	AddModelToList(testModel);
 
 
@@ -99,16 +193,44 @@ VulkanRenderer::~VulkanRenderer()
 {
 	skyboxMesh.reset();
 	swapChain.reset();
-	modelList.clear();
-	vkDestroySurfaceKHR(vulkanInstance->GetVk(), surface, nullptr);
+	drawList.Clear();
+	if (surface != nullptr)
+		vkDestroySurfaceKHR(vulkanInstance->GetVk(), surface, nullptr);
+
+	for (size_t i = 0; i < indirectBuffers.size(); i++)
+	{
+		vkDestroyBuffer(logicalDevice->GetVk(), indirectBuffers[i], nullptr);
+		VulkanHelper::FreeMemory(logicalDevice->GetVk(), indirectBuffersMemory[i]);
+	}
+	if (sceneFramebuffer != nullptr)
+		vkDestroyFramebuffer(logicalDevice->GetVk(), sceneFramebuffer, nullptr);
+	if (secondPhaseFramebuffer != nullptr)
+		vkDestroyFramebuffer(logicalDevice->GetVk(), secondPhaseFramebuffer, nullptr);
+	renderGraph.reset();
+	dynamicResolution.reset();
+	occlusionCullingPass.reset();
+	cascadedShadows.reset();
+	clusteredLighting.reset();
+	meshletCullPipeline.reset();
+	meshletCullShader.reset();
 	baseVertexShader.reset();
 	baseFragShader.reset();
+	depthPrepassVertexShader.reset();
+	gpuProfiler.reset();
 
 	for (size_t i = 0; i < commandBuffers.size(); i++)
 	{
 		vkFreeCommandBuffers(logicalDevice->GetVk(), drawCommandPool[i], 1 , &commandBuffers[i]);
 	}
+	for (size_t i = 0; i < computeCommandBuffers.size(); i++)
+	{
+		vkFreeCommandBuffers(logicalDevice->GetVk(), computeCommandPool[i], 1, &computeCommandBuffers[i]);
+	}
 
+	for (size_t i = 0; i < computeFinishedSemaphores.size(); i++)
+	{
+		vkDestroySemaphore(logicalDevice->GetVk(), computeFinishedSemaphores[i], nullptr);
+	}
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		vkDestroySemaphore(logicalDevice->GetVk(), renderFinishedSemaphores[i], nullptr);
@@ -122,17 +244,23 @@ VulkanRenderer::~VulkanRenderer()
 	{
 		vkDestroyCommandPool(logicalDevice->GetVk(), drawCommandPool[i], nullptr);
 	}
+	for (size_t i = 0; i < computeCommandPool.size(); i++)
+	{
+		vkDestroyCommandPool(logicalDevice->GetVk(), computeCommandPool[i], nullptr);
+	}
 
 	for (size_t i = 0; i < meshList.size(); i++)
 	{
 		delete meshList[i];
 	}
 	meshList.clear();
+	loadedMeshes.clear();
 	for (size_t i = 0; i < textureList.size(); i++)
 	{
 		delete textureList[i];
 	}
 	textureList.clear();
+	loadedTextures.clear();
 
 	Logger::Log("Vulkan destroyed");
 }
@@ -158,114 +286,490 @@ VulkanRenderer::~VulkanRenderer()
 
 	basicGraphicPipeline->Create(logicalDevice->GetVk(), swapChain->GetVkExtent2D(), renderPass->GetVk(), physicalDevice->GetMsaaSample(), VkPolygonMode::VK_POLYGON_MODE_FILL);
 
-	//TODO: make a function for that
 	// Recreate stuff in model
-	auto graphicPipelineIterator = modelList.begin();
+	for (const auto& model : drawList.GetModels())
+		model->Recreate(swapChain->GetVkImages().size());
+
+	for (size_t i = 0; i < commandBuffers.size(); i++)
+	{
+		vkFreeCommandBuffers(logicalDevice->GetVk(), drawCommandPool[i], 1, &commandBuffers[i]);
+	}
+	CreateCommandBuffer();
+}*/
+
+void VulkanRenderer::Draw(uint32_t imageIndex)
+{
+	PROFILE_FUNCTION();
 
-	while (graphicPipelineIterator != modelList.end())
+	CullSoftwareOcclusion();
+	drawList.Sort(camPos, FAR_PLANE);
+
+	// Models visible last frame are drawn first, the others are tested against the Hi-Z of the first ones
+	bool occlusion = occlusionCulling && occlusionCullingPass != nullptr;
+	if (occlusion)
 	{
-		auto meshIterator = graphicPipelineIterator->second.begin();
+		occlusionModels.clear();
+		for (const DrawList::DrawPacket& packet : drawList.GetPackets())
+			occlusionModels.push_back(packet.model);
 
-		while (meshIterator != graphicPipelineIterator->second.end())
-		{
-			auto modelIterator = meshIterator->second.begin();
+		occlusionCullingPass->Prepare(occlusionModels, currentFrame);
+	}
+	else if (occlusionCullingPass != nullptr)
+		occlusionCullingPass->Reset();
 
-			while (modelIterator != meshIterator->second.end())
-			{
-				modelIterator->get()->Recreate(swapChain->GetVkImages().size());
+	// Only the image submitted this frame is recorded, Present waited for the frame that last used its buffers
+	size_t i = imageIndex;
 
-				modelIterator++;
-			}
+	// Recorded first, the main pass draws the indirect ranges the meshlet cull allocates
+	if (logicalDevice->HasAsyncCompute())
+		RecordCompute(i, occlusion);
 
-			meshIterator++;
-		}
+	vkResetCommandPool(logicalDevice->GetVk(), drawCommandPool[i], 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		graphicPipelineIterator++;
+	if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to begin recording command buffer!");
 	}
 
-	for (size_t i = 0; i < commandBuffers.size(); i++)
+	// The queries belong to the frame in flight, they are read when its fence is waited again
+	dynamicResolution->CmdBeginScene(commandBuffers[i], static_cast<uint32_t>(currentFrame));
+
+	BuildRenderGraph(i, occlusion);
+	renderGraph->Execute(commandBuffers[i], gpuProfiler.get(), static_cast<uint32_t>(currentFrame));
+
+	if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
 	{
-		vkFreeCommandBuffers(logicalDevice->GetVk(), drawCommandPool[i], 1, &commandBuffers[i]);
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to record command buffer!");
 	}
-	CreateCommandBuffer();
-}*/
+}
 
-void VulkanRenderer::Draw()
+void VulkanRenderer::BuildRenderGraph(size_t i, bool occlusion)
 {
-	for (size_t i = 0; i < commandBuffers.size(); i++)
+	PROFILE_FUNCTION();
+
+	renderGraph->Reset();
+
+	VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (VulkanHelper::HasStencilComponent(VulkanHelper::FindDepthFormat()))
+		depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+	// Layouts the previous frame left the images in
+	uint32_t backbuffer = renderGraph->ImportImage("Backbuffer", swapChain->GetVkImages()[i], VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+	uint32_t shadowMap = renderGraph->ImportImage("Shadow map", cascadedShadows->GetShadowImage(), VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, cascadedShadows->GetCascadeCount());
+	uint32_t clusterLights = renderGraph->ImportBuffer("Cluster lights");
+	uint32_t meshletDraws = renderGraph->ImportBuffer("Meshlet draws");
+
+	// The scene attachments only live during the frame, the graph shares the memory of those whose passes don't overlap
+	VkSampleCountFlagBits msaaSamples = physicalDevice->GetMsaaSample();
+	bool msaa = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+	bool resolveDepth = occlusion && renderPass->IsDepthResolved();
+
+	VulkanRenderGraph::ImageDescription sceneColorDescription;
+	sceneColorDescription.extent = swapChain->GetVkExtent2D();
+	sceneColorDescription.format = swapChain->GetSwapChainImageFormat();
+	sceneColorDescription.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	uint32_t sceneColor = renderGraph->CreateImage("Scene color", sceneColorDescription);
+
+	// The samples stay in the tile memory, only the single sample depth of the occlusion culling is sampled then loaded by the second phase
+	VulkanRenderGraph::ImageDescription depthDescription;
+	depthDescription.extent = swapChain->GetVkExtent2D();
+	depthDescription.format = VulkanHelper::FindDepthFormat();
+	depthDescription.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (occlusion && !resolveDepth ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+	if (resolveDepth)
+		depthDescription.usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	depthDescription.samples = msaaSamples;
+	depthDescription.aspect = depthAspect;
+	uint32_t depth = renderGraph->CreateImage("Depth", depthDescription);
+
+	uint32_t msaaColor = UINT32_MAX;
+	if (msaa)
 	{
-		vkResetCommandPool(logicalDevice->GetVk(), drawCommandPool[i], 0);
+		VulkanRenderGraph::ImageDescription msaaColorDescription = sceneColorDescription;
+		msaaColorDescription.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		msaaColorDescription.samples = msaaSamples;
+		msaaColor = renderGraph->CreateImage("MSAA color", msaaColorDescription);
+	}
 
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	// Farthest sample of the depth, the occlusion culling samples it and the second phase loads it
+	uint32_t sceneDepth = depth;
+	if (resolveDepth)
+	{
+		VulkanRenderGraph::ImageDescription resolvedDepthDescription = depthDescription;
+		resolvedDepthDescription.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		resolvedDepthDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+		sceneDepth = renderGraph->CreateImage("Resolved depth", resolvedDepthDescription);
+	}
 
-		if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+	// Written on the compute queue with async compute, the graphics submit waits for it so the graph places no barrier
+	if (!logicalDevice->HasAsyncCompute())
+	{
+		uint32_t clusterPass = renderGraph->AddPass("Cluster build", [this](VkCommandBuffer commandBuffer)
+		{
+			clusteredLighting->CmdBuildClusters(commandBuffer, static_cast<uint32_t>(currentFrame));
+		});
+		renderGraph->Write(clusterPass, clusterLights, VulkanRenderGraph::ResourceUsage::COMPUTE_WRITE);
+	}
+
+	// Culled when the lit passes don't sample the shadow map
+	uint32_t shadowPass = renderGraph->AddPass("Shadows", [this, i](VkCommandBuffer commandBuffer)
+	{
+		cascadedShadows->CmdRender(commandBuffer, static_cast<uint32_t>(i), drawList.GetPackets());
+	});
+	renderGraph->Write(shadowPass, shadowMap, VulkanRenderGraph::ResourceUsage::DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+	// Cull the meshlets of every model, the render pass then draw the survivors with indirect draws
+	if (!logicalDevice->HasAsyncCompute())
+	{
+		uint32_t meshletCullPass = renderGraph->AddPass("Meshlet cull", [this, i, occlusion](VkCommandBuffer commandBuffer)
 		{
-			Logger::Log(LogSeverity::FATAL_ERROR, "failed to begin recording command buffer!");
+			CmdCullMeshlets(commandBuffer, i, occlusion);
+		});
+		renderGraph->Write(meshletCullPass, meshletDraws, VulkanRenderGraph::ResourceUsage::COMPUTE_WRITE);
+	}
+
+	uint32_t mainPass = renderGraph->AddPass("Main", [this, i, resolveDepth, depth](VkCommandBuffer commandBuffer)
+	{
+		CmdBeginRenderPass(commandBuffer, renderPass->GetVk(), sceneFramebuffer);
+		CmdDrawModels(commandBuffer, i, false);
+		if (resolveDepth)
+		{
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			occlusionCullingPass->CmdResolveDepth(commandBuffer, renderGraph->GetImageView(depth));
 		}
+		vkCmdEndRenderPass(commandBuffer);
+	});
+	renderGraph->Read(mainPass, clusterLights, VulkanRenderGraph::ResourceUsage::FRAGMENT_READ);
+	renderGraph->Read(mainPass, meshletDraws, VulkanRenderGraph::ResourceUsage::INDIRECT_READ);
+	if (shadows)
+		renderGraph->Read(mainPass, shadowMap, VulkanRenderGraph::ResourceUsage::FRAGMENT_DEPTH_SAMPLED);
+	renderGraph->Write(mainPass, depth, VulkanRenderGraph::ResourceUsage::DEPTH_ATTACHMENT);
+	renderGraph->Write(mainPass, sceneColor, VulkanRenderGraph::ResourceUsage::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	if (msaa)
+		renderGraph->Write(mainPass, msaaColor, VulkanRenderGraph::ResourceUsage::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	if (resolveDepth)
+		renderGraph->Write(mainPass, sceneDepth, VulkanRenderGraph::ResourceUsage::DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+	// Test every model against the depth of the first phase then draw the newly visible ones
+	if (occlusion)
+	{
+		uint32_t occlusionDraws = renderGraph->ImportBuffer("Occlusion draws");
+		uint32_t occlusionVisibility = renderGraph->ImportBuffer("Occlusion visibility");
+		uint32_t hiZ = renderGraph->CreateImage("Hi-Z", occlusionCullingPass->GetHiZDescription());
+
+		uint32_t occlusionPass = renderGraph->AddPass("Occlusion culling", [this, sceneDepth, hiZ](VkCommandBuffer commandBuffer)
+		{
+			occlusionCullingPass->CmdBuildHiZ(commandBuffer, currentFrame, dynamicResolution->GetRenderExtent(), renderGraph->GetImageView(sceneDepth), renderGraph->GetImageView(hiZ), renderGraph->GetImageMipViews(hiZ));
+			occlusionCullingPass->CmdTest(commandBuffer, currentFrame, viewProjection, dynamicResolution->GetRenderExtent());
+		});
+		renderGraph->Read(occlusionPass, sceneDepth, VulkanRenderGraph::ResourceUsage::COMPUTE_DEPTH_SAMPLED);
+		renderGraph->Write(occlusionPass, hiZ, VulkanRenderGraph::ResourceUsage::COMPUTE_WRITE);
+		renderGraph->Write(occlusionPass, occlusionDraws, VulkanRenderGraph::ResourceUsage::COMPUTE_WRITE);
+		renderGraph->Write(occlusionPass, occlusionVisibility, VulkanRenderGraph::ResourceUsage::COMPUTE_WRITE);
+
+		uint32_t secondPhasePass = renderGraph->AddPass("Main second phase", [this, i](VkCommandBuffer commandBuffer)
+		{
+			CmdBeginRenderPass(commandBuffer, loadRenderPass->GetVk(), secondPhaseFramebuffer);
+			CmdDrawModels(commandBuffer, i, true);
+			vkCmdEndRenderPass(commandBuffer);
+		});
+		renderGraph->Read(secondPhasePass, clusterLights, VulkanRenderGraph::ResourceUsage::FRAGMENT_READ);
+		renderGraph->Read(secondPhasePass, occlusionDraws, VulkanRenderGraph::ResourceUsage::INDIRECT_READ);
+		if (shadows)
+			renderGraph->Read(secondPhasePass, shadowMap, VulkanRenderGraph::ResourceUsage::FRAGMENT_DEPTH_SAMPLED);
+		renderGraph->Write(secondPhasePass, sceneDepth, VulkanRenderGraph::ResourceUsage::DEPTH_ATTACHMENT);
+		renderGraph->Write(secondPhasePass, sceneColor, VulkanRenderGraph::ResourceUsage::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		// Read back when the fence of the frame slot is waited again
+		renderGraph->Export(occlusionVisibility, VulkanRenderGraph::ResourceUsage::HOST_READ);
+	}
+
+	// Scene upscaled to the swapchain image then the UI over it at native resolution
+	uint32_t upscalePass = renderGraph->AddPass("Upscale", [this, i, sceneColor](VkCommandBuffer commandBuffer)
+	{
+		dynamicResolution->CmdEndScene(commandBuffer, static_cast<uint32_t>(currentFrame));
 
 		VkRenderPassBeginInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass->GetVk();
+		renderPassInfo.renderPass = presentRenderPass->GetVk();
 		renderPassInfo.framebuffer = swapChain->GetSwapChainFramebuffers()[i];
 		renderPassInfo.renderArea.offset = {0, 0};
 		renderPassInfo.renderArea.extent = swapChain->GetVkExtent2D();
 
-		std::array<VkClearValue, 2> clearValues = {};
-		clearValues[0].color = {clearColor.r, clearColor.g, clearColor.b, 1.0f};
-		clearValues[1].depthStencil = {1.0f, 0};
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		dynamicResolution->CmdUpscale(commandBuffer, renderGraph->GetImageView(sceneColor));
+		if (imgui)
+			dynamic_cast<ImguiVulkan*>(imgui.get())->Draw(commandBuffer);
+		vkCmdEndRenderPass(commandBuffer);
+	});
+	renderGraph->Read(upscalePass, sceneColor, VulkanRenderGraph::ResourceUsage::FRAGMENT_SAMPLED);
+	renderGraph->Write(upscalePass, backbuffer, VulkanRenderGraph::ResourceUsage::COLOR_ATTACHMENT, IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	// Headless frames are copied to be read back instead of presented
+	renderGraph->Export(backbuffer, IsHeadless() ? VulkanRenderGraph::ResourceUsage::TRANSFER_READ : VulkanRenderGraph::ResourceUsage::PRESENT);
+	renderGraph->Compile();
+
+	// Same order as the attachments of VulkanRenderPass
+	std::vector<VkImageView> attachments = {renderGraph->GetImageView(msaa ? msaaColor : sceneColor), renderGraph->GetImageView(depth)};
+	if (msaa)
+		attachments.push_back(renderGraph->GetImageView(sceneColor));
+	if (resolveDepth)
+		attachments.push_back(renderGraph->GetImageView(sceneDepth));
+	UpdateFramebuffer(sceneFramebuffer, sceneAttachments, attachments, renderPass->GetVk());
+
+	if (occlusion)
+		UpdateFramebuffer(secondPhaseFramebuffer, secondPhaseAttachments, {renderGraph->GetImageView(sceneColor), renderGraph->GetImageView(sceneDepth)}, loadRenderPass->GetVk());
+}
 
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+void VulkanRenderer::UpdateFramebuffer(VkFramebuffer& framebuffer, std::vector<VkImageView>& currentAttachments, const std::vector<VkImageView>& attachments, VkRenderPass vkRenderPass)
+{
+	if (attachments == currentAttachments)
+		return;
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// The views only change when the graph recreated its images, it waited for the device to be idle first
+	if (framebuffer != nullptr)
+		vkDestroyFramebuffer(logicalDevice->GetVk(), framebuffer, nullptr);
+	currentAttachments = attachments;
+
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = vkRenderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	framebufferInfo.pAttachments = attachments.data();
+	framebufferInfo.width = swapChain->GetVkExtent2D().width;
+	framebufferInfo.height = swapChain->GetVkExtent2D().height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(logicalDevice->GetVk(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create scene framebuffer!");
+	}
+}
 
-		//TODO: make a function for that
-		// Draw model
-		auto graphicPipelineIterator = modelList.begin();
+void VulkanRenderer::RecordCompute(size_t i, bool occlusion)
+{
+	PROFILE_FUNCTION();
 
-		while (graphicPipelineIterator != modelList.end())
-		{
-			auto meshIterator = graphicPipelineIterator->second.begin();
+	vkResetCommandPool(logicalDevice->GetVk(), computeCommandPool[i], 0);
 
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicPipelineIterator->first->GetVkPipeline());
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-			while (meshIterator != graphicPipelineIterator->second.end())
-			{
-				auto modelIterator = meshIterator->second.begin();
+	if (vkBeginCommandBuffer(computeCommandBuffers[i], &beginInfo) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to begin recording compute command buffer!");
+	}
+
+	// Both only read what the host wrote before the submit, they don't depend on each other
+	clusteredLighting->CmdBuildClusters(computeCommandBuffers[i], static_cast<uint32_t>(currentFrame));
+	CmdCullMeshlets(computeCommandBuffers[i], i, occlusion);
+
+	if (vkEndCommandBuffer(computeCommandBuffers[i]) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to record compute command buffer!");
+	}
+}
+
+void VulkanRenderer::CmdCullMeshlets(VkCommandBuffer commandBuffer, size_t i, bool occlusion)
+{
+	indirectDrawCount = 0;
+	meshletCullPipeline->CmdBind(commandBuffer);
+
+	for (const DrawList::DrawPacket& packet : drawList.GetPackets())
+	{
+		if ((!occlusion || packet.model->occlusionVisible) && !packet.model->softwareOccluded)
+			packet.model->CmdCull(commandBuffer, static_cast<int>(i));
+	}
+}
+
+void VulkanRenderer::CmdBeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass vkRenderPass, VkFramebuffer framebuffer)
+{
+	VkExtent2D renderExtent = dynamicResolution->GetRenderExtent();
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = vkRenderPass;
+	renderPassInfo.framebuffer = framebuffer;
+	renderPassInfo.renderArea.offset = {0, 0};
+	renderPassInfo.renderArea.extent = renderExtent;
+
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = {clearColor.r, clearColor.g, clearColor.b, 1.0f};
+	clearValues[1].depthStencil = {1.0f, 0};
 
-				meshIterator->first->CmdBind(commandBuffers[i]);
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport = {0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f};
+	VkRect2D scissor = {{0, 0}, renderExtent};
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void VulkanRenderer::CmdDrawModels(VkCommandBuffer commandBuffer, size_t i, bool secondPhase)
+{
+	// Packets are sorted by pipeline then material then mesh, state is only bound when it change
+	Mesh* boundMesh = nullptr;
 
-				while (modelIterator != meshIterator->second.end())
-				{
-					modelIterator->get()->Draw(commandBuffers[i], i);
+	// The draws of each pipeline are measured as a bucket of the pass
+	uint32_t frame = static_cast<uint32_t>(currentFrame);
+	bool measuringBucket = false;
 
-					modelIterator++;
-				}
+	// With MSAA the second phase draws in the single sample attachments, with its own pipelines and without the multisampled depth prepass
+	bool singleSample = secondPhase && !secondPhasePipelines.empty();
+	bool prepass = depthPrepass && !singleSample;
 
-				meshIterator++;
+	// Write the depth of every model first so the shading only run for the fragments that end up visible
+	if (prepass)
+	{
+		measuringBucket = gpuProfiler->CmdBeginBucket(commandBuffer, frame, "Depth prepass");
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrepassGraphicPipeline->GetVkPipeline());
+
+		for (const DrawList::DrawPacket& packet : drawList.GetPackets())
+		{
+			if (packet.model->mesh != boundMesh)
+			{
+				boundMesh = packet.model->mesh;
+				boundMesh->CmdBindPositions(commandBuffer);
 			}
 
-			graphicPipelineIterator++;
+			CmdDrawModel(commandBuffer, packet.model, i, secondPhase);
 		}
 
-		dynamic_cast<ImguiVulkan*>(imgui.get())->Draw(commandBuffers[i]);
+		if (measuringBucket)
+			gpuProfiler->CmdEndBucket(commandBuffer, frame);
+		measuringBucket = false;
+	}
+
+	VulkanGraphicPipeline* boundPipeline = nullptr;
+	boundMesh = nullptr;
+
+	for (const DrawList::DrawPacket& packet : drawList.GetPackets())
+	{
+		Model* model = packet.model;
 
-		vkCmdEndRenderPass(commandBuffers[i]);
+		// Not compatible with the single sample render pass, only the engine pipelines have a variant
+		if (singleSample && secondPhasePipelines.count(model->graphicPipeline) == 0)
+			continue;
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+		if (model->graphicPipeline != boundPipeline)
 		{
-			Logger::Log(LogSeverity::FATAL_ERROR, "failed to record command buffer!");
+			if (measuringBucket)
+				gpuProfiler->CmdEndBucket(commandBuffer, frame);
+			measuringBucket = gpuProfiler->CmdBeginBucket(commandBuffer, frame, "Pipeline " + std::to_string(packet.key >> DrawList::PIPELINE_SHIFT));
+
+			boundPipeline = model->graphicPipeline;
+
+			VulkanGraphicPipeline* graphicPipeline = boundPipeline;
+			if (singleSample)
+				graphicPipeline = secondPhasePipelines[graphicPipeline];
+			else if (prepass && depthEqualPipelines.count(graphicPipeline) != 0)
+				graphicPipeline = depthEqualPipelines[graphicPipeline];
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicPipeline->GetVkPipeline());
+			clusteredLighting->CmdBind(commandBuffer, graphicPipeline->GetVkPipelineLayout(), frame);
+			cascadedShadows->CmdBind(commandBuffer, graphicPipeline->GetVkPipelineLayout(), frame);
+		}
+
+		if (model->mesh != boundMesh)
+		{
+			boundMesh = model->mesh;
+			boundMesh->CmdBind(commandBuffer);
 		}
+
+		CmdDrawModel(commandBuffer, model, i, secondPhase);
+	}
+
+	if (measuringBucket)
+		gpuProfiler->CmdEndBucket(commandBuffer, frame);
+}
+
+void VulkanRenderer::CmdDrawModel(VkCommandBuffer commandBuffer, Model* model, size_t i, bool secondPhase)
+{
+	// Hidden by the software occlusion culling in both phases
+	if (model->softwareOccluded)
+		return;
+
+	bool occlusion = occlusionCulling && occlusionCullingPass != nullptr;
+
+	if (secondPhase)
+		occlusionCullingPass->CmdDrawSecondPhase(commandBuffer, currentFrame, model, static_cast<int>(i));
+	else if (!occlusion || model->occlusionVisible)
+		model->Draw(commandBuffer, static_cast<int>(i));
+}
+
+void VulkanRenderer::ReadFrameStatistics()
+{
+	PROFILE_FUNCTION();
+
+	if (!frameSubmitted[currentFrame])
+		return;
+
+	// The fence of the frame in flight was waited, the queries it submitted MAX_FRAMES_IN_FLIGHT frames ago are available
+	uint32_t frame = static_cast<uint32_t>(currentFrame);
+	clusteredLighting->ReadTimings(frame);
+	dynamicResolution->Update(frame);
+
+	gpuProfiler->Read(frame);
+
+	uint64_t invocations = gpuProfiler->GetFragmentInvocations();
+	if (invocations > 0)
+	{
+		if (frameDepthPrepass[currentFrame])
+			depthPrepassFragmentInvocations = invocations;
+		else
+			fragmentInvocations = invocations;
+	}
+
+	frameSubmitted[currentFrame] = false;
+}
+
+void VulkanRenderer::CullSoftwareOcclusion()
+{
+	PROFILE_FUNCTION();
+
+	softwareOccludedCount = 0;
+
+	if (!softwareOcclusionCulling)
+	{
+		for (const auto& model : drawList.GetModels())
+			model->softwareOccluded = false;
+		return;
+	}
+
+	softwareOcclusion->Begin(viewProjection);
+
+	for (const auto& model : drawList.GetModels())
+	{
+		if (model->occluder && !model->mesh->GetOccluderIndices().empty())
+			softwareOcclusion->AddOccluder(model->GetModelMatrix(), model->mesh->GetOccluderVertices(), model->mesh->GetOccluderIndices());
+	}
+
+	softwareOcclusion->Rasterize();
+
+	for (const auto& model : drawList.GetModels())
+	{
+		model->softwareOccluded = !softwareOcclusion->IsVisible(model->GetWorldBoundingSphere());
+
+		if (model->softwareOccluded)
+			softwareOccludedCount++;
 	}
 }
 
 void VulkanRenderer::Present(GlfwManager* window)
 {
-	// Remove model from model list
+	PROFILE_FUNCTION();
+
+	// Remove model from model list, the frames in flight may still draw them
 	if (modelToBeRemove.size() != 0)
 	{
+		WaitForIdle();
 		for (size_t i = 0; i < modelToBeRemove.size(); i++)
 		{
 			RemoveModelFromList(modelToBeRemove[i]);
@@ -273,84 +777,209 @@ void VulkanRenderer::Present(GlfwManager* window)
 		modelToBeRemove.clear();
 	}
 
-	vkWaitForFences(logicalDevice->GetVk(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	{
+		PROFILE_SCOPE("Wait for fence");
+		vkWaitForFences(logicalDevice->GetVk(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
 
-	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(logicalDevice->GetVk(), swapChain->GetVkSwapchainKHR(), std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	ReadFrameStatistics();
+	memoryTracker->Update();
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	uint32_t imageIndex;
+	if (IsHeadless())
 	{
-		//RecreateSwapChain();
-		return;
+		// Nothing to acquire, the offscreen images are drawn in turn
+		imageIndex = headlessImageIndex;
 	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+	else
 	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to acquire swap chain image!");
+		VkResult result = vkAcquireNextImageKHR(logicalDevice->GetVk(), swapChain->GetVkSwapchainKHR(), std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			//RecreateSwapChain();
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to acquire swap chain image!");
+		}
 	}
 
+	// More images than frames in flight, the frame that last drew in the image can still be running and use its indirect, uniform and command buffers
+	if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+	{
+		PROFILE_SCOPE("Wait for image fence");
+		vkWaitForFences(logicalDevice->GetVk(), 1, &imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
 	UpdateUniformBuffer(imageIndex);
 
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<VkPipelineStageFlags> waitStages;
+	if (!IsHeadless())
+	{
+		waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+		waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	}
+
+	// Only the indirect draws and the lit fragments wait for the compute queue, the shadows render meanwhile
+	if (logicalDevice->HasAsyncCompute())
+	{
+		waitSemaphores.push_back(computeFinishedSemaphores[currentFrame]);
+		waitStages.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
 
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
 
+	// Nothing waits for the render in headless mode, a semaphore signaled twice without wait is invalid
 	VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = IsHeadless() ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	vkResetFences(logicalDevice->GetVk(), 1, &inFlightFences[currentFrame]);
 	
-	Draw();
+	Draw(imageIndex);
+	if (logicalDevice->HasAsyncCompute())
+	{
+		VkSubmitInfo computeSubmitInfo = {};
+		computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		computeSubmitInfo.commandBufferCount = 1;
+		computeSubmitInfo.pCommandBuffers = &computeCommandBuffers[imageIndex];
+		computeSubmitInfo.signalSemaphoreCount = 1;
+		computeSubmitInfo.pSignalSemaphores = &computeFinishedSemaphores[currentFrame];
+
+		if (vkQueueSubmit(logicalDevice->GetComputeQueue(), 1, &computeSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to submit compute command buffer!");
+		}
+	}
 	if (vkQueueSubmit(logicalDevice->GetGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
 	{
 		Logger::Log(LogSeverity::FATAL_ERROR, "failed to submit draw command buffer!");
 	}
+	submittedImage = imageIndex;
+	frameSubmitted[currentFrame] = true;
+	frameDepthPrepass[currentFrame] = depthPrepass;
+
+	if (IsHeadless())
+		headlessImageIndex = (imageIndex + 1) % static_cast<uint32_t>(swapChain->GetVkImages().size());
 
-	VkPresentInfoKHR presentInfo = {};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	if (!IsHeadless())
+	{
+		VkPresentInfoKHR presentInfo = {};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = signalSemaphores;
 
-	VkSwapchainKHR swapChains[] = {swapChain->GetVkSwapchainKHR()};
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
+		VkSwapchainKHR swapChains[] = {swapChain->GetVkSwapchainKHR()};
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = swapChains;
 
-	presentInfo.pImageIndices = &imageIndex;
+		presentInfo.pImageIndices = &imageIndex;
 
-	result = vkQueuePresentKHR(logicalDevice->GetPresentQueue(), &presentInfo);
+		VkResult result = vkQueuePresentKHR(logicalDevice->GetPresentQueue(), &presentInfo);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window->HasWindowResize())
-	{
-		window->ResetWindowHasResize();
-		//RecreateSwapChain();
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window->HasWindowResize())
+		{
+			window->ResetWindowHasResize();
+			//RecreateSwapChain();
+		}
+		else if (result != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to present swap chain image!");
+		}
 	}
-	else if (result != VK_SUCCESS)
+
+	// The next frame only waits for the fence of its own slot, it is recorded while this one renders
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	PerfCounters::EndFrame();
+}
+
+bool VulkanRenderer::SaveFrame(const std::string& path)
+{
+	if (!IsHeadless() || submittedImage == UINT32_MAX)
 	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to present swap chain image!");
+		Logger::Log(LogSeverity::WARNING, "Only a frame rendered in headless mode can be saved");
+		return false;
 	}
 
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	VkDevice device = logicalDevice->GetVk();
+	VkExtent2D extent = swapChain->GetVkExtent2D();
+	VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+	VkBuffer readbackBuffer;
+	VkDeviceMemory readbackBufferMemory;
+	VulkanHelper::CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory, MemoryCategory::STAGING);
+
+	// The present render pass left the image in the transfer source layout, the frame may still be rendering
+	vkWaitForFences(device, 1, &imagesInFlight[submittedImage], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	VkCommandBuffer commandBuffer = VulkanHelper::BeginSingleTimeCommands();
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = {extent.width, extent.height, 1};
+	vkCmdCopyImageToBuffer(commandBuffer, swapChain->GetVkImages()[submittedImage], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	VulkanHelper::EndSingleTimeCommands(commandBuffer);
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(size));
+	void* data;
+	vkMapMemory(device, readbackBufferMemory, 0, size, 0, &data);
+	memcpy(pixels.data(), data, pixels.size());
+	vkUnmapMemory(device, readbackBufferMemory);
 
+	vkDestroyBuffer(device, readbackBuffer, nullptr);
+	VulkanHelper::FreeMemory(device, readbackBufferMemory);
 
-	vkQueueWaitIdle(logicalDevice->GetPresentQueue());
+	if (swapChain->GetSwapChainImageFormat() == VK_FORMAT_B8G8R8A8_UNORM || swapChain->GetSwapChainImageFormat() == VK_FORMAT_B8G8R8A8_SRGB)
+	{
+		for (size_t i = 0; i < pixels.size(); i += 4)
+			std::swap(pixels[i], pixels[i + 2]);
+	}
+
+	if (!stbi_write_png(path.c_str(), extent.width, extent.height, 4, pixels.data(), extent.width * 4))
+	{
+		Logger::Log(LogSeverity::WARNING, "Can't write the frame to " + path);
+		return false;
+	}
+
+	Logger::Log("Frame written to " + path);
+	return true;
 }
 
 Model* VulkanRenderer::BasicLoadModel(std::string meshName, std::string textureName, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale)
 {
-	Mesh* newMesh = new Mesh(meshName + ".obj", Mesh::MeshFormat::OBJ);
-	meshList.push_back(newMesh);
+	Mesh*& newMesh = loadedMeshes[meshName];
+	if (newMesh == nullptr)
+	{
+		std::string extension = std::filesystem::path(meshName).extension().string();
+
+		if (extension == ".glb" || extension == ".gltf")
+			newMesh = new Mesh(meshName, Mesh::MeshFormat::GLTF, extension == ".glb");
+		else
+			newMesh = new Mesh(meshName + ".obj", Mesh::MeshFormat::OBJ);
+		meshList.push_back(newMesh);
+	}
 
-	Texture* newTexture = new Texture(textureName);
-	textureList.push_back(newTexture);
+	Texture*& newTexture = loadedTextures[textureName];
+	if (newTexture == nullptr)
+	{
+		newTexture = new Texture(textureName);
+		textureList.push_back(newTexture);
+	}
 
 	Model* testModel = new Model(newMesh, newTexture, debugNormalTexture.get(), basicGraphicPipeline.get());
 
@@ -372,40 +1001,12 @@ void VulkanRenderer::MarkModelToBeRemove(Model* model)
 
 void VulkanRenderer::AddModelToList(Model* model)
 {
-	using namespace std;
-	if (modelList.count(model->graphicPipeline) == 0)
-	{
-		modelList.insert(pair<VulkanGraphicPipeline*, map<Mesh*, vector<unique_ptr<Model>>>>(
-			model->graphicPipeline, map<Mesh*, vector<unique_ptr<Model>>>()
-			));
-	}
-
-	if (modelList[model->graphicPipeline].count(model->mesh) == 0)
-	{
-		modelList[model->graphicPipeline].insert(pair<Mesh*, vector<unique_ptr<Model>>>(
-			model->mesh, vector<unique_ptr<Model>>()
-			));
-	}
-
-	modelList[model->graphicPipeline][model->mesh].push_back(unique_ptr<Model>(model));
+	drawList.Add(model);
 }
 
 void VulkanRenderer::RemoveModelFromList(Model* model)
 {
-	for (size_t i = 0; i < modelList[model->graphicPipeline][model->mesh].size(); i++)
-	{
-		if (modelList[model->graphicPipeline][model->mesh][i].get() == model)
-		{
-			modelList[model->graphicPipeline][model->mesh].erase(modelList[model->graphicPipeline][model->mesh].begin() + i);
-			break;
-		}
-	}
-
-	if (modelList[model->graphicPipeline][model->mesh].size() <= 0)
-		modelList[model->graphicPipeline].erase(model->mesh);
-
-	if (modelList[model->graphicPipeline].size() <= 0)
-		modelList.erase(model->graphicPipeline);
+	drawList.Remove(model->drawListHandle);
 }
 
 VulkanInstance* VulkanRenderer::GetVulkanInstance() const
@@ -418,6 +1019,11 @@ VkSurfaceKHR VulkanRenderer::GetVkSurfaceKHR() const
 	return surface;
 }
 
+bool VulkanRenderer::IsHeadless() const
+{
+	return window == nullptr;
+}
+
 VulkanPhysicalDevice* VulkanRenderer::GetPhysicalDevice() const
 {
 	return physicalDevice.get();
@@ -428,6 +1034,11 @@ VulkanLogicalDevice* VulkanRenderer::GetLogicalDevice() const
 	return logicalDevice.get();
 }
 
+VulkanMemoryTracker* VulkanRenderer::GetMemoryTracker() const
+{
+	return memoryTracker.get();
+}
+
 VulkanSwapChain* VulkanRenderer::GetSwapChain() const
 {
 	return swapChain.get();
@@ -438,6 +1049,16 @@ VulkanRenderPass* VulkanRenderer::GetRenderPass() const
 	return renderPass.get();
 }
 
+VulkanRenderPass* VulkanRenderer::GetPresentRenderPass() const
+{
+	return presentRenderPass.get();
+}
+
+const DrawList& VulkanRenderer::GetDrawList() const
+{
+	return drawList;
+}
+
 VkCommandPool VulkanRenderer::GetGlobalCommandPool() const
 {
 	return globalCommandPool;
@@ -448,6 +1069,85 @@ void VulkanRenderer::WaitForIdle()
 	vkDeviceWaitIdle(logicalDevice->GetVk());
 }
 
+VulkanComputePipeline* VulkanRenderer::GetMeshletCullPipeline() const
+{
+	return meshletCullPipeline.get();
+}
+
+const std::vector<VkBuffer>& VulkanRenderer::GetIndirectBuffers() const
+{
+	return indirectBuffers;
+}
+
+uint32_t VulkanRenderer::GetOccludedModelCount() const
+{
+	if (!occlusionCulling || occlusionCullingPass == nullptr)
+		return 0;
+
+	return occlusionCullingPass->GetOccludedCount();
+}
+
+bool VulkanRenderer::AllocateIndirectDraws(uint32_t count, uint32_t& firstDraw)
+{
+	if (indirectDrawCount + count > maxIndirectDraws)
+		return false;
+
+	firstDraw = indirectDrawCount;
+	indirectDrawCount += count;
+
+	return true;
+}
+
+uint32_t VulkanRenderer::GetSoftwareOccludedModelCount() const
+{
+	return softwareOccludedCount;
+}
+
+const SoftwareOcclusion* VulkanRenderer::GetSoftwareOcclusion() const
+{
+	return softwareOcclusion.get();
+}
+
+uint64_t VulkanRenderer::GetFragmentInvocations(bool withDepthPrepass) const
+{
+	return withDepthPrepass ? depthPrepassFragmentInvocations : fragmentInvocations;
+}
+
+VulkanClusteredLighting* VulkanRenderer::GetClusteredLighting() const
+{
+	return clusteredLighting.get();
+}
+
+const VulkanCascadedShadows* VulkanRenderer::GetCascadedShadows() const
+{
+	return cascadedShadows.get();
+}
+
+const VulkanRenderGraph* VulkanRenderer::GetRenderGraph() const
+{
+	return renderGraph.get();
+}
+
+bool VulkanRenderer::IsAsyncCompute() const
+{
+	return logicalDevice->HasAsyncCompute();
+}
+
+VulkanDynamicResolution* VulkanRenderer::GetDynamicResolution() const
+{
+	return dynamicResolution.get();
+}
+
+const VulkanGpuProfiler* VulkanRenderer::GetGpuProfiler() const
+{
+	return gpuProfiler.get();
+}
+
+TextureStreamer* VulkanRenderer::GetTextureStreamer() const
+{
+	return textureStreamer.get();
+}
+
 VulkanRenderer* VulkanRenderer::GetInstance()
 {
 	return instance;
@@ -470,6 +1170,22 @@ void VulkanRenderer::CreateCommandBuffer()
 			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate command buffers!");
 		}
 	}
+
+	computeCommandBuffers.resize(computeCommandPool.size());
+
+	for (size_t i = 0; i < computeCommandBuffers.size(); i++)
+	{
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = computeCommandPool[i];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(logicalDevice->GetVk(), &allocInfo, &computeCommandBuffers[i]) != VK_SUCCESS)
+		{
+			Logger::Log(LogSeverity::FATAL_ERROR, "failed to allocate compute command buffers!");
+		}
+	}
 }
 
 void VulkanRenderer::CreateSyncObject()
@@ -477,6 +1193,9 @@ void VulkanRenderer::CreateSyncObject()
 	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	imagesInFlight.resize(swapChain->GetVkImages().size(), VK_NULL_HANDLE);
+	frameSubmitted.resize(MAX_FRAMES_IN_FLIGHT, false);
+	frameDepthPrepass.resize(MAX_FRAMES_IN_FLIGHT, false);
 
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -494,10 +1213,95 @@ void VulkanRenderer::CreateSyncObject()
 			Logger::Log(LogSeverity::FATAL_ERROR, "failed to create synchronization objects for a frame!");
 		}
 	}
+
+	if (logicalDevice->HasAsyncCompute())
+	{
+		computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			if (vkCreateSemaphore(logicalDevice->GetVk(), &semaphoreInfo, nullptr, &computeFinishedSemaphores[i]) != VK_SUCCESS)
+			{
+				Logger::Log(LogSeverity::FATAL_ERROR, "failed to create compute semaphore!");
+			}
+		}
+	}
+}
+
+void VulkanRenderer::CreateMeshletCulling()
+{
+	meshletCullShader = std::unique_ptr<VulkanShader>(new VulkanShader("MeshletCullComp", VkShaderStageFlagBits::VK_SHADER_STAGE_COMPUTE_BIT));
+
+	meshletCullPipeline = std::unique_ptr<VulkanComputePipeline>(new VulkanComputePipeline(meshletCullShader.get()));
+	meshletCullPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);// Model uniform
+	meshletCullPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);// Meshlets
+	meshletCullPipeline->layoutBinding.AddLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);// Indirect draws
+	meshletCullPipeline->Create(sizeof(uint32_t) * 2);
+
+	// Models that don't fit in the indirect buffer are drawn without culling
+	maxIndirectDraws = Setting::Get("MaxMeshletDraws", 65536);
+	VkDeviceSize bufferSize = sizeof(VkDrawIndexedIndirectCommand) * maxIndirectDraws;
+
+	indirectBuffers.resize(swapChain->GetSwapChainFramebuffers().size());
+	indirectBuffersMemory.resize(swapChain->GetSwapChainFramebuffers().size());
+
+	for (size_t i = 0; i < indirectBuffers.size(); i++)
+	{
+		VulkanHelper::CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBuffers[i], indirectBuffersMemory[i]);
+	}
+}
+
+void VulkanRenderer::CreateDepthPrepass()
+{
+	depthPrepassVertexShader = std::unique_ptr<VulkanShader>(new VulkanShader("DepthPrepassVert", VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT));
+
+	depthPrepassGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
+	depthPrepassGraphicPipeline->AddShader(depthPrepassVertexShader.get());
+	depthPrepassGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL, VK_COMPARE_OP_LESS, true);
+
+	basicEqualGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
+	basicEqualGraphicPipeline->AddShader(baseVertexShader.get());
+	basicEqualGraphicPipeline->AddShader(baseFragShader.get());
+	basicEqualGraphicPipeline->AddSetLayout(clusteredLighting->GetDescriptorSetLayout());
+	basicEqualGraphicPipeline->AddSetLayout(cascadedShadows->GetDescriptorSetLayout());
+	basicEqualGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL, VK_COMPARE_OP_EQUAL);
+
+	textureColorEqualGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
+	textureColorEqualGraphicPipeline->AddShader(baseVertexShader.get());
+	textureColorEqualGraphicPipeline->AddShader(textureColorFragShader.get());
+	textureColorEqualGraphicPipeline->AddSetLayout(clusteredLighting->GetDescriptorSetLayout());
+	textureColorEqualGraphicPipeline->AddSetLayout(cascadedShadows->GetDescriptorSetLayout());
+	textureColorEqualGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL, VK_COMPARE_OP_EQUAL);
+
+	depthEqualPipelines[basicGraphicPipeline.get()] = basicEqualGraphicPipeline.get();
+	depthEqualPipelines[textureColorGraphicPipeline.get()] = textureColorEqualGraphicPipeline.get();
+}
+
+void VulkanRenderer::CreateSecondPhasePipelines()
+{
+	basicSecondPhaseGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
+	basicSecondPhaseGraphicPipeline->AddShader(baseVertexShader.get());
+	basicSecondPhaseGraphicPipeline->AddShader(baseFragShader.get());
+	basicSecondPhaseGraphicPipeline->AddSetLayout(clusteredLighting->GetDescriptorSetLayout());
+	basicSecondPhaseGraphicPipeline->AddSetLayout(cascadedShadows->GetDescriptorSetLayout());
+	basicSecondPhaseGraphicPipeline->SetSceneRenderPass(loadRenderPass->GetVk(), VK_SAMPLE_COUNT_1_BIT);
+	basicSecondPhaseGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL);
+
+	textureColorSecondPhaseGraphicPipeline = std::unique_ptr <VulkanGraphicPipeline>(new VulkanGraphicPipeline());
+	textureColorSecondPhaseGraphicPipeline->AddShader(baseVertexShader.get());
+	textureColorSecondPhaseGraphicPipeline->AddShader(textureColorFragShader.get());
+	textureColorSecondPhaseGraphicPipeline->AddSetLayout(clusteredLighting->GetDescriptorSetLayout());
+	textureColorSecondPhaseGraphicPipeline->AddSetLayout(cascadedShadows->GetDescriptorSetLayout());
+	textureColorSecondPhaseGraphicPipeline->SetSceneRenderPass(loadRenderPass->GetVk(), VK_SAMPLE_COUNT_1_BIT);
+	textureColorSecondPhaseGraphicPipeline->Create(VkPolygonMode::VK_POLYGON_MODE_FILL);
+
+	secondPhasePipelines[basicGraphicPipeline.get()] = basicSecondPhaseGraphicPipeline.get();
+	secondPhasePipelines[textureColorGraphicPipeline.get()] = textureColorSecondPhaseGraphicPipeline.get();
 }
 
 void VulkanRenderer::UpdateUniformBuffer(uint32_t currentImage)
 {
+	PROFILE_FUNCTION();
+
 	static auto startTime = std::chrono::high_resolution_clock::now();
 
 	auto currentTime = std::chrono::high_resolution_clock::now();
@@ -508,36 +1312,30 @@ void VulkanRenderer::UpdateUniformBuffer(uint32_t currentImage)
 	ubo.lightDir = lightDir;
 	ubo.lightColor = lightColor;
 	ubo.lightSetting = lightSetting;
-	ubo.proj = glm::perspective(glm::radians(45.0f), swapChain->GetVkExtent2D().width / (float)swapChain->GetVkExtent2D().height, 0.1f, 10000.0f);
+	float fov = glm::radians(45.0f);
+	float screenHeight = static_cast<float>(swapChain->GetVkExtent2D().height);
+	float aspect = swapChain->GetVkExtent2D().width / (float)swapChain->GetVkExtent2D().height;
+	ubo.proj = glm::perspective(fov, aspect, NEAR_PLANE, FAR_PLANE);
 	ubo.view = glm::lookAt(camPos, camPos + glm::normalize(camDir), glm::vec3(0.0f, 0.0f, 1.0f));
 	ubo.proj[1][1] *= -1;
+	viewProjection = ubo.proj * ubo.view;
+	clusteredLighting->Update(ubo.view, ubo.proj, NEAR_PLANE, FAR_PLANE, dynamicResolution->GetRenderExtent(), static_cast<uint32_t>(currentFrame));
 
-	//TODO: make a function for that
-	// Recreate stuff in model
-	auto graphicPipelineIterator = modelList.begin();
-
-	while (graphicPipelineIterator != modelList.end())
+	for (const auto& model : drawList.GetModels())
 	{
-		auto meshIterator = graphicPipelineIterator->second.begin();
-
-		while (meshIterator != graphicPipelineIterator->second.end())
-		{
-			auto modelIterator = meshIterator->second.begin();
-
-			while (modelIterator != meshIterator->second.end())
-			{
-				ubo.model = glm::translate(glm::mat4(1.0), modelIterator->get()->position);
-				ubo.model *= glm::mat4_cast(glm::quat(glm::radians(modelIterator->get()->rotation)));
-				ubo.model = glm::scale(ubo.model, modelIterator->get()->scale);
+		ubo.model = glm::translate(glm::mat4(1.0), model->position);
+		ubo.model *= glm::mat4_cast(glm::quat(glm::radians(model->rotation)));
+		ubo.model = glm::scale(ubo.model, model->scale);
 
-				modelIterator->get()->UpdateUniformBuffer(currentImage, &ubo);
+		model->UpdateUniformBuffer(currentImage, &ubo);
+		model->UpdateLod(ubo.model, camPos, fov, screenHeight, lodPixelError, lodHysteresis);
+	}
 
-				modelIterator++;
-			}
+	if (textureStreamer)
+		textureStreamer->Update(drawList.GetModels(), camPos, fov, screenHeight);
 
-			meshIterator++;
-		}
-
-		graphicPipelineIterator++;
-	}
+	if (shadows)
+		cascadedShadows->Update(ubo.view, fov, aspect, NEAR_PLANE, lightDir, drawList.GetModels(), static_cast<uint32_t>(currentFrame));
+	else
+		cascadedShadows->Disable(static_cast<uint32_t>(currentFrame));
 }
@@ -11,6 +11,7 @@
 #include "VulkanInstance.h"
 #include "VulkanPhysicalDevice.h"
 #include "VulkanLogicalDevice.h"
+#include "Rendering/Vulkan/VulkanMemoryTracker.h"
 #include "VulkanSwapChain.h"
 #include "VulkanRenderPass.h"
 #include "Rendering/Vulkan/VulkanGraphicPipeline.h"
@@ -18,8 +19,18 @@
 #include "Rendering/Texture.h"
 #include "Rendering/Mesh.h"
 #include "Rendering/Vulkan/VulkanDescriptor.h"
+#include "Rendering/Vulkan/VulkanComputePipeline.h"
+#include "Rendering/Vulkan/VulkanOcclusionCulling.h"
+#include "Rendering/Vulkan/VulkanClusteredLighting.h"
+#include "Rendering/Vulkan/VulkanCascadedShadows.h"
+#include "Rendering/Vulkan/VulkanRenderGraph.h"
+#include "Rendering/Vulkan/VulkanDynamicResolution.h"
+#include "Rendering/Vulkan/VulkanGpuProfiler.h"
 #include "Rendering/GlfwManager.h"
 #include "Rendering/Model.h"
+#include "Rendering/DrawList.h"
+#include "Rendering/SoftwareOcclusion.h"
+#include "Rendering/TextureStreamer.h"
 #include "Rendering/UI/ImguiBase.h"
 #include "Rendering/Renderer.h"
 
@@ -27,6 +38,8 @@ class VulkanRenderer : public Renderer
 {
 public:
 	static const int MAX_FRAMES_IN_FLIGHT = 2;
+	static constexpr float NEAR_PLANE = 0.1f;
+	static constexpr float FAR_PLANE = 10000.0f;
 	glm::vec3 clearColor = glm::vec3(100.0f / 255.0f, 149.0f / 255.0f, 237.0f / 255.0f);
 
 	glm::vec3 camPos = glm::vec3(0, 5.0f, 0.0f);
@@ -34,6 +47,13 @@ public:
 	glm::vec3 lightDir = glm::vec3(0.1f, 1, 1);
 	glm::vec2 lightSetting = glm::vec2(5, 1);
 	glm::vec3 lightColor = glm::vec3(1);
+	float lodPixelError = 1.0f; // Max simplification error allowed on screen in pixel
+	float lodHysteresis = 0.1f;
+	bool meshletCulling = true;
+	bool occlusionCulling = true;
+	bool softwareOcclusionCulling = false;
+	bool depthPrepass = false;
+	bool shadows = true;
 
 private:
 	static VulkanRenderer* instance;
@@ -44,17 +64,71 @@ private:
 	VkSurfaceKHR surface = nullptr;
 	std::unique_ptr<VulkanPhysicalDevice> physicalDevice;
 	std::unique_ptr<VulkanLogicalDevice> logicalDevice;
+	std::unique_ptr<VulkanMemoryTracker> memoryTracker; // Destroyed after every resource
 	std::unique_ptr<VulkanSwapChain> swapChain;
-	std::unique_ptr<VulkanRenderPass> renderPass;
+	std::unique_ptr<VulkanRenderPass> renderPass; // Resolve the color, and the depth for the occlusion culling
+	std::unique_ptr<VulkanRenderPass> loadRenderPass; // Second phase of the occlusion culling in the single sample attachments
+	std::unique_ptr<VulkanRenderPass> presentRenderPass; // Upscaled scene and UI in the swapchain image
 
 	//TODO: Change this so we can have multiple and take ref in mesh
 	std::unique_ptr<VulkanShader> baseVertexShader;
 	std::unique_ptr<VulkanShader> baseFragShader;
 	std::unique_ptr<VulkanShader> textureColorFragShader;
+	std::unique_ptr<VulkanShader> depthPrepassVertexShader;
 	std::unique_ptr <VulkanGraphicPipeline> basicGraphicPipeline;
 	std::unique_ptr <VulkanGraphicPipeline> textureColorGraphicPipeline;
 
-	std::map<VulkanGraphicPipeline*, std::map<Mesh*, std::vector<std::unique_ptr<Model>>>> modelList;
+	// Depth only pass then the pipelines above with an EQUAL depth test
+	std::unique_ptr <VulkanGraphicPipeline> depthPrepassGraphicPipeline;
+	std::unique_ptr <VulkanGraphicPipeline> basicEqualGraphicPipeline;
+	std::unique_ptr <VulkanGraphicPipeline> textureColorEqualGraphicPipeline;
+	std::map<VulkanGraphicPipeline*, VulkanGraphicPipeline*> depthEqualPipelines;
+
+	// Single sample pipelines of the second phase of the occlusion culling, only with MSAA
+	std::unique_ptr <VulkanGraphicPipeline> basicSecondPhaseGraphicPipeline;
+	std::unique_ptr <VulkanGraphicPipeline> textureColorSecondPhaseGraphicPipeline;
+	std::map<VulkanGraphicPipeline*, VulkanGraphicPipeline*> secondPhasePipelines;
+
+	// GPU time and shader invocations of each pass of the graph, the fragment invocations are compared with and without the depth prepass
+	std::unique_ptr<VulkanGpuProfiler> gpuProfiler;
+	uint32_t submittedImage = UINT32_MAX; // Image of the last submit
+	uint32_t headlessImageIndex = 0; // Next offscreen image drawn in headless mode
+	std::vector<bool> frameSubmitted; // Queries of each frame in flight waiting to be read once its fence signaled
+	std::vector<bool> frameDepthPrepass;
+	uint64_t fragmentInvocations = 0;
+	uint64_t depthPrepassFragmentInvocations = 0;
+
+	std::unique_ptr<VulkanShader> meshletCullShader;
+	std::unique_ptr<VulkanComputePipeline> meshletCullPipeline;
+	std::vector<VkBuffer> indirectBuffers;
+	std::vector<VkDeviceMemory> indirectBuffersMemory;
+	uint32_t maxIndirectDraws = 0;
+	uint32_t indirectDrawCount = 0;
+
+	std::unique_ptr<VulkanOcclusionCulling> occlusionCullingPass;
+	std::vector<Model*> occlusionModels;
+	glm::mat4 viewProjection = glm::mat4(1);
+
+	std::unique_ptr<VulkanClusteredLighting> clusteredLighting;
+	std::unique_ptr<VulkanCascadedShadows> cascadedShadows;
+
+	// Rebuilt for every command buffer, keeps the transient images between frames
+	std::unique_ptr<VulkanRenderGraph> renderGraph;
+	// Transient attachments of the graph, recreated with them
+	VkFramebuffer sceneFramebuffer = nullptr;
+	VkFramebuffer secondPhaseFramebuffer = nullptr;
+	std::vector<VkImageView> sceneAttachments;
+	std::vector<VkImageView> secondPhaseAttachments;
+
+	std::unique_ptr<VulkanDynamicResolution> dynamicResolution;
+
+	std::unique_ptr<SoftwareOcclusion> softwareOcclusion;
+	uint32_t softwareOccludedCount = 0;
+
+	DrawList drawList;
+
+	// Destroyed after the textures, they unregister themselves
+	std::unique_ptr<TextureStreamer> textureStreamer;
 
 	std::unique_ptr<Texture> checkerTexture;
 	std::unique_ptr<Texture> skyboxTexture;
@@ -67,20 +141,31 @@ private:
 	std::vector<Mesh*> meshList = std::vector<Mesh*>();
 	std::vector<Texture*> textureList = std::vector<Texture*>();
 
+	// Models loading the same file share its mesh and texture, owned by the lists above
+	std::map<std::string, Mesh*> loadedMeshes;
+	std::map<std::string, Texture*> loadedTextures;
+
 	//TODO: Move this
 	std::vector <VkCommandPool> drawCommandPool;
 	std::vector<VkCommandBuffer> commandBuffers;
 
+	// Cluster build and meshlet cull of each swapchain image when they run on the compute queue
+	std::vector<VkCommandPool> computeCommandPool;
+	std::vector<VkCommandBuffer> computeCommandBuffers;
+
 	VkCommandPool globalCommandPool;
 
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
+	std::vector<VkSemaphore> computeFinishedSemaphores; // Waited by the graphics submit when there is async compute
 	std::vector<VkFence> inFlightFences;
+	std::vector<VkFence> imagesInFlight; // Fence of the frame that last drew in each swapchain image, null before its first frame
 	size_t currentFrame = 0;
 
 	std::vector<Model*> modelToBeRemove;
 
 public:
+	/// <param name="window">Null to render headless in offscreen images, without surface nor present</param>
 	VulkanRenderer(GLFWwindow* window);
 	~VulkanRenderer();
 
@@ -88,18 +173,63 @@ public:
 
 	void Present(GlfwManager* window) override;
 
+	/// <summary>
+	/// Write the last submitted frame to a PNG, only the offscreen images of the headless mode can be read back.
+	/// </summary>
+	/// <returns>Return false if the frame can't be read or the file can't be written</returns>
+	bool SaveFrame(const std::string& path);
+
 	Model* BasicLoadModel(std::string meshName, std::string textureName, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale);
 	void MarkModelToBeRemove(Model* model);
 
 	void AddModelToList(Model* model);
 
 	VulkanInstance* GetVulkanInstance() const;
+
+	/// <summary>
+	/// Null in headless mode.
+	/// </summary>
 	VkSurfaceKHR GetVkSurfaceKHR() const;
+	bool IsHeadless() const;
 	VulkanPhysicalDevice* GetPhysicalDevice() const;
 	VulkanLogicalDevice* GetLogicalDevice() const;
+	VulkanMemoryTracker* GetMemoryTracker() const;
 	VulkanSwapChain* GetSwapChain() const;
 	VulkanRenderPass* GetRenderPass() const;
+	VulkanRenderPass* GetPresentRenderPass() const;
+	const DrawList& GetDrawList() const;
 	VkCommandPool GetGlobalCommandPool() const;
+	VulkanComputePipeline* GetMeshletCullPipeline() const;
+	const std::vector<VkBuffer>& GetIndirectBuffers() const;
+	uint32_t GetOccludedModelCount() const;
+	uint32_t GetSoftwareOccludedModelCount() const;
+	const SoftwareOcclusion* GetSoftwareOcclusion() const;
+	VulkanClusteredLighting* GetClusteredLighting() const;
+	const VulkanCascadedShadows* GetCascadedShadows() const;
+	const VulkanRenderGraph* GetRenderGraph() const;
+
+	/// <summary>
+	/// True when the cluster build and the meshlet cull run on the compute queue beside the shadows.
+	/// </summary>
+	bool IsAsyncCompute() const;
+	VulkanDynamicResolution* GetDynamicResolution() const;
+	const VulkanGpuProfiler* GetGpuProfiler() const;
+
+	/// <summary>
+	/// Null when the texture streaming is disabled, every mip is resident then.
+	/// </summary>
+	TextureStreamer* GetTextureStreamer() const;
+
+	/// <summary>
+	/// Fragment shader invocations of the last frame measured with or without the depth prepass, 0 if none was measured.
+	/// </summary>
+	uint64_t GetFragmentInvocations(bool withDepthPrepass) const;
+
+	/// <summary>
+	/// Reserve indirect draw commands in the indirect buffer of the command buffer being recorded.
+	/// </summary>
+	/// <returns>Return false if the indirect buffer is full</returns>
+	bool AllocateIndirectDraws(uint32_t count, uint32_t& firstDraw);
 
 	void WaitForIdle() override;
 
@@ -107,9 +237,37 @@ public:
 
 private:
 	void RemoveModelFromList(Model* model);
-	void Draw();
+	void Draw(uint32_t imageIndex);
+
+	/// <summary>
+	/// Declare the passes of the command buffer and what they read and write, the graph places the barriers between them.
+	/// </summary>
+	void BuildRenderGraph(size_t i, bool occlusion);
+
+	/// <summary>
+	/// Recreate a framebuffer of the scene render passes when the graph recreated its attachments.
+	/// </summary>
+	void UpdateFramebuffer(VkFramebuffer& framebuffer, std::vector<VkImageView>& currentAttachments, const std::vector<VkImageView>& attachments, VkRenderPass vkRenderPass);
+
+	/// <summary>
+	/// Record the passes of the compute queue, they are left out of the render graph then.
+	/// </summary>
+	void RecordCompute(size_t i, bool occlusion);
+
+	/// <summary>
+	/// Begin a scene render pass over the render extent of the dynamic resolution and set the viewport to it.
+	/// </summary>
+	void CmdBeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass vkRenderPass, VkFramebuffer framebuffer);
+	void CmdCullMeshlets(VkCommandBuffer commandBuffer, size_t i, bool occlusion);
+	void CmdDrawModels(VkCommandBuffer commandBuffer, size_t i, bool secondPhase);
+	void CmdDrawModel(VkCommandBuffer commandBuffer, Model* model, size_t i, bool secondPhase);
+	void ReadFrameStatistics();
+	void CullSoftwareOcclusion();
 
 	void CreateCommandBuffer();// TODO: Not here?
 	void CreateSyncObject();// TODO: Not here?
+	void CreateMeshletCulling();
+	void CreateDepthPrepass();
+	void CreateSecondPhasePipelines();
 	void UpdateUniformBuffer(uint32_t currentImage);// TODO: Not here?
 };
\ No newline at end of file
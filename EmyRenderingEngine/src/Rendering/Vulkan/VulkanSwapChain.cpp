@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include "Helper/Log.h"
+#include "Game/Setting.h"
 #include "VulkanRenderer.h"
 
 VulkanSwapChain::VulkanSwapChain(GLFWwindow* window)
@@ -12,62 +13,13 @@ VulkanSwapChain::VulkanSwapChain(GLFWwindow* window)
 
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
 	VkPhysicalDevice physicalDevice = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetVk();
-	VkSurfaceKHR surface = VulkanRenderer::GetInstance()->GetVkSurfaceKHR();
-	VkSampleCountFlagBits msaaSample = VulkanRenderer::GetInstance()->GetPhysicalDevice()->GetMsaaSample();
-	VkQueue graphicQueue = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetGraphicsQueue();
-	VkRenderPass renderPass = VulkanRenderer::GetInstance()->GetRenderPass()->GetVk();
-
-	VulkanHelper::SwapChainSupportDetails swapChainSupport = VulkanHelper::QuerySwapChainSupport();
-
-	VkSurfaceFormatKHR surfaceFormat = VulkanHelper::ChooseSwapSurfaceFormat(swapChainSupport.formats);
-	VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
-	VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities, window);
-
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
-	{
-		imageCount = swapChainSupport.capabilities.maxImageCount;
-	}
+	VkRenderPass presentRenderPass = VulkanRenderer::GetInstance()->GetPresentRenderPass()->GetVk();
 
-	VkSwapchainCreateInfoKHR createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	createInfo.surface = surface;
-	createInfo.minImageCount = imageCount;
-	createInfo.imageFormat = surfaceFormat.format;
-	createInfo.imageColorSpace = surfaceFormat.colorSpace;
-	createInfo.imageExtent = extent;
-	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
-	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	createInfo.presentMode = presentMode;
-	createInfo.clipped = VK_TRUE;
-
-	VulkanHelper::QueueFamilyIndices indices = VulkanHelper::FindQueueFamilies();
-	uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
-
-	if (indices.graphicsFamily != indices.presentFamily)
-	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-		createInfo.queueFamilyIndexCount = 2;
-		createInfo.pQueueFamilyIndices = queueFamilyIndices;
-	}
+	// Offscreen images stand for the swapchain in headless mode, nothing is presented
+	if (window != nullptr)
+		CreateSwapchainKHR(window);
 	else
-	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	}
-
-	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
-	{
-		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create swap chain!");
-	}
-
-	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
-	swapChainImages.resize(imageCount);
-	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
-
-	swapChainImageFormat = surfaceFormat.format;
-	swapChainExtent = extent;
+		CreateOffscreenImages();
 
 	swapChainImageViews.resize(swapChainImages.size());
 
@@ -76,52 +28,16 @@ VulkanSwapChain::VulkanSwapChain(GLFWwindow* window)
 		swapChainImageViews[i] = VulkanHelper::CreateImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 	}
 
-	// FrameBuffer
-	VulkanHelper::CreateTextureParameter colorTextureParameter = {};
-	colorTextureParameter.extent = extent;
-	colorTextureParameter.mipLevels = 1;
-	colorTextureParameter.msaaSample = msaaSample;
-	colorTextureParameter.imageFormat = swapChainImageFormat;
-	colorTextureParameter.tiling = VK_IMAGE_TILING_OPTIMAL;
-	colorTextureParameter.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	colorTextureParameter.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	colorTextureParameter.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
-	colorTextureParameter.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorTextureParameter.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VulkanHelper::CreateTexture(colorTextureParameter, colorImage, colorImageView, colorImageMemory);
-
-
-	VkFormat depthFormat = VulkanHelper::FindDepthFormat();
-	VulkanHelper::CreateTextureParameter depthTextureParameter = {};
-	depthTextureParameter.extent = extent;
-	depthTextureParameter.mipLevels = 1;
-	depthTextureParameter.msaaSample = msaaSample;
-	depthTextureParameter.imageFormat = depthFormat;
-	depthTextureParameter.tiling = VK_IMAGE_TILING_OPTIMAL;
-	depthTextureParameter.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-	depthTextureParameter.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	depthTextureParameter.aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
-	depthTextureParameter.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthTextureParameter.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VulkanHelper::CreateTexture(depthTextureParameter, depthImage, depthImageView, depthImageMemory);
-
+	// The scene color and depth are transient images of the render graph, only the swapchain images are framebuffers here
 	swapChainFramebuffers.resize(swapChainImageViews.size());
 
 	for (size_t i = 0; i < swapChainImageViews.size(); i++)
 	{
-		std::array<VkImageView, 3> attachments = {
-			colorImageView,
-			depthImageView,
-			swapChainImageViews[i]
-		};
-
 		VkFramebufferCreateInfo framebufferInfo = {};
 		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.renderPass = presentRenderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &swapChainImageViews[i];
 		framebufferInfo.width = swapChainExtent.width;
 		framebufferInfo.height = swapChainExtent.height;
 		framebufferInfo.layers = 1;
@@ -136,13 +52,6 @@ VulkanSwapChain::VulkanSwapChain(GLFWwindow* window)
 VulkanSwapChain::~VulkanSwapChain()
 {
 	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
-	vkDestroyImageView(device, colorImageView, nullptr);
-	vkDestroyImage(device, colorImage, nullptr);
-	vkFreeMemory(device, colorImageMemory, nullptr);
-
-	vkDestroyImageView(device, depthImageView, nullptr);
-	vkDestroyImage(device, depthImage, nullptr);
-	vkFreeMemory(device, depthImageMemory, nullptr);
 
 	for (auto framebuffer : swapChainFramebuffers)
 	{
@@ -154,7 +63,14 @@ VulkanSwapChain::~VulkanSwapChain()
 		vkDestroyImageView(device, imageView, nullptr);
 	}
 
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
+	for (size_t i = 0; i < offscreenImagesMemory.size(); i++)
+	{
+		vkDestroyImage(device, swapChainImages[i], nullptr);
+		VulkanHelper::FreeMemory(device, offscreenImagesMemory[i]);
+	}
+
+	if (swapChain != nullptr)
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
 
 	Logger::Log("Swap chain destroyed");
 }
@@ -189,6 +105,89 @@ VkExtent2D VulkanSwapChain::GetVkExtent2D() const
 	return swapChainExtent;
 }
 
+void VulkanSwapChain::CreateSwapchainKHR(GLFWwindow* window)
+{
+	VkDevice device = VulkanRenderer::GetInstance()->GetLogicalDevice()->GetVk();
+	VkSurfaceKHR surface = VulkanRenderer::GetInstance()->GetVkSurfaceKHR();
+
+	VulkanHelper::SwapChainSupportDetails swapChainSupport = VulkanHelper::QuerySwapChainSupport();
+
+	VkSurfaceFormatKHR surfaceFormat = VulkanHelper::ChooseSwapSurfaceFormat(swapChainSupport.formats);
+	VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
+	VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities, window);
+
+	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
+	{
+		imageCount = swapChainSupport.capabilities.maxImageCount;
+	}
+
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = surface;
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = surfaceFormat.format;
+	createInfo.imageColorSpace = surfaceFormat.colorSpace;
+	createInfo.imageExtent = extent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = presentMode;
+	createInfo.clipped = VK_TRUE;
+
+	VulkanHelper::QueueFamilyIndices indices = VulkanHelper::FindQueueFamilies();
+	uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+
+	if (indices.graphicsFamily != indices.presentFamily)
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
+	{
+		Logger::Log(LogSeverity::FATAL_ERROR, "failed to create swap chain!");
+	}
+
+	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
+	swapChainImages.resize(imageCount);
+	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
+
+	swapChainImageFormat = surfaceFormat.format;
+	swapChainExtent = extent;
+}
+
+void VulkanSwapChain::CreateOffscreenImages()
+{
+	uint32_t imageCount = Setting::Get("HeadlessImageCount", 2);
+	swapChainImageFormat = VulkanHelper::ChooseSwapSurfaceFormat({}).format;
+	swapChainExtent = {Setting::Get("HeadlessWidth", 1600).get<uint32_t>(), Setting::Get("HeadlessHeight", 900).get<uint32_t>()};
+
+	// Copied to a buffer to read the frame back
+	VulkanHelper::CreateTextureParameter imageParameter = {};
+	imageParameter.extent = swapChainExtent;
+	imageParameter.mipLevels = 1;
+	imageParameter.msaaSample = VK_SAMPLE_COUNT_1_BIT;
+	imageParameter.imageFormat = swapChainImageFormat;
+	imageParameter.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageParameter.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageParameter.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	imageParameter.category = MemoryCategory::ATTACHMENT;
+
+	swapChainImages.resize(imageCount);
+	offscreenImagesMemory.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		VulkanHelper::CreateImage(imageParameter, swapChainImages[i], offscreenImagesMemory[i]);
+	}
+}
+
 VkPresentModeKHR VulkanSwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const
 {
 	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
@@ -6,21 +6,16 @@
 class VulkanSwapChain
 {
 private:
-	VkSwapchainKHR swapChain = nullptr;
-	std::vector<VkImage> swapChainImages;
+	VkSwapchainKHR swapChain = nullptr; // Null in headless mode
+	std::vector<VkImage> swapChainImages; // Offscreen images in headless mode
+	std::vector<VkDeviceMemory> offscreenImagesMemory;
 	std::vector<VkImageView> swapChainImageViews;
-	std::vector<VkFramebuffer> swapChainFramebuffers;
+	std::vector<VkFramebuffer> swapChainFramebuffers; // Present render pass
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 
-	VkImage colorImage = nullptr;
-	VkDeviceMemory colorImageMemory = nullptr;
-	VkImageView colorImageView = nullptr;
-	VkImage depthImage = nullptr;
-	VkDeviceMemory depthImageMemory = nullptr;
-	VkImageView depthImageView = nullptr;
-
 public:
+	/// <param name="window">Null to render in offscreen images of the HeadlessWidth and HeadlessHeight settings</param>
 	VulkanSwapChain(GLFWwindow* window);
 	~VulkanSwapChain();
 
@@ -31,6 +26,8 @@ public:
 	VkFormat GetSwapChainImageFormat() const;
 	VkExtent2D GetVkExtent2D() const;
 private:
+	void CreateSwapchainKHR(GLFWwindow* window);
+	void CreateOffscreenImages();
 	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window) const;
 };
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include "Helper/Log.h"
 #include "Rendering/UI/ImguiBase.h"
 #include "SceneModel.h"
+#include "SceneLight.h"
+#include "Rendering/Vulkan/VulkanRenderer.h"
+#include "Helper/Profiler.h"
 
 Scene* Scene::currentScene = nullptr;
 uint64_t Scene::IDCounter = 0;
@@ -102,11 +105,14 @@ void Scene::IncrementIDCounter()
 
 void Scene::Save()
 {
+	PROFILE_FUNCTION();
+
 	using json = nlohmann::json;
 
 	json outScene;
 
 	outScene["Scene"]["IDCounter"] = IDCounter;
+	outScene["Scene"]["DepthPrepass"] = depthPrepass;
 
 	for (auto it = sceneObjects.begin(); it != sceneObjects.end(); it++)
 	{
@@ -126,9 +132,14 @@ void Scene::GUI()
 	ImGui::SameLine();
 	if (ImGui::Button("Add Scene Model"))
 		Add(SceneObject::Create<SceneModel>());
+	ImGui::SameLine();
+	if (ImGui::Button("Add Scene Light"))
+		Add(SceneObject::Create<SceneLight>());
 
 	if (ImGui::Button("Save Scene"))
 		Save();
+	ImGui::SameLine();
+	ImGui::Checkbox("Depth prepass", &depthPrepass);
 
 	for (size_t i = 0; i < GetRootSceneObjectSize(); i++)
 	{
@@ -147,8 +158,13 @@ void Scene::GUI()
 
 void Scene::Update()
 {
+	PROFILE_FUNCTION();
+
 	ClearSceneObjectToRemove();
 
+	if (VulkanRenderer::GetInstance() != nullptr)
+		VulkanRenderer::GetInstance()->depthPrepass = depthPrepass;
+
 	for (size_t i = 0; i < GetRootSceneObjectSize(); i++)
 	{
 		GetRootSceneObject(i)->Update();
@@ -169,6 +185,8 @@ void Scene::ClearSceneObjectToRemove()
 
 void Scene::Load()
 {
+	PROFILE_FUNCTION();
+
 	using json = nlohmann::json;
 
 	std::ifstream input(PATH + name + ".json");
@@ -183,6 +201,7 @@ void Scene::Load()
 	input >> scene;
 
 	IDCounter = scene["Scene"]["IDCounter"];
+	depthPrepass = scene["Scene"].value("DepthPrepass", false);
 
 	for (auto sceneObjectData : scene["Scene"]["SceneObject"])
 	{
@@ -7,10 +7,14 @@ class SceneObject;
 
 class Scene
 {
+public:
+	static const std::string PATH;
+
+	bool depthPrepass = false; // Applied to the renderer while the scene is loaded
+
 private:
 	static Scene* currentScene;
 	static uint64_t IDCounter;
-	static const std::string PATH;
 
 	std::unordered_map<uint64_t, SceneObject*> sceneObjects;
 	std::vector<SceneObject*> sceneObjectAtRoot;
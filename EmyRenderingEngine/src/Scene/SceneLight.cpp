@@ -0,0 +1,64 @@
+#include "Scene/SceneLight.h"
+#include "Rendering/Vulkan/VulkanRenderer.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+nlohmann::json SceneLight::Save()
+{
+	nlohmann::json sceneLight = SceneObject::Save();
+
+	sceneLight["Light"]["Color"] = {color.r, color.g, color.b};
+	sceneLight["Light"]["Intensity"] = intensity;
+	sceneLight["Light"]["Range"] = range;
+	sceneLight["Light"]["Spot"] = spot;
+	sceneLight["Light"]["ConeAngle"] = coneAngle;
+
+	return sceneLight;
+}
+
+std::string SceneLight::GetType()
+{
+	return "SceneLight";
+}
+
+void SceneLight::Update()
+{
+	SceneObject::Update();
+
+	if (VulkanRenderer::GetInstance() == nullptr)
+		return;
+
+	VulkanClusteredLighting* clusteredLighting = VulkanRenderer::GetInstance()->GetClusteredLighting();
+
+	if (spot)
+	{
+		glm::vec3 direction = glm::quat(glm::radians(transform.rotation)) * glm::vec3(0, 0, -1);
+		clusteredLighting->AddLight(VulkanClusteredLighting::CreateSpotLight(transform.position, direction, color, intensity, range, glm::radians(coneAngle)));
+	}
+	else
+		clusteredLighting->AddLight(VulkanClusteredLighting::CreatePointLight(transform.position, color, intensity, range));
+}
+
+void SceneLight::GUI()
+{
+	SceneObject::GUI();
+
+	ImGui::ColorEdit3("Color", &color.x);
+	ImGui::SliderFloat("Intensity", &intensity, 0, 100);
+	ImGui::SliderFloat("Range", &range, 0.1f, 100);
+	ImGui::Checkbox("Spot", &spot);
+	if (spot)
+		ImGui::SliderFloat("Cone angle", &coneAngle, 1, 89);
+}
+
+void SceneLight::Load(nlohmann::json sceneLight)
+{
+	SceneObject::Load(sceneLight);
+
+	nlohmann::json light = sceneLight["Light"];
+	color = glm::vec3(light["Color"][0], light["Color"][1], light["Color"][2]);
+	intensity = light["Intensity"];
+	range = light["Range"];
+	spot = light["Spot"];
+	coneAngle = light["ConeAngle"];
+}
\ No newline at end of file
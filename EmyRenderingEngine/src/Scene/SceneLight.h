@@ -0,0 +1,27 @@
+#pragma once
+#include "SceneObject.h"
+#include <glm/glm.hpp>
+
+/// <summary>
+/// Point or spot light added to the clustered lighting every frame.
+/// Spot lights point along the -z axis of their rotation.
+/// </summary>
+class SceneLight : public SceneObject
+{
+public:
+	glm::vec3 color = glm::vec3(1);
+	float intensity = 10.0f;
+	float range = 10.0f;
+	bool spot = false;
+	float coneAngle = 30.0f; // Half angle in degree
+
+	virtual nlohmann::json Save() override;
+
+	virtual std::string GetType() override;
+
+	virtual void Update() override;
+	virtual void GUI() override;
+
+protected:
+	virtual void Load(nlohmann::json sceneLight) override;
+};
\ No newline at end of file
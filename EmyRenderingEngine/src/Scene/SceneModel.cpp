@@ -3,18 +3,20 @@
 
 SceneModel::~SceneModel()
 {
-	VulkanRenderer::GetInstance()->MarkModelToBeRemove(model.get());
+	if (model != nullptr)
+		VulkanRenderer::GetInstance()->MarkModelToBeRemove(model);
 }
 
 nlohmann::json SceneModel::Save()
 {
 	nlohmann::json sceneModel = SceneObject::Save();
 
-	sceneModel["Model"]["ModelSaved"] = model.get() != nullptr;
+	sceneModel["Model"]["ModelSaved"] = model != nullptr;
 	if (model)
 	{
 		sceneModel["Model"]["Mesh"] = model->meshName;
 		sceneModel["Model"]["Texture"] = model->textureName;
+		sceneModel["Model"]["Static"] = model->isStatic;
 	}
 
 	return sceneModel;
@@ -48,9 +50,22 @@ void SceneModel::GUI()
 	if (ImGui::Button(buttonText.c_str()))
 	{
 		if (model != nullptr)
-			VulkanRenderer::GetInstance()->MarkModelToBeRemove(model.get());
+			VulkanRenderer::GetInstance()->MarkModelToBeRemove(model);
+
+		model = VulkanRenderer::GetInstance()->BasicLoadModel(std::string(meshToLoadInput), std::string(textureToLoadInput), glm::vec3(0), glm::vec3(0), glm::vec3(1));
+	}
+
+	if (model != nullptr)
+	{
+		uint32_t lod = model->GetCurrentLod();
+		uint32_t fullTriangleCount = model->mesh->GetTriangleCount(0);
+		uint32_t triangleCount = model->mesh->GetTriangleCount(lod);
+		float saving = fullTriangleCount > 0 ? 100.0f * (1.0f - static_cast<float>(triangleCount) / fullTriangleCount) : 0;
 
-		model.reset(VulkanRenderer::GetInstance()->BasicLoadModel(std::string(meshToLoadInput), std::string(textureToLoadInput), glm::vec3(0), glm::vec3(0), glm::vec3(1)));
+		ImGui::Text("Lod: %u/%u", lod, model->mesh->GetLodCount() - 1);
+		ImGui::Text("Triangles: %u/%u (%.0f%% saved)", triangleCount, fullTriangleCount, saving);
+		ImGui::Checkbox("Occluder", &model->occluder);
+		ImGui::Checkbox("Static", &model->isStatic);
 	}
 }
 
@@ -59,5 +74,8 @@ void SceneModel::Load(nlohmann::json sceneModel)
 	SceneObject::Load(sceneModel);
 
 	if (sceneModel["Model"]["ModelSaved"])
-		model.reset(VulkanRenderer::GetInstance()->BasicLoadModel(sceneModel["Model"]["Mesh"], sceneModel["Model"]["Texture"], transform.position, transform.rotation, transform.scale));
+	{
+		model = VulkanRenderer::GetInstance()->BasicLoadModel(sceneModel["Model"]["Mesh"], sceneModel["Model"]["Texture"], transform.position, transform.rotation, transform.scale);
+		model->isStatic = sceneModel["Model"].value("Static", true);
+	}
 }
@@ -6,7 +6,7 @@
 class SceneModel : public SceneObject
 {
 private:
-	std::shared_ptr<Model> model = nullptr;
+	Model* model = nullptr; // Owned by the draw list of the renderer
 
 	std::string meshToLoadInput;
 	std::string textureToLoadInput;
@@ -1,6 +1,8 @@
 #include "SceneObject.h"
 #include "SceneModel.h"
+#include "SceneLight.h"
 #include "Scene.h"
+#include "Helper/PerfCounters.h"
 
 bool SceneObject::isBeingCreated = false;
 
@@ -98,6 +100,7 @@ void SceneObject::GUI()
 
 void SceneObject::Update()
 {
+	PerfCounters::Add(PerfCounter::SCENE_OBJECTS_UPDATED);
 }
 
 SceneObject* SceneObject::LoadByType(nlohmann::json data)
@@ -112,6 +115,8 @@ SceneObject* SceneObject::LoadByType(nlohmann::json data)
 		returnObject = new SceneObject();
 	else if (type == "SceneModel")
 		returnObject = new SceneModel();
+	else if (type == "SceneLight")
+		returnObject = new SceneLight();
 
 	isBeingCreated = false;
 
@@ -4,6 +4,42 @@
 layout(binding = 1) uniform sampler2D texSampler;
 layout(binding = 2) uniform sampler2D normalSampler;
 
+#define MAX_LIGHTS_PER_CLUSTER 128 // VulkanClusteredLighting::MAX_LIGHTS_PER_CLUSTER
+#define MAX_CASCADES 4 // VulkanCascadedShadows::MAX_CASCADES
+
+struct Light
+{
+	vec4 positionRange; // xyz position in world space, w range
+	vec4 colorIntensity; // rgb color, w intensity
+	vec4 spotDirection; // xyz direction, w cosine of the cone half angle, -1 for point lights
+};
+
+layout(set = 1, binding = 0) uniform ClusterInfo {
+	mat4 view;
+	mat4 inverseProjection;
+	uvec4 gridSize; // xyz cluster count, w light count
+	vec4 screenSizeNearFar;
+} clusterInfo;
+
+layout(std430, set = 1, binding = 1) readonly buffer Lights {
+	Light lights[];
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer ClusterLightCounts {
+	uint clusterLightCounts[];
+};
+
+layout(std430, set = 1, binding = 3) readonly buffer ClusterLightIndices {
+	uint clusterLightIndices[];
+};
+
+layout(set = 2, binding = 0) uniform ShadowInfo {
+	mat4 lightViewProjection[MAX_CASCADES];
+	uvec4 cascadeCount; // x cascade count, 0 when the shadows are disabled
+} shadowInfo;
+
+layout(set = 2, binding = 1) uniform sampler2DArrayShadow shadowMap;
+
 layout(location = 0) in vec3 fragNormal; // contain in TBN
 layout(location = 1) in vec3 fragVertexColor;
 layout(location = 2) in vec2 fragTexCoord;
@@ -45,6 +81,69 @@ vec3 directional_light(vec3 normal, vec3 lightColor, vec3 surface, vec3 lightDir
   return max(lightColor * diffuse * surface, vec3(0.0));
 }
 
+vec3 local_light(Light light, vec3 normal, vec3 surface, vec3 position)
+{
+  vec3 toLight = light.positionRange.xyz - position;
+  float distance = length(toLight);
+  vec3 direction = toLight / max(distance, 0.0001);
+
+  // Smooth falloff reaching 0 at the range
+  float falloff = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+  float attenuation = falloff * falloff / (distance * distance + 1.0);
+
+  if (light.spotDirection.w > -1.0)
+  {
+    float cosAngle = dot(-direction, light.spotDirection.xyz);
+    attenuation *= smoothstep(light.spotDirection.w, mix(light.spotDirection.w, 1.0, 0.2), cosAngle);
+  }
+
+  float diffuse = max(dot(normal, direction), 0.0);
+
+  return light.colorIntensity.rgb * light.colorIntensity.w * diffuse * attenuation * surface;
+}
+
+float directional_shadow(vec3 position)
+{
+  // Cascades go from the nearest to the farthest, the first one containing the fragment is the sharpest
+  for (uint cascade = 0; cascade < shadowInfo.cascadeCount.x; cascade++)
+  {
+    vec4 lightPosition = shadowInfo.lightViewProjection[cascade] * vec4(position, 1.0);
+    vec3 coord = vec3(lightPosition.xy * 0.5 + 0.5, lightPosition.z);
+
+    if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0))))
+      continue;
+
+    // 3x3 taps of the filtered comparison
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+    {
+      for (int y = -1; y <= 1; y++)
+        lit += texture(shadowMap, vec4(coord.xy + vec2(x, y) * texelSize, float(cascade), coord.z));
+    }
+
+    return lit / 9.0;
+  }
+
+  return 1.0;
+}
+
+uint cluster_index()
+{
+  uvec3 gridSize = clusterInfo.gridSize.xyz;
+  float nearPlane = clusterInfo.screenSizeNearFar.z;
+  float farPlane = clusterInfo.screenSizeNearFar.w;
+
+  float depth = -(clusterInfo.view * vec4(fragPos, 1.0)).z;
+  uint slice = uint(max(log(depth / nearPlane) / log(farPlane / nearPlane) * float(gridSize.z), 0.0));
+  uvec2 tile = uvec2(gl_FragCoord.xy / clusterInfo.screenSizeNearFar.xy * vec2(gridSize.xy));
+
+  tile = min(tile, gridSize.xy - 1u);
+  slice = min(slice, gridSize.z - 1u);
+
+  return tile.x + gridSize.x * (tile.y + gridSize.y * slice);
+}
+
 void main()
 {
 	vec3 textureNormal = texture(normalSampler, fragTexCoord).rgb;
@@ -63,5 +162,13 @@ void main()
 	float shininess = lightSetting.x; // Set to lower values for matte, higher for gloss.
 	float specularity = lightSetting.y; //  The amount by which to scale the specular light cast on the object.
 
-	outColor = vec4(directional_light(TBN[2], lightColor, textureColor.rgb, lightDir, modelMatrix, viewMatrix, viewPosition), 1.0);
+	vec3 color = directional_light(TBN[2], lightColor, textureColor.rgb, lightDir, modelMatrix, viewMatrix, viewPosition) * directional_shadow(fragPos);
+
+	// Only the lights touching the cluster of the fragment
+	uint cluster = cluster_index();
+	uint clusterLightCount = clusterLightCounts[cluster];
+	for (uint i = 0; i < clusterLightCount; i++)
+		color += local_light(lights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]], TBN[2], textureColor.rgb, fragPos);
+
+	outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -33,6 +33,9 @@ layout(location = 16) out vec3 fragPos;
 layout(location = 17) out vec2 lightSetting;
 layout(location = 18) out vec3 lightColor;
 
+// Same depth as DepthPrepass.vert so the EQUAL depth test pass after the prepass
+invariant gl_Position;
+
 
 void main()
 {
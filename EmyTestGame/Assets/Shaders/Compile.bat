@@ -1,6 +1,15 @@
 C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V Base.vert -o "BaseVert.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V DepthPrepass.vert -o "DepthPrepassVert.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V ShadowDepth.vert -o "ShadowDepthVert.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V Upscale.vert -o "UpscaleVert.spv"
 C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V Base.frag -o "BaseFrag.spv"
 C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V TextureColor.frag -o "TextureColorFrag.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V Upscale.frag -o "UpscaleFrag.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V DepthResolve.frag -o "DepthResolveFrag.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V MeshletCull.comp -o "MeshletCullComp.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V HiZBuild.comp -o "HiZBuildComp.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V OcclusionTest.comp -o "OcclusionTestComp.spv"
+C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -V ClusterBuild.comp -o "ClusterBuildComp.spv"
 
 C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -G TutoGL.vert -o "TutoGLVert.spv"
 C:/VulkanSDK/1.2.141.2/Bin/glslangValidator.exe -G TutoGL.frag -o "TutoGLFrag.spv"
@@ -0,0 +1,24 @@
+#version 460 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+	vec3 viewPos;
+	vec3 lightDir;
+	vec2 lightSetting;
+	vec3 lightColor;
+} ubo;
+
+// In
+layout(location = 0) in vec3 inPosition;
+
+// Must match Base.vert
+invariant gl_Position;
+
+void main()
+{
+	vec4 vertexPosition = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = vertexPosition;
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 460 core
+#extension GL_ARB_separate_shader_objects : enable
+
+// Second subpass of the first phase of the occlusion culling, the samples of the depth never leave the tile memory
+layout(input_attachment_index = 0, binding = 0) uniform subpassInputMS depth;
+
+layout(push_constant) uniform ResolveInfo {
+	int sampleCount;
+} resolveInfo;
+
+void main()
+{
+	// Farthest sample so a partly covered pixel never occlude
+	float farthest = 0.0;
+	for (int i = 0; i < resolveInfo.sampleCount; i++)
+		farthest = max(farthest, subpassLoad(depth, i).r);
+
+	gl_FragDepth = farthest;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 460 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+	vec3 viewPos;
+	vec3 lightDir;
+	vec2 lightSetting;
+	vec3 lightColor;
+} ubo;
+
+// Cascade being rendered, VulkanCascadedShadows::CmdDrawCasters
+layout(push_constant) uniform Cascade {
+	mat4 lightViewProjection;
+} cascade;
+
+// In
+layout(location = 0) in vec3 inPosition;
+
+void main()
+{
+	gl_Position = cascade.lightViewProjection * ubo.model * vec4(inPosition, 1.0);
+}
\ No newline at end of file
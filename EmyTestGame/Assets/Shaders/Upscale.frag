@@ -0,0 +1,57 @@
+#version 460 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform sampler2D sceneColor;
+
+layout(push_constant) uniform UpscaleInfo {
+	vec2 renderSize; // Top left area of the scene color rendered this frame, in texel
+	vec2 textureSize;
+} upscaleInfo;
+
+// In
+layout(location = 0) in vec2 fragUv;
+
+// Out
+layout(location = 0) out vec4 outColor;
+
+vec3 SampleScene(vec2 texel)
+{
+	// Kept inside the rendered area so the texels outside never bleed on the edges
+	texel = clamp(texel, vec2(0.5), upscaleInfo.renderSize - 0.5);
+	return textureLod(sceneColor, texel / upscaleInfo.textureSize, 0.0).rgb;
+}
+
+void main()
+{
+	// Catmull-Rom filter, the 4x4 texels around the position are read with 9 bilinear taps
+	// by merging the weights of the 2 middle texels of each axis
+	vec2 position = fragUv * upscaleInfo.renderSize;
+	vec2 center = floor(position - 0.5) + 0.5;
+	vec2 f = position - center;
+
+	vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+	vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+	vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+	vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+	vec2 w12 = w1 + w2;
+	vec2 texel0 = center - 1.0;
+	vec2 texel12 = center + w2 / w12;
+	vec2 texel3 = center + 2.0;
+
+	vec3 color = vec3(0.0);
+	color += SampleScene(vec2(texel0.x, texel0.y)) * w0.x * w0.y;
+	color += SampleScene(vec2(texel12.x, texel0.y)) * w12.x * w0.y;
+	color += SampleScene(vec2(texel3.x, texel0.y)) * w3.x * w0.y;
+
+	color += SampleScene(vec2(texel0.x, texel12.y)) * w0.x * w12.y;
+	color += SampleScene(vec2(texel12.x, texel12.y)) * w12.x * w12.y;
+	color += SampleScene(vec2(texel3.x, texel12.y)) * w3.x * w12.y;
+
+	color += SampleScene(vec2(texel0.x, texel3.y)) * w0.x * w3.y;
+	color += SampleScene(vec2(texel12.x, texel3.y)) * w12.x * w3.y;
+	color += SampleScene(vec2(texel3.x, texel3.y)) * w3.x * w3.y;
+
+	// The negative lobes can ring below zero on sharp edges
+	outColor = vec4(max(color, vec3(0.0)), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 460 core
+#extension GL_ARB_separate_shader_objects : enable
+
+// Out
+layout(location = 0) out vec2 fragUv;
+
+void main()
+{
+	// Triangle covering the screen made from the vertex index, no vertex buffer
+	fragUv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(fragUv * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
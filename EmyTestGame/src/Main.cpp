@@ -3,9 +3,12 @@
 
 #include <Rendering/GlfwManager.h>
 #include <Rendering/Vulkan/VulkanRenderer.h>
+#include <Rendering/Vulkan/VulkanFrameCapture.h>
 #include <Rendering/OpenGL/OpenGLRenderer.h>  
 
 #include <Helper/FPSCounter.h>
+#include <Helper/Profiler.h>
+#include <Helper/PerfCounters.h>
 #include <glm/gtx/rotate_vector.hpp>
 #include <json.hpp>
 #include <fstream>
@@ -13,11 +16,13 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <Scene/Scene.h>
 #include "Rendering/UI/ImguiBase.h"
+#include "Rendering/UI/ProfilerWindow.h"
 #include "Imgui/imgui_internal.h"
 #include <filesystem>
 #include "Asset/AssetManager.h"
 #include <Game/Setting.h>
 #include <memory>
+#include <cmath>
 
 float camSpeed = 5;
 float lookSpeed = 0.5f;
@@ -30,9 +35,40 @@ bool demoWindowOpen = false;
 bool settingWindowOpen = false;
 bool hierarchyWindowOpen = true;
 bool statWindowOpen = false;
+bool memoryWindowOpen = false;
+
+int stressLightCount = 0;
+float stressLightSpacing = 2.0f;
+
+// Lights circling over a grid, used to measure the clustered lighting under load
+void SubmitStressLights()
+{
+	if (stressLightCount <= 0 || VulkanRenderer::GetInstance() == nullptr)
+		return;
+
+	VulkanClusteredLighting* clusteredLighting = VulkanRenderer::GetInstance()->GetClusteredLighting();
+	float time = static_cast<float>(glfwGetTime());
+	int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(stressLightCount))));
+
+	for (int i = 0; i < stressLightCount; i++)
+	{
+		float phase = time + i;
+		glm::vec2 cell = (glm::vec2(i % side, i / side) - glm::vec2(side * 0.5f)) * stressLightSpacing;
+		glm::vec3 position = glm::vec3(cell + glm::vec2(glm::cos(phase), glm::sin(phase)) * stressLightSpacing * 0.25f, 1.0f);
+		glm::vec3 color = glm::vec3(0.5f) + 0.5f * glm::cos(glm::vec3(0, 2, 4) + static_cast<float>(i));
+
+		// One light out of four is a spot pointing down
+		if (i % 4 == 0)
+			clusteredLighting->AddLight(VulkanClusteredLighting::CreateSpotLight(position + glm::vec3(0, 0, 2), glm::vec3(0, 0, -1), color, 20.0f, stressLightSpacing * 3.0f, glm::radians(35.0f)));
+		else
+			clusteredLighting->AddLight(VulkanClusteredLighting::CreatePointLight(position, color, 20.0f, stressLightSpacing * 2.0f));
+	}
+}
 
 void GUI()
 {
+	PROFILE_FUNCTION();
+
 	if (demoWindowOpen)
 	{
 		ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
@@ -47,6 +83,10 @@ void GUI()
 				settingWindowOpen = true;
 			if (ImGui::MenuItem("Stat"))
 				statWindowOpen = true;
+			if (ImGui::MenuItem("GPU Memory"))
+				memoryWindowOpen = true;
+			if (ImGui::MenuItem("Profiler"))
+				ProfilerWindow::windowOpen = true;
 			if (ImGui::MenuItem("Demo"))
 				demoWindowOpen = true;
 			if (ImGui::MenuItem("Scene"))
@@ -77,6 +117,37 @@ void GUI()
 
 				//ImGui::ColorEdit3("Light color", &vulkanManager->lightColor.x);
 			}
+
+			if (VulkanRenderer::GetInstance() != nullptr && ImGui::CollapsingHeader("Lod"))
+			{
+				ImGui::SliderFloat("Max pixel error", &VulkanRenderer::GetInstance()->lodPixelError, 0.1f, 10);
+				ImGui::SliderFloat("Hysteresis", &VulkanRenderer::GetInstance()->lodHysteresis, 0, 0.5f);
+			}
+
+			if (VulkanRenderer::GetInstance() != nullptr && ImGui::CollapsingHeader("Culling"))
+			{
+				ImGui::Checkbox("Meshlet culling", &VulkanRenderer::GetInstance()->meshletCulling);
+				ImGui::Checkbox("Occlusion culling", &VulkanRenderer::GetInstance()->occlusionCulling);
+				ImGui::Checkbox("Software occlusion culling", &VulkanRenderer::GetInstance()->softwareOcclusionCulling);
+			}
+
+			if (VulkanRenderer::GetInstance() != nullptr && ImGui::CollapsingHeader("Lighting"))
+			{
+				ImGui::SliderInt("Stress lights", &stressLightCount, 0, static_cast<int>(VulkanRenderer::GetInstance()->GetClusteredLighting()->GetMaxLights()));
+				ImGui::SliderFloat("Stress light spacing", &stressLightSpacing, 0.5f, 10);
+				ImGui::Checkbox("Shadows", &VulkanRenderer::GetInstance()->shadows);
+			}
+
+			if (VulkanRenderer::GetInstance() != nullptr && ImGui::CollapsingHeader("Resolution"))
+			{
+				VulkanDynamicResolution* dynamicResolution = VulkanRenderer::GetInstance()->GetDynamicResolution();
+				bool enabled = dynamicResolution->IsEnabled();
+				float budget = dynamicResolution->GetBudget();
+				if (ImGui::Checkbox("Dynamic resolution", &enabled))
+					dynamicResolution->SetEnabled(enabled);
+				if (ImGui::SliderFloat("Scene budget (ms)", &budget, 1, 50))
+					dynamicResolution->SetBudget(budget);
+			}
 		}
 		ImGui::End();
 	}
@@ -120,11 +191,178 @@ void GUI()
 
 			ImGui::Text(("FPS: " + std::to_string(FPSCounter::GetRawFPS())).c_str());
 			ImGui::Text(ss.str().c_str());
+
+			if (ImGui::CollapsingHeader("Frame times", ImGuiTreeNodeFlags_DefaultOpen))
+			{
+				FPSCounter::FrameTimeStats frameStats = FPSCounter::GetFrameTimeStats();
+				ImGui::Text("Frames: %u, average: %.2f ms (%.1f FPS)", frameStats.sampleCount, frameStats.average, frameStats.average > 0 ? 1000.0f / frameStats.average : 0.0f);
+				ImGui::Text("p50: %.2f ms, p95: %.2f ms, p99: %.2f ms, max: %.2f ms", frameStats.p50, frameStats.p95, frameStats.p99, frameStats.max);
+				ImGui::Text("1%% low: %.1f FPS, spikes: %u (last %.2f ms)", frameStats.onePercentLowFPS, FPSCounter::GetSpikeCount(), FPSCounter::GetLastSpikeTime());
+
+				std::vector<float> frameTimes = FPSCounter::GetFrameTimes(512);
+				ImGui::PlotLines("Frame time (ms)", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr, 0.0f, std::max(frameStats.p99 * 1.5f, 1.0f), ImVec2(0, 80));
+
+				// 1 ms bins up to 50 ms, the last one also has the slower frames
+				std::vector<float> histogram = FPSCounter::GetFrameTimeHistogram(50, 1.0f);
+				ImGui::PlotHistogram("Histogram (1 ms bins)", histogram.data(), static_cast<int>(histogram.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+
+				if (ImGui::Button("Reset frame times"))
+					FPSCounter::Reset();
+				ImGui::SameLine();
+				if (ImGui::Button("Export frame times"))
+					FPSCounter::ExportCsv("FrameTimes.csv");
+			}
+
+			if (ImGui::CollapsingHeader("Counters"))
+			{
+				ImGui::Text("Last frame, average and max over %u frames", static_cast<uint32_t>(std::min<uint64_t>(PerfCounters::GetFrameCount(), PerfCounters::HISTORY_CAPACITY)));
+				for (size_t i = 0; i < PerfCounters::COUNTER_COUNT; i++)
+				{
+					PerfCounter counter = static_cast<PerfCounter>(i);
+					PerfCounters::Stats stats = PerfCounters::GetStats(counter);
+					ImGui::Text("%s: %llu (average %.1f, max %llu)", PerfCounters::GetName(counter), stats.last, stats.average, stats.max);
+				}
+
+				std::vector<uint64_t> drawCalls = PerfCounters::GetHistory(PerfCounter::DRAW_CALLS, 512);
+				std::vector<float> drawCallPlot(drawCalls.begin(), drawCalls.end());
+				ImGui::PlotLines("Draw calls", drawCallPlot.data(), static_cast<int>(drawCallPlot.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+
+				if (ImGui::Button("Reset counters"))
+					PerfCounters::Reset();
+				ImGui::SameLine();
+				if (ImGui::Button("Export counters"))
+					PerfCounters::ExportJson("Counters.json");
+			}
+
+			if (ImGui::Button("Export CPU trace"))
+				Profiler::ExportChromeTrace("Trace.json");
+
+			if (VulkanRenderer::GetInstance() != nullptr)
+			{
+				const SoftwareOcclusion* softwareOcclusion = VulkanRenderer::GetInstance()->GetSoftwareOcclusion();
+
+				ImGui::Text(("Occluded models: " + std::to_string(VulkanRenderer::GetInstance()->GetOccludedModelCount())).c_str());
+				ImGui::Text("Software occluded models: %u (%u occluder triangles, %s)", VulkanRenderer::GetInstance()->GetSoftwareOccludedModelCount(), softwareOcclusion->GetTriangleCount(), softwareOcclusion->IsUsingAvx2() ? "AVX2" : "scalar");
+
+				uint64_t fragments = VulkanRenderer::GetInstance()->GetFragmentInvocations(false);
+				uint64_t prepassFragments = VulkanRenderer::GetInstance()->GetFragmentInvocations(true);
+				ImGui::Text("Fragments: %llu, with depth prepass: %llu", fragments, prepassFragments);
+				if (fragments > 0 && prepassFragments > 0)
+					ImGui::Text("Depth prepass fragment savings: %.1f%%", 100.0 * (1.0 - static_cast<double>(prepassFragments) / fragments));
+
+				const VulkanClusteredLighting* clusteredLighting = VulkanRenderer::GetInstance()->GetClusteredLighting();
+				ImGui::Text("Lights: %u, cluster build: %.3f ms (%s queue)", clusteredLighting->GetLightCount(), clusteredLighting->GetClusterBuildTime(), VulkanRenderer::GetInstance()->IsAsyncCompute() ? "compute" : "graphics");
+
+				const VulkanCascadedShadows* cascadedShadows = VulkanRenderer::GetInstance()->GetCascadedShadows();
+				ImGui::Text("Shadow cascades: %u (cached from %u), cache redraws: %u", cascadedShadows->GetCascadeCount(), cascadedShadows->GetFirstCachedCascade(), cascadedShadows->GetCacheRedrawCount());
+
+				const VulkanRenderGraph* renderGraph = VulkanRenderer::GetInstance()->GetRenderGraph();
+				ImGui::Text("Render graph: %u passes (%u culled), %u barriers, transient %.1f MB (%.1f MB without aliasing)", renderGraph->GetPassCount(), renderGraph->GetCulledPassCount(), renderGraph->GetBarrierCount(), renderGraph->GetTransientMemorySize() / (1024.0 * 1024.0), renderGraph->GetTransientRequestedSize() / (1024.0 * 1024.0));
+
+				const VulkanDynamicResolution* dynamicResolution = VulkanRenderer::GetInstance()->GetDynamicResolution();
+				ImGui::Text("Render resolution: %ux%u (%.0f%%), scene: %.2f ms / %.2f ms", dynamicResolution->GetRenderExtent().width, dynamicResolution->GetRenderExtent().height, dynamicResolution->GetScale() * 100.0f, dynamicResolution->GetSceneTime(), dynamicResolution->GetBudget());
+
+				const TextureStreamer* textureStreamer = VulkanRenderer::GetInstance()->GetTextureStreamer();
+				if (textureStreamer != nullptr)
+					ImGui::Text("Textures: %u, %.1f / %.1f MB, streaming: %u, evictions: %u", textureStreamer->GetTextureCount(), textureStreamer->GetUsedBytes() / (1024.0 * 1024.0), textureStreamer->GetBudget() / (1024.0 * 1024.0), textureStreamer->GetPendingCount(), textureStreamer->GetEvictionCount());
+
+				const VulkanGpuProfiler* gpuProfiler = VulkanRenderer::GetInstance()->GetGpuProfiler();
+				if (gpuProfiler->IsEnabled() && ImGui::CollapsingHeader("GPU passes"))
+				{
+					ImGui::Text("GPU frame: %.2f ms (average %.2f ms)", gpuProfiler->GetFrameTime(), gpuProfiler->GetAverageFrameTime());
+					for (const VulkanGpuProfiler::PassTiming& pass : gpuProfiler->GetPasses())
+					{
+						if (gpuProfiler->HasPipelineStatistics())
+							ImGui::Text("%s: %.3f ms (average %.3f ms), vertices: %llu, fragments: %llu", pass.name.c_str(), pass.time, pass.averageTime, pass.vertexInvocations, pass.fragmentInvocations);
+						else
+							ImGui::Text("%s: %.3f ms (average %.3f ms)", pass.name.c_str(), pass.time, pass.averageTime);
+					}
+
+					// Draws of each pipeline inside the passes, they can overlap on the GPU
+					for (const VulkanGpuProfiler::BucketTiming& bucket : gpuProfiler->GetBuckets())
+						ImGui::Text("  %s / %s: %.3f ms (average %.3f ms)", bucket.pass.c_str(), bucket.name.c_str(), bucket.time, bucket.averageTime);
+
+					if (ImGui::Button("Export GPU timings"))
+						gpuProfiler->ExportCsv("GpuProfile.csv");
+				}
+
+				// Replayed with EmyBenchmark BenchmarkReplay=FrameCapture.cbor
+				if (ImGui::Button("Capture frame"))
+					VulkanFrameCapture::Capture(VulkanRenderer::GetInstance())->Save("FrameCapture.cbor");
+			}
+		}
+		ImGui::End();
+	}
+
+	if (memoryWindowOpen && VulkanRenderer::GetInstance() != nullptr)
+	{
+		if (ImGui::Begin("GPU Memory", &memoryWindowOpen))
+		{
+			const VulkanMemoryTracker* memoryTracker = VulkanRenderer::GetInstance()->GetMemoryTracker();
+			const double MB = 1024.0 * 1024.0;
+
+			ImGui::Text("Budget source: %s", memoryTracker->IsMemoryBudgetSupported() ? "VK_EXT_memory_budget" : "tracked allocations");
+
+			const std::vector<VulkanMemoryTracker::HeapInfo>& heaps = memoryTracker->GetHeaps();
+			for (size_t i = 0; i < heaps.size(); i++)
+			{
+				const VulkanMemoryTracker::HeapInfo& heap = heaps[i];
+				ImGui::Text("Heap %zu%s: %.1f / %.1f MB (tracked %.1f MB, size %.1f MB)", i, heap.deviceLocal ? " (device local)" : "", heap.usage / MB, heap.budget / MB, heap.tracked / MB, heap.size / MB);
+				ImGui::ProgressBar(heap.budget > 0 ? static_cast<float>(static_cast<double>(heap.usage) / heap.budget) : 0.0f);
+			}
+
+			ImGui::Separator();
+			for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::COUNT); i++)
+			{
+				MemoryCategory category = static_cast<MemoryCategory>(i);
+				ImGui::Text("%s: %.2f MB in %u allocations", VulkanMemoryTracker::GetCategoryName(category), memoryTracker->GetCategoryUsage(category) / MB, memoryTracker->GetCategoryAllocationCount(category));
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Evictions under pressure: %u", memoryTracker->GetEvictionCount());
 		}
 		ImGui::End();
 	}
 
 	AssetManager::GUI();
+	ProfilerWindow::GUI();
+}
+
+// Render a fixed count of frames offscreen then save the last one, for the machines without display
+void RunHeadless()
+{
+	std::unique_ptr<VulkanRenderer> renderer = std::unique_ptr<VulkanRenderer>(new VulkanRenderer(nullptr));
+
+	std::string sceneName = Setting::Get("HeadlessScene", "").get<std::string>();
+	if (!sceneName.empty())
+		new Scene(sceneName);
+
+	uint32_t frameCount = Setting::Get("HeadlessFrames", 100);
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		PROFILE_FRAME();
+		PROFILE_SCOPE("Frame");
+		FPSCounter::StartCounting();
+
+		if (Scene::GetCurrentScene() != nullptr)
+			Scene::GetCurrentScene()->Update();
+		SubmitStressLights();
+
+		renderer->Present(nullptr);
+
+		FPSCounter::StopCounting();
+	}
+
+	renderer->WaitForIdle();
+
+	FPSCounter::FrameTimeStats frameStats = FPSCounter::GetFrameTimeStats();
+	std::stringstream ss;
+	ss << "Headless frames: " << frameStats.sampleCount << ", p50: " << frameStats.p50 << " ms, p99: " << frameStats.p99 << " ms, max: " << frameStats.max << " ms";
+	Logger::Log(ss.str());
+
+	std::string output = Setting::Get("HeadlessOutput", "Headless.png").get<std::string>();
+	if (!output.empty())
+		renderer->SaveFrame(output);
 }
 
 #if CONSOLE
@@ -136,9 +374,18 @@ int WinMain()
 	try
 	{
 		Logger::Open();
+		PROFILE_THREAD("Main");
 		Setting::Load();
+		FPSCounter::SetSpikeFactor(Setting::Get("FrameSpikeFactor", 2.0f));
 		AssetManager::Init();
 
+		// No window nor GLFW, only Vulkan can render headless
+		if (Setting::Get("Headless", false))
+		{
+			RunHeadless();
+			return 0;
+		}
+
 		GlfwManager glfwManager = GlfwManager(1600, 900, "TestGame");
 
 		std::unique_ptr<Renderer> renderer = Renderer::CreateGraphicalAPI(Setting::Get("GraphicAPI", GraphicalAPI::OPENGL).get<GraphicalAPI>(), glfwManager.GetWindow());
@@ -149,6 +396,8 @@ int WinMain()
 
 		while (!glfwWindowShouldClose(glfwManager.GetWindow()))
 		{
+			PROFILE_FRAME();
+			PROFILE_SCOPE("Frame");
 			FPSCounter::StartCounting();
 			glfwPollEvents();
 
@@ -205,6 +454,7 @@ int WinMain()
 
 			if (Scene::GetCurrentScene() != nullptr)
 				Scene::GetCurrentScene()->Update();
+			SubmitStressLights();
 
 			GUI();
 